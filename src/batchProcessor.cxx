@@ -0,0 +1,576 @@
+/****************************************************************************
+*   batchProcessor.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the headless batch mode.
+****************************************************************************/
+
+#include "batchProcessor.hxx"
+#include "metricsCore.hxx"
+#include "stageTrace.hxx"
+#include "streamingStatistics.hxx"
+#include "filterBank.hxx"
+#include "intensityHistogram.hxx"
+#include "myBrickVolumeReader.hxx"
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <vtkInformation.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+static bool endsWith( const std::string& text, const std::string& suffix )
+{
+    return text.size() >= suffix.size() && text.compare( text.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+static std::string csvField( const std::string& text )
+{
+    if ( text.find_first_of( ",\"\n" ) == std::string::npos )
+    {
+        return text;
+    }
+
+    std::string quoted = "\"";
+    for ( std::size_t i = 0; i < text.size(); i++ )
+    {
+        quoted += ( text[i] == '"' ) ? "\"\"" : std::string( 1, text[i] );
+    }
+
+    return quoted + "\"";
+}
+
+BatchResult::BatchResult()
+    : input( "" ), success( false ), error( "" ), seconds( 0.0 )
+{
+}
+
+BatchProcessor::BatchProcessor( const ProgramOptions& programOptions )
+    : options( programOptions ), cache( programOptions ), json( endsWith( vtksys::SystemTools::LowerCase( programOptions.outputFile ), ".json" ) ),
+      sweep( !programOptions.sweepThresholds.empty() ), regionMode( programOptions.usesRegionSNR() )
+{
+    imageNames.push_back( "original" );
+    for ( std::size_t i = 0; i < options.filters.size(); i++ )
+    {
+        imageNames.push_back( options.filters[i].id );
+    }
+}
+
+void BatchProcessor::addInput( const std::string& input )
+{
+    inputs.push_back( input );
+}
+
+bool BatchProcessor::addInputs( const std::string& path )
+{
+    std::size_t previousCount = inputs.size();
+
+    if ( vtksys::SystemTools::FileIsDirectory( path ) )
+    {
+        vtksys::Directory directory;
+        if ( !directory.Load( path ) )
+        {
+            std::cerr << "ERROR: Cannot list the directory " << path << "\n";
+            return false;
+        }
+
+        std::vector<std::string> found;
+        bool hasOtherFiles = false;
+
+        for ( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+        {
+            std::string name = directory.GetFile( i );
+            if ( name == "." || name == ".." )
+            {
+                continue;
+            }
+
+            std::string fullPath = path + "/" + name;
+            if ( classifyInput( fullPath ) >= 0 )
+            {
+                found.push_back( fullPath );
+            }
+            else
+            {
+                hasOtherFiles = true;
+            }
+        }
+
+        // A directory with only plain files is a single DICOM series
+        if ( found.empty() && hasOtherFiles )
+        {
+            found.push_back( path );
+        }
+
+        std::sort( found.begin(), found.end() );
+        inputs.insert( inputs.end(), found.begin(), found.end() );
+    }
+    else
+    {
+        std::ifstream list( path.c_str() );
+        if ( !list )
+        {
+            std::cerr << "ERROR: Cannot open the batch list " << path << "\n";
+            return false;
+        }
+
+        std::string line;
+        while ( std::getline( list, line ) )
+        {
+            line = line.substr( 0, line.find( '#' ) );
+            line.erase( 0, line.find_first_not_of( " \t\r" ) );
+            line.erase( line.find_last_not_of( " \t\r" ) + 1 );
+
+            if ( !line.empty() )
+            {
+                inputs.push_back( line );
+            }
+        }
+    }
+
+    if ( inputs.size() == previousCount )
+    {
+        std::cerr << "ERROR: No studies were found in " << path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void BatchProcessor::processStudy( BatchResult& result, int threadsPerStudy ) const
+{
+    bool streaming = options.streamSlabSize > 0;
+    int imageCount = static_cast<int>( imageNames.size() );
+
+    // Original and filtered images, unless streaming
+    std::vector< vtkSmartPointer<vtkImageData> > images;
+    bool cacheHit = !streaming && cache.load( result.input, images );
+
+    vtkSmartPointer<vtkImageReader2> reader;
+
+    int extent[6];
+
+    if ( !streaming && !cacheHit )
+    {
+        // Read and filter through the core library, within the memory budget of a study
+        MetricsCore core;
+        core.setNumberOfThreads( threadsPerStudy );
+        core.setMemoryBudgetMB( options.memoryBudgetMB );
+        core.setFilters( options.filters );
+
+        if ( !core.load( result.input ) || !core.filter() )
+        {
+            result.error = core.getError();
+            return;
+        }
+
+        images = core.getFilteredImages();
+        images.insert( images.begin(), core.getInput() );
+    }
+
+    if ( !streaming )
+    {
+        images[0]->GetExtent( extent );
+    }
+    else
+    {
+        reader = createImageReader( result.input, classifyInput( result.input ) );
+
+        if ( !reader )
+        {
+            result.error = "not a DICOM directory, readable NIfTI file or brick file";
+            return;
+        }
+
+        // Every study of a bricked volume has its own brick cache
+        myBrickVolumeReader* brickReader = myBrickVolumeReader::SafeDownCast( reader );
+        if ( brickReader )
+        {
+            brickReader->SetCacheSizeMB( options.brickCacheMB );
+        }
+
+        reader->UpdateInformation();
+        reader->GetOutputInformation( 0 )->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent );
+    }
+
+    if ( extent[1] < extent[0] || extent[3] < extent[2] || extent[5] < extent[4] )
+    {
+        result.error = "no image found";
+        return;
+    }
+
+    if ( streaming )
+    {
+        // Slabs are pulled through one filter at a time, each with the cores of the study
+        StreamingStatistics statistics;
+        statistics.setThresholds( options.lowerThreshold, options.upperThreshold );
+        statistics.setExtent( extent );
+        statistics.setSlabSize( options.streamSlabSize );
+        statistics.addSource( reader );
+
+        std::vector< vtkSmartPointer<vtkImageAlgorithm> > filters;
+        for ( std::size_t i = 0; i < options.filters.size(); i++ )
+        {
+            filters.push_back( FilterBank::createFilter( options.filters[i] ) );
+            filters.back()->SetInputConnection( reader->GetOutputPort() );
+            FilterBank::setNumberOfThreads( filters.back(), threadsPerStudy );
+            statistics.addSource( filters.back() );
+        }
+
+        result.thresholds[0].images = statistics.run();
+
+        result.success = true;
+        return;
+    }
+
+    // Without the cache, each filtered image is released as soon as its statistics are known
+    bool keepImages = !cacheHit && cache.isEnabled();
+
+    SNRStatistics statistics;
+    statistics.setThresholds( options.lowerThreshold, options.upperThreshold );
+    statistics.setExtent( extent );
+
+    IntensityHistogram histogram;
+    histogram.setExtent( extent );
+
+    for ( int i = 0; i < imageCount; i++ )
+    {
+        vtkImageData* image = images[i];
+        if ( !image || image->GetNumberOfPoints() == 0 )
+        {
+            result.error = "the " + imageNames[i] + " image is empty";
+            return;
+        }
+
+        if ( sweep )
+        {
+            // One pass over the image, then every pair is answered from the histogram
+            if ( !histogram.build( image ) )
+            {
+                result.error = "unsupported scalar type in the " + imageNames[i] + " image";
+                return;
+            }
+
+            for ( std::size_t j = 0; j < result.thresholds.size(); j++ )
+            {
+                ThresholdResult& row = result.thresholds[j];
+                double used[2];
+                row.images[i] = histogram.query( row.lower, row.upper, used );
+                row.used[i]   = std::make_pair( used[0], used[1] );
+            }
+        }
+        else if ( regionMode )
+        {
+            std::string error;
+            result.thresholds[0].regions[i] = regionStatistics.compute( image, &error );
+
+            if ( !error.empty() )
+            {
+                result.error = "the " + imageNames[i] + " image: " + error;
+                return;
+            }
+        }
+        else
+        {
+            result.thresholds[0].images[i] = statistics.compute( image );
+        }
+
+        if ( i > 0 && !cacheHit && !keepImages )
+        {
+            images[i]->ReleaseData();
+        }
+    }
+
+    if ( keepImages )
+    {
+        cache.store( result.input, images );
+    }
+
+    result.success = true;
+}
+
+void BatchProcessor::writeHeader( std::ostream& out ) const
+{
+    if ( json )
+    {
+        out << "[\n";
+        return;
+    }
+
+    out << "input,status,lower_threshold,upper_threshold";
+    for ( std::size_t i = 0; i < imageNames.size(); i++ )
+    {
+        const std::string& name = imageNames[i];
+
+        if ( regionMode )
+        {
+            out << "," << name << "_mean_noise," << name << "_mean_signal," << name << "_noise_"
+                << RegionStatistics::getEstimatorName( options.noiseEstimator ) << "," << name << "_snr";
+            continue;
+        }
+
+        out << "," << name << "_mean_background," << name << "_mean_foreground,"
+            << name << "_std_background," << name << "_snr";
+
+        // Binned (floating point) histograms snap the thresholds to bin edges
+        if ( sweep )
+        {
+            out << "," << name << "_lower_used," << name << "_upper_used";
+        }
+    }
+    out << ",seconds\n";
+}
+
+void BatchProcessor::writeRows( std::ostream& out, const BatchResult& result, bool first ) const
+{
+    std::ostringstream rows;
+    rows << std::setprecision( 10 );
+
+    // A failed study still gets one row per threshold pair, without statistics
+    const std::vector<ThresholdResult>& thresholds = result.thresholds;
+
+    for ( std::size_t j = 0; j < thresholds.size(); j++ )
+    {
+        const ThresholdResult& row = thresholds[j];
+
+        if ( json )
+        {
+            rows << ( first && j == 0 ? "" : ",\n" ) << "  { \"input\": " << jsonString( result.input )
+                 << ", \"status\": " << ( result.success ? "\"ok\"" : "\"error\"" );
+
+            if ( !result.success )
+            {
+                rows << ", \"error\": " << jsonString( result.error );
+            }
+
+            rows << ", \"lower_threshold\": " << jsonNumber( row.lower )
+                 << ", \"upper_threshold\": " << jsonNumber( row.upper );
+
+            if ( result.success )
+            {
+                for ( std::size_t i = 0; i < imageNames.size(); i++ )
+                {
+                    if ( regionMode )
+                    {
+                        const RegionResult& region = row.regions[i];
+                        rows << ", \"" << imageNames[i] << "\": { "
+                             << "\"mean_noise\": " << jsonNumber( region.noise.mean )
+                             << ", \"mean_signal\": " << jsonNumber( region.signal.mean )
+                             << ", \"noise_" << RegionStatistics::getEstimatorName( options.noiseEstimator ) << "\": "
+                             << jsonNumber( region.getNoise( options.noiseEstimator ) )
+                             << ", \"snr\": " << jsonNumber( region.getSNR( options.noiseEstimator ) ) << " }";
+                        continue;
+                    }
+
+                    const SNRPartial& image = row.images[i];
+                    rows << ", \"" << imageNames[i] << "\": { "
+                         << "\"mean_background\": " << jsonNumber( image.background.mean )
+                         << ", \"mean_foreground\": " << jsonNumber( image.foreground.mean )
+                         << ", \"std_background\": " << jsonNumber( image.background.getStandardDeviation() )
+                         << ", \"snr\": " << jsonNumber( image.getSNR() );
+
+                    if ( sweep )
+                    {
+                        rows << ", \"lower_used\": " << jsonNumber( row.used[i].first )
+                             << ", \"upper_used\": " << jsonNumber( row.used[i].second );
+                    }
+
+                    rows << " }";
+                }
+            }
+
+            rows << ", \"seconds\": " << jsonNumber( result.seconds ) << " }";
+        }
+        else
+        {
+            rows << csvField( result.input ) << ","
+                 << ( result.success ? "ok" : csvField( "error: " + result.error ) ) << ","
+                 << row.lower << "," << row.upper;
+
+            for ( std::size_t i = 0; i < imageNames.size(); i++ )
+            {
+                const SNRPartial& image = row.images[i];
+                if ( result.success && regionMode )
+                {
+                    const RegionResult& region = row.regions[i];
+                    rows << "," << region.noise.mean << "," << region.signal.mean << ","
+                         << region.getNoise( options.noiseEstimator ) << "," << region.getSNR( options.noiseEstimator );
+                }
+                else if ( result.success )
+                {
+                    rows << "," << image.background.mean << "," << image.foreground.mean
+                         << "," << image.background.getStandardDeviation() << "," << image.getSNR();
+
+                    if ( sweep )
+                    {
+                        rows << "," << row.used[i].first << "," << row.used[i].second;
+                    }
+                }
+                else
+                {
+                    rows << ( sweep ? ",,,,,," : ",,,," );
+                }
+            }
+
+            rows << "," << result.seconds << "\n";
+        }
+    }
+
+    out << rows.str();
+}
+
+void BatchProcessor::writeFooter( std::ostream& out ) const
+{
+    if ( json )
+    {
+        out << ( results.empty() ? "]\n" : "\n]\n" );
+    }
+}
+
+int BatchProcessor::run()
+{
+    // One entry per threshold pair: the sweep pairs, or the pair given with --lower/--upper
+    std::vector< std::pair<double, double> > pairs = options.sweepThresholds;
+    if ( !sweep )
+    {
+        pairs.push_back( std::make_pair( options.lowerThreshold, options.upperThreshold ) );
+    }
+
+    std::vector<ThresholdResult> thresholds( pairs.size() );
+    for ( std::size_t j = 0; j < pairs.size(); j++ )
+    {
+        thresholds[j].lower = pairs[j].first;
+        thresholds[j].upper = pairs[j].second;
+
+        thresholds[j].used.assign( imageNames.size(), pairs[j] );
+        thresholds[j].images.resize( imageNames.size() );
+        thresholds[j].regions.resize( imageNames.size() );
+    }
+
+    // The masks are read once and shared by all studies, which must have the same grid
+    if ( regionMode && !setupRegionStatistics( options, regionStatistics ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    results.assign( inputs.size(), BatchResult() );
+    for ( std::size_t i = 0; i < inputs.size(); i++ )
+    {
+        results[i].input      = inputs[i];
+        results[i].thresholds = thresholds;
+    }
+
+    // Results go to the file, or to the standard output. Progress and errors always go to the
+    // standard error, so the standard output holds only the CSV or JSON.
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+
+    if ( !options.outputFile.empty() )
+    {
+        file.open( options.outputFile.c_str() );
+        if ( !file )
+        {
+            std::cerr << "ERROR: Cannot write the batch results to " << options.outputFile << "\n";
+            return EXIT_FAILURE;
+        }
+        out = &file;
+    }
+
+    int cores = options.threads > 0 ? options.threads : std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+    int workers = std::max( 1, std::min( options.workers, static_cast<int>( inputs.size() ) ) );
+    int threadsPerStudy = std::max( 1, cores / workers );
+
+    std::cerr << "Processing " << inputs.size() << " studies with " << workers << " worker(s), "
+              << threadsPerStudy << " thread(s) per study \n";
+
+    // The vtkSMPTools configuration is process-wide, so it is sized once for a study here.
+    // The threaded filters get the same share through their thread count (see processStudy).
+    MetricsCore::setThreadPoolSize( threadsPerStudy );
+
+    writeHeader( *out );
+
+    std::atomic<std::size_t> nextStudy( 0 );
+    std::mutex outputMutex;
+    std::vector<char> done( inputs.size(), 0 );
+    std::size_t written = 0;
+    int failures = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]()
+    {
+        for ( ;; )
+        {
+            std::size_t i = nextStudy++;
+            if ( i >= results.size() )
+            {
+                return;
+            }
+
+            BatchResult& result = results[i];
+            auto studyStart = std::chrono::steady_clock::now();
+
+            try
+            {
+                ScopedTimer timer( "study", "batch" );
+                processStudy( result, threadsPerStudy );
+            }
+            catch ( const std::exception& exception )
+            {
+                result.success = false;
+                result.error = exception.what();
+            }
+
+            result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - studyStart ).count();
+
+            std::lock_guard<std::mutex> lock( outputMutex );
+
+            done[i] = 1;
+            failures += result.success ? 0 : 1;
+
+            std::cerr << "[" << i + 1 << "/" << results.size() << "] " << result.input << ": "
+                      << ( result.success ? "done" : "ERROR: " + result.error ) << " ("
+                      << std::fixed << std::setprecision( 2 ) << result.seconds << " s) \n";
+
+            // Keep the rows in input order: write every finished study up to the first unfinished one
+            while ( written < results.size() && done[written] )
+            {
+                writeRows( *out, results[written], written == 0 );
+                written++;
+            }
+            out->flush();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for ( int i = 1; i < workers; i++ )
+    {
+        threads.push_back( std::thread( [&]()
+        {
+            TraceRecorder::setThreadName( "batch worker" );
+            worker();
+        } ) );
+    }
+    worker();
+
+    for ( std::size_t i = 0; i < threads.size(); i++ )
+    {
+        threads[i].join();
+    }
+
+    writeFooter( *out );
+    out->flush();
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    std::cerr << "Processed " << results.size() << " studies (" << failures << " failed) in "
+              << std::fixed << std::setprecision( 2 ) << seconds << " s \n";
+
+    return ( failures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+*   batchProcessor.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the headless batch mode: SNR of many
+*                   studies without rendering or prompts.
+****************************************************************************/
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include "helperFunctions.hxx"
+#include "snrStatistics.hxx"
+#include "regionStatistics.hxx"
+#include "volumeCache.hxx"
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/*
+*   The statistics of one study for one threshold pair.
+*/
+struct ThresholdResult
+{
+    double lower;
+    double upper;
+    std::vector< std::pair<double, double> > used;  // Threshold range used per image (differs from lower/upper for binned histograms)
+    std::vector<SNRPartial> images;                 // Original, then the filtered images
+    std::vector<RegionResult> regions;              // Region SNR of the same images (see ProgramOptions::usesRegionSNR)
+};
+
+/*
+*   The result of one study in batch mode.
+*/
+struct BatchResult
+{
+    BatchResult();
+
+    std::string input;          // DICOM directory or NIfTI file
+    bool success;
+    std::string error;          // Reason for a failure
+    std::vector<ThresholdResult> thresholds;    // One entry, or one per sweep pair
+    double seconds;             // Wall time spent on the study
+};
+
+/*
+*   Runs the loading, filtering and SNR stages of the viewer over many studies,
+*   with the thresholds and filter settings taken from the program options.
+*
+*   Nothing is rendered and nothing is read from the standard input. Up to
+*   options.workers studies are processed at the same time, and each study gets
+*   its share of the cores: the threaded filters (see FilterBank) through their
+*   thread count, the vtkSMPTools stages (median, reader, statistics) through
+*   the process-wide vtkSMPTools pool, which run() sizes to the share of one
+*   study before the workers start. One row per study
+*   is written to a CSV or JSON file in the order of the inputs, as soon as all
+*   studies before it are done. A study that fails gets a row with its error
+*   and does not stop the batch.
+*
+*   With a threshold sweep, one IntensityHistogram per image answers all the
+*   pairs, and each study gets one row per pair. With signal/noise regions,
+*   masks or a robust noise estimator, RegionStatistics gives the SNR instead.
+*
+*   Unless streaming, the loaded and filtered volumes of each study are taken
+*   from (or added to) the VolumeCache.
+*/
+class BatchProcessor
+{
+    public:
+        BatchProcessor( const ProgramOptions& options );
+
+        /*
+        *   Add studies to the batch.
+        *
+        *   @param   path   A directory, whose sub-directories (DICOM series) and
+        *                   .nii/.nii.gz files are added, or a text file with one input
+        *                   per line ('#' starts a comment)
+        *
+        *   @returns a boolean representing whether at least one study was found
+        */
+        bool addInputs( const std::string& path );
+
+        /*
+        *   Add a single study (DICOM directory or NIfTI file) to the batch.
+        *
+        *   @param   input   The study
+        */
+        void addInput( const std::string& input );
+
+        /*
+        *   Process all studies and write the results.
+        *
+        *   @returns EXIT_SUCCESS if every study was processed, EXIT_FAILURE otherwise
+        */
+        int run();
+
+        /*
+        *   @returns the results of the last run, in input order
+        */
+        const std::vector<BatchResult>& getResults() const { return results; }
+
+    private:
+        void processStudy( BatchResult& result, int threadsPerStudy ) const;
+
+        void writeHeader( std::ostream& out ) const;
+        void writeRows( std::ostream& out, const BatchResult& result, bool first ) const;
+        void writeFooter( std::ostream& out ) const;
+
+        ProgramOptions options;
+        VolumeCache cache;
+        RegionStatistics regionStatistics;          // Set up (masks read) once in run()
+        std::vector<std::string> imageNames;        // Column names: "original", then the filter ids
+        std::vector<std::string> inputs;
+        std::vector<BatchResult> results;
+        bool json;
+        bool sweep;
+        bool regionMode;
+};
+
+#endif // BATCHPROCESSOR_H
@@ -0,0 +1,213 @@
+/****************************************************************************
+*   bitMask.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the bit-packed segmentation mask.
+****************************************************************************/
+
+#include "bitMask.hxx"
+#include "thresholdKernel.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+/*
+*   Pack one slice of the first component, for the types and images the
+*   kernels do not cover, with the same inclusive test.
+*/
+template <class T>
+static void packSlice( const T* in, int components, std::size_t count, double lower, double upper,
+                       std::uint64_t* bits )
+{
+    for ( std::size_t i = 0; i < count; i += 64 )
+    {
+        std::size_t end    = std::min<std::size_t>( count, i + 64 );
+        std::uint64_t word = 0;
+
+        for ( std::size_t k = i; k < end; k++ )
+        {
+            double voxel = static_cast<double>( in[k * components] );
+            word |= std::uint64_t( voxel >= lower && voxel <= upper ) << ( k - i );
+        }
+
+        bits[i / 64] = word;
+    }
+}
+
+/*
+*   Thresholds a range of slices of an image into a mask (vtkSMPTools functor).
+*/
+class BitMaskThresholdFunctor
+{
+    public:
+        BitMaskThresholdFunctor( BitMask& mask, vtkImageData* image, double lower, double upper )
+            : Mask( mask ), Image( image ), Lower( lower ), Upper( upper )
+        {
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end )
+        {
+            for ( vtkIdType slice = begin; slice < end; slice++ )
+            {
+                Mask.thresholdSlice( Image, Mask.getExtent()[4] + static_cast<int>( slice ), Lower, Upper );
+            }
+        }
+
+    private:
+        BitMask& Mask;
+        vtkImageData* Image;
+        double Lower;
+        double Upper;
+};
+
+/******************** Helper class "BitMask" functions ********************/
+BitMask::BitMask()
+    : wordsPerSlice( 0 )
+{
+    std::fill( extent, extent + 6, 0 );
+    std::fill( spacing, spacing + 3, 1.0 );
+    std::fill( origin, origin + 3, 0.0 );
+}
+
+void BitMask::setGeometry( vtkImageData* image )
+{
+    image->GetExtent( extent );
+    image->GetSpacing( spacing );
+    image->GetOrigin( origin );
+
+    words.clear();
+    wordsPerSlice = 0;
+
+    if ( extent[1] < extent[0] || extent[3] < extent[2] || extent[5] < extent[4] )
+    {
+        return;
+    }
+
+    std::size_t sliceVoxels = std::size_t( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 );
+    wordsPerSlice = ( sliceVoxels + 63 ) / 64;
+    words.assign( wordsPerSlice * ( extent[5] - extent[4] + 1 ), 0 );
+}
+
+void BitMask::thresholdSlice( vtkImageData* image, int z, double lower, double upper )
+{
+    std::uint64_t* bits = getSlice( z );
+    std::size_t count   = std::size_t( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 );
+    int components      = image->GetNumberOfScalarComponents();
+
+    // Rows of a slice are contiguous, so the slice is one run of voxels
+    void* in = image->GetScalarPointer( extent[0], extent[2], z );
+
+    if ( components == 1 )
+    {
+        switch ( image->GetScalarType() )
+        {
+            case VTK_SHORT:
+                thresholdPack( static_cast<const short*>( in ), count, lower, upper, bits );
+                return;
+
+            case VTK_UNSIGNED_SHORT:
+                thresholdPack( static_cast<const unsigned short*>( in ), count, lower, upper, bits );
+                return;
+
+            case VTK_FLOAT:
+                thresholdPack( static_cast<const float*>( in ), count, lower, upper, bits );
+                return;
+
+            default:
+                break;
+        }
+    }
+
+    switch ( image->GetScalarType() )
+    {
+        vtkTemplateAliasMacro( packSlice( static_cast<const VTK_TT*>( in ), components, count, lower, upper, bits ) );
+
+        default:
+            std::fill( bits, bits + wordsPerSlice, std::uint64_t( 0 ) );
+            break;
+    }
+}
+
+void BitMask::threshold( vtkImageData* image, double lower, double upper )
+{
+    if ( isEmpty() )
+    {
+        return;
+    }
+
+    BitMaskThresholdFunctor functor( *this, image, lower, upper );
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( extent[5] - extent[4] + 1 ), 1, functor );
+}
+
+bool BitMask::get( int x, int y, int z ) const
+{
+    std::size_t bit = std::size_t( y - extent[2] ) * ( extent[1] - extent[0] + 1 ) + ( x - extent[0] );
+    return ( ( getSlice( z )[bit / 64] >> ( bit % 64 ) ) & 1 ) != 0;
+}
+
+long long BitMask::count() const
+{
+    return countBits( words.data(), words.size() );
+}
+
+long long BitMask::countSlice( int z ) const
+{
+    return countBits( getSlice( z ), wordsPerSlice );
+}
+
+double BitMask::getVolume() const
+{
+    return static_cast<double>( count() ) * std::fabs( spacing[0] * spacing[1] * spacing[2] );
+}
+
+void BitMask::expandSlice( int z, const int rect[4], unsigned char* rgba, const unsigned char inside[4],
+                           const unsigned char outside[4] ) const
+{
+    const std::uint64_t* bits = getSlice( z );
+    std::size_t rowLength     = extent[1] - extent[0] + 1;
+
+    for ( int y = rect[2]; y <= rect[3]; y++ )
+    {
+        std::size_t bit = std::size_t( y - extent[2] ) * rowLength + ( rect[0] - extent[0] );
+
+        for ( int x = rect[0]; x <= rect[1]; x++, bit++, rgba += 4 )
+        {
+            const unsigned char* color = ( ( bits[bit / 64] >> ( bit % 64 ) ) & 1 ) ? inside : outside;
+            std::memcpy( rgba, color, 4 );
+        }
+    }
+}
+
+void BitMask::expandSlice( int z, vtkImageData* image, unsigned char value ) const
+{
+    const std::uint64_t* bits = getSlice( z );
+    std::size_t count         = std::size_t( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 );
+    unsigned char* out        = static_cast<unsigned char*>( image->GetScalarPointer( extent[0], extent[2], z ) );
+
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        out[i] = ( ( bits[i / 64] >> ( i % 64 ) ) & 1 ) ? value : 0;
+    }
+}
+
+vtkSmartPointer<vtkImageData> BitMask::toImage( unsigned char value ) const
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent( extent[0], extent[1], extent[2], extent[3], extent[4], extent[5] );
+    image->SetSpacing( spacing[0], spacing[1], spacing[2] );
+    image->SetOrigin( origin[0], origin[1], origin[2] );
+    image->AllocateScalars( VTK_UNSIGNED_CHAR, 1 );
+
+    for ( int z = extent[4]; !isEmpty() && z <= extent[5]; z++ )
+    {
+        expandSlice( z, image, value );
+    }
+
+    return image;
+}
+/***************************************************************************/
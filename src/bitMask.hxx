@@ -0,0 +1,138 @@
+/****************************************************************************
+*   bitMask.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the bit-packed segmentation mask.
+****************************************************************************/
+
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   A segmentation stored as one bit per voxel (1 = inside the thresholds),
+*   32 times smaller than a float segmentation and 8 times smaller than an
+*   unsigned char one.
+*
+*   Voxels are packed X fastest, then Y, into 64-bit words. Every slice starts
+*   on a new word, so different slices can be written by different threads at
+*   the same time. The unused bits of the last word of a slice stay 0, so the
+*   counts are plain popcounts of the words.
+*
+*   The mask is never expanded as a whole for display: expandSlice() turns
+*   one slice (or part of it) into RGBA, and toImage() creates an unsigned
+*   char volume for the 3D view only when it is needed.
+*/
+class BitMask
+{
+    public:
+        BitMask();
+
+        /*
+        *   Take the extent, spacing and origin of an image and clear the mask.
+        *
+        *   @param   image   The image that is segmented
+        */
+        void setGeometry( vtkImageData* image );
+
+        /*
+        *   @returns whether setGeometry() was called with a non-empty image
+        */
+        bool isEmpty() const { return words.empty(); }
+
+        const int* getExtent() const { return extent; }
+        const double* getSpacing() const { return spacing; }
+        const double* getOrigin() const { return origin; }
+
+        /*
+        *   @returns the words of one slice, each slice has getWordsPerSlice() of them
+        */
+        std::size_t getWordsPerSlice() const { return wordsPerSlice; }
+        std::uint64_t* getSlice( int z ) { return &words[( z - extent[4] ) * wordsPerSlice]; }
+        const std::uint64_t* getSlice( int z ) const { return &words[( z - extent[4] ) * wordsPerSlice]; }
+
+        /*
+        *   Threshold one slice of the first component of an image with the same
+        *   geometry into the mask (inclusive, like vtkImageThreshold::ThresholdBetween()).
+        *   Short, unsigned short and float images use the SIMD pack kernels.
+        *
+        *   @param   image   The image
+        *   @param   z       The slice (index of the image extent)
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        */
+        void thresholdSlice( vtkImageData* image, int z, double lower, double upper );
+
+        /*
+        *   Threshold all slices, in parallel with vtkSMPTools.
+        */
+        void threshold( vtkImageData* image, double lower, double upper );
+
+        /*
+        *   @returns whether a voxel is inside (indices of the extent)
+        */
+        bool get( int x, int y, int z ) const;
+
+        /*
+        *   @returns the number of voxels inside
+        */
+        long long count() const;
+
+        /*
+        *   @returns the number of voxels inside one slice
+        */
+        long long countSlice( int z ) const;
+
+        /*
+        *   @returns the volume inside (count() times the voxel volume, in the units of the spacing cubed)
+        */
+        double getVolume() const;
+
+        /*
+        *   @returns the memory used by the words (bytes)
+        */
+        std::size_t getMemorySize() const { return words.size() * sizeof( std::uint64_t ); }
+
+        /*
+        *   Expand a rectangle of one slice into RGBA pixels, X fastest.
+        *
+        *   @param   z         The slice
+        *   @param   rect      xMin, xMax, yMin, yMax (inclusive, within the extent)
+        *   @param   rgba      Receives 4 bytes per pixel
+        *   @param   inside    Colour of the voxels inside
+        *   @param   outside   Colour of the voxels outside
+        */
+        void expandSlice( int z, const int rect[4], unsigned char* rgba, const unsigned char inside[4],
+                          const unsigned char outside[4] ) const;
+
+        /*
+        *   Expand one slice into an unsigned char volume with the same extent.
+        *
+        *   @param   z       The slice
+        *   @param   image   Unsigned char image with the extent of the mask
+        *   @param   value   Value of the voxels inside (the others are 0)
+        */
+        void expandSlice( int z, vtkImageData* image, unsigned char value ) const;
+
+        /*
+        *   @param   value   Value of the voxels inside (the others are 0)
+        *
+        *   @returns the whole mask as an unsigned char image (one byte per voxel)
+        */
+        vtkSmartPointer<vtkImageData> toImage( unsigned char value = 1 ) const;
+
+    private:
+        std::vector<std::uint64_t> words;
+        std::size_t wordsPerSlice;
+        int extent[6];
+        double spacing[3];
+        double origin[3];
+};
+
+#endif // BITMASK_H
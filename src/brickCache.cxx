@@ -0,0 +1,112 @@
+/****************************************************************************
+*   brickCache.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the memory-bounded cache of decoded
+*                   bricks.
+****************************************************************************/
+
+#include "brickCache.hxx"
+
+BrickCache::BrickCache()
+    : budget( 1024.0 * 1024.0 * 1024.0 ), size( 0.0 ), hits( 0 ), misses( 0 )
+{
+}
+
+void BrickCache::setBudget( double bytes )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    budget = bytes;
+    evict();
+}
+
+double BrickCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return budget;
+}
+
+BrickVolume::Brick BrickCache::get( int brick )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    std::map<int, Entry>::iterator it = entries.find( brick );
+    if ( it == entries.end() )
+    {
+        misses++;
+        return BrickVolume::Brick();
+    }
+
+    recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.position );
+    hits++;
+    return it->second.data;
+}
+
+void BrickCache::insert( int brick, const BrickVolume::Brick& data )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    double bytes = static_cast<double>( data->size() );
+    if ( bytes > budget )
+    {
+        return;
+    }
+
+    std::map<int, Entry>::iterator it = entries.find( brick );
+    if ( it != entries.end() )
+    {
+        size -= static_cast<double>( it->second.data->size() );
+        it->second.data = data;
+        recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.position );
+    }
+    else
+    {
+        recentlyUsed.push_front( brick );
+
+        Entry entry;
+        entry.data     = data;
+        entry.position = recentlyUsed.begin();
+        entries.insert( std::make_pair( brick, entry ) );
+    }
+
+    size += bytes;
+    evict();
+}
+
+void BrickCache::clear()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    entries.clear();
+    recentlyUsed.clear();
+    size = 0.0;
+}
+
+double BrickCache::getSize() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return size;
+}
+
+long long BrickCache::getHits() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return hits;
+}
+
+long long BrickCache::getMisses() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return misses;
+}
+
+void BrickCache::evict()
+{
+    while ( size > budget && !recentlyUsed.empty() )
+    {
+        std::map<int, Entry>::iterator it = entries.find( recentlyUsed.back() );
+        size -= static_cast<double>( it->second.data->size() );
+        entries.erase( it );
+        recentlyUsed.pop_back();
+    }
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+*   brickCache.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the memory-bounded cache of decoded bricks.
+****************************************************************************/
+
+#ifndef BRICKCACHE_H
+#define BRICKCACHE_H
+
+#include "brickVolume.hxx"
+
+#include <list>
+#include <map>
+#include <mutex>
+
+/*
+*   Keeps the most recently used bricks of a BrickVolume in memory, up to a
+*   budget in bytes. When a new brick does not fit, the least recently used
+*   bricks are dropped until it does.
+*
+*   The bricks are shared pointers, so a brick that is dropped while an
+*   image is being copied from it stays valid until the copy is done.
+*   All functions may be called from several threads.
+*/
+class BrickCache
+{
+    public:
+        BrickCache();
+
+        /*
+        *   Set the memory budget, dropping bricks if the cache is over it.
+        *
+        *   @param   bytes   The most memory the bricks may use
+        */
+        void setBudget( double bytes );
+        double getBudget() const;
+
+        /*
+        *   @param   brick   The brick index
+        *
+        *   @returns the cached brick (now the most recently used), or null if it is not cached
+        */
+        BrickVolume::Brick get( int brick );
+
+        /*
+        *   Add a brick as the most recently used. A brick larger than the whole
+        *   budget is not kept.
+        *
+        *   @param   brick   The brick index
+        *   @param   data    The voxels of the brick
+        */
+        void insert( int brick, const BrickVolume::Brick& data );
+
+        /*
+        *   Drop all bricks (e.g. when another file is opened).
+        */
+        void clear();
+
+        /*
+        *   @returns the memory used by the cached bricks (bytes)
+        */
+        double getSize() const;
+
+        /*
+        *   @returns the number of get() calls that found their brick / did not
+        */
+        long long getHits() const;
+        long long getMisses() const;
+
+    private:
+        BrickCache( const BrickCache& ) = delete;
+        void operator=( const BrickCache& ) = delete;
+
+        struct Entry
+        {
+            BrickVolume::Brick data;
+            std::list<int>::iterator position;
+        };
+
+        void evict();
+
+        // Everything below is guarded by mutex
+        mutable std::mutex mutex;
+        std::map<int, Entry> entries;
+        std::list<int> recentlyUsed;        // Most recently used first
+        double budget;
+        double size;
+        long long hits;
+        long long misses;
+};
+
+#endif // BRICKCACHE_H
@@ -0,0 +1,486 @@
+/****************************************************************************
+*   brickVolume.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the bricked on-disk volume format.
+****************************************************************************/
+
+#include "brickVolume.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+#include <vtkAlgorithm.h>
+#include <vtkInformation.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkSMPTools.h>
+#include <vtk_zlib.h>
+
+#include <vtksys/SystemTools.hxx>
+
+// Changing the layout must change the version
+static const char brickMagic[8] = { 'V', 'T', 'K', 'M', 'B', 'R', 'I', 'K' };
+static const int brickVersion   = 1;
+static const int brickByteOrder = 0x01020304;
+
+/*
+*   Fixed-size header at the start of a brick file, followed by one
+*   BrickRecord per brick.
+*/
+struct BrickHeader
+{
+    char magic[8];
+    int version;
+    int headerSize;
+    int byteOrder;
+    int scalarType;
+    int components;
+    int brickSize;
+    int compression;        // 0 = raw, 1 = zlib
+    int extent[6];
+    int reserved;
+    double spacing[3];
+    double origin[3];
+    long long brickCount;
+};
+
+/******************** Helper class "BrickVolume" functions ********************/
+BrickVolume::BrickVolume()
+    : scalarType( 0 ), components( 0 ), scalarSize( 0 ), brickSize( 0 ), compressed( false )
+{
+    std::fill( extent, extent + 6, 0 );
+    std::fill( spacing, spacing + 3, 1.0 );
+    std::fill( origin, origin + 3, 0.0 );
+    std::fill( brickCounts, brickCounts + 3, 0 );
+}
+
+bool BrickVolume::open( const std::string& file )
+{
+    fileName = file;
+    error.clear();
+    records.clear();
+
+    std::ifstream stream( file.c_str(), std::ios::binary );
+    BrickHeader header;
+
+    if ( !stream || !stream.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) ||
+         std::memcmp( header.magic, brickMagic, sizeof( brickMagic ) ) != 0 )
+    {
+        error = "not a brick file: " + file;
+        return false;
+    }
+
+    if ( header.version != brickVersion || header.headerSize != static_cast<int>( sizeof( header ) ) ||
+         header.byteOrder != brickByteOrder )
+    {
+        error = "unsupported brick file version or byte order: " + file;
+        return false;
+    }
+
+    scalarType = header.scalarType;
+    components = header.components;
+    scalarSize = vtkDataArray::GetDataTypeSize( scalarType );
+    brickSize  = header.brickSize;
+    compressed = header.compression != 0;
+    std::copy( header.extent, header.extent + 6, extent );
+    std::copy( header.spacing, header.spacing + 3, spacing );
+    std::copy( header.origin, header.origin + 3, origin );
+
+    long long expected = 1;
+    for ( int i = 0; i < 3; i++ )
+    {
+        int size       = extent[2 * i + 1] - extent[2 * i] + 1;
+        brickCounts[i] = ( brickSize > 0 && size > 0 ) ? ( size + brickSize - 1 ) / brickSize : 0;
+        expected      *= brickCounts[i];
+    }
+
+    if ( scalarSize <= 0 || components < 1 || expected == 0 || header.brickCount != expected )
+    {
+        error = "corrupt brick file header: " + file;
+        return false;
+    }
+
+    records.resize( static_cast<std::size_t>( expected ) );
+    if ( !stream.read( reinterpret_cast<char*>( records.data() ), records.size() * sizeof( BrickRecord ) ) )
+    {
+        records.clear();
+        error = "truncated brick index: " + file;
+        return false;
+    }
+
+    return true;
+}
+
+void BrickVolume::getBrickExtent( int brick, int brickExtent[6] ) const
+{
+    int index[3] = { brick % brickCounts[0],
+                     ( brick / brickCounts[0] ) % brickCounts[1],
+                     brick / ( brickCounts[0] * brickCounts[1] ) };
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        brickExtent[2 * i]     = extent[2 * i] + index[i] * brickSize;
+        brickExtent[2 * i + 1] = std::min( brickExtent[2 * i] + brickSize - 1, extent[2 * i + 1] );
+    }
+}
+
+std::size_t BrickVolume::getBrickBytes( int brick ) const
+{
+    int brickExtent[6];
+    getBrickExtent( brick, brickExtent );
+
+    return std::size_t( brickExtent[1] - brickExtent[0] + 1 ) * ( brickExtent[3] - brickExtent[2] + 1 ) *
+           ( brickExtent[5] - brickExtent[4] + 1 ) * components * scalarSize;
+}
+
+double BrickVolume::getLayerBytes() const
+{
+    return double( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 ) *
+           std::min( brickSize, extent[5] - extent[4] + 1 ) * components * scalarSize;
+}
+
+double BrickVolume::getStoredBytes() const
+{
+    double bytes = 0.0;
+    for ( std::size_t i = 0; i < records.size(); i++ )
+    {
+        bytes += static_cast<double>( records[i].bytes );
+    }
+    return bytes;
+}
+
+std::vector<int> BrickVolume::getBricks( const int request[6] ) const
+{
+    std::vector<int> bricks;
+    int first[3], last[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        int low  = std::max( request[2 * i], extent[2 * i] );
+        int high = std::min( request[2 * i + 1], extent[2 * i + 1] );
+
+        if ( high < low || records.empty() )
+        {
+            return bricks;
+        }
+
+        first[i] = ( low - extent[2 * i] ) / brickSize;
+        last[i]  = ( high - extent[2 * i] ) / brickSize;
+    }
+
+    // Z, then Y, then X: the order of the file
+    for ( int z = first[2]; z <= last[2]; z++ )
+    {
+        for ( int y = first[1]; y <= last[1]; y++ )
+        {
+            for ( int x = first[0]; x <= last[0]; x++ )
+            {
+                bricks.push_back( ( z * brickCounts[1] + y ) * brickCounts[0] + x );
+            }
+        }
+    }
+
+    return bricks;
+}
+
+bool BrickVolume::readBricks( const std::vector<int>& bricks, std::vector<Brick>& data )
+{
+    data.assign( bricks.size(), Brick() );
+
+    if ( bricks.empty() )
+    {
+        return true;
+    }
+
+    std::ifstream stream( fileName.c_str(), std::ios::binary );
+    if ( !stream )
+    {
+        error = "cannot open the brick file " + fileName;
+        return false;
+    }
+
+    // One forward pass over the file, even if the bricks were asked for in another order
+    std::vector<std::size_t> order( bricks.size() );
+    std::iota( order.begin(), order.end(), std::size_t( 0 ) );
+    std::sort( order.begin(), order.end(), [this, &bricks]( std::size_t a, std::size_t b )
+    {
+        return records[bricks[a]].offset < records[bricks[b]].offset;
+    } );
+
+    std::vector< std::vector<char> > stored( bricks.size() );
+    {
+        ScopedTimer timer( "brick read", "io" );
+
+        for ( std::size_t i = 0; i < order.size(); i++ )
+        {
+            const BrickRecord& record = records[bricks[order[i]]];
+            std::vector<char>& bytes  = stored[order[i]];
+
+            bytes.resize( static_cast<std::size_t>( record.bytes ) );
+            if ( !stream.seekg( record.offset ) || !stream.read( bytes.data(), record.bytes ) )
+            {
+                error = "the brick file " + fileName + " is shorter than its index says";
+                return false;
+            }
+            timer.addBytes( static_cast<double>( record.bytes ) );
+        }
+    }
+
+    // Raw bricks are moved as they are, compressed ones decompressed in parallel
+    std::atomic<int> failures( 0 );
+    auto decompress = [this, &bricks, &stored, &data, &failures]( vtkIdType begin, vtkIdType end )
+    {
+        for ( vtkIdType i = begin; i < end; i++ )
+        {
+            std::size_t rawBytes = getBrickBytes( bricks[i] );
+
+            if ( stored[i].size() == rawBytes )
+            {
+                data[i] = std::make_shared< const std::vector<char> >( std::move( stored[i] ) );
+                continue;
+            }
+
+            std::shared_ptr< std::vector<char> > voxels = std::make_shared< std::vector<char> >( rawBytes );
+            uLongf length = static_cast<uLongf>( rawBytes );
+
+            if ( uncompress( reinterpret_cast<Bytef*>( voxels->data() ), &length,
+                             reinterpret_cast<const Bytef*>( stored[i].data() ),
+                             static_cast<uLong>( stored[i].size() ) ) != Z_OK || length != rawBytes )
+            {
+                failures++;
+                continue;
+            }
+
+            data[i] = voxels;
+        }
+    };
+
+    {
+        ScopedTimer timer( "brick decompress", "io" );
+        vtkSMPTools::For( 0, static_cast<vtkIdType>( bricks.size() ), 1, decompress );
+    }
+
+    if ( failures > 0 )
+    {
+        error = "corrupt bricks in " + fileName;
+        return false;
+    }
+
+    return true;
+}
+
+void BrickVolume::copyBrick( int brick, const Brick& data, vtkImageData* image ) const
+{
+    int brickExtent[6], imageExtent[6], copyExtent[6];
+    getBrickExtent( brick, brickExtent );
+    image->GetExtent( imageExtent );
+
+    for ( int i = 0; i < 6; i += 2 )
+    {
+        copyExtent[i]     = std::max( brickExtent[i], imageExtent[i] );
+        copyExtent[i + 1] = std::min( brickExtent[i + 1], imageExtent[i + 1] );
+
+        if ( copyExtent[i + 1] < copyExtent[i] )
+        {
+            return;
+        }
+    }
+
+    std::size_t voxelBytes = std::size_t( components ) * scalarSize;
+    std::size_t rowBytes   = std::size_t( copyExtent[1] - copyExtent[0] + 1 ) * voxelBytes;
+    std::size_t brickRow   = std::size_t( brickExtent[1] - brickExtent[0] + 1 );
+    std::size_t brickRows  = std::size_t( brickExtent[3] - brickExtent[2] + 1 );
+
+    for ( int z = copyExtent[4]; z <= copyExtent[5]; z++ )
+    {
+        for ( int y = copyExtent[2]; y <= copyExtent[3]; y++ )
+        {
+            std::size_t voxel = ( std::size_t( z - brickExtent[4] ) * brickRows + ( y - brickExtent[2] ) ) * brickRow +
+                                ( copyExtent[0] - brickExtent[0] );
+
+            std::memcpy( image->GetScalarPointer( copyExtent[0], y, z ), data->data() + voxel * voxelBytes, rowBytes );
+        }
+    }
+}
+
+bool BrickVolume::convert( vtkAlgorithm* source, const std::string& outputFile, int size, bool compress )
+{
+    error.clear();
+    records.clear();
+
+    source->UpdateInformation();
+
+    int wholeExtent[6];
+    source->GetOutputInformation( 0 )->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent );
+
+    if ( size < 1 || wholeExtent[1] < wholeExtent[0] || wholeExtent[3] < wholeExtent[2] || wholeExtent[5] < wholeExtent[4] )
+    {
+        error = "no image to convert";
+        return false;
+    }
+
+    // This volume describes the file while it is written, so getBrickExtent() works for it
+    std::copy( wholeExtent, wholeExtent + 6, extent );
+    brickSize  = size;
+    compressed = compress;
+
+    long long brickCount = 1;
+    for ( int i = 0; i < 3; i++ )
+    {
+        brickCounts[i] = ( extent[2 * i + 1] - extent[2 * i] + size ) / size;
+        brickCount    *= brickCounts[i];
+    }
+    records.resize( static_cast<std::size_t>( brickCount ) );
+
+    std::ofstream file( outputFile.c_str(), std::ios::binary );
+    if ( !file )
+    {
+        error = "cannot write " + outputFile;
+        records.clear();
+        return false;
+    }
+
+    // The header and index are written last, when the types and offsets are known
+    BrickHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+
+    std::vector<char> placeholder( sizeof( header ) + records.size() * sizeof( BrickRecord ), 0 );
+    file.write( placeholder.data(), placeholder.size() );
+    long long offset = static_cast<long long>( placeholder.size() );
+
+    int layerBricks = brickCounts[0] * brickCounts[1];
+
+    for ( int layer = 0; layer < brickCounts[2] && error.empty(); layer++ )
+    {
+        int layerExtent[6] = { extent[0], extent[1], extent[2], extent[3],
+                               extent[4] + layer * size, std::min( extent[4] + ( layer + 1 ) * size - 1, extent[5] ) };
+
+        ScopedTimer timer( "brick layer", "io" );
+
+        source->UpdateExtent( layerExtent );
+        vtkImageData* slab = vtkImageData::SafeDownCast( source->GetOutputDataObject( 0 ) );
+
+        int slabExtent[6];
+        if ( slab )
+        {
+            slab->GetExtent( slabExtent );
+        }
+
+        if ( !slab || !slab->GetPointData()->GetScalars() || slabExtent[0] > layerExtent[0] ||
+             slabExtent[1] < layerExtent[1] || slabExtent[2] > layerExtent[2] || slabExtent[3] < layerExtent[3] ||
+             slabExtent[4] > layerExtent[4] || slabExtent[5] < layerExtent[5] )
+        {
+            error = "cannot read the slices " + std::to_string( layerExtent[4] ) + " to " + std::to_string( layerExtent[5] );
+            break;
+        }
+
+        if ( layer == 0 )
+        {
+            scalarType = slab->GetScalarType();
+            components = slab->GetNumberOfScalarComponents();
+            scalarSize = slab->GetScalarSize();
+            slab->GetSpacing( spacing );
+            slab->GetOrigin( origin );
+        }
+
+        // Gather (and compress) the bricks of the layer in parallel, then write them in order
+        std::vector< std::vector<char> > stored( layerBricks );
+        auto pack = [this, slab, layer, layerBricks, compress, &stored]( vtkIdType begin, vtkIdType end )
+        {
+            for ( vtkIdType i = begin; i < end; i++ )
+            {
+                int brick = layer * layerBricks + static_cast<int>( i );
+                int brickExtent[6];
+                getBrickExtent( brick, brickExtent );
+
+                std::vector<char> voxels( getBrickBytes( brick ) );
+                std::size_t rowBytes = std::size_t( brickExtent[1] - brickExtent[0] + 1 ) * components * scalarSize;
+                char* target = voxels.data();
+
+                for ( int z = brickExtent[4]; z <= brickExtent[5]; z++ )
+                {
+                    for ( int y = brickExtent[2]; y <= brickExtent[3]; y++, target += rowBytes )
+                    {
+                        std::memcpy( target, slab->GetScalarPointer( brickExtent[0], y, z ), rowBytes );
+                    }
+                }
+
+                if ( compress )
+                {
+                    std::vector<char> packed( compressBound( static_cast<uLong>( voxels.size() ) ) );
+                    uLongf length = static_cast<uLongf>( packed.size() );
+
+                    // Bricks that do not shrink are stored raw
+                    if ( compress2( reinterpret_cast<Bytef*>( packed.data() ), &length,
+                                    reinterpret_cast<const Bytef*>( voxels.data() ),
+                                    static_cast<uLong>( voxels.size() ), Z_BEST_SPEED ) == Z_OK &&
+                         length < voxels.size() )
+                    {
+                        packed.resize( length );
+                        voxels.swap( packed );
+                    }
+                }
+
+                stored[i].swap( voxels );
+            }
+        };
+        vtkSMPTools::For( 0, static_cast<vtkIdType>( layerBricks ), 1, pack );
+
+        for ( int i = 0; i < layerBricks; i++ )
+        {
+            BrickRecord& record = records[layer * layerBricks + i];
+            record.offset = offset;
+            record.bytes  = static_cast<long long>( stored[i].size() );
+
+            file.write( stored[i].data(), stored[i].size() );
+            offset += record.bytes;
+        }
+
+        timer.addBytes( static_cast<double>( slab->GetActualMemorySize() ) * 1024.0 );
+    }
+
+    if ( error.empty() )
+    {
+        std::memcpy( header.magic, brickMagic, sizeof( brickMagic ) );
+        header.version     = brickVersion;
+        header.headerSize  = static_cast<int>( sizeof( header ) );
+        header.byteOrder   = brickByteOrder;
+        header.scalarType  = scalarType;
+        header.components  = components;
+        header.brickSize   = brickSize;
+        header.compression = compress ? 1 : 0;
+        header.brickCount  = brickCount;
+        std::copy( extent, extent + 6, header.extent );
+        std::copy( spacing, spacing + 3, header.spacing );
+        std::copy( origin, origin + 3, header.origin );
+
+        file.seekp( 0 );
+        file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+        file.write( reinterpret_cast<const char*>( records.data() ), records.size() * sizeof( BrickRecord ) );
+
+        if ( !file )
+        {
+            error = "cannot write " + outputFile;
+        }
+    }
+
+    file.close();
+
+    if ( !error.empty() )
+    {
+        records.clear();
+        vtksys::SystemTools::RemoveFile( outputFile );
+        return false;
+    }
+
+    // Read back the header that was written, so this volume describes the new file
+    return open( outputFile );
+}
+/***************************************************************************/
@@ -0,0 +1,158 @@
+/****************************************************************************
+*   brickVolume.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the bricked on-disk volume format.
+****************************************************************************/
+
+#ifndef BRICKVOLUME_H
+#define BRICKVOLUME_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+class vtkAlgorithm;
+
+/*
+*   A volume stored on disk as cubic bricks (64 x 64 x 64 voxels by default),
+*   so any sub-extent can be read without reading the whole volume.
+*
+*   The file (.bvol) is a fixed-size header, an index with the offset and
+*   stored size of every brick, then the bricks. Bricks are numbered and stored
+*   X fastest, then Y, then Z, so the bricks of one layer of slices are
+*   contiguous and a pass over the slabs reads the file front to back. The
+*   bricks at the high edges are clipped to the extent. Each brick is stored
+*   raw or compressed with zlib: a stored size equal to the raw size means raw.
+*
+*   Like the volume cache, the fields are stored in native byte order. Files
+*   written on a machine with another byte order are rejected by open().
+*/
+class BrickVolume
+{
+    public:
+        // The voxels of one brick (X fastest, components interleaved)
+        typedef std::shared_ptr< const std::vector<char> > Brick;
+
+        BrickVolume();
+
+        /*
+        *   Read the header and the index of a brick file.
+        *
+        *   @param   fileName   The .bvol file
+        *
+        *   @returns a boolean representing whether the file is a readable brick file
+        */
+        bool open( const std::string& fileName );
+
+        /*
+        *   @returns the reason open(), readBricks() or convert() failed
+        */
+        const std::string& getError() const { return error; }
+
+        const std::string& getFileName() const { return fileName; }
+        const int* getExtent() const { return extent; }
+        const double* getSpacing() const { return spacing; }
+        const double* getOrigin() const { return origin; }
+        int getScalarType() const { return scalarType; }
+        int getNumberOfComponents() const { return components; }
+        int getBrickSize() const { return brickSize; }
+        bool isCompressed() const { return compressed; }
+
+        /*
+        *   @returns the number of bricks, 0 before open()
+        */
+        int getNumberOfBricks() const { return static_cast<int>( records.size() ); }
+
+        /*
+        *   @param   brick         The brick index
+        *   @param   brickExtent   Receives the extent of the brick (clipped to the volume)
+        */
+        void getBrickExtent( int brick, int brickExtent[6] ) const;
+
+        /*
+        *   @returns the uncompressed size of a brick (bytes)
+        */
+        std::size_t getBrickBytes( int brick ) const;
+
+        /*
+        *   @returns the uncompressed size of one layer of bricks (bytes)
+        */
+        double getLayerBytes() const;
+
+        /*
+        *   @returns the stored size of all bricks (bytes)
+        */
+        double getStoredBytes() const;
+
+        /*
+        *   @param   request   An extent (clipped to the volume)
+        *
+        *   @returns the bricks that intersect the extent, in file order
+        */
+        std::vector<int> getBricks( const int request[6] ) const;
+
+        /*
+        *   Read bricks from the file. The stored bricks are read one after the
+        *   other in file order, then decompressed in parallel with vtkSMPTools.
+        *
+        *   @param   bricks   The brick indices
+        *   @param   data     Receives one brick per index, in the same order
+        *
+        *   @returns a boolean representing whether all bricks were read
+        */
+        bool readBricks( const std::vector<int>& bricks, std::vector<Brick>& data );
+
+        /*
+        *   Copy the part of a brick that intersects an image into the image.
+        *
+        *   @param   brick   The brick index
+        *   @param   data    The voxels of the brick
+        *   @param   image   An image with the scalar type and components of the volume
+        */
+        void copyBrick( int brick, const Brick& data, vtkImageData* image ) const;
+
+        /*
+        *   Write the first output of an image pipeline to a brick file.
+        *
+        *   The source is updated one layer of bricks (brickSize slices) at a time,
+        *   so only one layer is in memory, then the bricks of the layer are
+        *   compressed in parallel and written in order. This needs a source
+        *   that produces only the requested slices; a reader that always loads
+        *   the whole volume still works but needs the whole volume in memory.
+        *
+        *   @param   source       The reader (or filter) to convert
+        *   @param   outputFile   The .bvol file to write
+        *   @param   size         Edge length of the bricks (voxels)
+        *   @param   compress     Compress the bricks with zlib
+        *
+        *   @returns a boolean representing whether the file was written (see getError())
+        */
+        bool convert( vtkAlgorithm* source, const std::string& outputFile, int size, bool compress );
+
+    private:
+        struct BrickRecord
+        {
+            long long offset;
+            long long bytes;        // Stored size
+        };
+
+        std::string fileName;
+        std::string error;
+        int extent[6];
+        double spacing[3];
+        double origin[3];
+        int scalarType;
+        int components;
+        int scalarSize;
+        int brickSize;
+        bool compressed;
+        int brickCounts[3];
+        std::vector<BrickRecord> records;
+};
+
+#endif // BRICKVOLUME_H
@@ -0,0 +1,407 @@
+/****************************************************************************
+*   filterBank.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the registry of smoothing filters and
+*                   of the concurrent execution of the selected filters.
+****************************************************************************/
+
+#include "filterBank.hxx"
+#include "myImageMedian3D.hxx"
+#include "myImageRecursiveGaussian.hxx"
+#include "myImageBilateral3D.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <vtkThreadedImageAlgorithm.h>
+#include <vtkImageGaussianSmooth.h>
+#include <vtkImageAnisotropicDiffusion3D.h>
+
+/*
+*   A registered filter.
+*/
+struct RegisteredFilter
+{
+    std::string name;
+    std::string label;
+    std::map<std::string, double> defaults;
+    FilterBank::Factory factory;
+    FilterBank::SpatialParameters spatial;
+};
+
+static vtkSmartPointer<vtkImageAlgorithm> createGaussian( const FilterSpec& spec )
+{
+    if ( spec.get( "recursive" ) != 0.0 )
+    {
+        vtkSmartPointer<myImageRecursiveGaussian> recursiveFilter = vtkSmartPointer<myImageRecursiveGaussian>::New();
+        recursiveFilter->SetStandardDeviation( spec.get( "sigma" ) );
+
+        return recursiveFilter;
+    }
+
+    double radius = spec.get( "radius" );
+
+    vtkSmartPointer<vtkImageGaussianSmooth> smoothFilter = vtkSmartPointer<vtkImageGaussianSmooth>::New();
+    smoothFilter->SetStandardDeviation( spec.get( "sigma" ) );
+    smoothFilter->SetRadiusFactors( radius, radius, radius );
+    smoothFilter->SetDimensionality( 3 );
+
+    return smoothFilter;
+}
+
+static vtkSmartPointer<vtkImageAlgorithm> createMedian( const FilterSpec& spec )
+{
+    int kernel = std::max( 1, static_cast<int>( spec.get( "kernel" ) ) );
+
+    vtkSmartPointer<myImageMedian3D> medianFilter = vtkSmartPointer<myImageMedian3D>::New();
+    medianFilter->SetKernelSize( kernel, kernel, kernel );
+
+    return medianFilter;
+}
+
+static vtkSmartPointer<vtkImageAlgorithm> createDiffusion( const FilterSpec& spec )
+{
+    vtkSmartPointer<vtkImageAnisotropicDiffusion3D> diffusionFilter = vtkSmartPointer<vtkImageAnisotropicDiffusion3D>::New();
+    diffusionFilter->SetNumberOfIterations( static_cast<int>( spec.get( "iterations" ) ) );
+    diffusionFilter->SetDiffusionThreshold( spec.get( "threshold" ) );
+    diffusionFilter->SetDiffusionFactor( spec.get( "factor" ) );
+
+    return diffusionFilter;
+}
+
+static vtkSmartPointer<vtkImageAlgorithm> createBilateral( const FilterSpec& spec )
+{
+    vtkSmartPointer<myImageBilateral3D> bilateralFilter = vtkSmartPointer<myImageBilateral3D>::New();
+    bilateralFilter->SetSpatialStandardDeviation( spec.get( "sigma" ) );
+    bilateralFilter->SetRangeStandardDeviation( spec.get( "range" ) );
+
+    return bilateralFilter;
+}
+
+/*
+*   The registered filters in registration order, with the built-in filters first.
+*/
+static std::vector<RegisteredFilter>& registry()
+{
+    static std::vector<RegisteredFilter> filters;
+
+    if ( filters.empty() )
+    {
+        filters.push_back( { "gaussian", "Gaussian", { { "sigma", 1.0 }, { "radius", 1.0 }, { "recursive", 0.0 } },
+                             createGaussian, { { "sigma", FilterBank::SPATIAL_LENGTH } } } );
+        filters.push_back( { "median", "Median", { { "kernel", 5.0 } }, createMedian,
+                             { { "kernel", FilterBank::SPATIAL_KERNEL } } } );
+        filters.push_back( { "diffusion", "Diffusion", { { "iterations", 5.0 }, { "threshold", 5.0 }, { "factor", 1.0 } },
+                             createDiffusion, {} } );
+        filters.push_back( { "bilateral", "Bilateral", { { "sigma", 1.5 }, { "range", 50.0 } }, createBilateral,
+                             { { "sigma", FilterBank::SPATIAL_LENGTH } } } );
+    }
+
+    return filters;
+}
+
+/*
+*   @returns whether a parameter divides by its value and must be greater than 0
+*/
+static bool isPositiveParameter( const std::string& filter, const std::string& key )
+{
+    return filter == "bilateral" && ( key == "sigma" || key == "range" );
+}
+
+static const RegisteredFilter* findFilter( const std::string& name )
+{
+    std::vector<RegisteredFilter>& filters = registry();
+
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        if ( filters[i].name == name )
+        {
+            return &filters[i];
+        }
+    }
+
+    return nullptr;
+}
+
+/******************** Struct "FilterSpec" functions ********************/
+double FilterSpec::get( const std::string& key ) const
+{
+    std::map<std::string, double>::const_iterator it = parameters.find( key );
+    return ( it == parameters.end() ) ? 0.0 : it->second;
+}
+
+std::string FilterSpec::toString() const
+{
+    std::ostringstream text;
+    text << std::setprecision( 17 ) << name;
+
+    // The map keeps the keys sorted, so equal filters give equal strings
+    const char* separator = ":";
+    for ( std::map<std::string, double>::const_iterator it = parameters.begin(); it != parameters.end(); ++it )
+    {
+        text << separator << it->first << "=" << it->second;
+        separator = ",";
+    }
+
+    return text.str();
+}
+/***************************************************************************/
+
+/******************** Class "FilterBank" functions *********************/
+void FilterBank::registerFilter( const std::string& name, const std::string& label,
+                                 const std::map<std::string, double>& defaults, const Factory& factory,
+                                 const SpatialParameters& spatial )
+{
+    RegisteredFilter filter = { name, label, defaults, factory, spatial };
+
+    std::vector<RegisteredFilter>& filters = registry();
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        if ( filters[i].name == name )
+        {
+            filters[i] = filter;
+            return;
+        }
+    }
+
+    filters.push_back( filter );
+}
+
+bool FilterBank::parseSpec( const std::string& text, FilterSpec& spec )
+{
+    std::size_t colon = text.find( ':' );
+
+    spec = FilterSpec();
+    spec.name = text.substr( 0, colon );
+
+    const RegisteredFilter* filter = findFilter( spec.name );
+    if ( !filter )
+    {
+        std::cout << "ERROR: Unknown filter \"" << spec.name << "\". \n";
+        return false;
+    }
+
+    if ( colon == std::string::npos )
+    {
+        return true;
+    }
+
+    std::istringstream fields( text.substr( colon + 1 ) );
+    std::string field;
+
+    while ( std::getline( fields, field, ',' ) )
+    {
+        std::size_t equals = field.find( '=' );
+        std::string key    = field.substr( 0, equals );
+        std::string value  = ( equals == std::string::npos ) ? "" : field.substr( equals + 1 );
+
+        if ( filter->defaults.count( key ) == 0 )
+        {
+            std::cout << "ERROR: The " << spec.name << " filter has no parameter \"" << key << "\". \n";
+            return false;
+        }
+
+        char* end = nullptr;
+        double number = strtod( value.c_str(), &end );
+
+        if ( value.empty() || *end != '\0' || !std::isfinite( number ) || number < 0.0 )
+        {
+            std::cout << "ERROR: The " << spec.name << " parameter " << key << " expects a non-negative number, got \""
+                      << value << "\". \n";
+            return false;
+        }
+
+        if ( number == 0.0 && isPositiveParameter( spec.name, key ) )
+        {
+            std::cout << "ERROR: The " << spec.name << " parameter " << key << " must be greater than 0. \n";
+            return false;
+        }
+
+        spec.parameters[key] = number;
+    }
+
+    return true;
+}
+
+void FilterBank::complete( std::vector<FilterSpec>& specs )
+{
+    std::map<std::string, int> total, seen;
+    for ( std::size_t i = 0; i < specs.size(); i++ )
+    {
+        total[specs[i].name]++;
+    }
+
+    for ( std::size_t i = 0; i < specs.size(); i++ )
+    {
+        FilterSpec& spec = specs[i];
+        const RegisteredFilter* filter = findFilter( spec.name );
+
+        // insert() keeps the parameters that were given
+        spec.parameters.insert( filter->defaults.begin(), filter->defaults.end() );
+
+        // The first filter of a kind keeps the plain name, the others are numbered
+        int number = ++seen[spec.name];
+        spec.id    = spec.name;
+        spec.label = filter->label;
+
+        if ( number > 1 )
+        {
+            spec.id    += std::to_string( number );
+            spec.label += " " + std::to_string( number );
+        }
+        else if ( total[spec.name] > 1 )
+        {
+            spec.label += " 1";
+        }
+    }
+}
+
+FilterSpec FilterBank::coarsen( const FilterSpec& spec, int factor )
+{
+    FilterSpec coarse = spec;
+    const RegisteredFilter* filter = findFilter( spec.name );
+
+    if ( !filter || factor <= 1 )
+    {
+        return coarse;
+    }
+
+    for ( SpatialParameters::const_iterator spatial = filter->spatial.begin(); spatial != filter->spatial.end(); ++spatial )
+    {
+        std::map<std::string, double>::iterator it = coarse.parameters.find( spatial->first );
+        if ( it == coarse.parameters.end() )
+        {
+            continue;
+        }
+
+        double value = it->second;
+
+        if ( spatial->second == SPATIAL_KERNEL )
+        {
+            double radius = std::floor( ( value - 1.0 ) / ( 2.0 * factor ) + 0.5 );
+            it->second = std::max( 1.0, 2.0 * radius + 1.0 );
+        }
+        else
+        {
+            it->second = value / factor;
+        }
+    }
+
+    return coarse;
+}
+
+vtkSmartPointer<vtkImageAlgorithm> FilterBank::createFilter( const FilterSpec& spec )
+{
+    const RegisteredFilter* filter = findFilter( spec.name );
+    return filter ? filter->factory( spec ) : nullptr;
+}
+
+void FilterBank::printFilters( std::ostream& out )
+{
+    std::vector<RegisteredFilter>& filters = registry();
+
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        FilterSpec spec;
+        spec.name       = filters[i].name;
+        spec.parameters = filters[i].defaults;
+
+        out << "    " << spec.toString() << " \n";
+    }
+}
+
+void FilterBank::setNumberOfThreads( vtkAlgorithm* filter, int threads )
+{
+    threads = std::max( 1, threads );
+
+    vtkThreadedImageAlgorithm* threaded = vtkThreadedImageAlgorithm::SafeDownCast( filter );
+    if ( threaded )
+    {
+        threaded->SetNumberOfThreads( threads );
+    }
+
+    // The vtkSMPTools filters bound their number of tasks instead
+    myImageMedian3D* median = myImageMedian3D::SafeDownCast( filter );
+    if ( median )
+    {
+        median->SetNumberOfThreads( threads );
+    }
+
+    myImageRecursiveGaussian* gaussian = myImageRecursiveGaussian::SafeDownCast( filter );
+    if ( gaussian )
+    {
+        gaussian->SetNumberOfThreads( threads );
+    }
+}
+
+FilterBank::FilterBank( const std::vector<FilterSpec>& filterSpecs )
+    : specs( filterSpecs )
+{
+}
+
+std::vector< vtkSmartPointer<vtkImageData> > FilterBank::run( vtkImageData* input, int cores )
+{
+    int count = getNumberOfFilters();
+
+    std::vector< vtkSmartPointer<vtkImageData> > outputs( count );
+    seconds.assign( count, 0.0 );
+
+    if ( count == 0 )
+    {
+        return outputs;
+    }
+
+    // Each filter gets an equal share of the cores, the first ones one more for the remainder
+    cores = std::max( 1, cores );
+
+    // The pipelines of the threads must not share a data object, but the voxels are shared
+    std::vector< vtkSmartPointer<vtkImageAlgorithm> > filters( count );
+    for ( int i = 0; i < count; i++ )
+    {
+        vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+        copy->ShallowCopy( input );
+
+        filters[i] = createFilter( specs[i] );
+        filters[i]->SetInputData( copy );
+        setNumberOfThreads( filters[i], cores / count + ( i < cores % count ? 1 : 0 ) );
+    }
+
+    auto work = [&]( int i )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ScopedTimer timer( specs[i].label, "filter" );
+
+        filters[i]->Update();
+
+        // Copy the output, so the filter and its input copy can be freed
+        outputs[i] = vtkSmartPointer<vtkImageData>::New();
+        outputs[i]->ShallowCopy( filters[i]->GetOutput() );
+        timer.addBytes( ( input->GetActualMemorySize() + outputs[i]->GetActualMemorySize() ) * 1024.0 );
+
+        seconds[i] = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    };
+
+    std::vector<std::thread> threads;
+    for ( int i = 1; i < count; i++ )
+    {
+        threads.push_back( std::thread( work, i ) );
+    }
+    work( 0 );
+
+    for ( std::size_t i = 0; i < threads.size(); i++ )
+    {
+        threads[i].join();
+    }
+
+    return outputs;
+}
+/***************************************************************************/
@@ -0,0 +1,166 @@
+/****************************************************************************
+*   filterBank.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the registry of smoothing filters and of
+*                   the concurrent execution of the selected filters.
+****************************************************************************/
+
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageAlgorithm.h>
+
+/*
+*   A filter selected on the commandline: a registered name and its
+*   parameters, written "name:key=value,key=value" (e.g. "gaussian:sigma=2").
+*/
+struct FilterSpec
+{
+    std::string name;                           // Registered name, e.g. "gaussian"
+    std::string id;                             // Unique lowercase name for columns and options, e.g. "gaussian2"
+    std::string label;                          // Name shown in the viewer and the results, e.g. "Gaussian 2"
+    std::map<std::string, double> parameters;   // Every parameter of the filter, after FilterBank::complete()
+
+    /*
+    *   @returns a parameter, 0 if it is not set
+    */
+    double get( const std::string& key ) const;
+
+    /*
+    *   @returns whether a parameter is set
+    */
+    bool has( const std::string& key ) const { return parameters.count( key ) > 0; }
+
+    /*
+    *   @returns "name:key=value,..." with every parameter (used in the cache key)
+    */
+    std::string toString() const;
+};
+
+/*
+*   The filters applied to the original image.
+*
+*   Filters are registered by name with a label, default parameters and a
+*   factory. gaussian (vtkImageGaussianSmooth or myImageRecursiveGaussian),
+*   median (myImageMedian3D), diffusion (vtkImageAnisotropicDiffusion3D) and
+*   bilateral (myImageBilateral3D) are built in.
+*
+*   run() applies all filters at the same time, each on its own thread and its
+*   own shallow copy of the input (the voxels are shared and only read). The
+*   cores are split between the filters: threaded VTK filters get their share
+*   with SetNumberOfThreads(). Filters threaded with vtkSMPTools share the
+*   SMP thread pool instead.
+*/
+class FilterBank
+{
+    public:
+        typedef std::function< vtkSmartPointer<vtkImageAlgorithm>( const FilterSpec& ) > Factory;
+
+        // How a parameter measured in voxels follows the downsampling of coarsen()
+        enum SpatialParameter
+        {
+            SPATIAL_LENGTH = 0,     // Divided by the factor (e.g. a standard deviation)
+            SPATIAL_KERNEL          // An odd kernel size: 2r+1 becomes 2(r/factor)+1, at least 1
+        };
+        typedef std::map<std::string, SpatialParameter> SpatialParameters;
+
+        /*
+        *   Register a filter. Must be called before the options are parsed.
+        *
+        *   @param   name       Name used in --filter (lowercase)
+        *   @param   label      Name shown in the viewer and the results
+        *   @param   defaults   Every parameter of the filter with its default value
+        *   @param   factory    Creates a new, unconnected filter for a spec
+        *   @param   spatial    Parameters measured in voxels, scaled by coarsen()
+        */
+        static void registerFilter( const std::string& name, const std::string& label,
+                                    const std::map<std::string, double>& defaults, const Factory& factory,
+                                    const SpatialParameters& spatial = SpatialParameters() );
+
+        /*
+        *   Parse "name:key=value,...". Only the given parameters are set.
+        *
+        *   @param   text   The --filter value
+        *   @param   spec   The parsed filter
+        *
+        *   @returns a boolean representing whether the filter and its parameters exist
+        */
+        static bool parseSpec( const std::string& text, FilterSpec& spec );
+
+        /*
+        *   Fill in the default parameters and give each filter a unique id and label
+        *   (the second Gaussian becomes "gaussian2", "Gaussian 2").
+        *
+        *   @param   specs   The filters in commandline order
+        */
+        static void complete( std::vector<FilterSpec>& specs );
+
+        /*
+        *   The same filter for an image downsampled by a factor (see ImagePyramid):
+        *   the parameters measured in voxels are scaled down by the factor, so
+        *   the filter smooths about the same physical distance.
+        *
+        *   @param   spec     A completed spec
+        *   @param   factor   The downsampling factor
+        *
+        *   @returns the spec for the downsampled image
+        */
+        static FilterSpec coarsen( const FilterSpec& spec, int factor );
+
+        /*
+        *   @returns a new, unconnected filter for a completed spec
+        */
+        static vtkSmartPointer<vtkImageAlgorithm> createFilter( const FilterSpec& spec );
+
+        /*
+        *   Print the registered filters and their default parameters.
+        *
+        *   @param   out   The stream to print to
+        */
+        static void printFilters( std::ostream& out );
+
+        FilterBank( const std::vector<FilterSpec>& specs );
+
+        int getNumberOfFilters() const { return static_cast<int>( specs.size() ); }
+        const FilterSpec& getSpec( int filter ) const { return specs[filter]; }
+
+        /*
+        *   Apply every filter to an image, all at the same time.
+        *
+        *   @param   input   The original image
+        *   @param   cores   Cores to split between the filters
+        *
+        *   @returns the filtered images, in the order of the specs
+        */
+        std::vector< vtkSmartPointer<vtkImageData> > run( vtkImageData* input, int cores );
+
+        /*
+        *   @returns the wall time of each filter in the last run() (seconds)
+        */
+        const std::vector<double>& getSeconds() const { return seconds; }
+
+        /*
+        *   Set the threads of a threaded VTK filter, or bound the vtkSMPTools
+        *   tasks of myImageMedian3D and myImageRecursiveGaussian.
+        *
+        *   @param   filter    The filter
+        *   @param   threads   Number of threads
+        */
+        static void setNumberOfThreads( vtkAlgorithm* filter, int threads );
+
+    private:
+        std::vector<FilterSpec> specs;
+        std::vector<double> seconds;
+};
+
+#endif // FILTERBANK_H
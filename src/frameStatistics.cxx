@@ -0,0 +1,103 @@
+/****************************************************************************
+*   frameStatistics.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the frame time and input latency
+*                   statistics of the viewer.
+****************************************************************************/
+
+#include "frameStatistics.hxx"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+/*
+*   @returns the value at a fraction (0 - 1) of the sorted values, 0 if there are none
+*/
+static double percentile( std::vector<double> values, double fraction )
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+
+    std::size_t index = static_cast<std::size_t>( fraction * ( values.size() - 1 ) + 0.5 );
+    std::nth_element( values.begin(), values.begin() + index, values.end() );
+    return values[index];
+}
+
+static double mean( const std::vector<double>& values )
+{
+    double sum = 0.0;
+    for ( std::size_t i = 0; i < values.size(); i++ )
+    {
+        sum += values[i];
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+FrameStatistics::FrameStatistics()
+    : requests( 0 ), changedViewports( 0 )
+{
+}
+
+void FrameStatistics::addRequest()
+{
+    requests++;
+}
+
+void FrameStatistics::addFrame( double frameSeconds, double latencySeconds, int viewports )
+{
+    frameTimes.push_back( frameSeconds );
+    latencies.push_back( latencySeconds );
+    changedViewports += viewports;
+}
+
+std::string FrameStatistics::format() const
+{
+    // Average over the last frames, so the overlay does not flicker
+    std::size_t count = std::min<std::size_t>( frameTimes.size(), 30 );
+    double frameTime = 0.0, latency = 0.0;
+
+    for ( std::size_t i = frameTimes.size() - count; i < frameTimes.size(); i++ )
+    {
+        frameTime += frameTimes[i];
+        latency   += latencies[i];
+    }
+
+    std::stringstream tmp;
+    tmp << std::fixed << std::setprecision( 1 );
+    tmp << "Frame: " << ( count ? 1000.0 * frameTime / count : 0.0 ) << " ms, latency: "
+        << ( count ? 1000.0 * latency / count : 0.0 ) << " ms, renders: " << frameTimes.size()
+        << "/" << requests;
+    return tmp.str();
+}
+
+void FrameStatistics::print( std::ostream& out ) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::fixed << std::setprecision( 2 );
+    out << "Render requests: " << requests << ", frames drawn: " << frameTimes.size();
+    if ( !frameTimes.empty() )
+    {
+        out << ", viewports drawn per frame: " << double( changedViewports ) / frameTimes.size();
+    }
+    out << "\n";
+
+    if ( !frameTimes.empty() )
+    {
+        out << "Frame time (ms):       mean " << 1000.0 * mean( frameTimes ) << ", median "
+            << 1000.0 * percentile( frameTimes, 0.5 ) << ", 95% " << 1000.0 * percentile( frameTimes, 0.95 )
+            << ", max " << 1000.0 * percentile( frameTimes, 1.0 ) << "\n";
+        out << "Input latency (ms):    mean " << 1000.0 * mean( latencies ) << ", median "
+            << 1000.0 * percentile( latencies, 0.5 ) << ", 95% " << 1000.0 * percentile( latencies, 0.95 )
+            << ", max " << 1000.0 * percentile( latencies, 1.0 ) << "\n";
+    }
+
+    out.flags( flags );
+    out.precision( precision );
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+*   frameStatistics.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the frame time and input latency
+*                   statistics of the viewer.
+****************************************************************************/
+
+#ifndef FRAMESTATISTICS_H
+#define FRAMESTATISTICS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+*   Collects the interactive performance of the viewer: how many renders were
+*   requested, how many were drawn after coalescing, how long each render took
+*   and how long the oldest input of each frame waited until it was displayed.
+*/
+class FrameStatistics
+{
+    public:
+        FrameStatistics();
+
+        /*
+        *   Count one render request (one input event that changed the display).
+        */
+        void addRequest();
+
+        /*
+        *   Record a drawn frame.
+        *
+        *   @param   frameSeconds     Time spent in Render()
+        *   @param   latencySeconds   Time from the oldest request of the frame to the end of Render()
+        *   @param   viewports        Number of viewports drawn in the frame (the changed ones)
+        */
+        void addFrame( double frameSeconds, double latencySeconds, int viewports );
+
+        long getRequests() const { return requests; }
+        long getFrames() const { return static_cast<long>( frameTimes.size() ); }
+
+        /*
+        *   @returns a one-line summary of the last frames for the on-screen overlay
+        */
+        std::string format() const;
+
+        /*
+        *   Print the session summary: frame and request counts, and the mean,
+        *   median, 95th percentile and maximum of the frame times and latencies.
+        *
+        *   @param   out   The stream to print to
+        */
+        void print( std::ostream& out ) const;
+
+    private:
+        long requests;
+        long changedViewports;
+        std::vector<double> frameTimes;
+        std::vector<double> latencies;
+};
+
+#endif // FRAMESTATISTICS_H
@@ -11,6 +11,8 @@
 
 #include "helperFunctions.hxx"
 
+#include <cctype>
+
 /****************** Helper class "ImageMessage" functions ******************/
 std::string ImageMessage::sliceNumberFormat( int minSlice, int maxSlice ) 
 {
@@ -39,9 +41,782 @@ std::string ImageMessage::filterFormat( std::string text, double snr )
     tmp << "Filter:  " << text << ", SNR = " << std::setprecision(4) << snr;
     return tmp.str();
 }
+
+std::string ImageMessage::previewFormat( std::string text, double snr, int factor )
+{
+    std::stringstream tmp;
+    tmp << filterFormat( text, snr ) << " (" << factor << "x preview)";
+    return tmp.str();
+}
+
+std::string ImageMessage::thresholdFormat( double lower, double upper )
+{
+    std::stringstream tmp;
+    tmp << "Threshold: [" << lower << ", " << upper << "]";
+    return tmp.str();
+}
 /***************************************************************************/
 
 /************************* Other helper functions **************************/
+ProgramOptions::ProgramOptions()
+    : inputFile( "" ), inputType( -1 ), streamSlabSize( 0 ), gaussianStd( 1.0 ), recursiveGaussian( false ),
+      lowerThreshold( 0.0 ), upperThreshold( 0.0 ), hasLowerThreshold( false ), hasUpperThreshold( false ),
+      batchInput( "" ), outputFile( "" ), workers( 0 ), useCache( true ), cacheDirectory( "" ), cacheSizeMB( 4096.0 ),
+      lazySlices( false ), preview( false ), volumeSource( "" ), offscreenFile( "" ),
+      surfaceFile( "" ), surfaceTriangles( 0 ), signalMaskFile( "" ), noiseMaskFile( "" ),
+      noiseEstimator( NOISE_STD ), threads( 0 ), memoryBudgetMB( 0.0 ),
+      traceFile( "" ), brickFile( "" ), brickSize( 64 ), compressBricks( false ), brickCacheMB( 1024.0 ),
+      serveSocket( "" ), serveCacheMB( 8192.0 ), registerFile( "" ), registerLevels( 3 ), registerPoints( 50000 ),
+      registerSeconds( 30.0 )
+{
+}
+
+bool ProgramOptions::usesRegionSNR() const
+{
+    return !signalRegions.empty() || !noiseRegions.empty() || !signalMaskFile.empty() || !noiseMaskFile.empty() ||
+           noiseEstimator != NOISE_STD;
+}
+
+bool ProgramOptions::usesWholeExtentFilter() const
+{
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        if ( filters[i].name == "gaussian" && filters[i].get( "recursive" ) != 0.0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void printUsage( const char* programName )
+{
+    std::cout << "Correct usage: \n";
+    std::cout << programName << " <DICOM_Folder_Directory> [options] \n";
+    std::cout << "OR: \n";
+    std::cout << programName << " <NIfTI_File_Directory> [options] \n";
+    std::cout << "OR: \n";
+    std::cout << programName << " --batch <list_file|directory> --lower <value> --upper <value> [options] \n";
+    std::cout << "Options: \n";
+    std::cout << "  --stream <slices>      Filter and calculate the SNR in Z-slabs of <slices> slices \n";
+    std::cout << "  --filter <name[:k=v,...]> Apply a filter (repeatable, default: gaussian and median). Filters: \n";
+    FilterBank::printFilters( std::cout );
+    std::cout << "  --sigma <std>          Standard deviation of the Gaussian filters in voxels (default 1.0) \n";
+    std::cout << "  --recursive-gaussian   Use a recursive Gaussian (constant cost for any std) \n";
+    std::cout << "  --lower <value>        Lower threshold (skips the prompt) \n";
+    std::cout << "  --upper <value>        Upper threshold (skips the prompt) \n";
+    std::cout << "  --batch <list|dir>     Process every study in a list file or directory without rendering \n";
+    std::cout << "  --workers <n>          Studies processed at the same time in batch mode (default 1), requests with --serve (default 4) \n";
+    std::cout << "  --output <file>        Batch results file, .csv or .json (default: CSV on the standard output) \n";
+    std::cout << "  --config <file>        Read options from a file with one \"key = value\" per line \n";
+    std::cout << "  --sweep <file>         Compute the SNR for every \"lower upper\" pair in the file from one histogram \n";
+    std::cout << "  --no-cache             Do not read or write the cache of loaded and filtered volumes \n";
+    std::cout << "  --cache-dir <dir>      Cache directory (default: $VTKMETRICS_CACHE_DIR or ~/.cache/vtkMetrics) \n";
+    std::cout << "  --cache-size <MB>      Size limit of the cache, oldest entries are deleted first (default 4096) \n";
+    std::cout << "  --lazy                 Open the viewer first and filter the displayed slices on demand \n";
+    std::cout << "  --preview              Open the viewer with an 8x downsampled preview, refined in the background \n";
+    std::cout << "  --volume <name>        Show original|<filter>|segmentation|surface in 3D when the viewer opens \n";
+    std::cout << "  --offscreen <file>     Render the viewer once without a window and save it as a PNG file \n";
+    std::cout << "  --surface <file>       Extract the segmentation surface and save it as .stl or .obj \n";
+    std::cout << "  --surface-triangles <n> Decimate the surface to about <n> triangles (default 0 = keep all) \n";
+    std::cout << "  --signal-roi <x0,x1,y0,y1,z0,z1> Signal box in voxels (repeatable, default: voxels in [lower, upper]) \n";
+    std::cout << "  --noise-roi <x0,x1,y0,y1,z0,z1>  Noise box in voxels (repeatable, default: voxels outside [lower, upper]) \n";
+    std::cout << "  --signal-mask <image>  Signal region: nonzero voxels of an image on the same grid \n";
+    std::cout << "  --noise-mask <image>   Noise region: nonzero voxels of an image on the same grid \n";
+    std::cout << "  --noise <std|mad|rayleigh> Noise estimator (default std) \n";
+    std::cout << "  --threads <n>          Threads of the processing (default: all cores) \n";
+    std::cout << "  --memory-budget <MB>   Fail before reading or filtering when the images would exceed <MB> \n";
+    std::cout << "  --trace <file.json>    Time every stage, print a summary and write a Chrome trace \n";
+    std::cout << "  --convert-bricks <file.bvol> Convert the input into a bricked volume for out-of-core reading and exit \n";
+    std::cout << "  --brick-size <n>       Edge length of the bricks of a conversion in voxels (default 64) \n";
+    std::cout << "  --compress-bricks      Compress the bricks of a conversion with zlib (lossless) \n";
+    std::cout << "  --brick-cache <MB>     Memory for the decoded bricks when reading a .bvol file (default 1024) \n";
+    std::cout << "  --serve <socket>       Answer snr/segment/stats/shutdown requests on a Unix socket, keeping studies in memory \n";
+    std::cout << "  --serve-cache <MB>     Memory for the studies kept by --serve, least recently used first out (default 8192) \n";
+    std::cout << "  --register <file>      Align the input to a reference surface (.stl/.obj) or scan before the SNR \n";
+    std::cout << "  --register-levels <n>  Levels of the coarse to fine registration (default 3) \n";
+    std::cout << "  --register-points <n>  Surface points of the finest registration level (default 50000, 0 = all) \n";
+    std::cout << "  --register-time <s>    Time limit of the registration in seconds (default 30, 0 = none) \n";
+}
+
+/*
+*   Read a number for an option. Fails if the text is not a complete number.
+*/
+static bool parseNumber( const std::string& option, const std::string& text, double& value )
+{
+    char* end = nullptr;
+    value = strtod( text.c_str(), &end );
+
+    if ( text.empty() || *end != '\0' )
+    {
+        std::cout << "ERROR: " << option << " expects a number, got \"" << text << "\". \n";
+        return false;
+    }
+
+    return true;
+}
+
+/*
+*   Read a box "x0,x1,y0,y1,z0,z1" for an option. Fails unless there are six
+*   whole numbers and each minimum is at most its maximum.
+*/
+static bool parseBox( const std::string& option, const std::string& text, RegionBox& box )
+{
+    std::istringstream fields( text );
+    std::string field;
+    int count = 0;
+
+    while ( std::getline( fields, field, ',' ) )
+    {
+        char* end = nullptr;
+        long number = strtol( field.c_str(), &end, 10 );
+
+        if ( count == 6 || field.empty() || *end != '\0' )
+        {
+            count = -1;
+            break;
+        }
+
+        box.extent[count++] = static_cast<int>( number );
+    }
+
+    if ( count != 6 || box.extent[0] > box.extent[1] || box.extent[2] > box.extent[3] || box.extent[4] > box.extent[5] )
+    {
+        std::cout << "ERROR: " << option << " expects x0,x1,y0,y1,z0,z1 with each minimum at most its maximum, got \""
+                  << text << "\". \n";
+        return false;
+    }
+
+    return true;
+}
+
+/*
+*   Apply a list of arguements to the options. Shared by the commandline and the config file.
+*
+*   @param   args               The arguements (without the program name)
+*   @param   options            The parsed options
+*   @param   allowPositional    Whether an input image may be given without an option name
+*   @param   allowConfig        Whether --config may be used
+*
+*   @returns a boolean representing whether the arguements are valid
+*/
+static bool parseOptionList( const std::vector<std::string>& args, ProgramOptions& options,
+                             bool allowPositional, bool allowConfig )
+{
+    for ( std::size_t i = 0; i < args.size(); i++ )
+    {
+        const std::string& arg = args[i];
+        bool hasValue = ( i + 1 < args.size() );
+        double value = 0.0;
+
+        if ( arg == "--stream" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.streamSlabSize = static_cast<int>( value );
+
+            if ( options.streamSlabSize <= 0 )
+            {
+                std::cout << "ERROR: The slab size must be a positive number of slices. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--sigma" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.gaussianStd ) )
+            {
+                return false;
+            }
+
+            if ( options.gaussianStd <= 0.0 )
+            {
+                std::cout << "ERROR: The standard deviation must be positive. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--recursive-gaussian" )
+        {
+            options.recursiveGaussian = true;
+        }
+        else if ( arg == "--filter" && hasValue )
+        {
+            FilterSpec spec;
+            if ( !FilterBank::parseSpec( args[++i], spec ) )
+            {
+                return false;
+            }
+            options.filters.push_back( spec );
+        }
+        else if ( arg == "--lower" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.lowerThreshold ) )
+            {
+                return false;
+            }
+            options.hasLowerThreshold = true;
+        }
+        else if ( arg == "--upper" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.upperThreshold ) )
+            {
+                return false;
+            }
+            options.hasUpperThreshold = true;
+        }
+        else if ( arg == "--batch" && hasValue )
+        {
+            options.batchInput = args[++i];
+        }
+        else if ( arg == "--output" && hasValue )
+        {
+            options.outputFile = args[++i];
+        }
+        else if ( arg == "--workers" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.workers = static_cast<int>( value );
+
+            if ( options.workers <= 0 )
+            {
+                std::cout << "ERROR: The number of workers must be positive. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--sweep" && hasValue )
+        {
+            if ( !loadThresholdPairs( args[++i], options.sweepThresholds ) )
+            {
+                return false;
+            }
+        }
+        else if ( arg == "--lazy" )
+        {
+            options.lazySlices = true;
+        }
+        else if ( arg == "--preview" )
+        {
+            options.preview = true;
+        }
+        else if ( arg == "--volume" && hasValue )
+        {
+            // Checked once the filters are known
+            options.volumeSource = args[++i];
+        }
+        else if ( arg == "--offscreen" && hasValue )
+        {
+            options.offscreenFile = args[++i];
+        }
+        else if ( arg == "--surface" && hasValue )
+        {
+            options.surfaceFile = args[++i];
+        }
+        else if ( arg == "--surface-triangles" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.surfaceTriangles = static_cast<vtkIdType>( value );
+
+            if ( options.surfaceTriangles < 0 )
+            {
+                std::cout << "ERROR: The triangle budget cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( ( arg == "--signal-roi" || arg == "--noise-roi" ) && hasValue )
+        {
+            RegionBox box;
+            if ( !parseBox( arg, args[++i], box ) )
+            {
+                return false;
+            }
+            ( arg == "--signal-roi" ? options.signalRegions : options.noiseRegions ).push_back( box );
+        }
+        else if ( arg == "--signal-mask" && hasValue )
+        {
+            options.signalMaskFile = args[++i];
+        }
+        else if ( arg == "--noise-mask" && hasValue )
+        {
+            options.noiseMaskFile = args[++i];
+        }
+        else if ( arg == "--noise" && hasValue )
+        {
+            if ( !RegionStatistics::estimatorFromName( args[++i], options.noiseEstimator ) )
+            {
+                std::cout << "ERROR: --noise expects std, mad or rayleigh, got \"" << args[i] << "\". \n";
+                return false;
+            }
+        }
+        else if ( arg == "--no-cache" )
+        {
+            options.useCache = false;
+        }
+        else if ( arg == "--cache-dir" && hasValue )
+        {
+            options.cacheDirectory = args[++i];
+        }
+        else if ( arg == "--trace" && hasValue )
+        {
+            options.traceFile = args[++i];
+        }
+        else if ( arg == "--convert-bricks" && hasValue )
+        {
+            options.brickFile = args[++i];
+        }
+        else if ( arg == "--brick-size" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.brickSize = static_cast<int>( value );
+
+            if ( options.brickSize < 8 || options.brickSize > 512 )
+            {
+                std::cout << "ERROR: The brick size must be between 8 and 512 voxels. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--compress-bricks" )
+        {
+            options.compressBricks = true;
+        }
+        else if ( arg == "--brick-cache" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.brickCacheMB ) )
+            {
+                return false;
+            }
+
+            if ( options.brickCacheMB < 0.0 )
+            {
+                std::cout << "ERROR: The brick cache size cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--serve" && hasValue )
+        {
+            options.serveSocket = args[++i];
+        }
+        else if ( arg == "--serve-cache" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.serveCacheMB ) )
+            {
+                return false;
+            }
+
+            if ( options.serveCacheMB <= 0.0 )
+            {
+                std::cout << "ERROR: The server cache size must be positive. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--register" && hasValue )
+        {
+            options.registerFile = args[++i];
+        }
+        else if ( arg == "--register-levels" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.registerLevels = static_cast<int>( value );
+
+            if ( options.registerLevels < 1 || options.registerLevels > 8 )
+            {
+                std::cout << "ERROR: The registration levels must be between 1 and 8. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--register-points" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.registerPoints = static_cast<vtkIdType>( value );
+
+            if ( options.registerPoints < 0 )
+            {
+                std::cout << "ERROR: The registration points cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--register-time" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.registerSeconds ) )
+            {
+                return false;
+            }
+
+            if ( options.registerSeconds < 0.0 )
+            {
+                std::cout << "ERROR: The registration time limit cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--threads" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], value ) )
+            {
+                return false;
+            }
+            options.threads = static_cast<int>( value );
+
+            if ( options.threads <= 0 )
+            {
+                std::cout << "ERROR: The number of threads must be positive. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--memory-budget" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.memoryBudgetMB ) )
+            {
+                return false;
+            }
+
+            if ( options.memoryBudgetMB < 0.0 )
+            {
+                std::cout << "ERROR: The memory budget cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--cache-size" && hasValue )
+        {
+            if ( !parseNumber( arg, args[++i], options.cacheSizeMB ) )
+            {
+                return false;
+            }
+
+            if ( options.cacheSizeMB < 0.0 )
+            {
+                std::cout << "ERROR: The cache size cannot be negative. \n";
+                return false;
+            }
+        }
+        else if ( arg == "--config" && hasValue && allowConfig )
+        {
+            if ( !loadConfigFile( args[++i], options ) )
+            {
+                return false;
+            }
+        }
+        else if ( arg.compare( 0, 2, "--" ) == 0 || !allowPositional )
+        {
+            std::cout << "ERROR: Unknown or incomplete option " << arg << "\n";
+            return false;
+        }
+        else if ( options.inputFile.empty() )
+        {
+            options.inputFile = arg;
+        }
+        else
+        {
+            std::cout << "ERROR: More than one input was provided. \n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool loadConfigFile( const std::string& fileName, ProgramOptions& options )
+{
+    std::ifstream file( fileName.c_str() );
+
+    if ( !file )
+    {
+        std::cout << "ERROR: Cannot open the config file " << fileName << "\n";
+        return false;
+    }
+
+    // Every "key = value" line becomes "--key value". Flags take a yes/no value.
+    std::vector<std::string> args;
+    std::string line;
+
+    while ( std::getline( file, line ) )
+    {
+        line = line.substr( 0, line.find( '#' ) );
+
+        std::size_t equals = line.find( '=' );
+        std::string key    = line.substr( 0, equals );
+        std::string value  = ( equals == std::string::npos ) ? "" : line.substr( equals + 1 );
+
+        key.erase( 0, key.find_first_not_of( " \t\r" ) );
+        key.erase( key.find_last_not_of( " \t\r" ) + 1 );
+        value.erase( 0, value.find_first_not_of( " \t\r" ) );
+        value.erase( value.find_last_not_of( " \t\r" ) + 1 );
+
+        if ( key.empty() )
+        {
+            continue;
+        }
+
+        if ( key == "recursive-gaussian" || key == "no-cache" || key == "lazy" || key == "preview" ||
+             key == "compress-bricks" )
+        {
+            if ( value.empty() || value == "1" || value == "yes" || value == "true" )
+            {
+                args.push_back( "--" + key );
+            }
+            continue;
+        }
+
+        args.push_back( "--" + key );
+        args.push_back( value );
+    }
+
+    return parseOptionList( args, options, false, false );
+}
+
+bool loadThresholdPairs( const std::string& fileName, std::vector< std::pair<double, double> >& thresholds )
+{
+    std::ifstream file( fileName.c_str() );
+
+    if ( !file )
+    {
+        std::cout << "ERROR: Cannot open the threshold file " << fileName << "\n";
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+
+    while ( std::getline( file, line ) )
+    {
+        lineNumber++;
+        line = line.substr( 0, line.find( '#' ) );
+        std::replace( line.begin(), line.end(), ',', ' ' );
+
+        std::istringstream fields( line );
+        std::string lower, upper, extra;
+
+        if ( !( fields >> lower ) )
+        {
+            continue;
+        }
+
+        std::pair<double, double> pair;
+        if ( !( fields >> upper ) || ( fields >> extra ) ||
+             !parseNumber( "The lower threshold", lower, pair.first ) ||
+             !parseNumber( "The upper threshold", upper, pair.second ) )
+        {
+            std::cout << "ERROR: Line " << lineNumber << " of " << fileName << " is not a \"lower upper\" pair. \n";
+            return false;
+        }
+
+        thresholds.push_back( pair );
+    }
+
+    if ( thresholds.empty() )
+    {
+        std::cout << "ERROR: No threshold pairs were found in " << fileName << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool parseArguments( int argc, char* argv[], ProgramOptions& options )
+{
+    // Options given after --config override the values in the file
+    std::vector<std::string> args( argv + 1, argv + argc );
+
+    if ( !parseOptionList( args, options, true, true ) )
+    {
+        return false;
+    }
+
+    // Without --filter, the Gaussian and median filters of the original viewer
+    if ( options.filters.empty() )
+    {
+        FilterSpec gaussian, median;
+        FilterBank::parseSpec( "gaussian", gaussian );
+        FilterBank::parseSpec( "median:kernel=5", median );
+        options.filters.push_back( gaussian );
+        options.filters.push_back( median );
+    }
+
+    // --sigma and --recursive-gaussian apply to the Gaussian filters that do not set them
+    for ( std::size_t i = 0; i < options.filters.size(); i++ )
+    {
+        FilterSpec& spec = options.filters[i];
+        if ( spec.name == "gaussian" )
+        {
+            spec.parameters.insert( std::make_pair( "sigma", options.gaussianStd ) );
+            spec.parameters.insert( std::make_pair( "recursive", options.recursiveGaussian ? 1.0 : 0.0 ) );
+        }
+    }
+
+    FilterBank::complete( options.filters );
+
+    if ( !options.volumeSource.empty() )
+    {
+        bool known = options.volumeSource == "original" || options.volumeSource == "segmentation" ||
+                     options.volumeSource == "surface";
+
+        for ( std::size_t i = 0; i < options.filters.size(); i++ )
+        {
+            known = known || options.volumeSource == options.filters[i].id;
+        }
+
+        if ( !known )
+        {
+            std::cout << "ERROR: --volume expects original, segmentation, surface or a filter name";
+            for ( std::size_t i = 0; i < options.filters.size(); i++ )
+            {
+                std::cout << ( i == 0 ? " (" : ", " ) << options.filters[i].id;
+            }
+            std::cout << "). \n";
+            return false;
+        }
+    }
+
+    if ( !options.sweepThresholds.empty() && options.streamSlabSize > 0 )
+    {
+        std::cout << "ERROR: --sweep needs the whole images and cannot be used with --stream. \n";
+        return false;
+    }
+
+    if ( options.usesWholeExtentFilter() && options.streamSlabSize > 0 )
+    {
+        std::cout << "ERROR: The recursive Gaussian filters whole lines of the volume and cannot be used with --stream. \n";
+        return false;
+    }
+
+    if ( options.lazySlices && options.streamSlabSize > 0 )
+    {
+        std::cout << "ERROR: --lazy keeps the original image in memory and cannot be used with --stream. \n";
+        return false;
+    }
+
+    if ( options.preview && ( options.streamSlabSize > 0 || options.lazySlices ) )
+    {
+        std::cout << "ERROR: --preview needs the whole original image and cannot be used with --stream or --lazy. \n";
+        return false;
+    }
+
+    if ( !options.volumeSource.empty() && options.streamSlabSize > 0 )
+    {
+        std::cout << "ERROR: --volume needs the whole images and cannot be used with --stream. \n";
+        return false;
+    }
+
+    if ( !options.surfaceFile.empty() && options.streamSlabSize > 0 )
+    {
+        std::cout << "ERROR: --surface needs the whole image and cannot be used with --stream. \n";
+        return false;
+    }
+
+    if ( options.usesRegionSNR() &&
+         ( options.streamSlabSize > 0 || options.lazySlices || options.preview || !options.sweepThresholds.empty() ) )
+    {
+        std::cout << "ERROR: The region SNR (--signal-roi, --noise-roi, --signal-mask, --noise-mask, --noise) cannot be "
+                     "used with --stream, --lazy, --preview or --sweep. \n";
+        return false;
+    }
+
+    if ( !options.brickFile.empty() )
+    {
+        const std::string& name = options.brickFile;
+        if ( name.size() <= 5 || name.compare( name.size() - 5, 5, ".bvol" ) != 0 )
+        {
+            std::cout << "ERROR: The file of --convert-bricks must have the .bvol extension. \n";
+            return false;
+        }
+
+        if ( !options.batchInput.empty() || !options.sweepThresholds.empty() )
+        {
+            std::cout << "ERROR: --convert-bricks converts a single input and cannot be used with --batch or --sweep. \n";
+            return false;
+        }
+    }
+
+    if ( !options.registerFile.empty() )
+    {
+        if ( !options.batchInput.empty() || !options.sweepThresholds.empty() || !options.serveSocket.empty() ||
+             !options.brickFile.empty() || options.streamSlabSize > 0 || options.lazySlices || options.preview )
+        {
+            std::cout << "ERROR: --register resamples a single whole image and cannot be used with --batch, --sweep, "
+                         "--serve, --convert-bricks, --stream, --lazy or --preview. \n";
+            return false;
+        }
+
+        std::string reference = options.registerFile;
+        std::transform( reference.begin(), reference.end(), reference.begin(), ::tolower );
+        bool surface = reference.size() > 4 && ( reference.compare( reference.size() - 4, 4, ".stl" ) == 0 ||
+                                                 reference.compare( reference.size() - 4, 4, ".obj" ) == 0 );
+
+        if ( !surface && classifyInput( options.registerFile ) < 0 )
+        {
+            std::cout << "ERROR: The reference of --register must be a .stl or .obj surface, a DICOM directory, "
+                         "a NIfTI file or a .bvol file. \n";
+            return false;
+        }
+
+        // The surfaces are extracted at the thresholds before filtering
+        if ( !options.hasLowerThreshold || !options.hasUpperThreshold )
+        {
+            std::cout << "ERROR: --register needs both --lower and --upper. \n";
+            return false;
+        }
+    }
+
+    // With signal and noise regions the SNR does not depend on the thresholds
+    bool regionsOnly = ( !options.signalRegions.empty() || !options.signalMaskFile.empty() ) &&
+                       ( !options.noiseRegions.empty() || !options.noiseMaskFile.empty() );
+
+    if ( !options.serveSocket.empty() )
+    {
+        if ( !options.inputFile.empty() || !options.batchInput.empty() || !options.sweepThresholds.empty() ||
+             options.streamSlabSize > 0 || !options.brickFile.empty() || options.usesRegionSNR() )
+        {
+            std::cout << "ERROR: --serve takes the studies and thresholds from its requests and cannot be used with an "
+                         "input, --batch, --sweep, --stream, --convert-bricks or the region SNR. \n";
+            return false;
+        }
+
+        return true;
+    }
+
+    if ( !options.batchInput.empty() )
+    {
+        if ( !options.inputFile.empty() )
+        {
+            std::cout << "ERROR: Give the inputs either with --batch or as a single input, not both. \n";
+            return false;
+        }
+
+        if ( options.sweepThresholds.empty() && !regionsOnly && ( !options.hasLowerThreshold || !options.hasUpperThreshold ) )
+        {
+            std::cout << "ERROR: Batch mode needs both --lower and --upper, --sweep, or signal and noise regions. \n";
+            return false;
+        }
+
+        return true;
+    }
+
+    if ( options.inputFile.empty() )
+    {
+        return false;
+    }
+
+    // Verify that the provided input arguement is valid
+    options.inputType = checkInputs( options.inputFile );
+
+    return ( options.inputType == 0 || options.inputType == 1 || options.inputType == 2 );
+}
+
 int checkInputs( std::string imageFile )
 {
     int validFile = -1;
@@ -59,6 +834,21 @@ int checkInputs( std::string imageFile )
     */
     std::size_t imagePeriod = imageFile.find_last_of(".");
 
+    // Compressed NIfTI files have a two-part extension
+    if ( imageFile.length() > 7 && imageFile.compare( imageFile.length() - 7, 7, ".nii.gz" ) == 0 )
+    {
+        std::cerr << "Reading compressed NIfTI image..." << std::endl;
+        return 1;
+    }
+
+    // Bricked volumes written by --convert-bricks have a four-letter extension, which the
+    // three-letter check below would take for a directory
+    if ( imageFile.length() > 5 && imageFile.compare( imageFile.length() - 5, 5, ".bvol" ) == 0 )
+    {
+        std::cerr << "Reading bricked volume..." << std::endl;
+        return 2;
+    }
+
     /* 
     *   We can have potential problems here where a period is included in the file path.
     *   For this assignment, file extensions will only be ".dcm".
@@ -70,13 +860,13 @@ int checkInputs( std::string imageFile )
 
         // First input is a directory containing a DICOM series
         validFile = 0;
-        std::cout << "First input arguement is a directory. Checking contents of the directory... \n";
-        std::cout << "Reading DICOM series from " << imageFile << "... \n";
+        std::cerr << "First input arguement is a directory. Checking contents of the directory... \n";
+        std::cerr << "Reading DICOM series from " << imageFile << "... \n";
     }
     else if ( imagePeriod != std::string::npos )
     {
         // Input is a file. Check filetype.
-        std::cout << "Input provided is a file. Checking the filetype... \n";
+        std::cerr << "Input provided is a file. Checking the filetype... \n";
         
         std::string fileExtension;
         fileExtension.assign(imageFile, imagePeriod, 4);
@@ -87,7 +877,7 @@ int checkInputs( std::string imageFile )
         }
         else if ( fileExtension == ".nii" )
         {
-            std::cout << "Reading NIfTI image..." << std::endl;
+            std::cerr << "Reading NIfTI image..." << std::endl;
             validFile = 1;
         }
         else
@@ -99,9 +889,57 @@ int checkInputs( std::string imageFile )
     {
         // Only accept DICOM or NIfTI filet ypes.
         validFile = -1;
-        std::cout << "ERROR: Incorrect input arguement. Please provide a valid DICOM directory or NIfTI file. \n";
+        std::cerr << "ERROR: Incorrect input arguement. Please provide a valid DICOM directory or NIfTI file. \n";
     }   
 
     return validFile;
 }
+
+/*
+*   Read a mask image and add it to the region statistics.
+*/
+static bool addMaskFile( const std::string& fileName, bool signal, RegionStatistics& statistics )
+{
+    vtkSmartPointer<vtkImageReader2> reader = createImageReader( fileName, checkInputs( fileName ) );
+
+    if ( !reader )
+    {
+        std::cerr << "ERROR: Cannot read the mask " << fileName << "\n";
+        return false;
+    }
+
+    reader->Update();
+
+    bool added = signal ? statistics.addSignalMask( reader->GetOutput() ) : statistics.addNoiseMask( reader->GetOutput() );
+    if ( !added )
+    {
+        std::cerr << "ERROR: The mask " << fileName << " has no nonzero voxel. \n";
+        return false;
+    }
+
+    return true;
+}
+
+bool setupRegionStatistics( const ProgramOptions& options, RegionStatistics& statistics )
+{
+    statistics.setThresholds( options.lowerThreshold, options.upperThreshold );
+    statistics.setNoiseEstimator( options.noiseEstimator );
+
+    for ( std::size_t i = 0; i < options.signalRegions.size(); i++ )
+    {
+        statistics.addSignalRegion( options.signalRegions[i] );
+    }
+    for ( std::size_t i = 0; i < options.noiseRegions.size(); i++ )
+    {
+        statistics.addNoiseRegion( options.noiseRegions[i] );
+    }
+
+    if ( !options.signalMaskFile.empty() && !addMaskFile( options.signalMaskFile, true, statistics ) )
+    {
+        return false;
+    }
+
+    return options.noiseMaskFile.empty() || addMaskFile( options.noiseMaskFile, false, statistics );
+}
+
 /***************************************************************************/
\ No newline at end of file
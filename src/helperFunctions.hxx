@@ -10,6 +10,11 @@
 #ifndef HELPERFUNCTIONS_H
 #define HELPERFUNCTIONS_H
 
+#include "filterBank.hxx"
+#include "jsonText.hxx"
+#include "metricsCore.hxx"
+#include "regionStatistics.hxx"
+
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -17,6 +22,9 @@
 #include <vector>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <fstream>
 
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -45,6 +53,7 @@
 #include <vtkSmartPointer.h>
 #include <vtkObjectFactory.h>
 #include <vtkImageAlgorithm.h>
+#include <vtkImageReader2.h>
 
 #include <vtkImageGaussianSmooth.h>
 #include <vtkImageMedian3D.h>
@@ -111,22 +120,157 @@ class ImageMessage
         static std::string windowFormat( int window );
 
         static std::string filterFormat( std::string text, double snr );
+
+        /*
+        *   Create a filter message with the provisional SNR of a downsampled image.
+        *
+        *   @param   text     The image name
+        *   @param   snr      The SNR of the downsampled image
+        *   @param   factor   The downsampling factor
+        *
+        *   @returns A string with the preview message
+        */
+        static std::string previewFormat( std::string text, double snr, int factor );
+
+        /*
+        *   Create a message that shows the current segmentation thresholds.
+        *
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        *
+        *   @returns A string with the threshold message
+        */
+        static std::string thresholdFormat( double lower, double upper );
 };
 
 /************************* Other helper functions **************************/
 
+/*
+*   Options provided in the commandline when running the program.
+*/
+struct ProgramOptions
+{
+    ProgramOptions();
+
+    std::string inputFile;      // DICOM directory, NIfTI file or brick file
+    int inputType;              // 0 = DICOM, 1 = NIfTI, 2 = brick file (see checkInputs)
+    int streamSlabSize;         // Slices per slab in streaming mode, 0 = load the whole volume
+    double gaussianStd;         // Standard deviation of the Gaussian filters without a sigma parameter (voxels)
+    bool recursiveGaussian;     // Gaussian filters without a recursive parameter use the recursive Gaussian
+    std::vector<FilterSpec> filters;    // Filters applied to the image (--filter), Gaussian and median by default
+    double lowerThreshold;      // Lower threshold, used instead of the prompt when given
+    double upperThreshold;      // Upper threshold, used instead of the prompt when given
+    bool hasLowerThreshold;
+    bool hasUpperThreshold;
+    std::string batchInput;     // List file or directory of studies, empty = interactive mode
+    std::string outputFile;     // Batch results (.csv or .json), empty = CSV on the standard output
+    int workers;                // Studies (batch mode) or requests (--serve) processed at the same time, 0 = the default of the mode
+    std::vector< std::pair<double, double> > sweepThresholds;  // (lower, upper) pairs of a sweep, empty = no sweep
+    bool useCache;              // Keep the loaded and filtered volumes on disk for later runs
+    std::string cacheDirectory; // Cache directory, empty = the default (see VolumeCache)
+    double cacheSizeMB;         // Size limit of the cache directory in MB
+    bool lazySlices;            // Open the viewer before filtering and filter the displayed slices on demand
+    bool preview;               // Open the viewer with the filters and SNR of a downsampled image, refine in the background
+    std::string volumeSource;   // Volume shown in 3D when the viewer opens (see VolumeView), empty = the 2D slice
+    std::string offscreenFile;  // Render the viewer once without a window into this PNG file, empty = interactive
+    std::string surfaceFile;    // Extract the segmentation surface into this .stl or .obj file, empty = no export
+    vtkIdType surfaceTriangles; // Triangle budget of the surface, 0 = no decimation
+    std::vector<RegionBox> signalRegions;   // Signal boxes (--signal-roi), empty = the voxels in [lower, upper]
+    std::vector<RegionBox> noiseRegions;    // Noise boxes (--noise-roi), empty = the voxels outside [lower, upper]
+    std::string signalMaskFile; // Signal mask image (--signal-mask), empty = none
+    std::string noiseMaskFile;  // Noise mask image (--noise-mask), empty = none
+    NoiseEstimator noiseEstimator;  // Estimator of the noise standard deviation (--noise)
+    int threads;                // Threads of the processing (split between batch workers), 0 = all cores
+    double memoryBudgetMB;      // Limit of the original and filtered images of a study in MB, 0 = no limit
+    std::string traceFile;      // Chrome trace JSON of the stage timings, empty = no tracing
+    std::string brickFile;      // Convert the input into this .bvol brick file and exit, empty = no conversion
+    int brickSize;              // Edge length of the bricks of a conversion (voxels)
+    bool compressBricks;        // Compress the bricks of a conversion with zlib
+    double brickCacheMB;        // Memory budget of the decoded bricks when reading a brick file
+    std::string serveSocket;    // Unix domain socket of the study server, empty = no server
+    double serveCacheMB;        // Memory budget of the studies kept by the server in MB
+    std::string registerFile;   // Reference surface (.stl/.obj) or scan the input is aligned to, empty = no registration
+    int registerLevels;         // Levels of the coarse to fine registration
+    vtkIdType registerPoints;   // Surface samples of the finest registration level, 0 = every point
+    double registerSeconds;     // Time limit of the registration, 0 = no limit
+
+    /*
+    *   @returns whether the SNR uses regions, masks or a robust noise estimator
+    *            (RegionStatistics) instead of the threshold SNR (SNRStatistics)
+    */
+    bool usesRegionSNR() const;
+
+    /*
+    *   @returns whether a filter needs the whole input extent (the recursive
+    *            Gaussian), so the images cannot be streamed in slabs
+    */
+    bool usesWholeExtentFilter() const;
+};
+
+/*
+*   Print the correct program usage.
+*
+*   @param   programName   Name of the executable (argv[0])
+*/
+void printUsage( const char* programName );
+
+/*
+*   Parse the commandline arguements.
+*
+*   @param   argc      Number of arguements
+*   @param   argv      The arguements
+*   @param   options   The parsed options
+*
+*   @returns a boolean representing whether the arguements are valid
+*/
+bool parseArguments( int argc, char* argv[], ProgramOptions& options );
+
+/*
+*   Read options from a config file. Each line is "key = value", where the key
+*   is a commandline option without the leading dashes (e.g. "lower = 100").
+*   Text after a '#' is ignored.
+*
+*   @param   fileName   The config file
+*   @param   options    The parsed options
+*
+*   @returns a boolean representing whether the file was read and is valid
+*/
+bool loadConfigFile( const std::string& fileName, ProgramOptions& options );
+
+/*
+*   Read threshold pairs for a sweep. Each line holds a lower and an upper
+*   threshold separated by a space or a comma. Text after a '#' is ignored.
+*
+*   @param   fileName     The threshold file
+*   @param   thresholds   The (lower, upper) pairs, appended in file order
+*
+*   @returns a boolean representing whether the file was read and is valid
+*/
+bool loadThresholdPairs( const std::string& fileName, std::vector< std::pair<double, double> >& thresholds );
+
 /*
 *   Check the input arguements provided in the commandline when running the program.
+*   Reference surfaces (.stl/.obj) are given with --register, not as the input.
+*   The messages go to the standard error, so they never mix with batch results.
 *
-*   @param   dicomFile   input DICOM directory
-*   @param   objFile     input OBJ file
+*   @param   imageFile   input DICOM directory, NIfTI file or brick file
 *
-*   @returns a boolean representing whether the input arguements are valid
-*            FALSE for invalid arguement
-*            TRUE for a valid DICOM directory and valid OBJ file
+*   @returns the input type: 0 for a DICOM directory, 1 for a NIfTI file,
+*            2 for a brick file, -1 for an invalid arguement
 */
 int checkInputs( std::string imageFile );
 
+/*
+*   Set up the region SNR of the options: thresholds, noise estimator, boxes,
+*   and the masks, which are read here.
+*
+*   @param   options      The parsed options
+*   @param   statistics   The region statistics to set up
+*
+*   @returns a boolean representing whether the masks could be read and are not empty
+*/
+bool setupRegionStatistics( const ProgramOptions& options, RegionStatistics& statistics );
+
 /***************************************************************************/
 
 #endif // HELPERFUNCTIONS_H
\ No newline at end of file
@@ -0,0 +1,204 @@
+/****************************************************************************
+*   imagePyramid.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the multi-resolution pyramid used for
+*                   the coarse-to-fine preview.
+****************************************************************************/
+
+#include "imagePyramid.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+/*
+*   Convert a block mean back to the scalar type, rounding integers to the nearest value.
+*/
+template <class T>
+static T toScalar( double value )
+{
+    if ( std::numeric_limits<T>::is_integer )
+    {
+        return static_cast<T>( std::floor( value + 0.5 ) );
+    }
+
+    return static_cast<T>( value );
+}
+
+/*
+*   Per-slice worker: each output voxel is the mean of up to 2x2x2 input voxels.
+*   The input rows of a block are read front to back, one after the other.
+*/
+template <class T>
+class ReduceFunctor
+{
+    public:
+        ReduceFunctor( const T* input, const vtkIdType inIncrements[3], const int inSize[3],
+                       T* output, const vtkIdType outIncrements[3], const int outSize[3], int components )
+            : Input( input ), Output( output ), Components( components )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                InIncrements[i]  = inIncrements[i];
+                OutIncrements[i] = outIncrements[i];
+                InSize[i]        = inSize[i];
+                OutSize[i]       = outSize[i];
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            std::vector<double> sums( static_cast<std::size_t>( OutSize[0] ) * Components );
+            std::vector<int> counts( OutSize[0] );
+
+            for ( vtkIdType z = begin; z < end; z++ )
+            {
+                int zCount = std::min( 2, InSize[2] - 2 * int( z ) );
+
+                for ( int y = 0; y < OutSize[1]; y++ )
+                {
+                    int yCount = std::min( 2, InSize[1] - 2 * y );
+
+                    std::fill( sums.begin(), sums.end(), 0.0 );
+                    std::fill( counts.begin(), counts.end(), 0 );
+
+                    for ( int dz = 0; dz < zCount; dz++ )
+                    {
+                        for ( int dy = 0; dy < yCount; dy++ )
+                        {
+                            const T* row = Input + ( 2 * z + dz ) * InIncrements[2] + ( 2 * y + dy ) * InIncrements[1];
+
+                            for ( int x = 0; x < InSize[0]; x++ )
+                            {
+                                const T* voxel = row + x * InIncrements[0];
+                                double* sum    = &sums[static_cast<std::size_t>( x / 2 ) * Components];
+
+                                for ( int c = 0; c < Components; c++ )
+                                {
+                                    sum[c] += static_cast<double>( voxel[c] );
+                                }
+                                counts[x / 2]++;
+                            }
+                        }
+                    }
+
+                    T* out = Output + z * OutIncrements[2] + y * OutIncrements[1];
+
+                    for ( int x = 0; x < OutSize[0]; x++ )
+                    {
+                        for ( int c = 0; c < Components; c++ )
+                        {
+                            out[x * OutIncrements[0] + c] = toScalar<T>( sums[x * Components + c] / counts[x] );
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        const T* Input;
+        T* Output;
+        vtkIdType InIncrements[3];
+        vtkIdType OutIncrements[3];
+        int InSize[3];
+        int OutSize[3];
+        int Components;
+};
+
+template <class T>
+static void ReduceExecute( const T* input, const vtkIdType inIncrements[3], const int inSize[3],
+                           T* output, const vtkIdType outIncrements[3], const int outSize[3], int components )
+{
+    ReduceFunctor<T> functor( input, inIncrements, inSize, output, outIncrements, outSize, components );
+    vtkSMPTools::For( 0, outSize[2], 1, functor );
+}
+
+/******************** Helper class "ImagePyramid" functions ********************/
+ImagePyramid::ImagePyramid() : seconds( 0.0 )
+{
+}
+
+void ImagePyramid::build( vtkImageData* image, int levelCount )
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ScopedTimer timer( "pyramid", "preview" );
+
+    levels.assign( 1, image );
+
+    for ( int level = 1; level <= levelCount; level++ )
+    {
+        int* dims = levels.back()->GetDimensions();
+        if ( dims[0] <= 1 || dims[1] <= 1 || dims[2] <= 1 )
+        {
+            break;
+        }
+
+        vtkSmartPointer<vtkImageData> reduced = reduce( levels.back() );
+        if ( !reduced )
+        {
+            break;
+        }
+
+        levels.push_back( reduced );
+    }
+
+    seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+vtkSmartPointer<vtkImageData> ImagePyramid::reduce( vtkImageData* image )
+{
+    int extent[6];
+    image->GetExtent( extent );
+
+    double spacing[3], origin[3];
+    image->GetSpacing( spacing );
+    image->GetOrigin( origin );
+
+    int inSize[3], outSize[3];
+    double outSpacing[3], outOrigin[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        inSize[i]  = extent[2 * i + 1] - extent[2 * i] + 1;
+        outSize[i] = ( inSize[i] + 1 ) / 2;
+
+        // The first output voxel is the centre of the first block
+        outSpacing[i] = 2.0 * spacing[i];
+        outOrigin[i]  = origin[i] + ( extent[2 * i] + 0.5 ) * spacing[i];
+    }
+
+    vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+    output->SetExtent( 0, outSize[0] - 1, 0, outSize[1] - 1, 0, outSize[2] - 1 );
+    output->SetSpacing( outSpacing );
+    output->SetOrigin( outOrigin );
+    output->AllocateScalars( image->GetScalarType(), image->GetNumberOfScalarComponents() );
+
+    vtkIdType inIncrements[3], outIncrements[3];
+    image->GetIncrements( inIncrements );
+    output->GetIncrements( outIncrements );
+
+    void* input = image->GetScalarPointer( extent[0], extent[2], extent[4] );
+    void* out   = output->GetScalarPointer();
+
+    switch ( image->GetScalarType() )
+    {
+        vtkTemplateAliasMacro( ReduceExecute( static_cast<const VTK_TT*>( input ), inIncrements, inSize,
+                                              static_cast<VTK_TT*>( out ), outIncrements, outSize,
+                                              image->GetNumberOfScalarComponents() ) );
+
+        default:
+        {
+            return nullptr;
+        }
+    }
+
+    return output;
+}
+/***************************************************************************/
@@ -0,0 +1,77 @@
+/****************************************************************************
+*   imagePyramid.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the multi-resolution pyramid used for the
+*                   coarse-to-fine preview.
+****************************************************************************/
+
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   Downsampled copies of an image: level 0 is the image itself, each further
+*   level halves X, Y and Z (2x, 4x, 8x, ...).
+*
+*   A level is the mean of the 2x2x2 blocks of the level before it (the last
+*   block of an odd axis has one voxel fewer). Each output slice reads two
+*   input slices row by row, and the slices are split between threads with
+*   vtkSMPTools. Integer images are rounded to the nearest value. The spacing
+*   doubles with each level and the origin moves to the centre of the first
+*   block, so all levels cover the same physical space.
+*/
+class ImagePyramid
+{
+    public:
+        ImagePyramid();
+
+        /*
+        *   Build the pyramid. It stops early once an axis is down to one voxel
+        *   (or for an unsupported scalar type).
+        *
+        *   @param   image    The full resolution image (shared, not copied)
+        *   @param   levels   Number of downsampled levels (3 = 2x, 4x and 8x)
+        */
+        void build( vtkImageData* image, int levels );
+
+        /*
+        *   @returns the number of levels, including the full resolution level 0
+        */
+        int getNumberOfLevels() const { return static_cast<int>( levels.size() ); }
+
+        /*
+        *   @returns a level, 0 = the full resolution image
+        */
+        vtkImageData* getLevel( int level ) const { return levels[level]; }
+
+        /*
+        *   @returns the downsampling factor of a level (2 to the power of the level)
+        */
+        static int getFactor( int level ) { return 1 << level; }
+
+        /*
+        *   @returns the wall time of the last build() (seconds)
+        */
+        double getSeconds() const { return seconds; }
+
+        /*
+        *   Halve an image along X, Y and Z.
+        *
+        *   @param   image   The image to downsample
+        *
+        *   @returns the mean of the 2x2x2 blocks of the image, with all its components
+        */
+        static vtkSmartPointer<vtkImageData> reduce( vtkImageData* image );
+
+    private:
+        std::vector< vtkSmartPointer<vtkImageData> > levels;
+        double seconds;
+};
+
+#endif // IMAGEPYRAMID_H
@@ -0,0 +1,327 @@
+/****************************************************************************
+*   intensityHistogram.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the intensity histogram used to answer
+*                   many threshold pairs from a single pass.
+****************************************************************************/
+
+#include "intensityHistogram.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkTemplateAliasMacro.h>
+
+/*
+*   Raw per-bin sums of one thread. Exact histograms only need the counts.
+*   Binned histograms sum the offsets from the lower bin edge, which stay small.
+*/
+struct HistogramBins
+{
+    std::vector<vtkIdType> counts;
+    std::vector<double> sums;
+    std::vector<double> sumSquares;
+};
+
+/*
+*   Per-thread worker over Z slices. Every thread fills its own bins, which are
+*   added together after the loop.
+*/
+template <class T>
+class IntensityHistogramFunctor
+{
+    public:
+        IntensityHistogramFunctor( const T* base, const vtkIdType increments[3], const int extent[6],
+                                   double minimum, double binWidth, int numberOfBins, bool exact )
+            : Base( base ), Minimum( minimum ), BinWidth( binWidth ), Scale( 1.0 / binWidth ),
+              NumberOfBins( numberOfBins ), Exact( exact )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                Increments[i] = increments[i];
+            }
+            for ( int i = 0; i < 6; i++ )
+            {
+                Extent[i] = extent[i];
+            }
+        }
+
+        void Initialize()
+        {
+            HistogramBins& local = Local.Local();
+            local.counts.assign( NumberOfBins, 0 );
+
+            if ( !Exact )
+            {
+                local.sums.assign( NumberOfBins, 0.0 );
+                local.sumSquares.assign( NumberOfBins, 0.0 );
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end )
+        {
+            HistogramBins& local = Local.Local();
+            vtkIdType* counts    = &local.counts[0];
+            long long offset     = static_cast<long long>( Minimum );
+            int rowLength        = Extent[1] - Extent[0] + 1;
+
+            for ( vtkIdType z = begin; z < end; z++ )
+            {
+                for ( int y = 0; y <= Extent[3] - Extent[2]; y++ )
+                {
+                    const T* row = Base + z * Increments[2] + y * Increments[1];
+
+                    if ( Exact )
+                    {
+                        for ( int x = 0; x < rowLength; x++ )
+                        {
+                            counts[static_cast<long long>( row[x * Increments[0]] ) - offset]++;
+                        }
+                        continue;
+                    }
+
+                    for ( int x = 0; x < rowLength; x++ )
+                    {
+                        double voxel    = static_cast<double>( row[x * Increments[0]] );
+                        double position = ( voxel - Minimum ) * Scale;
+
+                        // NaN voxels are not counted
+                        if ( !( position >= 0.0 ) )
+                        {
+                            if ( position != position )
+                            {
+                                continue;
+                            }
+                            position = 0.0;
+                        }
+
+                        int bin = ( position < NumberOfBins ) ? static_cast<int>( position ) : NumberOfBins - 1;
+                        double delta = voxel - ( Minimum + bin * BinWidth );
+
+                        counts[bin]++;
+                        local.sums[bin]       += delta;
+                        local.sumSquares[bin] += delta * delta;
+                    }
+                }
+            }
+        }
+
+        void Reduce()
+        {
+        }
+
+        vtkSMPThreadLocal<HistogramBins> Local;
+
+    private:
+        const T* Base;
+        vtkIdType Increments[3];
+        int Extent[6];
+        double Minimum;
+        double BinWidth;
+        double Scale;
+        int NumberOfBins;
+        bool Exact;
+};
+
+template <class T>
+void IntensityHistogramExecute( const T* base, const vtkIdType increments[3], const int extent[6],
+                                double minimum, double binWidth, int numberOfBins, bool exact,
+                                HistogramBins& total )
+{
+    IntensityHistogramFunctor<T> functor( base, increments, extent, minimum, binWidth, numberOfBins, exact );
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( extent[5] - extent[4] + 1 ), functor );
+
+    total.counts.assign( numberOfBins, 0 );
+    total.sums.assign( numberOfBins, 0.0 );
+    total.sumSquares.assign( numberOfBins, 0.0 );
+
+    typename vtkSMPThreadLocal<HistogramBins>::iterator it;
+    for ( it = functor.Local.begin(); it != functor.Local.end(); ++it )
+    {
+        const HistogramBins& local = *it;
+
+        for ( int i = 0; i < numberOfBins && !local.counts.empty(); i++ )
+        {
+            total.counts[i] += local.counts[i];
+            if ( !exact )
+            {
+                total.sums[i]       += local.sums[i];
+                total.sumSquares[i] += local.sumSquares[i];
+            }
+        }
+    }
+}
+
+/***************** Helper class "IntensityHistogram" functions *****************/
+IntensityHistogram::IntensityHistogram()
+    : minimum( 0.0 ), binWidth( 1.0 ), exact( false ), numberOfBins( 16384 ), useExtent( false )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = 0;
+    }
+}
+
+void IntensityHistogram::setExtent( const int newExtent[6] )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = newExtent[i];
+    }
+    useExtent = true;
+}
+
+void IntensityHistogram::clearExtent()
+{
+    useExtent = false;
+}
+
+void IntensityHistogram::setNumberOfBins( int newBins )
+{
+    numberOfBins = std::max( 1, newBins );
+}
+
+bool IntensityHistogram::build( vtkImageData* image )
+{
+    bins.clear();
+
+    ScopedTimer timer( "histogram", "statistics" );
+    timer.addBytes( image->GetActualMemorySize() * 1024.0 );
+
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    if ( !scalars )
+    {
+        return false;
+    }
+
+    int wholeExtent[6];
+    image->GetExtent( wholeExtent );
+
+    // Clip the requested extent to the image
+    int ext[6];
+    for ( int i = 0; i < 6; i += 2 )
+    {
+        ext[i]     = useExtent ? std::max( extent[i], wholeExtent[i] ) : wholeExtent[i];
+        ext[i + 1] = useExtent ? std::min( extent[i + 1], wholeExtent[i + 1] ) : wholeExtent[i + 1];
+    }
+
+    if ( ext[0] > ext[1] || ext[2] > ext[3] || ext[4] > ext[5] )
+    {
+        return true;
+    }
+
+    // The range of the whole image contains the range of the extent
+    double range[2];
+    scalars->GetRange( range, 0 );
+
+    if ( range[0] > range[1] )
+    {
+        return true;
+    }
+
+    int scalarType = image->GetScalarType();
+    bool integral  = ( scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE );
+
+    int count;
+    minimum = range[0];
+    exact   = integral && ( range[1] - range[0] + 1.0 <= MaximumExactBins );
+
+    if ( exact )
+    {
+        count    = static_cast<int>( range[1] - range[0] ) + 1;
+        binWidth = 1.0;
+    }
+    else
+    {
+        count    = numberOfBins;
+        binWidth = ( range[1] > range[0] ) ? ( range[1] - range[0] ) / count : 1.0;
+    }
+
+    vtkIdType increments[3];
+    image->GetIncrements( increments );
+
+    void* base = image->GetScalarPointer( ext[0], ext[2], ext[4] );
+    HistogramBins total;
+
+    switch ( scalarType )
+    {
+        vtkTemplateAliasMacro( IntensityHistogramExecute( static_cast<const VTK_TT*>( base ), increments, ext,
+                                                          minimum, binWidth, count, exact, total ) );
+
+        default:
+        {
+            std::cerr << "ERROR: Unsupported scalar type for the intensity histogram. \n";
+            return false;
+        }
+    }
+
+    bins.resize( count );
+    for ( int i = 0; i < count; i++ )
+    {
+        if ( exact )
+        {
+            bins[i].count = total.counts[i];
+            bins[i].mean  = minimum + i;
+        }
+        else
+        {
+            bins[i].addBlock( total.counts[i], total.sums[i], total.sumSquares[i] );
+            bins[i].mean += minimum + i * binWidth;
+        }
+    }
+
+    return true;
+}
+
+SNRPartial IntensityHistogram::query( double lower, double upper, double effective[2] ) const
+{
+    double binCount = static_cast<double>( bins.size() );
+    double first, last;
+
+    if ( exact )
+    {
+        // One bin per value: [lower, upper] holds the integers ceil(lower) .. floor(upper)
+        first = std::ceil( lower ) - minimum;
+        last  = std::floor( upper ) - minimum + 1.0;
+    }
+    else
+    {
+        first = std::floor( ( lower - minimum ) / binWidth + 0.5 );
+        last  = std::floor( ( upper - minimum ) / binWidth + 0.5 );
+    }
+
+    // Clamp before converting, the thresholds can be far outside the image range
+    int begin = static_cast<int>( std::min( std::max( first, 0.0 ), binCount ) );
+    int end   = static_cast<int>( std::min( std::max( last, 0.0 ), binCount ) );
+    end = std::max( begin, end );
+
+    if ( effective )
+    {
+        effective[0] = minimum + begin * binWidth;
+        effective[1] = minimum + end * binWidth - ( exact ? 1.0 : 0.0 );
+    }
+
+    SNRPartial result;
+    for ( int i = 0; i < static_cast<int>( bins.size() ); i++ )
+    {
+        if ( i >= begin && i < end )
+        {
+            result.foreground.merge( bins[i] );
+        }
+        else
+        {
+            result.background.merge( bins[i] );
+        }
+    }
+
+    return result;
+}
+/***************************************************************************/
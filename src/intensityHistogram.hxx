@@ -0,0 +1,107 @@
+/****************************************************************************
+*   intensityHistogram.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the intensity histogram used to answer
+*                   many threshold pairs from a single pass.
+****************************************************************************/
+
+#ifndef INTENSITYHISTOGRAM_H
+#define INTENSITYHISTOGRAM_H
+
+#include "snrStatistics.hxx"
+
+#include <vector>
+
+#include <vtkImageData.h>
+
+/*
+*   A 1D histogram of an image that keeps the count, mean and M2 of the voxels
+*   in each bin.
+*
+*   Integer images with a value range of at most MaximumExactBins get one bin
+*   per value, so any threshold pair gives the same foreground/background split
+*   as SNRStatistics. Floating point images (and integer images with a wider
+*   range) get numberOfBins equal bins between the minimum and maximum of the
+*   image. Their thresholds are snapped to the nearest bin edge, and query()
+*   reports the range that was actually used.
+*
+*   The histogram is built in one pass, threaded over Z with vtkSMPTools. Each
+*   query then merges the bins (O(bins)) without touching the image again.
+*/
+class IntensityHistogram
+{
+    public:
+        IntensityHistogram();
+
+        /*
+        *   Restrict the histogram to a sub-extent of the image.
+        *   By default the whole image extent is used.
+        *
+        *   @param   extent   The extent (xMin, xMax, yMin, yMax, zMin, zMax)
+        */
+        void setExtent( const int extent[6] );
+
+        /*
+        *   Use the whole extent of each image (default).
+        */
+        void clearExtent();
+
+        /*
+        *   Set the number of bins for floating point images and for integer
+        *   images whose range is too wide for one bin per value.
+        *
+        *   @param   bins   Number of bins (>= 1, default 16384)
+        */
+        void setNumberOfBins( int bins );
+
+        /*
+        *   Build the histogram of the first component of an image.
+        *
+        *   @param   image   The image to process
+        *
+        *   @returns a boolean representing whether the scalar type is supported
+        */
+        bool build( vtkImageData* image );
+
+        /*
+        *   Compute the foreground/background statistics for one threshold pair.
+        *
+        *   @param   lower       The lower threshold
+        *   @param   upper       The upper threshold
+        *   @param   effective   If not null, receives the threshold range that
+        *                        was used (integer values for exact histograms,
+        *                        bin edges otherwise)
+        *
+        *   @returns the same statistics as SNRStatistics::compute() would give
+        */
+        SNRPartial query( double lower, double upper, double effective[2] = nullptr ) const;
+
+        /*
+        *   @returns whether each bin holds exactly one integer value
+        */
+        bool isExact() const { return exact; }
+
+        /*
+        *   @returns the number of bins of the last build
+        */
+        int getNumberOfBins() const { return static_cast<int>( bins.size() ); }
+
+        /*
+        *   Largest value range (max - min + 1) of an integer image that gets
+        *   one bin per value. Covers every 8 and 16 bit image.
+        */
+        static const int MaximumExactBins = 1 << 16;
+
+    private:
+        std::vector<SNRAccumulator> bins;
+        double minimum;
+        double binWidth;
+        bool exact;
+        int numberOfBins;
+        int extent[6];
+        bool useExtent;
+};
+
+#endif // INTENSITYHISTOGRAM_H
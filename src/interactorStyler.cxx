@@ -8,14 +8,36 @@
 
 #include "interactorStyler.hxx"
 
-void myInteractorStyler::setImageViewer( vtkImageMapper* originalMapper, vtkImageMapper* segMapper, 
-                                         vtkImageMapper* gaussMapper, vtkImageMapper* medianMapper, vtkRenderWindow* renderWindow )
+#include <algorithm>
+
+#include <vtkRendererCollection.h>
+#include <vtkVersion.h>
+
+// Since VTK 9.1 the window draws into its own framebuffer and copies it to the screen,
+// so a viewport that is not drawn keeps its last frame
+#if VTK_MAJOR_VERSION > 9 || ( VTK_MAJOR_VERSION == 9 && VTK_MINOR_VERSION >= 1 )
+#define VTKMETRICS_PARTIAL_FRAMES 1
+#else
+#define VTKMETRICS_PARTIAL_FRAMES 0
+#endif
+
+myInteractorStyler::myInteractorStyler()
+    : _ImageMapper( nullptr ), _SegMapper( nullptr ),
+      _RenderWindow( nullptr ), _OriginalRenderer( nullptr ), _SegRenderer( nullptr ), _SliceStatusMapper( nullptr ), _WindowLevelStatusMapper( nullptr ),
+      _WindowStatusMapper( nullptr ), _Overlay( nullptr ), _ThresholdStatusMapper( nullptr ),
+      _SliceCache( nullptr ), _FrameStatisticsActor( nullptr ),
+      _FrameStatisticsMapper( nullptr ), _VolumeView( nullptr ), _DirtyViewports( 0 ), _RenderTimerId( -1 ), slice( 0 ),
+      minSlice( 0 ), maxSlice( 0 ), windowLevel( 0.0 ), window( 0.0 )
+{
+}
+
+void myInteractorStyler::setImageViewer( vtkImageMapper* originalMapper, vtkImageMapper* segMapper,
+                                         const std::vector<vtkImageMapper*>& filterMappers, vtkRenderWindow* renderWindow )
 {
     _RenderWindow = renderWindow;
     _ImageMapper = originalMapper;
     _SegMapper = segMapper;
-    _GaussMapper = gaussMapper;
-    _MedianMapper = medianMapper;
+    _FilterMappers = filterMappers;
     minSlice = originalMapper->GetWholeZMin();
     maxSlice = originalMapper->GetWholeZMax();
     windowLevel = originalMapper->GetColorLevel();
@@ -25,6 +47,35 @@ void myInteractorStyler::setImageViewer( vtkImageMapper* originalMapper, vtkImag
     slice = minSlice;
 }
 
+void myInteractorStyler::setViewportRenderers( vtkRenderer* original, vtkRenderer* segmentation,
+                                               const std::vector<vtkRenderer*>& filters )
+{
+    _OriginalRenderer = original;
+    _SegRenderer = segmentation;
+    _FilterRenderers = filters;
+}
+
+int myInteractorStyler::getViewport( vtkRenderer* renderer ) const
+{
+    if ( !renderer )
+    {
+        return 0;
+    }
+    if ( renderer == _OriginalRenderer || ( _VolumeView && renderer == _VolumeView->getRenderer() ) )
+    {
+        return VIEWPORT_ORIGINAL;
+    }
+    if ( renderer == _SegRenderer )
+    {
+        return VIEWPORT_SEGMENTATION;
+    }
+    if ( std::find( _FilterRenderers.begin(), _FilterRenderers.end(), renderer ) != _FilterRenderers.end() )
+    {
+        return VIEWPORT_FILTERS;
+    }
+    return 0;
+}
+
 void myInteractorStyler::setSliceStatusMapper( vtkTextMapper* statusMapper ) 
 {
     _SliceStatusMapper = statusMapper;
@@ -40,23 +91,145 @@ void myInteractorStyler::setWindowStatusMapper( vtkTextMapper* statusMapper )
     _WindowStatusMapper = statusMapper;
 }
 
-void myInteractorStyler::moveSliceForward() 
+void myInteractorStyler::setThresholdOverlay( ThresholdOverlay* overlay, vtkTextMapper* thresholdStatusMapper,
+                                              const std::vector<vtkTextMapper*>& snrMappers,
+                                              const std::vector<std::string>& names )
 {
-    if ( slice < maxSlice ) 
+    _Overlay = overlay;
+    _ThresholdStatusMapper = thresholdStatusMapper;
+    _SNRMappers = snrMappers;
+    _SNRNames = names;
+}
+
+void myInteractorStyler::setSliceCache( SliceCache* cache, const std::vector<int>& filters )
+{
+    _SliceCache = cache;
+    _CacheFilters = filters;
+}
+
+void myInteractorStyler::setFrameStatisticsMapper( vtkActor2D* actor, vtkTextMapper* mapper )
+{
+    _FrameStatisticsActor = actor;
+    _FrameStatisticsMapper = mapper;
+}
+
+void myInteractorStyler::setVolumeView( VolumeView* view )
+{
+    _VolumeView = view;
+}
+
+void myInteractorStyler::requestRender( int viewports )
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    _FrameStatistics.addRequest();
+
+    // The latency of a frame is measured from its oldest request
+    if ( _DirtyViewports == 0 )
     {
-        slice += 1;
+        _PendingSince = now;
+    }
+    _DirtyViewports |= viewports;
 
-        _ImageMapper->SetZSlice( slice );
-        _SegMapper->SetZSlice( slice );
-        _GaussMapper->SetZSlice( slice );
-        _MedianMapper->SetZSlice( slice );
+    // A timer is already waiting to draw this change with the others
+    if ( _RenderTimerId >= 0 )
+    {
+        return;
+    }
 
-        // Create the message to be displayed.
-        std::string msg = ImageMessage::sliceNumberFormat( slice, maxSlice );
+    long sinceLastFrame = static_cast<long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>( now - _LastFrameEnd ).count() );
 
-        // Update the mapper and render.
-        _SliceStatusMapper->SetInput( msg.c_str() );
-        _RenderWindow->Render();
+    if ( sinceLastFrame >= FrameInterval || !this->Interactor )
+    {
+        renderNow();
+    }
+    else
+    {
+        _RenderTimerId = this->Interactor->CreateOneShotTimer( FrameInterval - sinceLastFrame );
+    }
+}
+
+void myInteractorStyler::renderNow()
+{
+    if ( _DirtyViewports == 0 )
+    {
+        return;
+    }
+
+    // Shown with this frame, so it lags one frame behind
+    if ( _FrameStatisticsMapper && _FrameStatisticsActor && _FrameStatisticsActor->GetVisibility() )
+    {
+        std::string msg = _FrameStatistics.format();
+        _FrameStatisticsMapper->SetInput( msg.c_str() );
+        _DirtyViewports |= VIEWPORT_ORIGINAL;
+    }
+
+    // Clean viewports are skipped for this frame. Renderers already turned off (the hidden
+    // volume view) stay off, and every renderer gets its own setting back afterwards.
+    std::vector<vtkRenderer*> skipped;
+    int viewports = 0;
+
+    vtkRendererCollection* renderers = _RenderWindow->GetRenderers();
+    renderers->InitTraversal();
+    while ( vtkRenderer* renderer = renderers->GetNextItem() )
+    {
+        if ( !renderer->GetDraw() )
+        {
+            continue;
+        }
+
+        int viewport = getViewport( renderer );
+
+        if ( VTKMETRICS_PARTIAL_FRAMES && viewport != 0 && !( _DirtyViewports & viewport ) )
+        {
+            renderer->DrawOff();
+            skipped.push_back( renderer );
+        }
+        else
+        {
+            viewports++;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    _RenderWindow->Render();
+
+    for ( std::size_t i = 0; i < skipped.size(); i++ )
+    {
+        skipped[i]->DrawOn();
+    }
+
+    _LastFrameEnd = std::chrono::steady_clock::now();
+
+    _FrameStatistics.addFrame( std::chrono::duration<double>( _LastFrameEnd - start ).count(),
+                               std::chrono::duration<double>( _LastFrameEnd - _PendingSince ).count(), viewports );
+    _DirtyViewports = 0;
+}
+
+void myInteractorStyler::showCachedSlices( int direction )
+{
+    if ( !_SliceCache )
+    {
+        return;
+    }
+
+    // Each cached slice is a one-slice image, so the mappers get a new input per slice
+    for ( std::size_t i = 0; i < _FilterMappers.size(); i++ )
+    {
+        _FilterMappers[i]->SetInputData( _SliceCache->getSlice( _CacheFilters[i], slice ) );
+    }
+
+    _SliceCache->prefetch( slice, direction );
+}
+
+void myInteractorStyler::moveSliceForward() 
+{
+    if ( slice < maxSlice ) 
+    {
+        slice += 1;
+        showSlice( 1 );
     }
 }
 
@@ -65,18 +238,44 @@ void myInteractorStyler::moveSliceBackward()
     if ( slice > minSlice ) 
     {
         slice -= 1;
+        showSlice( -1 );
+    }
+}
 
-        _ImageMapper->SetZSlice( slice );
-        _SegMapper->SetZSlice( slice );
-        _GaussMapper->SetZSlice( slice );
-        _MedianMapper->SetZSlice( slice );
+void myInteractorStyler::showSlice( int direction )
+{
+    _ImageMapper->SetZSlice( slice );
+    _SegMapper->SetZSlice( slice );
+    for ( std::size_t i = 0; i < _FilterMappers.size(); i++ )
+    {
+        _FilterMappers[i]->SetZSlice( slice );
+    }
 
-        // Create the message to be displayed.
-        std::string msg = ImageMessage::sliceNumberFormat( slice, maxSlice );
+    // Make sure the overlay of this slice matches the current thresholds
+    if ( _Overlay )
+    {
+        _Overlay->showSlice( slice );
+    }
 
-        // Update the mapper and render.
-        _SliceStatusMapper->SetInput( msg.c_str() );
-        _RenderWindow->Render();
+    showCachedSlices( direction );
+
+    // Create the message to be displayed.
+    std::string msg = ImageMessage::sliceNumberFormat( slice, maxSlice );
+
+    // Update the mapper and render.
+    _SliceStatusMapper->SetInput( msg.c_str() );
+    requestRender( VIEWPORT_ALL );
+}
+
+void myInteractorStyler::applyWindowLevel()
+{
+    _ImageMapper->SetColorLevel( windowLevel );
+    _ImageMapper->SetColorWindow( window );
+
+    for ( std::size_t i = 0; i < _FilterMappers.size(); i++ )
+    {
+        _FilterMappers[i]->SetColorLevel( windowLevel );
+        _FilterMappers[i]->SetColorWindow( window );
     }
 }
 
@@ -84,62 +283,120 @@ void myInteractorStyler::moveWindowLevelForward()
 {
     windowLevel += 10;
 
-    _ImageMapper->SetColorLevel( windowLevel );
-    _GaussMapper->SetColorLevel( windowLevel );
-    _MedianMapper->SetColorLevel( windowLevel );
+    applyWindowLevel();
 
     // Create the message to be displayed.
     std::string msg = ImageMessage::windowLevelFormat( int( windowLevel ) );
 
     // Update the mapper and render.
-    _WindowLevelStatusMapper->SetInput( msg.c_str() );
-    _RenderWindow->Render();
+    if ( _WindowLevelStatusMapper )
+    {
+        _WindowLevelStatusMapper->SetInput( msg.c_str() );
+    }
+    requestRender( VIEWPORT_ALL );
 }
 
 void myInteractorStyler::moveWindowLevelBackward() 
 {
     windowLevel -= 10;
 
-    _ImageMapper->SetColorLevel( windowLevel );
-    _GaussMapper->SetColorLevel( windowLevel );
-    _MedianMapper->SetColorLevel( windowLevel );
+    applyWindowLevel();
 
     // Create the message to be displayed.
     std::string msg = ImageMessage::windowLevelFormat( int( windowLevel ) );
 
     // Update the mapper and render.
-    _WindowLevelStatusMapper->SetInput( msg.c_str() );
-    _RenderWindow->Render();
+    if ( _WindowLevelStatusMapper )
+    {
+        _WindowLevelStatusMapper->SetInput( msg.c_str() );
+    }
+    requestRender( VIEWPORT_ALL );
 }
 
 void myInteractorStyler::moveWindowForward()
 {
     window += 10;
 
-    _ImageMapper->SetColorWindow( window );
-    _GaussMapper->SetColorWindow( window );
-    _MedianMapper->SetColorWindow( window );
+    applyWindowLevel();
 
     // Create the message to be displayed.
     std::string msg = ImageMessage::windowFormat( int( window ) );
 
     // Update the mapper and render.
-    _WindowStatusMapper->SetInput( msg.c_str() );
-    _RenderWindow->Render();
+    if ( _WindowStatusMapper )
+    {
+        _WindowStatusMapper->SetInput( msg.c_str() );
+    }
+    requestRender( VIEWPORT_ALL );
 }
 
 void myInteractorStyler::moveWindowBackward()
 {
     window -= 10;
 
-    _ImageMapper->SetColorWindow( window );
-    _GaussMapper->SetColorWindow( window );
-    _MedianMapper->SetColorWindow( window );
+    applyWindowLevel();
 
     // Create the message to be displayed.
     std::string msg = ImageMessage::windowFormat( int( window ) );
 
     // Update the mapper and render.
-    _WindowStatusMapper->SetInput( msg.c_str() );
-    _RenderWindow->Render();  
-}
\ No newline at end of file
+    if ( _WindowStatusMapper )
+    {
+        _WindowStatusMapper->SetInput( msg.c_str() );
+    }
+    requestRender( VIEWPORT_ALL );  
+}
+
+void myInteractorStyler::moveLowerThreshold( int steps )
+{
+    if ( !_Overlay )
+    {
+        return;
+    }
+
+    double lower = _Overlay->getLowerThreshold() + steps * _Overlay->getThresholdStep();
+    updateThresholds( lower, std::max( lower, _Overlay->getUpperThreshold() ) );
+}
+
+void myInteractorStyler::moveUpperThreshold( int steps )
+{
+    if ( !_Overlay )
+    {
+        return;
+    }
+
+    double upper = _Overlay->getUpperThreshold() + steps * _Overlay->getThresholdStep();
+    updateThresholds( std::min( upper, _Overlay->getLowerThreshold() ), upper );
+}
+
+void myInteractorStyler::updateThresholds( double lower, double upper )
+{
+    // Only the displayed slice is thresholded here, the rest follows in the background
+    _Overlay->setThresholds( lower, upper, _SegMapper->GetZSlice() );
+
+    std::string msg = ImageMessage::thresholdFormat( lower, upper );
+    _ThresholdStatusMapper->SetInput( msg.c_str() );
+
+    int viewports = VIEWPORT_SEGMENTATION;
+
+    // The volume view shows the foreground range
+    if ( _VolumeView )
+    {
+        _VolumeView->setIntensityRange( lower, upper );
+        viewports |= VIEWPORT_ORIGINAL;
+    }
+
+    // The SNR comes from the histograms, without another pass over the images
+    if ( _Overlay->hasHistograms() )
+    {
+        viewports = VIEWPORT_ALL;
+
+        for ( std::size_t i = 0; i < _SNRMappers.size(); i++ )
+        {
+            std::string snrMsg = ImageMessage::filterFormat( _SNRNames[i], _Overlay->getStatistics( static_cast<int>( i ) ).getSNR() );
+            _SNRMappers[i]->SetInput( snrMsg.c_str() );
+        }
+    }
+
+    requestRender( viewports );
+}
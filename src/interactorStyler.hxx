@@ -10,6 +10,10 @@
 #define INTERACTORSTYLER_H
 
 #include "helperFunctions.hxx"
+#include "thresholdOverlay.hxx"
+#include "sliceCache.hxx"
+#include "frameStatistics.hxx"
+#include "volumeView.hxx"
 
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -21,6 +25,7 @@
 #include <vtkDICOMImageReader.h>
 #include <vtkNIFTIImageReader.h>
 #include <vtkInteractorStyleImage.h>
+#include <vtkCommand.h>
 
 #include <vtkTextProperty.h>
 #include <vtkTextMapper.h>
@@ -30,6 +35,7 @@
 #include <vtkObjectFactory.h>
 
 #include <string>
+#include <vector>
 
 /* 
 *   A class for a custom interactor style to override the default interactor style.
@@ -44,10 +50,23 @@ public:
    /*
    *   Set the class image viewer.
    *
-   *   @param   imageViewer   Image viewer from main
+   *   @param   originalMapper   Mapper of the original image
+   *   @param   segMapper        Mapper of the segmentation overlay
+   *   @param   filterMappers    Mappers of the filtered images, in filter order
+   *   @param   renderWindow     Render window from main
    */
-   void setImageViewer( vtkImageMapper* originalMapper, vtkImageMapper* segMapper, 
-                        vtkImageMapper* gaussMapper, vtkImageMapper* medianMapper, vtkRenderWindow* renderWindow );
+   void setImageViewer( vtkImageMapper* originalMapper, vtkImageMapper* segMapper,
+                        const std::vector<vtkImageMapper*>& filterMappers, vtkRenderWindow* renderWindow );
+
+   /*
+   *   Set the renderer of each viewport, so a frame draws only the viewports that
+   *   changed. Without them every viewport is drawn.
+   *
+   *   @param   original       Renderer of the original image (or the volume view in its place)
+   *   @param   segmentation   Renderer of the segmentation
+   *   @param   filters        Renderers of the filtered images, in filter order
+   */
+   void setViewportRenderers( vtkRenderer* original, vtkRenderer* segmentation, const std::vector<vtkRenderer*>& filters );
 
    /*
    *   Set the class status mapper for the slice message.
@@ -70,15 +89,110 @@ public:
    */
    void setWindowStatusMapper( vtkTextMapper* _WindowStatusMapper );
 
+   /*
+   *   Enable the threshold keys.
+   *
+   *   @param   overlay                  Segmentation overlay from main
+   *   @param   thresholdStatusMapper    Mapper from main for the threshold message
+   *   @param   snrMappers               Mappers from main for the SNR messages of the
+   *                                     original image, then the filtered images
+   *   @param   names                    Names shown in the SNR messages, in the same order
+   */
+   void setThresholdOverlay( ThresholdOverlay* overlay, vtkTextMapper* thresholdStatusMapper,
+                             const std::vector<vtkTextMapper*>& snrMappers, const std::vector<std::string>& names );
+
+   /*
+   *   Show the filter viewports from a slice cache (lazy mode), or from the
+   *   mapper inputs again when the cache is null.
+   *
+   *   @param   cache     Slice cache from main
+   *   @param   filters   Index in the cache of each filter, in filter order
+   */
+   void setSliceCache( SliceCache* cache, const std::vector<int>& filters );
+
+   /*
+   *   Set the text shown by the F key with the frame time, input latency and render count.
+   *
+   *   @param   actor    Actor of the message (hidden until F is pressed)
+   *   @param   mapper   Mapper of the message
+   */
+   void setFrameStatisticsMapper( vtkActor2D* actor, vtkTextMapper* mapper );
+
+   /*
+   *   Set the 3D view shown in place of the original image by the V key.
+   *
+   *   @param   view   The volume view
+   */
+   void setVolumeView( VolumeView* view );
+
+   /*
+   *   Viewports whose content can change, for requestRender().
+   */
+   enum Viewport
+   {
+      VIEWPORT_ORIGINAL     = 1,
+      VIEWPORT_SEGMENTATION = 2,
+      VIEWPORT_FILTERS      = 4,    // Every filter viewport
+      VIEWPORT_ALL          = 7
+   };
+
+   /*
+   *   Ask for the window to be redrawn. Requests are coalesced: the window is
+   *   drawn at once if the last frame is at least FrameInterval old, otherwise
+   *   once when the interval has passed, with everything requested until then.
+   *
+   *   @param   viewports   The viewports that changed (Viewport flags)
+   */
+   void requestRender( int viewports );
+
+   /*
+   *   @returns the render statistics of the session
+   */
+   const FrameStatistics& getFrameStatistics() const { return _FrameStatistics; }
+
+   /*
+   *   Shortest time between two frames (60 frames per second).
+   */
+   static const int FrameInterval = 16;
+
 protected:
+   myInteractorStyler();
+
+   /*
+   *   Draw the dirty viewports now and record the frame.
+   */
+   void renderNow();
+
+   /*
+   *   @returns the Viewport flag of a renderer of the window, 0 for a renderer
+   *            that is not one of the viewports (always drawn)
+   */
+   int getViewport( vtkRenderer* renderer ) const;
+
    vtkImageMapper*   _ImageMapper;
    vtkImageMapper*   _SegMapper;
-   vtkImageMapper*   _GaussMapper;
-   vtkImageMapper*   _MedianMapper;
+   std::vector<vtkImageMapper*> _FilterMappers;
    vtkRenderWindow*  _RenderWindow;
+   vtkRenderer*      _OriginalRenderer;
+   vtkRenderer*      _SegRenderer;
+   std::vector<vtkRenderer*> _FilterRenderers;
    vtkTextMapper*   _SliceStatusMapper;
    vtkTextMapper*   _WindowLevelStatusMapper;
    vtkTextMapper*   _WindowStatusMapper;
+   ThresholdOverlay* _Overlay;
+   vtkTextMapper*   _ThresholdStatusMapper;
+   std::vector<vtkTextMapper*> _SNRMappers;
+   std::vector<std::string> _SNRNames;
+   SliceCache*      _SliceCache;
+   std::vector<int> _CacheFilters;
+   vtkActor2D*      _FrameStatisticsActor;
+   vtkTextMapper*   _FrameStatisticsMapper;
+   FrameStatistics  _FrameStatistics;
+   VolumeView*      _VolumeView;
+   int _DirtyViewports;
+   int _RenderTimerId;
+   std::chrono::steady_clock::time_point _PendingSince;
+   std::chrono::steady_clock::time_point _LastFrameEnd;
    int slice;
    int minSlice;
    int maxSlice;
@@ -90,6 +204,18 @@ protected:
    */
    void moveSliceForward();
 
+   /*
+   *   Show a slice in every viewport.
+   *
+   *   @param   direction   +1 after moving forward, -1 after moving backward
+   */
+   void showSlice( int direction );
+
+   /*
+   *   Apply the current window and level to the original and filtered images.
+   */
+   void applyWindowLevel();
+
    /*
    *   Move the previous slice in the image.
    */
@@ -115,6 +241,34 @@ protected:
    */
    void moveWindowBackward();
 
+   /*
+   *   Give the filter mappers the cached slices of the current slice (lazy
+   *   mode) and prefetch the next ones.
+   *
+   *   @param   direction   +1 after moving forward, -1 after moving backward
+   */
+   void showCachedSlices( int direction );
+
+   /*
+   *   Move the lower threshold by a number of steps (keeps lower <= upper).
+   *
+   *   @param   steps   Number of threshold steps, negative to decrease
+   */
+   void moveLowerThreshold( int steps );
+
+   /*
+   *   Move the upper threshold by a number of steps (keeps lower <= upper).
+   *
+   *   @param   steps   Number of threshold steps, negative to decrease
+   */
+   void moveUpperThreshold( int steps );
+
+   /*
+   *   Apply new thresholds: re-threshold the displayed slice, update the
+   *   threshold and SNR messages and render.
+   */
+   void updateThresholds( double lower, double upper );
+
    /*
    *   Overload the default interactor event listener for key presses.
    *   UP ARROW key    = move to next slice
@@ -123,6 +277,10 @@ protected:
    *   RIGHT ARROW key = decrease window level
    *   Z Key           = increase window
    *   X key           = decrease window
+   *   [ and ] keys    = decrease/increase the lower threshold
+   *   ; and ' keys    = decrease/increase the upper threshold
+   *   F key           = show/hide the frame statistics
+   *   V key           = show the next volume in 3D, then the original slice again
    */
    virtual void OnKeyDown()
    {
@@ -152,10 +310,52 @@ protected:
       {
          moveWindowBackward();
       }
+      else if ( key.compare("bracketleft") == 0 )
+      {
+         moveLowerThreshold( -1 );
+      }
+      else if ( key.compare("bracketright") == 0 )
+      {
+         moveLowerThreshold( 1 );
+      }
+      else if ( key.compare("semicolon") == 0 )
+      {
+         moveUpperThreshold( -1 );
+      }
+      else if ( key.compare("apostrophe") == 0 )
+      {
+         moveUpperThreshold( 1 );
+      }
+      else if ( key.compare("f") == 0 && _FrameStatisticsActor )
+      {
+         _FrameStatisticsActor->SetVisibility( !_FrameStatisticsActor->GetVisibility() );
+         requestRender( VIEWPORT_ORIGINAL );
+      }
+      else if ( key.compare("v") == 0 && _VolumeView )
+      {
+         _VolumeView->showNext();
+         requestRender( VIEWPORT_ORIGINAL );
+      }
 
       vtkInteractorStyleImage::OnKeyDown();
    }
 
+   /*
+   *   Overload the default interactor event listener for characters.
+   *   F is the frame statistics key here, not the default fly-to.
+   */
+   virtual void OnChar()
+   {
+      char key = this->GetInteractor()->GetKeyCode();
+
+      if ( key == 'f' || key == 'F' )
+      {
+         return;
+      }
+
+      vtkInteractorStyleImage::OnChar();
+   }
+
    /*
    *   Overload the default interactor event listener for the mouse scroll wheel.
    *   Moves to the next slice.
@@ -179,10 +379,76 @@ protected:
 
    /*
    *  Overload the default interactor event listener for the left mouse button.
-   *  Need to overload this function and leave blank so that the default window 
-   *  leveling is only done with the left and right arrow keys as desired.
+   *  Need to overload this function so that the default window leveling is
+   *  only done with the left and right arrow keys as desired. Over the volume
+   *  view the left button rotates the camera, with the level of detail.
    */
-   virtual void OnLeftButtonDown()  { }
+   virtual void OnLeftButtonDown()
+   {
+      if ( !_VolumeView || !_VolumeView->isShown() )
+      {
+         return;
+      }
+
+      int* position = this->Interactor->GetEventPosition();
+      this->FindPokedRenderer( position[0], position[1] );
+
+      if ( this->CurrentRenderer != _VolumeView->getRenderer() )
+      {
+         return;
+      }
+
+      _VolumeView->setInteractive( true );
+      this->StartRotate();
+   }
+
+   /*
+   *  Overload the default interactor event listener for the left mouse button.
+   *  Ends a rotation of the volume view with a full resolution frame.
+   */
+   virtual void OnLeftButtonUp()
+   {
+      if ( this->State == VTKIS_ROTATE )
+      {
+         _VolumeView->setInteractive( false );
+         this->EndRotate();
+         return;
+      }
+
+      vtkInteractorStyleImage::OnLeftButtonUp();
+   }
+
+   /*
+   *  Overload the default interactor event listener for mouse moves.
+   *  A rotation stays with the volume view when the pointer leaves it.
+   */
+   virtual void OnMouseMove()
+   {
+      if ( this->State == VTKIS_ROTATE )
+      {
+         this->Rotate();
+         this->InvokeEvent( vtkCommand::InteractionEvent, nullptr );
+         return;
+      }
+
+      vtkInteractorStyleImage::OnMouseMove();
+   }
+
+   /*
+   *   Overload the default interactor event listener for timers.
+   *   Draws the coalesced frame when the render timer fires.
+   */
+   virtual void OnTimer()
+   {
+      if ( _RenderTimerId >= 0 && this->Interactor->GetTimerEventId() == _RenderTimerId )
+      {
+         _RenderTimerId = -1;
+         renderNow();
+         return;
+      }
+
+      vtkInteractorStyleImage::OnTimer();
+   }
 };
 
 #endif  // INTERACTORSTYLER_H
\ No newline at end of file
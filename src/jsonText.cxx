@@ -0,0 +1,51 @@
+/****************************************************************************
+*   jsonText.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the JSON text helpers shared by the
+*                   trace, the batch results and the study server.
+****************************************************************************/
+
+#include "jsonText.hxx"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+std::string jsonString( const std::string& text )
+{
+    std::string quoted = "\"";
+    for ( std::size_t i = 0; i < text.size(); i++ )
+    {
+        char c = text[i];
+        if ( c == '"' || c == '\\' )
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ( c == '\n' )
+        {
+            quoted += "\\n";
+        }
+        else if ( static_cast<unsigned char>( c ) >= 0x20 )
+        {
+            quoted += c;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+std::string jsonNumber( double value )
+{
+    // JSON has no NaN or infinity (e.g. the SNR of an image without background)
+    if ( !std::isfinite( value ) )
+    {
+        return "null";
+    }
+
+    std::ostringstream text;
+    text << std::setprecision( 10 ) << value;
+    return text.str();
+}
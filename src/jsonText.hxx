@@ -0,0 +1,25 @@
+/****************************************************************************
+*   jsonText.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the JSON text helpers shared by the trace,
+*                   the batch results and the study server.
+****************************************************************************/
+
+#ifndef JSONTEXT_H
+#define JSONTEXT_H
+
+#include <string>
+
+/*
+*   @returns the text as a JSON string, with quotes, backslashes and newlines escaped
+*/
+std::string jsonString( const std::string& text );
+
+/*
+*   @returns the number as JSON text, null for NaN and infinity
+*/
+std::string jsonNumber( double value );
+
+#endif // JSONTEXT_H
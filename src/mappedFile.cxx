@@ -0,0 +1,98 @@
+/****************************************************************************
+*   mappedFile.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of read-only memory-mapped files and of
+*                   VTK arrays that use mapped pages without copying them.
+****************************************************************************/
+
+#include "mappedFile.hxx"
+
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+*   DeleteEvent callback of a mapped array: drops the array's reference to the mapping.
+*/
+static void releaseMapping( vtkObject* vtkNotUsed( caller ), unsigned long vtkNotUsed( eventId ),
+                            void* clientData, void* vtkNotUsed( callData ) )
+{
+    delete static_cast<std::shared_ptr<MappedFile>*>( clientData );
+}
+
+MappedFile::MappedFile( void* mappedAddress, std::size_t mappedLength )
+    : address( mappedAddress ), length( mappedLength )
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    munmap( address, length );
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open( const std::string& fileName )
+{
+#ifndef _WIN32
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+        return std::shared_ptr<MappedFile>();
+    }
+
+    struct stat status;
+    void* address = MAP_FAILED;
+
+    if ( fstat( fd, &status ) == 0 && status.st_size > 0 )
+    {
+        address = mmap( nullptr, static_cast<std::size_t>( status.st_size ), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE, fd, 0 );
+    }
+    close( fd );
+
+    if ( address == MAP_FAILED )
+    {
+        return std::shared_ptr<MappedFile>();
+    }
+
+    return std::shared_ptr<MappedFile>( new MappedFile( address, static_cast<std::size_t>( status.st_size ) ) );
+#else
+    (void)fileName;
+    return std::shared_ptr<MappedFile>();
+#endif
+}
+
+vtkSmartPointer<vtkDataArray> MappedFile::createArray( const std::shared_ptr<MappedFile>& file, std::size_t offset,
+                                                       int scalarType, int components, vtkIdType tuples )
+{
+    vtkSmartPointer<vtkDataArray> array;
+    std::size_t scalarSize = static_cast<std::size_t>( vtkDataArray::GetDataTypeSize( scalarType ) );
+    std::size_t values     = static_cast<std::size_t>( tuples ) * components;
+
+    if ( !file || scalarSize == 0 || offset % scalarSize != 0 || offset + values * scalarSize > file->size() )
+    {
+        return array;
+    }
+
+    array.TakeReference( vtkDataArray::CreateDataArray( scalarType ) );
+    array->SetNumberOfComponents( components );
+
+    // save = 1: VTK never frees the pages, the mapping does
+    array->SetVoidArray( const_cast<char*>( file->data() ) + offset, static_cast<vtkIdType>( values ), 1 );
+
+    vtkSmartPointer<vtkCallbackCommand> release = vtkSmartPointer<vtkCallbackCommand>::New();
+    release->SetCallback( releaseMapping );
+    release->SetClientData( new std::shared_ptr<MappedFile>( file ) );
+    array->AddObserver( vtkCommand::DeleteEvent, release );
+
+    return array;
+}
@@ -0,0 +1,67 @@
+/****************************************************************************
+*   mappedFile.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of read-only memory-mapped files and of VTK
+*                   arrays that use mapped pages without copying them.
+****************************************************************************/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <vtkSmartPointer.h>
+#include <vtkDataArray.h>
+
+/*
+*   A whole file mapped privately into memory. Writes go to private copies of
+*   the pages and never reach the file. The file is unmapped when the last
+*   shared pointer (including the ones held by mapped arrays) is released.
+*/
+class MappedFile
+{
+    public:
+        /*
+        *   Map a file.
+        *
+        *   @param   fileName   The file to map
+        *
+        *   @returns the mapping, or an empty pointer if the file cannot be mapped
+        *            (always empty on Windows)
+        */
+        static std::shared_ptr<MappedFile> open( const std::string& fileName );
+
+        ~MappedFile();
+
+        const char* data() const { return static_cast<const char*>( address ); }
+        std::size_t size() const { return length; }
+
+        /*
+        *   Wrap a part of the file in a VTK array without copying it. The array
+        *   keeps the mapping alive until it is deleted.
+        *
+        *   @param   file         The mapping
+        *   @param   offset       Byte offset of the first value (aligned to the value size)
+        *   @param   scalarType   VTK type of the values
+        *   @param   components   Number of components per tuple
+        *   @param   tuples       Number of tuples
+        *
+        *   @returns the array, or an empty pointer if the range is outside the file
+        */
+        static vtkSmartPointer<vtkDataArray> createArray( const std::shared_ptr<MappedFile>& file, std::size_t offset,
+                                                          int scalarType, int components, vtkIdType tuples );
+
+    private:
+        MappedFile( void* address, std::size_t length );
+        MappedFile( const MappedFile& ) = delete;
+        void operator=( const MappedFile& ) = delete;
+
+        void* address;
+        std::size_t length;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,114 @@
+/****************************************************************************
+*   medianBench.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Compares myImageMedian3D with vtkImageMedian3D on the
+*                   same input: run time and bit-exact output.
+****************************************************************************/
+
+#include "myImageMedian3D.hxx"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageMedian3D.h>
+#include <vtkImageAlgorithm.h>
+
+/*
+*   Run a filter on an image and return the run time in seconds.
+*/
+static double timeFilter( vtkImageAlgorithm* filter, vtkImageData* image )
+{
+    filter->SetInputData( image );
+
+    auto start = std::chrono::steady_clock::now();
+    filter->Update();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>( end - start ).count();
+}
+
+template <class T>
+static bool benchmarkType( const std::string& name, int scalarType, int size, int kernel )
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions( size, size, size );
+    image->AllocateScalars( scalarType, 1 );
+
+    // CT-like values: a noisy block of soft tissue in air
+    std::mt19937 generator( 7 );
+    std::normal_distribution<double> noise( 0.0, 40.0 );
+    T* data = static_cast<T*>( image->GetScalarPointer() );
+    for ( int z = 0; z < size; z++ )
+    {
+        for ( int y = 0; y < size; y++ )
+        {
+            for ( int x = 0; x < size; x++ )
+            {
+                bool inside = x > size / 4 && x < 3 * size / 4 && y > size / 4 && y < 3 * size / 4;
+                double value = ( inside ? 1040.0 : 24.0 ) + noise( generator );
+
+                // The noise reaches below 0 in the air, which an unsigned type cannot hold
+                value = std::min( std::max( value, static_cast<double>( std::numeric_limits<T>::lowest() ) ),
+                                  static_cast<double>( std::numeric_limits<T>::max() ) );
+                *data++ = static_cast<T>( value );
+            }
+        }
+    }
+
+    vtkSmartPointer<vtkImageMedian3D> reference = vtkSmartPointer<vtkImageMedian3D>::New();
+    reference->SetKernelSize( kernel, kernel, kernel );
+
+    vtkSmartPointer<myImageMedian3D> fast = vtkSmartPointer<myImageMedian3D>::New();
+    fast->SetKernelSize( kernel, kernel, kernel );
+
+    double referenceTime = timeFilter( reference, image );
+    double fastTime      = timeFilter( fast, image );
+
+    vtkImageData* a = reference->GetOutput();
+    vtkImageData* b = fast->GetOutput();
+
+    bool exact = a->GetScalarType() == b->GetScalarType() &&
+                 a->GetNumberOfPoints() == b->GetNumberOfPoints() &&
+                 std::memcmp( a->GetScalarPointer(), b->GetScalarPointer(),
+                              a->GetNumberOfPoints() * a->GetScalarSize() ) == 0;
+
+    std::cout << name << " " << size << "^3, kernel " << kernel << "^3: "
+              << "vtkImageMedian3D " << referenceTime << " s, "
+              << "myImageMedian3D " << fastTime << " s, "
+              << "speedup " << referenceTime / fastTime << "x, "
+              << ( exact ? "bit-exact" : "OUTPUT DIFFERS" ) << "\n";
+
+    return exact;
+}
+
+int main( int argc, char* argv[] )
+{
+    int size   = ( argc > 1 ) ? atoi( argv[1] ) : 128;
+    int kernel = ( argc > 2 ) ? atoi( argv[2] ) : 5;
+
+    if ( size <= 0 || kernel <= 0 )
+    {
+        std::cout << "Usage: " << argv[0] << " [volume edge length] [kernel size] \n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision( 3 );
+
+    bool exact = true;
+    exact &= benchmarkType<short>( "int16", VTK_SHORT, size, kernel );
+    exact &= benchmarkType<unsigned short>( "uint16", VTK_UNSIGNED_SHORT, size, kernel );
+    exact &= benchmarkType<float>( "float", VTK_FLOAT, size, kernel );
+
+    return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+*   memoryUsage.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the resident memory queries used to
+*                   report the memory of each processing stage.
+****************************************************************************/
+
+#include "memoryUsage.hxx"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+static const double bytesPerMB = 1024.0 * 1024.0;
+
+double getResidentMemoryMB()
+{
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+    {
+        return counters.WorkingSetSize / bytesPerMB;
+    }
+    return 0.0;
+#elif defined( __APPLE__ )
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if ( task_info( mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>( &info ), &count ) == KERN_SUCCESS )
+    {
+        return info.resident_size / bytesPerMB;
+    }
+    return 0.0;
+#else
+    // The second field of statm is the resident size in pages
+    long pages = 0;
+    FILE* file = std::fopen( "/proc/self/statm", "r" );
+    if ( !file )
+    {
+        return 0.0;
+    }
+    if ( std::fscanf( file, "%*s %ld", &pages ) != 1 )
+    {
+        pages = 0;
+    }
+    std::fclose( file );
+    return double( pages ) * sysconf( _SC_PAGESIZE ) / bytesPerMB;
+#endif
+}
+
+double getPeakResidentMemoryMB()
+{
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+    {
+        return counters.PeakWorkingSetSize / bytesPerMB;
+    }
+    return 0.0;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+        return 0.0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / bytesPerMB;        // Bytes
+#else
+    return usage.ru_maxrss / 1024.0;            // KB
+#endif
+#endif
+}
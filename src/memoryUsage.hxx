@@ -0,0 +1,23 @@
+/****************************************************************************
+*   memoryUsage.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the resident memory queries used to
+*                   report the memory of each processing stage.
+****************************************************************************/
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+/*
+*   @returns the resident set size of the process in MB, 0 if it cannot be queried
+*/
+double getResidentMemoryMB();
+
+/*
+*   @returns the largest resident set size of the process so far in MB, 0 if it cannot be queried
+*/
+double getPeakResidentMemoryMB();
+
+#endif // MEMORYUSAGE_H
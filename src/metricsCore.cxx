@@ -0,0 +1,427 @@
+/****************************************************************************
+*   metricsCore.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the processing API of the vtkMetricsCore
+*                   library (load, filter, SNR, segmentation).
+****************************************************************************/
+
+#include "metricsCore.hxx"
+#include "stageTrace.hxx"
+#include "myDICOMImageReader.hxx"
+#include "myNIFTIImageReader.hxx"
+#include "myBrickVolumeReader.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkNIFTIImageReader.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <vtksys/SystemTools.hxx>
+
+/*
+*   Size of an image described by pipeline information (megabytes).
+*/
+static double imageMB( vtkInformation* info, const int extent[6] )
+{
+    double voxels = double( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 ) * ( extent[5] - extent[4] + 1 );
+    double bytes  = voxels * vtkImageData::GetNumberOfScalarComponents( info ) *
+                    vtkDataArray::GetDataTypeSize( vtkImageData::GetScalarType( info ) );
+
+    return bytes / ( 1024.0 * 1024.0 );
+}
+
+int classifyInput( const std::string& input )
+{
+    if ( vtksys::SystemTools::FileIsDirectory( input ) )
+    {
+        return 0;
+    }
+
+    std::string name = vtksys::SystemTools::LowerCase( input );
+
+    bool nifti = ( name.size() > 4 && name.compare( name.size() - 4, 4, ".nii" ) == 0 ) ||
+                 ( name.size() > 7 && name.compare( name.size() - 7, 7, ".nii.gz" ) == 0 );
+    bool bricks = name.size() > 5 && name.compare( name.size() - 5, 5, ".bvol" ) == 0;
+
+    return nifti ? 1 : ( bricks ? 2 : -1 );
+}
+
+vtkSmartPointer<vtkImageReader2> createImageReader( const std::string& inputFile, int inputType )
+{
+    switch( inputType )
+    {
+        case 0:     // Directory with DICOM series
+        {
+            // Read all files from the DICOM series in the specified directory (headers and slices in parallel).
+            vtkSmartPointer<myDICOMImageReader> dicomReader = vtkSmartPointer<myDICOMImageReader>::New();
+            dicomReader->SetDirectoryName( inputFile.c_str() );
+
+            return dicomReader;
+        }
+
+        case 1:     // NIfTI
+        {
+            // Check if the input file is readable.
+            vtkSmartPointer<vtkNIFTIImageReader> niftiCheck = vtkSmartPointer<vtkNIFTIImageReader>::New();
+
+            if ( !( niftiCheck->CanReadFile( inputFile.c_str() ) ) )
+            {
+                return nullptr;
+            }
+
+            // Uncompressed files are memory-mapped, compressed files are decompressed in place
+            vtkSmartPointer<myNIFTIImageReader> niftiReader = vtkSmartPointer<myNIFTIImageReader>::New();
+            niftiReader->SetFileName( inputFile.c_str() );
+
+            return niftiReader;
+        }
+
+        case 2:     // Bricked volume (only the bricks of each update extent are read)
+        {
+            if ( !vtksys::SystemTools::FileExists( inputFile, true ) )
+            {
+                return nullptr;
+            }
+
+            vtkSmartPointer<myBrickVolumeReader> brickReader = vtkSmartPointer<myBrickVolumeReader>::New();
+            brickReader->SetFileName( inputFile.c_str() );
+
+            return brickReader;
+        }
+
+        default:
+        {
+            return nullptr;
+        }
+    }
+}
+
+/******************** Helper class "MetricsCore" functions ********************/
+MetricsCore::MetricsCore()
+    : threads( 0 ), memoryBudgetMB( 0.0 ), lowerThreshold( 0.0 ), upperThreshold( 0.0 )
+{
+}
+
+void MetricsCore::setNumberOfThreads( int numberOfThreads )
+{
+    threads = std::max( 0, numberOfThreads );
+}
+
+int MetricsCore::getNumberOfThreads() const
+{
+    if ( threads > 0 )
+    {
+        return threads;
+    }
+
+    return std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+}
+
+void MetricsCore::setThreadPoolSize( int numberOfThreads )
+{
+    vtkSMPTools::Initialize( std::max( 0, numberOfThreads ) );
+}
+
+void MetricsCore::setMemoryBudgetMB( double megabytes )
+{
+    memoryBudgetMB = std::max( 0.0, megabytes );
+}
+
+bool MetricsCore::fitsBudget( double megabytes, const std::string& what )
+{
+    if ( memoryBudgetMB <= 0.0 || megabytes <= memoryBudgetMB )
+    {
+        return true;
+    }
+
+    std::ostringstream message;
+    message << what << " need " << static_cast<long long>( std::ceil( megabytes ) ) << " MB, over the memory budget of "
+            << static_cast<long long>( memoryBudgetMB ) << " MB";
+    error = message.str();
+
+    return false;
+}
+
+bool MetricsCore::load( const std::string& path )
+{
+    error.clear();
+    ScopedTimer timer( "load", "io" );
+
+    vtkSmartPointer<vtkImageReader2> newReader = createImageReader( path, classifyInput( path ) );
+    if ( !newReader )
+    {
+        error = "not a DICOM directory, readable NIfTI file or brick file: " + path;
+        return false;
+    }
+
+    newReader->UpdateInformation();
+
+    vtkInformation* info = newReader->GetOutputInformation( 0 );
+    int extent[6];
+    info->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent );
+
+    if ( extent[1] < extent[0] || extent[3] < extent[2] || extent[5] < extent[4] )
+    {
+        error = "no image found in " + path;
+        return false;
+    }
+
+    if ( !fitsBudget( imageMB( info, extent ), "the input image would" ) )
+    {
+        return false;
+    }
+
+    newReader->Update();
+
+    // The input shares the reader output (no deep copy)
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->ShallowCopy( newReader->GetOutput() );
+
+    if ( image->GetNumberOfPoints() == 0 )
+    {
+        error = "the image in " + path + " is empty";
+        return false;
+    }
+
+    setInput( image );
+    reader = newReader;
+    timer.addBytes( image->GetActualMemorySize() * 1024.0 );
+
+    return true;
+}
+
+void MetricsCore::setInput( vtkImageData* image )
+{
+    input = image;
+    reader = nullptr;
+    filtered.clear();
+    filterSeconds.clear();
+}
+
+bool MetricsCore::setInputBuffer( void* buffer, int scalarType, const int dims[3], const double* spacing,
+                                  const double* origin, int components )
+{
+    error.clear();
+
+    if ( !buffer || dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0 || components <= 0 )
+    {
+        error = "the buffer is empty or its dimensions are not positive";
+        return false;
+    }
+
+    vtkSmartPointer<vtkDataArray> scalars;
+    scalars.TakeReference( vtkDataArray::CreateDataArray( scalarType ) );
+    if ( !scalars )
+    {
+        error = "unsupported scalar type";
+        return false;
+    }
+
+    // Save = 1: the array never frees the caller's buffer
+    vtkIdType voxels = static_cast<vtkIdType>( dims[0] ) * dims[1] * dims[2];
+    scalars->SetNumberOfComponents( components );
+    scalars->SetVoidArray( buffer, voxels * components, 1 );
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions( dims );
+    if ( spacing )
+    {
+        image->SetSpacing( spacing[0], spacing[1], spacing[2] );
+    }
+    if ( origin )
+    {
+        image->SetOrigin( origin[0], origin[1], origin[2] );
+    }
+    image->GetPointData()->SetScalars( scalars );
+
+    setInput( image );
+
+    return true;
+}
+
+void MetricsCore::setFilters( const std::vector<FilterSpec>& specs )
+{
+    filters = specs;
+    filtered.clear();
+    filterSeconds.clear();
+}
+
+double MetricsCore::estimateFilteredMB() const
+{
+    if ( !input )
+    {
+        return 0.0;
+    }
+
+    int extent[6];
+    input->GetExtent( extent );
+
+    // The output type of each filter comes from its pipeline information, without running it
+    double megabytes = 0.0;
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        vtkSmartPointer<vtkImageAlgorithm> probe = FilterBank::createFilter( filters[i] );
+        probe->SetInputData( input );
+        probe->UpdateInformation();
+
+        megabytes += imageMB( probe->GetOutputInformation( 0 ), extent );
+    }
+
+    return megabytes;
+}
+
+bool MetricsCore::checkMemoryBudget()
+{
+    error.clear();
+
+    if ( !input )
+    {
+        return true;
+    }
+
+    // GetActualMemorySize() is in kibibytes
+    double inputMB = input->GetActualMemorySize() / 1024.0;
+    return fitsBudget( inputMB + estimateFilteredMB(), "the input and filtered images would" );
+}
+
+bool MetricsCore::filter()
+{
+    error.clear();
+
+    if ( !input )
+    {
+        error = "no input image";
+        return false;
+    }
+
+    if ( !checkMemoryBudget() )
+    {
+        return false;
+    }
+
+    ScopedTimer timer( "filters", "filter" );
+
+    // The filters only read the input, so they run at the same time with a share of the threads each
+    FilterBank bank( filters );
+    filtered      = bank.run( input, getNumberOfThreads() );
+    filterSeconds = bank.getSeconds();
+
+    return true;
+}
+
+void MetricsCore::setFilteredImages( const std::vector< vtkSmartPointer<vtkImageData> >& images )
+{
+    filtered = images;
+    filterSeconds.clear();
+}
+
+std::vector<vtkImageData*> MetricsCore::getImages() const
+{
+    std::vector<vtkImageData*> images( 1, input );
+    images.insert( images.end(), filtered.begin(), filtered.end() );
+
+    return images;
+}
+
+void* MetricsCore::getImageBuffer( int image ) const
+{
+    std::vector<vtkImageData*> images = getImages();
+
+    if ( image < 0 || image >= static_cast<int>( images.size() ) || !images[image] )
+    {
+        return nullptr;
+    }
+
+    return images[image]->GetScalarPointer();
+}
+
+void MetricsCore::setThresholds( double lower, double upper )
+{
+    lowerThreshold = lower;
+    upperThreshold = upper;
+}
+
+std::vector<SNRPartial> MetricsCore::computeSNR() const
+{
+    std::vector<SNRPartial> results;
+    if ( !input )
+    {
+        return results;
+    }
+
+    // The whole image: every row, column and slice
+    int extent[6];
+    input->GetExtent( extent );
+
+    SNRStatistics statistics;
+    statistics.setThresholds( lowerThreshold, upperThreshold );
+    statistics.setExtent( extent );
+
+    ScopedTimer timer( "snr", "statistics" );
+
+    std::vector<vtkImageData*> images = getImages();
+    for ( std::size_t i = 0; i < images.size(); i++ )
+    {
+        results.push_back( statistics.compute( images[i] ) );
+        timer.addBytes( images[i]->GetActualMemorySize() * 1024.0 );
+    }
+
+    return results;
+}
+
+bool MetricsCore::computeRegionSNR( const RegionStatistics& statistics, std::vector<RegionResult>& results )
+{
+    error.clear();
+    results.clear();
+
+    if ( !input )
+    {
+        error = "no input image";
+        return false;
+    }
+
+    ScopedTimer timer( "region snr", "statistics" );
+
+    std::vector<vtkImageData*> images = getImages();
+    for ( std::size_t i = 0; i < images.size(); i++ )
+    {
+        results.push_back( statistics.compute( images[i], &error ) );
+
+        if ( !error.empty() )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MetricsCore::segment( BitMask& mask, int image ) const
+{
+    std::vector<vtkImageData*> images = getImages();
+
+    if ( image < 0 || image >= static_cast<int>( images.size() ) || !images[image] )
+    {
+        return false;
+    }
+
+    ScopedTimer timer( "threshold", "segmentation" );
+
+    // One bit per voxel, packed by the SIMD kernels, one slice per vtkSMPTools task
+    mask.setGeometry( images[image] );
+    mask.threshold( images[image], lowerThreshold, upperThreshold );
+
+    timer.addBytes( images[image]->GetActualMemorySize() * 1024.0 + mask.getMemorySize() );
+
+    return true;
+}
+/***************************************************************************/
@@ -0,0 +1,239 @@
+/****************************************************************************
+*   metricsCore.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the processing API of the vtkMetricsCore
+*                   library (load, filter, SNR, segmentation).
+****************************************************************************/
+
+#ifndef METRICSCORE_H
+#define METRICSCORE_H
+
+#include "filterBank.hxx"
+#include "snrStatistics.hxx"
+#include "regionStatistics.hxx"
+#include "bitMask.hxx"
+
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageReader2.h>
+
+/*
+*   Classify an input path.
+*
+*   @param   input   A DICOM directory, NIfTI file or brick file
+*
+*   @returns 0 for a directory (DICOM series), 1 for .nii/.nii.gz, 2 for .bvol, -1 otherwise
+*/
+int classifyInput( const std::string& input );
+
+/*
+*   Create an unexecuted reader for an input.
+*
+*   @param   inputFile   A DICOM directory, NIfTI file or brick file
+*   @param   inputType   0 = DICOM series, 1 = NIfTI, 2 = brick file (see classifyInput())
+*
+*   @returns the reader, or nullptr if the input cannot be read
+*/
+vtkSmartPointer<vtkImageReader2> createImageReader( const std::string& inputFile, int inputType );
+
+/*
+*   The processing pipeline of vtkMetrics without the viewer:
+*   load -> filter -> computeSNR -> segment.
+*
+*   The input is either read from a file (load()) or given by the caller as
+*   an image or a raw buffer, which are shared, not copied. The filtered
+*   images stay in memory until the next filter() or setInput(), so one
+*   loaded volume can be filtered, measured and segmented several times.
+*
+*   Resources:
+*   - setNumberOfThreads() sets the threads of the filters of this instance,
+*     which split them. Instances are independent, so several can run on
+*     their own threads at the same time.
+*   - setThreadPoolSize() sizes the vtkSMPTools pool used by the statistics
+*     and the segmentation.
+*     It is process-wide and should be set once, before any processing.
+*   - setMemoryBudgetMB() limits the memory of the input and filtered images
+*     together. load() and filter() estimate their size first and fail
+*     without allocating when it would be exceeded.
+*
+*   Functions returning a boolean set getError() when they fail.
+*/
+class MetricsCore
+{
+    public:
+        MetricsCore();
+
+        /*
+        *   @param   threads   Threads of the filters, 0 = all cores (default)
+        */
+        void setNumberOfThreads( int threads );
+
+        /*
+        *   @returns the threads used, with 0 resolved to the number of cores
+        */
+        int getNumberOfThreads() const;
+
+        /*
+        *   Size the process-wide vtkSMPTools thread pool (SNR, histograms, regions, segmentation).
+        *
+        *   @param   threads   Threads, 0 = the vtkSMPTools default
+        */
+        static void setThreadPoolSize( int threads );
+
+        /*
+        *   @param   megabytes   Limit of the input and filtered images, 0 = no limit (default)
+        */
+        void setMemoryBudgetMB( double megabytes );
+        double getMemoryBudgetMB() const { return memoryBudgetMB; }
+
+        /*
+        *   Read a DICOM directory or NIfTI file (uncompressed NIfTI is memory-mapped).
+        *
+        *   @param   path   The input
+        *
+        *   @returns a boolean representing whether the image was read
+        */
+        bool load( const std::string& path );
+
+        /*
+        *   @returns the reader of the last load() (for its timings), nullptr after setInput()
+        */
+        vtkImageReader2* getReader() const { return reader; }
+
+        /*
+        *   Use an image that is already in memory. It is shared, not copied.
+        *   Clears the filtered images.
+        */
+        void setInput( vtkImageData* image );
+
+        /*
+        *   Use a raw buffer of voxels, X fastest, then Y, then Z. The buffer is
+        *   wrapped, not copied, and must outlive the use of this instance.
+        *
+        *   @param   buffer       The voxels
+        *   @param   scalarType   VTK scalar type (e.g. VTK_SHORT)
+        *   @param   dims         Voxels along X, Y and Z
+        *   @param   spacing      Voxel size, nullptr = 1
+        *   @param   origin       Position of the first voxel, nullptr = 0
+        *   @param   components   Components per voxel
+        *
+        *   @returns a boolean representing whether the buffer describes a valid image
+        */
+        bool setInputBuffer( void* buffer, int scalarType, const int dims[3], const double* spacing = nullptr,
+                             const double* origin = nullptr, int components = 1 );
+
+        vtkImageData* getInput() const { return input; }
+
+        /*
+        *   Set the filters of filter(). Clears the filtered images.
+        *
+        *   @param   specs   Completed specs (see FilterBank::complete())
+        */
+        void setFilters( const std::vector<FilterSpec>& specs );
+        const std::vector<FilterSpec>& getFilters() const { return filters; }
+
+        /*
+        *   Apply all filters to the input at the same time (see FilterBank).
+        *
+        *   @returns a boolean representing whether there is an input and the
+        *            filtered images fit in the memory budget
+        */
+        bool filter();
+
+        /*
+        *   Use filtered images computed elsewhere (e.g. loaded from a cache),
+        *   one per filter, in the order of the filters.
+        */
+        void setFilteredImages( const std::vector< vtkSmartPointer<vtkImageData> >& images );
+
+        const std::vector< vtkSmartPointer<vtkImageData> >& getFilteredImages() const { return filtered; }
+
+        /*
+        *   @returns the wall time of each filter in the last filter() (seconds)
+        */
+        const std::vector<double>& getFilterSeconds() const { return filterSeconds; }
+
+        /*
+        *   @returns the input, then the filtered images
+        */
+        std::vector<vtkImageData*> getImages() const;
+
+        /*
+        *   @param   image   0 = the input, i = the i-th filtered image
+        *
+        *   @returns the voxels of an image (not a copy), nullptr if it does not exist
+        */
+        void* getImageBuffer( int image ) const;
+
+        /*
+        *   @returns the megabytes the filtered images of the filters would need for the input
+        */
+        double estimateFilteredMB() const;
+
+        /*
+        *   Check that the input and the filtered images of the filters fit in
+        *   the memory budget, before filtering (filter() checks it too).
+        *
+        *   @returns a boolean representing whether they fit
+        */
+        bool checkMemoryBudget();
+
+        /*
+        *   Set the threshold range of the foreground (inclusive).
+        */
+        void setThresholds( double lower, double upper );
+
+        /*
+        *   The threshold SNR of the input and the filtered images (one threaded pass each).
+        *
+        *   @returns the statistics of the input, then the filtered images
+        */
+        std::vector<SNRPartial> computeSNR() const;
+
+        /*
+        *   The SNR of the input and the filtered images from signal and noise regions.
+        *
+        *   @param   statistics   The regions and noise estimator
+        *   @param   results      Receives the input, then the filtered images
+        *
+        *   @returns a boolean representing whether the regions fit the images
+        */
+        bool computeRegionSNR( const RegionStatistics& statistics, std::vector<RegionResult>& results );
+
+        /*
+        *   Segment an image into a bit mask: 1 inside the thresholds, 0 outside
+        *   (see BitMask::count() and BitMask::getVolume() for its size).
+        *
+        *   @param   mask    Receives the segmentation
+        *   @param   image   0 = the input, i = the i-th filtered image
+        *
+        *   @returns a boolean representing whether the image exists
+        */
+        bool segment( BitMask& mask, int image = 0 ) const;
+
+        /*
+        *   @returns the reason of the last failure
+        */
+        const std::string& getError() const { return error; }
+
+    private:
+        bool fitsBudget( double megabytes, const std::string& what );
+
+        vtkSmartPointer<vtkImageReader2> reader;
+        vtkSmartPointer<vtkImageData> input;
+        std::vector<FilterSpec> filters;
+        std::vector< vtkSmartPointer<vtkImageData> > filtered;
+        std::vector<double> filterSeconds;
+        int threads;
+        double memoryBudgetMB;
+        double lowerThreshold;
+        double upperThreshold;
+        std::string error;
+};
+
+#endif // METRICSCORE_H
@@ -0,0 +1,134 @@
+/****************************************************************************
+*   myBrickVolumeReader.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a reader of bricked volumes that reads
+*                   only the bricks of the update extent.
+****************************************************************************/
+
+#include "myBrickVolumeReader.hxx"
+
+#include <algorithm>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkInformation.h>
+#include <vtkErrorCode.h>
+#include <vtkSMPTools.h>
+
+vtkStandardNewMacro( myBrickVolumeReader );
+
+myBrickVolumeReader::myBrickVolumeReader()
+    : BricksRead( 0 )
+{
+}
+
+myBrickVolumeReader::~myBrickVolumeReader()
+{
+}
+
+void myBrickVolumeReader::SetCacheSizeMB( double megabytes )
+{
+    this->Cache.setBudget( std::max( 0.0, megabytes ) * 1024.0 * 1024.0 );
+}
+
+double myBrickVolumeReader::GetCacheSizeMB() const
+{
+    return this->Cache.getBudget() / ( 1024.0 * 1024.0 );
+}
+
+void myBrickVolumeReader::ExecuteInformation()
+{
+    if ( !this->FileName )
+    {
+        vtkErrorMacro( "A file name must be set" );
+        this->SetErrorCode( vtkErrorCode::NoFileNameError );
+        return;
+    }
+
+    // The header and index of the same file are only read once
+    if ( this->Volume.getNumberOfBricks() == 0 || this->Volume.getFileName() != this->FileName )
+    {
+        this->Cache.clear();
+        this->BricksRead = 0;
+
+        if ( !this->Volume.open( this->FileName ) )
+        {
+            vtkErrorMacro( "Cannot read " << this->Volume.getError() );
+            this->SetErrorCode( vtkErrorCode::FileFormatError );
+            return;
+        }
+    }
+
+    std::copy( this->Volume.getExtent(), this->Volume.getExtent() + 6, this->DataExtent );
+    std::copy( this->Volume.getSpacing(), this->Volume.getSpacing() + 3, this->DataSpacing );
+    std::copy( this->Volume.getOrigin(), this->Volume.getOrigin() + 3, this->DataOrigin );
+    this->SetDataScalarType( this->Volume.getScalarType() );
+    this->SetNumberOfScalarComponents( this->Volume.getNumberOfComponents() );
+
+    this->vtkImageReader2::ExecuteInformation();
+}
+
+void myBrickVolumeReader::ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo )
+{
+    vtkImageData* data = this->AllocateOutputData( output, outInfo );
+
+    if ( this->Volume.getNumberOfBricks() == 0 || !data->GetPointData()->GetScalars() )
+    {
+        vtkErrorMacro( "No brick file to read" );
+        return;
+    }
+
+    int extent[6];
+    data->GetExtent( extent );
+
+    const int* wholeExtent = this->Volume.getExtent();
+    bool whole = std::equal( extent, extent + 6, wholeExtent );
+
+    // Bricks still cached from the previous slab are not read again
+    std::vector<int> bricks = this->Volume.getBricks( extent );
+    std::vector<BrickVolume::Brick> voxels( bricks.size() );
+    std::vector<int> missing;
+    std::vector<std::size_t> missingSlots;
+
+    for ( std::size_t i = 0; i < bricks.size(); i++ )
+    {
+        voxels[i] = whole ? BrickVolume::Brick() : this->Cache.get( bricks[i] );
+        if ( !voxels[i] )
+        {
+            missing.push_back( bricks[i] );
+            missingSlots.push_back( i );
+        }
+    }
+
+    std::vector<BrickVolume::Brick> loaded;
+    if ( !this->Volume.readBricks( missing, loaded ) )
+    {
+        vtkErrorMacro( "Cannot read " << this->Volume.getError() );
+        this->SetErrorCode( vtkErrorCode::PrematureEndOfFileError );
+        return;
+    }
+    this->BricksRead += static_cast<long long>( missing.size() );
+
+    for ( std::size_t i = 0; i < missing.size(); i++ )
+    {
+        voxels[missingSlots[i]] = loaded[i];
+        if ( !whole )
+        {
+            this->Cache.insert( missing[i], loaded[i] );
+        }
+    }
+
+    // Bricks cover disjoint parts of the output, so they are copied in parallel
+    const BrickVolume& volume = this->Volume;
+    auto copyBricks = [&volume, &bricks, &voxels, data]( vtkIdType begin, vtkIdType end )
+    {
+        for ( vtkIdType i = begin; i < end; i++ )
+        {
+            volume.copyBrick( bricks[i], voxels[i], data );
+        }
+    };
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( bricks.size() ), 1, copyBricks );
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+*   myBrickVolumeReader.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a reader of bricked volumes that reads
+*                   only the bricks of the update extent.
+****************************************************************************/
+
+#ifndef MYBRICKVOLUMEREADER_H
+#define MYBRICKVOLUMEREADER_H
+
+#include "brickVolume.hxx"
+#include "brickCache.hxx"
+
+#include <vtkImageReader2.h>
+
+/*
+*   Reads .bvol files (see BrickVolume) for volumes larger than the memory.
+*
+*   Each update reads only the bricks that intersect the update extent, so a
+*   slab of a streamed pass or the displayed slice of the viewer costs one layer
+*   of bricks instead of the volume. Decoded bricks are kept in a BrickCache
+*   with a memory budget: the filters of a streamed slab request the slab plus
+*   their kernel padding, so with room for three layers (the previous, current
+*   and next) every brick is read from disk once per pass.
+*
+*   An update of the whole extent reads every brick without caching them, as
+*   the cache would only drop them again.
+*/
+class myBrickVolumeReader : public vtkImageReader2
+{
+public:
+   static myBrickVolumeReader* New();
+
+   vtkTypeMacro( myBrickVolumeReader, vtkImageReader2 );
+
+   /*
+   *   Set the memory budget of the brick cache (default 1024 MB).
+   *
+   *   @param   megabytes   The budget, 0 = no caching
+   */
+   void SetCacheSizeMB( double megabytes );
+   double GetCacheSizeMB() const;
+
+   /*
+   *   @returns the open brick file (valid after UpdateInformation())
+   */
+   const BrickVolume& GetVolume() const { return this->Volume; }
+
+   /*
+   *   @returns the number of bricks read from disk since the file was opened
+   */
+   long long GetBricksRead() const { return this->BricksRead; }
+
+   /*
+   *   @returns the number of bricks that came from the cache since the file was opened
+   */
+   long long GetCacheHits() const { return this->Cache.getHits(); }
+
+protected:
+   myBrickVolumeReader();
+   ~myBrickVolumeReader() override;
+
+   void ExecuteInformation() override;
+   void ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo ) override;
+
+   BrickVolume Volume;
+   BrickCache Cache;
+   long long BricksRead;
+
+private:
+   myBrickVolumeReader( const myBrickVolumeReader& ) = delete;
+   void operator=( const myBrickVolumeReader& ) = delete;
+};
+
+#endif  // MYBRICKVOLUMEREADER_H
@@ -0,0 +1,347 @@
+/****************************************************************************
+*   myDICOMImageReader.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a multithreaded DICOM series reader.
+****************************************************************************/
+
+#include "myDICOMImageReader.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkErrorCode.h>
+#include <vtkDICOMImageReader.h>
+#include <vtkSMPTools.h>
+
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+vtkStandardNewMacro( myDICOMImageReader );
+
+/*
+*   What the information pass needs from the header of one file.
+*/
+struct DICOMHeader
+{
+    bool valid;
+    double position;        // Distance along the slice normal
+    int extent[6];
+    double spacing[3];
+    double origin[3];
+    int scalarType;
+    int components;
+};
+
+/*
+*   Parses the headers of a range of files. Each file gets its own reader.
+*/
+class DICOMHeaderFunctor
+{
+    public:
+        DICOMHeaderFunctor( const std::vector<std::string>& files, std::vector<DICOMHeader>& headers )
+            : Files( files ), Headers( headers )
+        {
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            for ( vtkIdType i = begin; i < end; i++ )
+            {
+                DICOMHeader& header = Headers[i];
+                header.valid = false;
+
+                vtkSmartPointer<vtkDICOMImageReader> reader = vtkSmartPointer<vtkDICOMImageReader>::New();
+                if ( !reader->CanReadFile( Files[i].c_str() ) )
+                {
+                    continue;
+                }
+
+                reader->SetFileName( Files[i].c_str() );
+                reader->UpdateInformation();
+
+                if ( reader->GetErrorCode() != vtkErrorCode::NoError )
+                {
+                    continue;
+                }
+
+                // Sort key: image position projected on the slice normal (row x column direction)
+                const float* position    = reader->GetImagePositionPatient();
+                const float* orientation = reader->GetImageOrientationPatient();
+
+                double normal[3] = { orientation[1] * orientation[5] - orientation[2] * orientation[4],
+                                     orientation[2] * orientation[3] - orientation[0] * orientation[5],
+                                     orientation[0] * orientation[4] - orientation[1] * orientation[3] };
+
+                if ( normal[0] == 0.0 && normal[1] == 0.0 && normal[2] == 0.0 )
+                {
+                    normal[2] = 1.0;
+                }
+
+                header.position = position[0] * normal[0] + position[1] * normal[1] + position[2] * normal[2];
+
+                reader->GetDataExtent( header.extent );
+                reader->GetDataSpacing( header.spacing );
+                reader->GetDataOrigin( header.origin );
+                header.scalarType = reader->GetDataScalarType();
+                header.components = reader->GetNumberOfScalarComponents();
+                header.valid      = true;
+            }
+        }
+
+    private:
+        const std::vector<std::string>& Files;
+        std::vector<DICOMHeader>& Headers;
+};
+
+/*
+*   Decodes a range of slices and copies the rows of the update extent
+*   straight into the output volume.
+*/
+class DICOMDecodeFunctor
+{
+    public:
+        DICOMDecodeFunctor( const std::vector<std::string>& files, vtkImageData* output, std::atomic<int>& failures )
+            : Files( files ), Output( output ), Failures( failures )
+        {
+            output->GetExtent( Extent );
+            output->GetIncrements( Increments );
+            Base       = static_cast<char*>( output->GetScalarPointer() );
+            ScalarSize = output->GetScalarSize();
+            VoxelSize  = ScalarSize * output->GetNumberOfScalarComponents();
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            std::size_t rowBytes = static_cast<std::size_t>( Extent[1] - Extent[0] + 1 ) * VoxelSize;
+
+            for ( vtkIdType z = begin; z < end; z++ )
+            {
+                vtkSmartPointer<vtkDICOMImageReader> reader = vtkSmartPointer<vtkDICOMImageReader>::New();
+                reader->SetFileName( Files[z].c_str() );
+                reader->Update();
+
+                vtkImageData* slice = reader->GetOutput();
+                int sliceExtent[6];
+                slice->GetExtent( sliceExtent );
+
+                // Slice z of the range is slice Extent[4] + z of the output
+                char* outSlice = Base + z * Increments[2] * ScalarSize;
+
+                // A slice that cannot be decoded is left as zeros rather than uninitialized memory
+                if ( reader->GetErrorCode() != vtkErrorCode::NoError ||
+                     slice->GetScalarType() != Output->GetScalarType() ||
+                     sliceExtent[0] > Extent[0] || sliceExtent[1] < Extent[1] ||
+                     sliceExtent[2] > Extent[2] || sliceExtent[3] < Extent[3] )
+                {
+                    for ( int y = Extent[2]; y <= Extent[3]; y++ )
+                    {
+                        std::memset( outSlice + ( y - Extent[2] ) * Increments[1] * ScalarSize, 0, rowBytes );
+                    }
+
+                    Failures++;
+                    continue;
+                }
+
+                for ( int y = Extent[2]; y <= Extent[3]; y++ )
+                {
+                    const void* row = slice->GetScalarPointer( Extent[0], y, sliceExtent[4] );
+                    char* outRow    = outSlice + ( y - Extent[2] ) * Increments[1] * ScalarSize;
+
+                    std::memcpy( outRow, row, rowBytes );
+                }
+            }
+        }
+
+    private:
+        const std::vector<std::string>& Files;
+        vtkImageData* Output;
+        std::atomic<int>& Failures;
+        int Extent[6];
+        vtkIdType Increments[3];
+        char* Base;
+        int ScalarSize;
+        int VoxelSize;
+};
+
+static double secondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+myDICOMImageReader::myDICOMImageReader()
+    : DirectoryName( nullptr ), ScanTime( 0.0 ), HeaderTime( 0.0 ), SortTime( 0.0 ), DecodeTime( 0.0 )
+{
+}
+
+myDICOMImageReader::~myDICOMImageReader()
+{
+    this->SetDirectoryName( nullptr );
+}
+
+void myDICOMImageReader::PrintTimings( ostream& os )
+{
+    os << "DICOM loading (" << this->Slices.size() << " slices): scan " << this->ScanTime << " s, headers "
+       << this->HeaderTime << " s, sort " << this->SortTime << " s, decode " << this->DecodeTime << " s \n";
+}
+
+void myDICOMImageReader::ExecuteInformation()
+{
+    if ( !this->DirectoryName )
+    {
+        vtkErrorMacro( "A directory name must be set" );
+        this->SetErrorCode( vtkErrorCode::NoFileNameError );
+        return;
+    }
+
+    // The headers of the same directory are only parsed once
+    if ( this->Slices.empty() || this->ScannedDirectory != this->DirectoryName )
+    {
+        this->Slices.clear();
+        this->ScannedDirectory.clear();
+
+        /*************************** List the files ****************************/
+        auto start = std::chrono::steady_clock::now();
+
+        vtksys::Directory directory;
+        if ( !directory.Load( this->DirectoryName ) )
+        {
+            vtkErrorMacro( "Cannot list the directory " << this->DirectoryName );
+            this->SetErrorCode( vtkErrorCode::CannotOpenFileError );
+            return;
+        }
+
+        std::vector<std::string> files;
+        for ( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+        {
+            std::string path = std::string( this->DirectoryName ) + "/" + directory.GetFile( i );
+            if ( !vtksys::SystemTools::FileIsDirectory( path ) )
+            {
+                files.push_back( path );
+            }
+        }
+
+        this->ScanTime = secondsSince( start );
+
+        /************************** Parse the headers **************************/
+        start = std::chrono::steady_clock::now();
+
+        std::vector<DICOMHeader> headers( files.size() );
+        DICOMHeaderFunctor headerFunctor( files, headers );
+        vtkSMPTools::For( 0, static_cast<vtkIdType>( files.size() ), 1, headerFunctor );
+
+        this->HeaderTime = secondsSince( start );
+
+        /*************************** Sort the slices ***************************/
+        start = std::chrono::steady_clock::now();
+
+        std::vector<std::size_t> order;
+        for ( std::size_t i = 0; i < files.size(); i++ )
+        {
+            if ( headers[i].valid )
+            {
+                order.push_back( i );
+            }
+        }
+
+        if ( order.empty() )
+        {
+            vtkErrorMacro( "No DICOM files were found in " << this->DirectoryName );
+            this->SetErrorCode( vtkErrorCode::FileFormatError );
+            return;
+        }
+
+        std::stable_sort( order.begin(), order.end(), [&]( std::size_t a, std::size_t b )
+        {
+            return ( headers[a].position != headers[b].position ) ? headers[a].position < headers[b].position
+                                                                  : files[a] < files[b];
+        } );
+
+        // All slices must match the first one; files of another size or type are skipped
+        const DICOMHeader& first = headers[order[0]];
+        for ( std::size_t i = 0; i < order.size(); i++ )
+        {
+            const DICOMHeader& header = headers[order[i]];
+
+            if ( header.scalarType != first.scalarType || header.components != first.components ||
+                 header.extent[1] - header.extent[0] != first.extent[1] - first.extent[0] ||
+                 header.extent[3] - header.extent[2] != first.extent[3] - first.extent[2] )
+            {
+                vtkWarningMacro( "Skipping " << files[order[i]] << ": its size or type differs from the series" );
+                continue;
+            }
+
+            Slice slice;
+            slice.FileName = files[order[i]];
+            slice.Position = header.position;
+            this->Slices.push_back( slice );
+        }
+
+        this->DataExtent[0] = first.extent[0];
+        this->DataExtent[1] = first.extent[1];
+        this->DataExtent[2] = first.extent[2];
+        this->DataExtent[3] = first.extent[3];
+        this->DataExtent[4] = 0;
+        this->DataExtent[5] = static_cast<int>( this->Slices.size() ) - 1;
+
+        for ( int i = 0; i < 3; i++ )
+        {
+            this->DataSpacing[i] = first.spacing[i];
+            this->DataOrigin[i]  = first.origin[i];
+        }
+
+        this->SetDataScalarType( first.scalarType );
+        this->SetNumberOfScalarComponents( first.components );
+
+        this->ScannedDirectory = this->DirectoryName;
+        this->SortTime = secondsSince( start );
+    }
+
+    this->vtkImageReader2::ExecuteInformation();
+}
+
+void myDICOMImageReader::ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo )
+{
+    vtkImageData* data = this->AllocateOutputData( output, outInfo );
+
+    if ( this->Slices.empty() || !data->GetPointData()->GetScalars() )
+    {
+        vtkErrorMacro( "No DICOM slices to read" );
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int extent[6];
+    data->GetExtent( extent );
+
+    // Decode only the slices of the update extent
+    std::vector<std::string> files;
+    for ( int z = extent[4]; z <= extent[5]; z++ )
+    {
+        files.push_back( this->Slices[z].FileName );
+    }
+
+    std::atomic<int> failures( 0 );
+    DICOMDecodeFunctor decodeFunctor( files, data, failures );
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( files.size() ), 1, decodeFunctor );
+
+    data->GetPointData()->GetScalars()->SetName( "DICOMImage" );
+
+    this->DecodeTime = secondsSince( start );
+
+    if ( failures > 0 )
+    {
+        vtkErrorMacro( << failures.load() << " DICOM slices could not be decoded and were filled with zeros" );
+        this->SetErrorCode( vtkErrorCode::FileFormatError );
+    }
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+*   myDICOMImageReader.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a multithreaded DICOM series reader.
+*                   Replacement for vtkDICOMImageReader::SetDirectoryName.
+****************************************************************************/
+
+#ifndef MYDICOMIMAGEREADER_H
+#define MYDICOMIMAGEREADER_H
+
+#include <string>
+#include <vector>
+
+#include <vtkImageReader2.h>
+
+/*
+*   Reads a directory with a DICOM series into one volume.
+*
+*   The information pass lists the directory, parses the header of every file
+*   in parallel and sorts the slices by their position along the slice normal.
+*   The result is cached until the directory name changes, so repeated
+*   UpdateInformation() calls do not touch the files again.
+*
+*   The data pass allocates the output once and decodes the slices of the
+*   update extent in parallel (vtkSMPTools). Each slice is decoded by its own
+*   vtkDICOMImageReader and its rows are copied into their final place in the
+*   output, so the volume is never assembled or copied as a whole. Because only
+*   the requested slices are decoded, streamed Z-slabs read only their files.
+*   A slice that fails to decode is filled with zeros and the reader reports
+*   a FileFormatError.
+*
+*   The time of each phase is kept and can be printed with PrintTimings().
+*/
+class myDICOMImageReader : public vtkImageReader2
+{
+public:
+   static myDICOMImageReader* New();
+
+   vtkTypeMacro( myDICOMImageReader, vtkImageReader2 );
+
+   /*
+   *   Set the directory that holds the DICOM series.
+   */
+   vtkSetStringMacro( DirectoryName );
+   vtkGetStringMacro( DirectoryName );
+
+   /*
+   *   @returns the number of slices found in the directory
+   */
+   int GetNumberOfSlices() const { return static_cast<int>( this->Slices.size() ); }
+
+   /*
+   *   Time in seconds spent listing the directory, parsing the headers,
+   *   sorting the slices and decoding the pixel data (last execution of each).
+   */
+   vtkGetMacro( ScanTime, double );
+   vtkGetMacro( HeaderTime, double );
+   vtkGetMacro( SortTime, double );
+   vtkGetMacro( DecodeTime, double );
+
+   /*
+   *   Print the time of each loading phase on one line.
+   *
+   *   @param   os   The stream to print to
+   */
+   void PrintTimings( ostream& os );
+
+protected:
+   myDICOMImageReader();
+   ~myDICOMImageReader() override;
+
+   void ExecuteInformation() override;
+   void ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo ) override;
+
+   /*
+   *   One file of the series and its sort key.
+   */
+   struct Slice
+   {
+      std::string FileName;
+      double Position;
+   };
+
+   char* DirectoryName;
+
+   std::vector<Slice> Slices;
+   std::string ScannedDirectory;
+
+   double ScanTime;
+   double HeaderTime;
+   double SortTime;
+   double DecodeTime;
+
+private:
+   myDICOMImageReader( const myDICOMImageReader& ) = delete;
+   void operator=( const myDICOMImageReader& ) = delete;
+};
+
+#endif  // MYDICOMIMAGEREADER_H
@@ -0,0 +1,203 @@
+/****************************************************************************
+*   myImageBilateral3D.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a 3D bilateral (edge preserving
+*                   smoothing) filter.
+****************************************************************************/
+
+#include "myImageBilateral3D.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+
+vtkStandardNewMacro( myImageBilateral3D );
+
+/*
+*   Convert a weighted mean back to the scalar type, rounding integers to the
+*   nearest value within the range of the type.
+*/
+template <class T>
+static T toScalar( double value )
+{
+    if ( std::numeric_limits<T>::is_integer )
+    {
+        value = std::floor( value + 0.5 );
+        value = std::min( std::max( value, static_cast<double>( std::numeric_limits<T>::lowest() ) ),
+                          static_cast<double>( std::numeric_limits<T>::max() ) );
+    }
+
+    return static_cast<T>( value );
+}
+
+template <class T>
+static void myImageBilateral3DExecute( myImageBilateral3D* self, vtkImageData* inData, vtkImageData* outData,
+                                       const int outExt[6], const int kernelMiddle[3], T* )
+{
+    int inExt[6];
+    inData->GetExtent( inExt );
+
+    vtkIdType inInc[3], outInc[3];
+    inData->GetIncrements( inInc );
+    outData->GetIncrements( outInc );
+
+    const T* inBase = static_cast<const T*>( inData->GetScalarPointer( inExt[0], inExt[2], inExt[4] ) );
+    T* outBase      = static_cast<T*>( outData->GetScalarPointer( outExt[0], outExt[2], outExt[4] ) );
+
+    int components = inData->GetNumberOfScalarComponents();
+    int radius[3]  = { kernelMiddle[0], kernelMiddle[1], kernelMiddle[2] };
+    int size[3]    = { 2 * radius[0] + 1, 2 * radius[1] + 1, 2 * radius[2] + 1 };
+
+    // Spatial weights of the whole kernel, computed once
+    double spatial = self->GetSpatialStandardDeviation();
+    std::vector<double> spatialWeights( size[0] * size[1] * size[2] );
+
+    for ( int k = 0; k < size[2]; k++ )
+    {
+        for ( int j = 0; j < size[1]; j++ )
+        {
+            for ( int i = 0; i < size[0]; i++ )
+            {
+                double dx = i - radius[0], dy = j - radius[1], dz = k - radius[2];
+                spatialWeights[( k * size[1] + j ) * size[0] + i] =
+                    std::exp( -( dx * dx + dy * dy + dz * dz ) / ( 2.0 * spatial * spatial ) );
+            }
+        }
+    }
+
+    double range = self->GetRangeStandardDeviation();
+    double rangeFactor = -1.0 / ( 2.0 * range * range );
+
+    for ( int z = outExt[4]; z <= outExt[5]; z++ )
+    {
+        int zMin = std::max( z - radius[2], inExt[4] ), zMax = std::min( z + radius[2], inExt[5] );
+
+        for ( int y = outExt[2]; y <= outExt[3]; y++ )
+        {
+            int yMin = std::max( y - radius[1], inExt[2] ), yMax = std::min( y + radius[1], inExt[3] );
+
+            for ( int x = outExt[0]; x <= outExt[1]; x++ )
+            {
+                int xMin = std::max( x - radius[0], inExt[0] ), xMax = std::min( x + radius[0], inExt[1] );
+
+                const T* centre = inBase + ( x - inExt[0] ) * inInc[0] + ( y - inExt[2] ) * inInc[1]
+                                         + ( z - inExt[4] ) * inInc[2];
+                T* out = outBase + ( x - outExt[0] ) * outInc[0] + ( y - outExt[2] ) * outInc[1]
+                                 + ( z - outExt[4] ) * outInc[2];
+
+                for ( int c = 0; c < components; c++ )
+                {
+                    double value = static_cast<double>( centre[c] );
+                    double sum = 0.0, weights = 0.0;
+
+                    for ( int hz = zMin; hz <= zMax; hz++ )
+                    {
+                        for ( int hy = yMin; hy <= yMax; hy++ )
+                        {
+                            const T* in = inBase + ( xMin - inExt[0] ) * inInc[0] + ( hy - inExt[2] ) * inInc[1]
+                                                 + ( hz - inExt[4] ) * inInc[2] + c;
+                            const double* spatialRow = &spatialWeights[( ( hz - z + radius[2] ) * size[1]
+                                                                         + ( hy - y + radius[1] ) ) * size[0]
+                                                                       + ( xMin - x + radius[0] )];
+
+                            for ( int hx = xMin; hx <= xMax; hx++, in += inInc[0], spatialRow++ )
+                            {
+                                double difference = static_cast<double>( *in ) - value;
+                                double weight = *spatialRow * std::exp( difference * difference * rangeFactor );
+
+                                sum     += weight * static_cast<double>( *in );
+                                weights += weight;
+                            }
+                        }
+                    }
+
+                    // The centre voxel always has weight 1, so weights > 0
+                    out[c] = toScalar<T>( sum / weights );
+                }
+            }
+        }
+    }
+}
+
+/****************** Class "myImageBilateral3D" functions ******************/
+myImageBilateral3D::myImageBilateral3D()
+{
+    this->SpatialStandardDeviation = 0.0;
+    this->RangeStandardDeviation   = 50.0;
+    this->HandleBoundaries         = 1;
+    this->SetSpatialStandardDeviation( 1.5 );
+}
+
+myImageBilateral3D::~myImageBilateral3D()
+{
+}
+
+void myImageBilateral3D::SetSpatialStandardDeviation( double std )
+{
+    if ( this->SpatialStandardDeviation == std )
+    {
+        return;
+    }
+
+    this->SpatialStandardDeviation = std;
+
+    // The spatial weight is below 14% of the centre beyond 2 standard deviations
+    int radius = std::max( 1, static_cast<int>( std::ceil( 2.0 * std ) ) );
+    for ( int i = 0; i < 3; i++ )
+    {
+        this->KernelSize[i]   = 2 * radius + 1;
+        this->KernelMiddle[i] = radius;
+    }
+
+    this->Modified();
+}
+
+void myImageBilateral3D::ThreadedRequestData( vtkInformation* vtkNotUsed( request ),
+                                              vtkInformationVector** vtkNotUsed( inputVector ),
+                                              vtkInformationVector* vtkNotUsed( outputVector ),
+                                              vtkImageData*** inData, vtkImageData** outData,
+                                              int outExt[6], int vtkNotUsed( threadId ) )
+{
+    vtkImageData* input = inData[0][0];
+    if ( !input || !input->GetPointData()->GetScalars() )
+    {
+        return;
+    }
+
+    // Both standard deviations divide the exponents of the weights
+    if ( !( this->SpatialStandardDeviation > 0.0 ) || !( this->RangeStandardDeviation > 0.0 ) )
+    {
+        vtkErrorMacro( "The spatial and range standard deviations must be greater than 0" );
+        return;
+    }
+
+    if ( input->GetScalarType() != outData[0]->GetScalarType() )
+    {
+        vtkErrorMacro( "Input scalar type " << input->GetScalarType() << " must match output scalar type "
+                       << outData[0]->GetScalarType() );
+        return;
+    }
+
+    switch ( input->GetScalarType() )
+    {
+        vtkTemplateMacro( myImageBilateral3DExecute( this, input, outData[0], outExt, this->KernelMiddle,
+                                                     static_cast<VTK_TT*>( nullptr ) ) );
+
+        default:
+        {
+            vtkErrorMacro( "Unknown input scalar type" );
+            return;
+        }
+    }
+}
+/***************************************************************************/
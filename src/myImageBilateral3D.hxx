@@ -0,0 +1,66 @@
+/****************************************************************************
+*   myImageBilateral3D.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a 3D bilateral (edge preserving
+*                   smoothing) filter.
+****************************************************************************/
+
+#ifndef MYIMAGEBILATERAL3D_H
+#define MYIMAGEBILATERAL3D_H
+
+#include <vtkImageSpatialAlgorithm.h>
+
+/*
+*   A 3D bilateral filter: each voxel becomes the average of its neighbourhood,
+*   weighted by a Gaussian of the distance (spatial standard deviation, in
+*   voxels) times a Gaussian of the intensity difference to the centre voxel
+*   (range standard deviation, in intensity units). Voxels across an edge
+*   differ by more than the range standard deviation and barely contribute,
+*   so edges stay sharp while flat regions are smoothed.
+*
+*   The neighbourhood is clipped to the image at the border. The output has
+*   the scalar type of the input, rounded to the nearest value for integers. Threaded over the output extent with
+*   vtkThreadedImageAlgorithm, so SetNumberOfThreads() limits it.
+*/
+class myImageBilateral3D : public vtkImageSpatialAlgorithm
+{
+public:
+   static myImageBilateral3D* New();
+
+   vtkTypeMacro( myImageBilateral3D, vtkImageSpatialAlgorithm );
+
+   /*
+   *   Set the spatial standard deviation. The kernel radius is 2 standard deviations.
+   *
+   *   @param   std   Standard deviation in voxels (> 0)
+   */
+   void SetSpatialStandardDeviation( double std );
+   vtkGetMacro( SpatialStandardDeviation, double );
+
+   /*
+   *   Set the range standard deviation.
+   *
+   *   @param   std   Standard deviation in intensity units (> 0)
+   */
+   vtkSetMacro( RangeStandardDeviation, double );
+   vtkGetMacro( RangeStandardDeviation, double );
+
+protected:
+   myImageBilateral3D();
+   ~myImageBilateral3D() override;
+
+   void ThreadedRequestData( vtkInformation* request, vtkInformationVector** inputVector,
+                             vtkInformationVector* outputVector, vtkImageData*** inData,
+                             vtkImageData** outData, int outExt[6], int threadId ) override;
+
+   double SpatialStandardDeviation;
+   double RangeStandardDeviation;
+
+private:
+   myImageBilateral3D( const myImageBilateral3D& ) = delete;
+   void operator=( const myImageBilateral3D& ) = delete;
+};
+
+#endif  // MYIMAGEBILATERAL3D_H
@@ -0,0 +1,550 @@
+/****************************************************************************
+*   myImageMedian3D.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a fast 3D median filter. Drop-in
+*                   replacement for vtkImageMedian3D.
+****************************************************************************/
+
+#include "myImageMedian3D.hxx"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkSMPTools.h>
+
+vtkStandardNewMacro( myImageMedian3D );
+
+/*
+*   Grain of vtkSMPTools::For that splits a range into at most the given number
+*   of tasks (0 lets vtkSMPTools choose).
+*
+*   @param   count     Number of items in the range
+*   @param   threads   Largest number of tasks, or 0 for no bound
+*   @returns the grain
+*/
+static vtkIdType grainForThreads( vtkIdType count, int threads )
+{
+    return threads > 0 ? std::max<vtkIdType>( 1, ( count + threads - 1 ) / threads ) : 0;
+}
+
+/*
+*   Pointers, extents and kernel geometry shared by all slab workers.
+*   Increments are in scalars and include the number of components.
+*/
+template <class T>
+struct MedianContext
+{
+    const T* inBase;
+    vtkIdType inInc[3];
+    int inExt[6];
+
+    T* outBase;
+    vtkIdType outInc[3];
+    int outExt[6];
+
+    int kernelSize[3];
+    int kernelMiddle[3];
+    int numberOfElements;
+    int component;
+
+    // Histogram path (integer images with a limited value range)
+    bool useHistogram;
+    long long minValue;
+    int numBins;
+
+    // Output voxels whose whole neighbourhood lies inside the input
+    int interior[6];
+
+    const T* in( int x, int y, int z ) const
+    {
+        return inBase + ( x - inExt[0] ) * inInc[0] + ( y - inExt[2] ) * inInc[1]
+                      + ( z - inExt[4] ) * inInc[2] + component;
+    }
+
+    T* out( int x, int y, int z ) const
+    {
+        return outBase + ( x - outExt[0] ) * outInc[0] + ( y - outExt[2] ) * outInc[1]
+                       + ( z - outExt[4] ) * outInc[2] + component;
+    }
+};
+
+/*
+*   Median of a neighbourhood clipped by the image border, matching vtkImageMedian3D.
+*
+*   vtkImageMedian3D adds the samples one at a time (Z outer, X inner) to a
+*   running median. For an odd number of samples that gives the true median. For
+*   an even number it gives the lower middle value if the last sample is >= the
+*   median of the others, and the upper middle value otherwise.
+*/
+template <class T>
+static T clippedMedian( const MedianContext<T>& c, int x, int y, int z, std::vector<double>& buffer )
+{
+    int hoodMin[3] = { x - c.kernelMiddle[0], y - c.kernelMiddle[1], z - c.kernelMiddle[2] };
+    int hoodMax[3];
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        hoodMax[i] = std::min( hoodMin[i] + c.kernelSize[i] - 1, c.inExt[2 * i + 1] );
+        hoodMin[i] = std::max( hoodMin[i], c.inExt[2 * i] );
+    }
+
+    buffer.clear();
+    for ( int hz = hoodMin[2]; hz <= hoodMax[2]; hz++ )
+    {
+        for ( int hy = hoodMin[1]; hy <= hoodMax[1]; hy++ )
+        {
+            for ( int hx = hoodMin[0]; hx <= hoodMax[0]; hx++ )
+            {
+                buffer.push_back( static_cast<double>( *c.in( hx, hy, hz ) ) );
+            }
+        }
+    }
+
+    std::size_t n = buffer.size();
+
+    if ( n % 2 == 1 )
+    {
+        std::nth_element( buffer.begin(), buffer.begin() + n / 2, buffer.end() );
+        return static_cast<T>( buffer[n / 2] );
+    }
+
+    double last = buffer[n - 1];
+    std::nth_element( buffer.begin(), buffer.begin() + ( n - 2 ) / 2, buffer.end() - 1 );
+    double previousMedian = buffer[( n - 2 ) / 2];
+
+    std::size_t rank = ( last >= previousMedian ) ? n / 2 - 1 : n / 2;
+    std::nth_element( buffer.begin(), buffer.begin() + rank, buffer.end() );
+    return static_cast<T>( buffer[rank] );
+}
+
+/*
+*   Histogram of the voxels in the current kernel window, with the median bin
+*   tracked incrementally (Huang). "below" counts the samples in bins < median.
+*/
+class MedianHistogram
+{
+    public:
+        MedianHistogram( int numBins, int numberOfElements )
+            : bins( numBins, 0 ), median( 0 ), below( 0 ), half( numberOfElements / 2 )
+        {
+        }
+
+        void add( int bin )
+        {
+            bins[bin]++;
+            below += ( bin < median );
+        }
+
+        void remove( int bin )
+        {
+            bins[bin]--;
+            below -= ( bin < median );
+        }
+
+        int getMedian()
+        {
+            while ( below > half )
+            {
+                median--;
+                below -= bins[median];
+            }
+            while ( below + bins[median] <= half )
+            {
+                below += bins[median];
+                median++;
+            }
+            return median;
+        }
+
+    private:
+        std::vector<int> bins;
+        int median;
+        int below;
+        int half;
+};
+
+/*
+*   Serpentine walk of the kernel window through the interior of one slab.
+*/
+template <class T>
+class HistogramWalker
+{
+    public:
+        HistogramWalker( const MedianContext<T>& context )
+            : c( context ), histogram( context.numBins, context.numberOfElements )
+        {
+        }
+
+        void run( int zStart, int zEnd )
+        {
+            const int* r = c.interior;
+
+            center[0] = r[0];
+            center[1] = r[2];
+            center[2] = zStart;
+
+            // Fill the first window
+            int lo[3], hi[3];
+            window( lo, hi );
+            for ( int z = lo[2]; z <= hi[2]; z++ )
+            {
+                for ( int y = lo[1]; y <= hi[1]; y++ )
+                {
+                    for ( int x = lo[0]; x <= hi[0]; x++ )
+                    {
+                        histogram.add( bin( x, y, z ) );
+                    }
+                }
+            }
+
+            int dx = 1, dy = 1;
+            int nx = r[1] - r[0] + 1;
+            int ny = r[3] - r[2] + 1;
+
+            for ( int z = zStart; z <= zEnd; z++ )
+            {
+                if ( z != zStart )
+                {
+                    shift( 2, 1 );
+                }
+
+                for ( int row = 0; row < ny; row++ )
+                {
+                    if ( row != 0 )
+                    {
+                        shift( 1, dy );
+                    }
+
+                    for ( int col = 0; col < nx; col++ )
+                    {
+                        if ( col != 0 )
+                        {
+                            shift( 0, dx );
+                        }
+
+                        *c.out( center[0], center[1], center[2] ) =
+                            static_cast<T>( c.minValue + histogram.getMedian() );
+                    }
+
+                    dx = -dx;
+                }
+
+                dy = -dy;
+            }
+        }
+
+    private:
+        const MedianContext<T>& c;
+        MedianHistogram histogram;
+        int center[3];
+
+        int bin( int x, int y, int z ) const
+        {
+            return static_cast<int>( static_cast<long long>( *c.in( x, y, z ) ) - c.minValue );
+        }
+
+        void window( int lo[3], int hi[3] ) const
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                lo[i] = center[i] - c.kernelMiddle[i];
+                hi[i] = lo[i] + c.kernelSize[i] - 1;
+            }
+        }
+
+        /*
+        *   Move the window one voxel along an axis: drop the trailing face, add the leading face.
+        */
+        void shift( int axis, int direction )
+        {
+            int lo[3], hi[3];
+            window( lo, hi );
+
+            int leaving  = ( direction > 0 ) ? lo[axis] : hi[axis];
+            int entering = ( direction > 0 ) ? hi[axis] + 1 : lo[axis] - 1;
+
+            // Restrict the loops to the face being moved
+            int faceLo[3] = { lo[0], lo[1], lo[2] };
+            int faceHi[3] = { hi[0], hi[1], hi[2] };
+
+            faceLo[axis] = faceHi[axis] = leaving;
+            for ( int z = faceLo[2]; z <= faceHi[2]; z++ )
+                for ( int y = faceLo[1]; y <= faceHi[1]; y++ )
+                    for ( int x = faceLo[0]; x <= faceHi[0]; x++ )
+                        histogram.remove( bin( x, y, z ) );
+
+            faceLo[axis] = faceHi[axis] = entering;
+            for ( int z = faceLo[2]; z <= faceHi[2]; z++ )
+                for ( int y = faceLo[1]; y <= faceHi[1]; y++ )
+                    for ( int x = faceLo[0]; x <= faceHi[0]; x++ )
+                        histogram.add( bin( x, y, z ) );
+
+            center[axis] += direction;
+        }
+};
+
+/*
+*   Interior of one row for images that cannot use a histogram: the window is
+*   kept sorted, and each step removes the leaving X face and merges in the
+*   entering one.
+*/
+template <class T>
+static void sortedWindowRow( const MedianContext<T>& c, int y, int z, std::vector<T>& windowValues,
+                             std::vector<T>& leaving, std::vector<T>& entering, std::vector<T>& scratch )
+{
+    int lo[3] = { c.interior[0] - c.kernelMiddle[0], y - c.kernelMiddle[1], z - c.kernelMiddle[2] };
+    int hi[3] = { lo[0] + c.kernelSize[0] - 1, lo[1] + c.kernelSize[1] - 1, lo[2] + c.kernelSize[2] - 1 };
+
+    windowValues.clear();
+    for ( int hz = lo[2]; hz <= hi[2]; hz++ )
+        for ( int hy = lo[1]; hy <= hi[1]; hy++ )
+            for ( int hx = lo[0]; hx <= hi[0]; hx++ )
+                windowValues.push_back( *c.in( hx, hy, hz ) );
+
+    std::sort( windowValues.begin(), windowValues.end() );
+
+    std::size_t medianIndex = ( windowValues.size() - 1 ) / 2;
+
+    for ( int x = c.interior[0]; x <= c.interior[1]; x++ )
+    {
+        if ( x != c.interior[0] )
+        {
+            int leavingX  = x - 1 - c.kernelMiddle[0];
+            int enteringX = leavingX + c.kernelSize[0];
+
+            leaving.clear();
+            entering.clear();
+            for ( int hz = lo[2]; hz <= hi[2]; hz++ )
+            {
+                for ( int hy = lo[1]; hy <= hi[1]; hy++ )
+                {
+                    leaving.push_back( *c.in( leavingX, hy, hz ) );
+                    entering.push_back( *c.in( enteringX, hy, hz ) );
+                }
+            }
+            std::sort( leaving.begin(), leaving.end() );
+            std::sort( entering.begin(), entering.end() );
+
+            scratch.clear();
+            std::set_difference( windowValues.begin(), windowValues.end(), leaving.begin(), leaving.end(),
+                                 std::back_inserter( scratch ) );
+            windowValues.clear();
+            std::merge( scratch.begin(), scratch.end(), entering.begin(), entering.end(),
+                        std::back_inserter( windowValues ) );
+        }
+
+        *c.out( x, y, z ) = windowValues[medianIndex];
+    }
+}
+
+/*
+*   Processes a range of output Z slices.
+*/
+template <class T>
+class MedianFunctor
+{
+    public:
+        MedianFunctor( const MedianContext<T>& context ) : c( context )
+        {
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            int zStart = c.outExt[4] + static_cast<int>( begin );
+            int zEnd   = c.outExt[4] + static_cast<int>( end ) - 1;
+
+            const int* r   = c.interior;
+            bool hasInterior = ( c.numberOfElements % 2 == 1 ) && r[0] <= r[1] && r[2] <= r[3];
+
+            int interiorStart = std::max( zStart, r[4] );
+            int interiorEnd   = std::min( zEnd, r[5] );
+
+            // Fast path for the interior
+            if ( hasInterior && interiorStart <= interiorEnd )
+            {
+                if ( c.useHistogram )
+                {
+                    HistogramWalker<T> walker( c );
+                    walker.run( interiorStart, interiorEnd );
+                }
+                else
+                {
+                    std::vector<T> windowValues, leaving, entering, scratch;
+                    for ( int z = interiorStart; z <= interiorEnd; z++ )
+                    {
+                        for ( int y = r[2]; y <= r[3]; y++ )
+                        {
+                            sortedWindowRow( c, y, z, windowValues, leaving, entering, scratch );
+                        }
+                    }
+                }
+            }
+
+            // Exact path for everything the fast path did not cover
+            std::vector<double> buffer;
+            for ( int z = zStart; z <= zEnd; z++ )
+            {
+                for ( int y = c.outExt[2]; y <= c.outExt[3]; y++ )
+                {
+                    for ( int x = c.outExt[0]; x <= c.outExt[1]; x++ )
+                    {
+                        bool inside = hasInterior && x >= r[0] && x <= r[1] && y >= r[2] && y <= r[3]
+                                                  && z >= r[4] && z <= r[5];
+                        if ( !inside )
+                        {
+                            *c.out( x, y, z ) = clippedMedian( c, x, y, z, buffer );
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        const MedianContext<T>& c;
+};
+
+template <class T>
+static void myImageMedian3DExecute( myImageMedian3D* self, vtkImageData* inData, vtkDataArray* inArray,
+                                    vtkImageData* outData, const int outExt[6], const int kernelSize[3],
+                                    const int kernelMiddle[3], T* )
+{
+    MedianContext<T> c;
+
+    inData->GetExtent( c.inExt );
+    inData->GetIncrements( c.inInc );
+    c.inBase = static_cast<const T*>( inArray->GetVoidPointer( 0 ) );
+
+    outData->GetIncrements( c.outInc );
+    for ( int i = 0; i < 6; i++ )
+    {
+        c.outExt[i] = outExt[i];
+    }
+    c.outBase = static_cast<T*>( outData->GetScalarPointer( outExt[0], outExt[2], outExt[4] ) );
+
+    c.numberOfElements = self->GetNumberOfElements();
+    for ( int i = 0; i < 3; i++ )
+    {
+        c.kernelSize[i]   = kernelSize[i];
+        c.kernelMiddle[i] = kernelMiddle[i];
+
+        // Output voxels whose whole kernel lies inside the input
+        c.interior[2 * i]     = std::max( outExt[2 * i], c.inExt[2 * i] + kernelMiddle[i] );
+        c.interior[2 * i + 1] = std::min( outExt[2 * i + 1],
+                                          c.inExt[2 * i + 1] - ( kernelSize[i] - 1 - kernelMiddle[i] ) );
+    }
+
+    int numComponents = inArray->GetNumberOfComponents();
+
+    for ( int comp = 0; comp < numComponents; comp++ )
+    {
+        c.component    = comp;
+        c.useHistogram = false;
+
+        if ( std::numeric_limits<T>::is_integer )
+        {
+            double range[2];
+            inArray->GetRange( range, comp );
+
+            if ( range[1] - range[0] + 1 <= myImageMedian3D::MaximumHistogramBins )
+            {
+                c.useHistogram = true;
+                c.minValue     = static_cast<long long>( range[0] );
+                c.numBins      = static_cast<int>( range[1] - range[0] ) + 1;
+            }
+        }
+
+        MedianFunctor<T> functor( c );
+        vtkIdType slices = outExt[5] - outExt[4] + 1;
+        vtkSMPTools::For( 0, slices, grainForThreads( slices, self->GetNumberOfThreads() ), functor );
+    }
+}
+
+/****************** Class "myImageMedian3D" functions ******************/
+myImageMedian3D::myImageMedian3D()
+{
+    this->NumberOfElements = 0;
+    this->NumberOfThreads  = 0;
+    this->SetKernelSize( 1, 1, 1 );
+    this->HandleBoundaries = 1;
+}
+
+myImageMedian3D::~myImageMedian3D()
+{
+}
+
+void myImageMedian3D::SetKernelSize( int size0, int size1, int size2 )
+{
+    int size[3] = { size0, size1, size2 };
+    bool modified = false;
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( this->KernelSize[i] != size[i] )
+        {
+            modified = true;
+            this->KernelSize[i]   = size[i];
+            this->KernelMiddle[i] = size[i] / 2;
+        }
+    }
+
+    this->NumberOfElements = size0 * size1 * size2;
+
+    if ( modified )
+    {
+        this->Modified();
+    }
+}
+
+int myImageMedian3D::RequestData( vtkInformation* vtkNotUsed( request ), vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector )
+{
+    vtkInformation* inInfo  = inputVector[0]->GetInformationObject( 0 );
+    vtkInformation* outInfo = outputVector->GetInformationObject( 0 );
+
+    vtkImageData* input  = vtkImageData::SafeDownCast( inInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+    vtkImageData* output = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+
+    int outExt[6];
+    outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExt );
+
+    this->AllocateOutputData( output, outInfo, outExt );
+
+    vtkDataArray* inArray = input ? input->GetPointData()->GetScalars() : nullptr;
+    if ( !inArray || outExt[0] > outExt[1] || outExt[2] > outExt[3] || outExt[4] > outExt[5] )
+    {
+        return 1;
+    }
+
+    if ( inArray->GetDataType() != output->GetScalarType() )
+    {
+        vtkErrorMacro( "Input scalar type " << inArray->GetDataType() << " must match output scalar type "
+                       << output->GetScalarType() );
+        return 0;
+    }
+
+    switch ( inArray->GetDataType() )
+    {
+        vtkTemplateMacro( myImageMedian3DExecute( this, input, inArray, output, outExt, this->KernelSize,
+                                                  this->KernelMiddle, static_cast<VTK_TT*>( nullptr ) ) );
+
+        default:
+        {
+            vtkErrorMacro( "Unknown input scalar type" );
+            return 0;
+        }
+    }
+
+    return 1;
+}
+/***************************************************************************/
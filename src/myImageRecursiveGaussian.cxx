@@ -0,0 +1,386 @@
+/****************************************************************************
+*   myImageRecursiveGaussian.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a recursive (Young - van Vliet)
+*                   Gaussian smoothing filter with a constant cost per voxel.
+****************************************************************************/
+
+#include "myImageRecursiveGaussian.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkSMPTools.h>
+
+vtkStandardNewMacro( myImageRecursiveGaussian );
+
+/*
+*   Grain of vtkSMPTools::For that splits a range into at most the given number
+*   of tasks (0 lets vtkSMPTools choose).
+*
+*   @param   count     Number of items in the range
+*   @param   threads   Largest number of tasks, or 0 for no bound
+*   @returns the grain
+*/
+static vtkIdType grainForThreads( vtkIdType count, int threads )
+{
+    return threads > 0 ? std::max<vtkIdType>( 1, ( count + threads - 1 ) / threads ) : 0;
+}
+
+/*
+*   Causal and anti-causal recursion over n samples with a stride, in place.
+*   The borders are extended with their first/last value.
+*
+*   Both this and recursiveRows() multiply in double with double coefficients
+*   and feed back the float values they store, so the three axes round the
+*   same way. Float coefficients would move the gain B + a1 + a2 + a3 away
+*   from 1 for large standard deviations, where the poles are close to 1.
+*/
+static void recursiveLine( float* line, int n, vtkIdType stride, const double c[4] )
+{
+    if ( n < 2 )
+    {
+        return;
+    }
+
+    float w1 = line[0], w2 = line[0], w3 = line[0];
+    for ( int i = 0; i < n; i++ )
+    {
+        float w = static_cast<float>( c[0] * line[i * stride] + c[1] * w1 + c[2] * w2 + c[3] * w3 );
+        line[i * stride] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    float y1 = line[( n - 1 ) * stride], y2 = y1, y3 = y1;
+    for ( int i = n - 1; i >= 0; i-- )
+    {
+        float y = static_cast<float>( c[0] * line[i * stride] + c[1] * y1 + c[2] * y2 + c[3] * y3 );
+        line[i * stride] = y;
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+    }
+}
+
+/*
+*   The same recursion run on whole rows at once: rows[k] points to the k-th
+*   row along the filtered axis, each with rowLength contiguous values.
+*   The inner loop is over contiguous memory and vectorizes (in double, with
+*   the same rounding as recursiveLine()).
+*/
+static void recursiveRows( float* base, int n, vtkIdType rowStride, vtkIdType rowLength, const double c[4] )
+{
+    if ( n < 2 )
+    {
+        return;
+    }
+
+    const double B  = c[0];
+    const double a1 = c[1];
+    const double a2 = c[2];
+    const double a3 = c[3];
+
+    // Causal pass. Row 0 is its own steady state (B + a1 + a2 + a3 = 1).
+    for ( int k = 1; k < n; k++ )
+    {
+        float* r        = base + k * rowStride;
+        const float* r1 = base + ( k - 1 ) * rowStride;
+        const float* r2 = base + std::max( k - 2, 0 ) * rowStride;
+        const float* r3 = base + std::max( k - 3, 0 ) * rowStride;
+
+        for ( vtkIdType i = 0; i < rowLength; i++ )
+        {
+            r[i] = static_cast<float>( B * r[i] + a1 * r1[i] + a2 * r2[i] + a3 * r3[i] );
+        }
+    }
+
+    // Anti-causal pass
+    for ( int k = n - 2; k >= 0; k-- )
+    {
+        float* r        = base + k * rowStride;
+        const float* r1 = base + ( k + 1 ) * rowStride;
+        const float* r2 = base + std::min( k + 2, n - 1 ) * rowStride;
+        const float* r3 = base + std::min( k + 3, n - 1 ) * rowStride;
+
+        for ( vtkIdType i = 0; i < rowLength; i++ )
+        {
+            r[i] = static_cast<float>( B * r[i] + a1 * r1[i] + a2 * r2[i] + a3 * r3[i] );
+        }
+    }
+}
+
+/*
+*   X pass: convert each input row to float and filter it.
+*/
+template <class T>
+class RecursiveGaussianXFunctor
+{
+    public:
+        RecursiveGaussianXFunctor( const T* in, float* out, const int dims[3], int numComponents,
+                                   bool filter, const double coefficients[4] )
+            : In( in ), Out( out ), NumComponents( numComponents ), Filter( filter )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                Dims[i] = dims[i];
+            }
+            for ( int i = 0; i < 4; i++ )
+            {
+                Coefficients[i] = coefficients[i];
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            vtkIdType rowLength = vtkIdType( Dims[0] ) * NumComponents;
+
+            for ( vtkIdType row = begin; row < end; row++ )
+            {
+                const T* in = In + row * rowLength;
+                float* out  = Out + row * rowLength;
+
+                for ( vtkIdType i = 0; i < rowLength; i++ )
+                {
+                    out[i] = static_cast<float>( in[i] );
+                }
+
+                if ( Filter )
+                {
+                    for ( int comp = 0; comp < NumComponents; comp++ )
+                    {
+                        recursiveLine( out + comp, Dims[0], NumComponents, Coefficients );
+                    }
+                }
+            }
+        }
+
+    private:
+        const T* In;
+        float* Out;
+        int Dims[3];
+        int NumComponents;
+        bool Filter;
+        double Coefficients[4];
+};
+
+/*
+*   Y pass (one task per Z slice) and Z pass (one task per Y row).
+*/
+class RecursiveGaussianRowsFunctor
+{
+    public:
+        RecursiveGaussianRowsFunctor( float* data, int n, vtkIdType taskStride, vtkIdType rowStride,
+                                      vtkIdType rowLength, const double coefficients[4] )
+            : Data( data ), N( n ), TaskStride( taskStride ), RowStride( rowStride ), RowLength( rowLength )
+        {
+            for ( int i = 0; i < 4; i++ )
+            {
+                Coefficients[i] = coefficients[i];
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            for ( vtkIdType task = begin; task < end; task++ )
+            {
+                recursiveRows( Data + task * TaskStride, N, RowStride, RowLength, Coefficients );
+            }
+        }
+
+    private:
+        float* Data;
+        int N;
+        vtkIdType TaskStride;
+        vtkIdType RowStride;
+        vtkIdType RowLength;
+        double Coefficients[4];
+};
+
+template <class T>
+static void myImageRecursiveGaussianExecute( const T* in, float* out, const int dims[3], int numComponents,
+                                             const double sigma[3], int threads )
+{
+    double coefficients[3][4];
+    bool filter[3];
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        filter[axis] = sigma[axis] >= 0.5 && dims[axis] > 1;
+        myImageRecursiveGaussian::ComputeCoefficients( std::max( sigma[axis], 0.5 ), coefficients[axis] );
+    }
+
+    vtkIdType rowLength   = vtkIdType( dims[0] ) * numComponents;
+    vtkIdType sliceLength = rowLength * dims[1];
+
+    RecursiveGaussianXFunctor<T> xPass( in, out, dims, numComponents, filter[0], coefficients[0] );
+    vtkIdType rows = vtkIdType( dims[1] ) * dims[2];
+    vtkSMPTools::For( 0, rows, grainForThreads( rows, threads ), xPass );
+
+    if ( filter[1] )
+    {
+        RecursiveGaussianRowsFunctor yPass( out, dims[1], sliceLength, rowLength, rowLength, coefficients[1] );
+        vtkSMPTools::For( 0, dims[2], grainForThreads( dims[2], threads ), yPass );
+    }
+
+    if ( filter[2] )
+    {
+        RecursiveGaussianRowsFunctor zPass( out, dims[2], rowLength, sliceLength, rowLength, coefficients[2] );
+        vtkSMPTools::For( 0, dims[1], grainForThreads( dims[1], threads ), zPass );
+    }
+}
+
+/************** Class "myImageRecursiveGaussian" functions *************/
+myImageRecursiveGaussian::myImageRecursiveGaussian()
+{
+    this->StandardDeviations[0] = 1.0;
+    this->StandardDeviations[1] = 1.0;
+    this->StandardDeviations[2] = 1.0;
+    this->NumberOfThreads       = 0;
+}
+
+myImageRecursiveGaussian::~myImageRecursiveGaussian()
+{
+}
+
+void myImageRecursiveGaussian::ComputeCoefficients( double sigma, double coefficients[4] )
+{
+    // Young and van Vliet, Signal Processing 44 (1995), eq. 11b and 8c
+    double q;
+    if ( sigma >= 2.5 )
+    {
+        q = 0.98711 * sigma - 0.96330;
+    }
+    else
+    {
+        q = 3.97156 - 4.14554 * sqrt( 1.0 - 0.26891 * sigma );
+    }
+
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -( 1.4281 * q2 + 1.26661 * q3 );
+    double b3 = 0.422205 * q3;
+
+    coefficients[0] = 1.0 - ( b1 + b2 + b3 ) / b0;
+    coefficients[1] = b1 / b0;
+    coefficients[2] = b2 / b0;
+    coefficients[3] = b3 / b0;
+}
+
+void myImageRecursiveGaussian::ComputeKernelError( double sigma, double& maxError, double& l1Error )
+{
+    sigma = std::max( sigma, 0.5 );
+
+    int radius = static_cast<int>( ceil( 8.0 * sigma ) );
+    int n      = 2 * radius + 1;
+
+    std::vector<float> response( n, 0.0f );
+    response[radius] = 1.0f;
+
+    double coefficients[4];
+    ComputeCoefficients( sigma, coefficients );
+    recursiveLine( &response[0], n, 1, coefficients );
+
+    std::vector<double> kernel( n );
+    double sum = 0.0;
+    for ( int i = 0; i < n; i++ )
+    {
+        double x  = i - radius;
+        kernel[i] = exp( -x * x / ( 2.0 * sigma * sigma ) );
+        sum      += kernel[i];
+    }
+
+    maxError = 0.0;
+    l1Error  = 0.0;
+    for ( int i = 0; i < n; i++ )
+    {
+        double difference = fabs( response[i] - kernel[i] / sum );
+        maxError = std::max( maxError, difference );
+        l1Error += difference;
+    }
+
+    maxError /= kernel[radius] / sum;
+}
+
+int myImageRecursiveGaussian::RequestInformation( vtkInformation* vtkNotUsed( request ),
+                                                  vtkInformationVector** vtkNotUsed( inputVector ),
+                                                  vtkInformationVector* outputVector )
+{
+    vtkInformation* outInfo = outputVector->GetInformationObject( 0 );
+    vtkDataObject::SetPointDataActiveScalarInfo( outInfo, VTK_FLOAT, -1 );
+    return 1;
+}
+
+int myImageRecursiveGaussian::RequestUpdateExtent( vtkInformation* vtkNotUsed( request ),
+                                                   vtkInformationVector** inputVector,
+                                                   vtkInformationVector* vtkNotUsed( outputVector ) )
+{
+    // The recursion runs over whole lines
+    vtkInformation* inInfo = inputVector[0]->GetInformationObject( 0 );
+
+    int wholeExtent[6];
+    inInfo->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent );
+    inInfo->Set( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), wholeExtent, 6 );
+
+    return 1;
+}
+
+int myImageRecursiveGaussian::RequestData( vtkInformation* vtkNotUsed( request ),
+                                           vtkInformationVector** inputVector,
+                                           vtkInformationVector* outputVector )
+{
+    vtkInformation* inInfo  = inputVector[0]->GetInformationObject( 0 );
+    vtkInformation* outInfo = outputVector->GetInformationObject( 0 );
+
+    vtkImageData* input  = vtkImageData::SafeDownCast( inInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+    vtkImageData* output = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+
+    vtkDataArray* inArray = input ? input->GetPointData()->GetScalars() : nullptr;
+    if ( !inArray )
+    {
+        vtkErrorMacro( "No input scalars" );
+        return 0;
+    }
+
+    // The whole input is filtered, so the output covers the whole input extent
+    int inExt[6];
+    input->GetExtent( inExt );
+
+    output->SetExtent( inExt );
+    output->AllocateScalars( VTK_FLOAT, inArray->GetNumberOfComponents() );
+
+    int dims[3];
+    input->GetDimensions( dims );
+
+    float* outPtr = static_cast<float*>( output->GetScalarPointer() );
+
+    switch ( inArray->GetDataType() )
+    {
+        vtkTemplateMacro( myImageRecursiveGaussianExecute( static_cast<const VTK_TT*>( inArray->GetVoidPointer( 0 ) ),
+                                                           outPtr, dims, inArray->GetNumberOfComponents(),
+                                                           this->StandardDeviations, this->NumberOfThreads ) );
+
+        default:
+        {
+            vtkErrorMacro( "Unknown input scalar type" );
+            return 0;
+        }
+    }
+
+    return 1;
+}
+/***************************************************************************/
@@ -0,0 +1,99 @@
+/****************************************************************************
+*   myImageRecursiveGaussian.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a recursive (Young - van Vliet) Gaussian
+*                   smoothing filter with a constant cost per voxel.
+****************************************************************************/
+
+#ifndef MYIMAGERECURSIVEGAUSSIAN_H
+#define MYIMAGERECURSIVEGAUSSIAN_H
+
+#include <vtkImageAlgorithm.h>
+
+/*
+*   Gaussian smoothing with the third-order recursive filter of Young and
+*   van Vliet (1995). Each axis is filtered with one causal and one anti-causal
+*   pass, so the cost per voxel does not depend on the standard deviation.
+*
+*   The X pass runs along contiguous rows. The Y and Z passes run the recursion
+*   on whole rows at a time (one Z slice, or one Y row across all slices, per
+*   task), so memory is always read contiguously. All passes are threaded with
+*   vtkSMPTools, in at most NumberOfThreads tasks each when it is set. The
+*   output is float.
+*
+*   The recursion needs whole lines, so the filter always requests the whole
+*   input extent. It cannot be streamed in slabs (--stream rejects it), as
+*   every slab would read and filter the whole volume again.
+*/
+class myImageRecursiveGaussian : public vtkImageAlgorithm
+{
+public:
+   static myImageRecursiveGaussian* New();
+
+   vtkTypeMacro( myImageRecursiveGaussian, vtkImageAlgorithm );
+
+   /*
+   *   Set the standard deviation along each axis, in voxels. Axes with a
+   *   standard deviation below 0.5 are not filtered.
+   */
+   vtkSetVector3Macro( StandardDeviations, double );
+   vtkGetVector3Macro( StandardDeviations, double );
+
+   /*
+   *   Set the same standard deviation along all three axes.
+   *
+   *   @param   std   Standard deviation in voxels
+   */
+   void SetStandardDeviation( double std )
+   {
+      this->SetStandardDeviations( std, std, std );
+   }
+
+   /*
+   *   Bound the number of vtkSMPTools tasks of one update, so filters that run
+   *   side by side can share the cores like threaded VTK filters do. 0 (the
+   *   default) leaves the split to vtkSMPTools.
+   */
+   vtkSetClampMacro( NumberOfThreads, int, 0, VTK_INT_MAX );
+   vtkGetMacro( NumberOfThreads, int );
+
+   /*
+   *   Compute the recursion coefficients for a standard deviation.
+   *
+   *   @param   sigma          Standard deviation in voxels (>= 0.5)
+   *   @param   coefficients   B, b1/b0, b2/b0, b3/b0
+   */
+   static void ComputeCoefficients( double sigma, double coefficients[4] );
+
+   /*
+   *   Compare the 1D impulse response of the recursive filter with the sampled,
+   *   normalized Gaussian kernel.
+   *
+   *   @param   sigma      Standard deviation in voxels
+   *   @param   maxError   Largest absolute difference, relative to the kernel peak
+   *   @param   l1Error    Sum of the absolute differences (the kernel sums to 1)
+   */
+   static void ComputeKernelError( double sigma, double& maxError, double& l1Error );
+
+protected:
+   myImageRecursiveGaussian();
+   ~myImageRecursiveGaussian() override;
+
+   int RequestInformation( vtkInformation* request, vtkInformationVector** inputVector,
+                           vtkInformationVector* outputVector ) override;
+   int RequestUpdateExtent( vtkInformation* request, vtkInformationVector** inputVector,
+                            vtkInformationVector* outputVector ) override;
+   int RequestData( vtkInformation* request, vtkInformationVector** inputVector,
+                    vtkInformationVector* outputVector ) override;
+
+   double StandardDeviations[3];
+   int NumberOfThreads;
+
+private:
+   myImageRecursiveGaussian( const myImageRecursiveGaussian& ) = delete;
+   void operator=( const myImageRecursiveGaussian& ) = delete;
+};
+
+#endif  // MYIMAGERECURSIVEGAUSSIAN_H
@@ -0,0 +1,106 @@
+/****************************************************************************
+*   myMaskSliceSource.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of an image source that expands the
+*                   displayed slice of the segmentation mask into RGBA.
+****************************************************************************/
+
+#include "myMaskSliceSource.hxx"
+#include "thresholdOverlay.hxx"
+
+#include <algorithm>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+vtkStandardNewMacro( myMaskSliceSource );
+
+myMaskSliceSource::myMaskSliceSource()
+    : Overlay( nullptr )
+{
+    this->SetNumberOfInputPorts( 0 );
+
+    unsigned char inside[4]  = { 255, 0, 0, 255 };
+    unsigned char outside[4] = { 0, 0, 0, 0 };
+    std::copy( inside, inside + 4, this->InsideColor );
+    std::copy( outside, outside + 4, this->OutsideColor );
+}
+
+myMaskSliceSource::~myMaskSliceSource()
+{
+}
+
+void myMaskSliceSource::SetOverlay( ThresholdOverlay* overlay )
+{
+    this->Overlay = overlay;
+    this->Modified();
+}
+
+vtkMTimeType myMaskSliceSource::GetMTime()
+{
+    vtkMTimeType time = this->Superclass::GetMTime();
+
+    if ( this->Overlay )
+    {
+        time = std::max( time, this->Overlay->getMaskMTime() );
+    }
+
+    return time;
+}
+
+int myMaskSliceSource::RequestInformation( vtkInformation* vtkNotUsed( request ),
+                                           vtkInformationVector** vtkNotUsed( inputVector ),
+                                           vtkInformationVector* outputVector )
+{
+    if ( !this->Overlay || !this->Overlay->hasMask() )
+    {
+        vtkErrorMacro( "No overlay mask" );
+        return 0;
+    }
+
+    const BitMask& mask     = this->Overlay->getMask();
+    vtkInformation* outInfo = outputVector->GetInformationObject( 0 );
+
+    outInfo->Set( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), mask.getExtent(), 6 );
+    outInfo->Set( vtkDataObject::SPACING(), mask.getSpacing(), 3 );
+    outInfo->Set( vtkDataObject::ORIGIN(), mask.getOrigin(), 3 );
+    vtkDataObject::SetPointDataActiveScalarInfo( outInfo, VTK_UNSIGNED_CHAR, 4 );
+
+    return 1;
+}
+
+int myMaskSliceSource::RequestData( vtkInformation* vtkNotUsed( request ),
+                                    vtkInformationVector** vtkNotUsed( inputVector ),
+                                    vtkInformationVector* outputVector )
+{
+    vtkInformation* outInfo = outputVector->GetInformationObject( 0 );
+    vtkImageData* output    = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+
+    // Only the requested slices (the displayed one for vtkImageMapper)
+    int updateExtent[6];
+    outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent );
+
+    output->SetExtent( updateExtent );
+    output->AllocateScalars( VTK_UNSIGNED_CHAR, 4 );
+
+    if ( updateExtent[1] < updateExtent[0] || updateExtent[3] < updateExtent[2] || updateExtent[5] < updateExtent[4] )
+    {
+        return 1;
+    }
+
+    int rect[4] = { updateExtent[0], updateExtent[1], updateExtent[2], updateExtent[3] };
+    vtkIdType slicePixels = vtkIdType( rect[1] - rect[0] + 1 ) * ( rect[3] - rect[2] + 1 );
+
+    unsigned char* rgba = static_cast<unsigned char*>( output->GetScalarPointer() );
+    for ( int z = updateExtent[4]; z <= updateExtent[5]; z++, rgba += 4 * slicePixels )
+    {
+        this->Overlay->expandSlice( z, rect, rgba, this->InsideColor, this->OutsideColor );
+    }
+
+    return 1;
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+*   myMaskSliceSource.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of an image source that expands the displayed
+*                   slice of the segmentation mask into RGBA.
+****************************************************************************/
+
+#ifndef MYMASKSLICESOURCE_H
+#define MYMASKSLICESOURCE_H
+
+#include <vtkImageAlgorithm.h>
+
+class ThresholdOverlay;
+
+/*
+*   The RGBA (unsigned char, 4 components) image of the bit-packed mask of a
+*   ThresholdOverlay, for the vtkImageMapper of the overlay.
+*
+*   The output has the whole extent of the mask, but only the requested
+*   update extent is produced: vtkImageMapper requests the displayed Z slice,
+*   so a frame expands one slice instead of mapping the whole volume to colours.
+*   The source is re-executed when the overlay changes its mask.
+*/
+class myMaskSliceSource : public vtkImageAlgorithm
+{
+public:
+   static myMaskSliceSource* New();
+
+   vtkTypeMacro( myMaskSliceSource, vtkImageAlgorithm );
+
+   /*
+   *   @param   overlay   The overlay whose mask is shown (must outlive the source)
+   */
+   void SetOverlay( ThresholdOverlay* overlay );
+
+   /*
+   *   Colours of the voxels inside and outside the thresholds
+   *   (default opaque red and transparent black).
+   */
+   vtkSetVector4Macro( InsideColor, unsigned char );
+   vtkSetVector4Macro( OutsideColor, unsigned char );
+
+   /*
+   *   @returns the modification time, including the changes of the mask
+   */
+   vtkMTimeType GetMTime() override;
+
+protected:
+   myMaskSliceSource();
+   ~myMaskSliceSource() override;
+
+   int RequestInformation( vtkInformation* request, vtkInformationVector** inputVector,
+                           vtkInformationVector* outputVector ) override;
+   int RequestData( vtkInformation* request, vtkInformationVector** inputVector,
+                    vtkInformationVector* outputVector ) override;
+
+   ThresholdOverlay* Overlay;
+   unsigned char InsideColor[4];
+   unsigned char OutsideColor[4];
+
+private:
+   myMaskSliceSource( const myMaskSliceSource& ) = delete;
+   void operator=( const myMaskSliceSource& ) = delete;
+};
+
+#endif  // MYMASKSLICESOURCE_H
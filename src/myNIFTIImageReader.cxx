@@ -0,0 +1,342 @@
+/****************************************************************************
+*   myNIFTIImageReader.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a zero-copy NIfTI reader that
+*                   memory-maps uncompressed .nii files.
+****************************************************************************/
+
+#include "myNIFTIImageReader.hxx"
+#include "mappedFile.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkErrorCode.h>
+#include <vtkNIFTIImageReader.h>
+#include <vtk_zlib.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+vtkStandardNewMacro( myNIFTIImageReader );
+
+/*
+*   @returns the VTK scalar type of a NIfTI datatype code, -1 if this reader does not handle it
+*/
+static int niftiScalarType( int datatype )
+{
+    switch ( datatype )
+    {
+        case 2:     return VTK_UNSIGNED_CHAR;
+        case 4:     return VTK_SHORT;
+        case 8:     return VTK_INT;
+        case 16:    return VTK_FLOAT;
+        case 64:    return VTK_DOUBLE;
+        case 256:   return VTK_SIGNED_CHAR;
+        case 512:   return VTK_UNSIGNED_SHORT;
+        case 768:   return VTK_UNSIGNED_INT;
+        case 1024:  return VTK_TYPE_INT64;
+        case 1280:  return VTK_TYPE_UINT64;
+        default:    return -1;
+    }
+}
+
+template <class T>
+static T headerValue( const unsigned char* header, int offset )
+{
+    T value;
+    std::memcpy( &value, header + offset, sizeof( T ) );
+    return value;
+}
+
+myNIFTIImageReader::myNIFTIImageReader()
+    : Mode( FALLBACK ), RescaleSlope( 1.0 ), RescaleIntercept( 0.0 ), VoxelOffset( 0 ), DataSize( 0 ),
+      StreamFile( nullptr ), StreamSlice( 0 )
+{
+}
+
+myNIFTIImageReader::~myNIFTIImageReader()
+{
+    this->CloseStream();
+}
+
+void myNIFTIImageReader::CloseStream()
+{
+    if ( this->StreamFile )
+    {
+        gzclose( static_cast<gzFile>( this->StreamFile ) );
+        this->StreamFile = nullptr;
+    }
+    this->StreamSlice = 0;
+}
+
+const char* myNIFTIImageReader::GetReadMethod() const
+{
+    switch ( this->Mode )
+    {
+        case MAPPED:        return "memory-mapped";
+        case DECOMPRESSED:  return "decompressed";
+        default:            return "vtkNIFTIImageReader";
+    }
+}
+
+bool myNIFTIImageReader::ReadHeader()
+{
+    // zlib reads uncompressed files as they are, so one path reads both headers
+    unsigned char header[348];
+
+    gzFile file = gzopen( this->FileName, "rb" );
+    if ( !file )
+    {
+        return false;
+    }
+
+    int bytesRead = gzread( file, header, sizeof( header ) );
+    int direct    = gzdirect( file );
+    gzclose( file );
+
+    // A header size of 348 in native byte order rules out NIfTI-2 and byte-swapped files
+    if ( bytesRead != static_cast<int>( sizeof( header ) ) || headerValue<int>( header, 0 ) != 348 ||
+         std::memcmp( header + 344, "n+1", 4 ) != 0 )
+    {
+        return false;
+    }
+
+    short dim[8];
+    float pixdim[8];
+    for ( int i = 0; i < 8; i++ )
+    {
+        dim[i]    = headerValue<short>( header, 40 + 2 * i );
+        pixdim[i] = headerValue<float>( header, 76 + 4 * i );
+    }
+
+    int scalarType = niftiScalarType( headerValue<short>( header, 70 ) );
+    float voxelOffset = headerValue<float>( header, 108 );
+    float slope       = headerValue<float>( header, 112 );
+    float intercept   = headerValue<float>( header, 116 );
+
+    // vtkNIFTIImageReader flips the slices when qfac is negative, and turns dimensions 4+ into components
+    if ( scalarType < 0 || pixdim[0] < 0.0f || dim[0] < 1 || dim[0] > 7 )
+    {
+        return false;
+    }
+
+    for ( int i = 4; i <= dim[0]; i++ )
+    {
+        if ( dim[i] != 1 )
+        {
+            return false;
+        }
+    }
+
+    vtkIdType voxels = 1;
+    for ( int i = 0; i < 3; i++ )
+    {
+        int size = ( i < dim[0] ) ? dim[i + 1] : 1;
+        if ( size < 1 )
+        {
+            return false;
+        }
+
+        this->DataExtent[2 * i]     = 0;
+        this->DataExtent[2 * i + 1] = size - 1;
+        this->DataSpacing[i]        = ( i < dim[0] && pixdim[i + 1] != 0.0f ) ? pixdim[i + 1] : 1.0;
+        this->DataOrigin[i]         = 0.0;
+
+        voxels *= size;
+    }
+
+    this->SetDataScalarType( scalarType );
+    this->SetNumberOfScalarComponents( 1 );
+
+    int scalarSize         = vtkDataArray::GetDataTypeSize( scalarType );
+    this->VoxelOffset      = static_cast<vtkIdType>( voxelOffset );
+    this->DataSize         = voxels * scalarSize;
+    this->RescaleSlope     = ( slope != 0.0f ) ? slope : 1.0;
+    this->RescaleIntercept = ( slope != 0.0f ) ? intercept : 0.0;
+    this->Mode             = DECOMPRESSED;
+
+#ifndef _WIN32
+    // Uncompressed files are mapped when the voxels are aligned and the file holds all of them
+    struct stat status;
+    if ( direct && this->VoxelOffset % scalarSize == 0 && stat( this->FileName, &status ) == 0 &&
+         status.st_size >= this->VoxelOffset + this->DataSize )
+    {
+        this->Mode = MAPPED;
+    }
+#else
+    (void)direct;
+#endif
+
+    return true;
+}
+
+void myNIFTIImageReader::ExecuteInformation()
+{
+    if ( !this->FileName )
+    {
+        vtkErrorMacro( "A file name must be set" );
+        this->SetErrorCode( vtkErrorCode::NoFileNameError );
+        return;
+    }
+
+    // The file or its contents may have changed
+    this->CloseStream();
+
+    if ( !this->ReadHeader() )
+    {
+        // Everything else is left to vtkNIFTIImageReader
+        this->Mode = FALLBACK;
+
+        if ( !this->FallbackReader )
+        {
+            this->FallbackReader = vtkSmartPointer<vtkNIFTIImageReader>::New();
+        }
+        this->FallbackReader->SetFileName( this->FileName );
+        this->FallbackReader->UpdateInformation();
+
+        vtkInformation* info = this->FallbackReader->GetOutputInformation( 0 );
+        info->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), this->DataExtent );
+        info->Get( vtkDataObject::SPACING(), this->DataSpacing );
+        info->Get( vtkDataObject::ORIGIN(), this->DataOrigin );
+
+        vtkInformation* scalarInfo = vtkDataObject::GetActiveFieldInformation(
+            info, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS );
+        if ( scalarInfo )
+        {
+            this->SetDataScalarType( scalarInfo->Get( vtkDataObject::FIELD_ARRAY_TYPE() ) );
+            this->SetNumberOfScalarComponents( scalarInfo->Get( vtkDataObject::FIELD_NUMBER_OF_COMPONENTS() ) );
+        }
+        this->RescaleSlope     = this->FallbackReader->GetRescaleSlope();
+        this->RescaleIntercept = this->FallbackReader->GetRescaleIntercept();
+    }
+
+    this->vtkImageReader2::ExecuteInformation();
+}
+
+void myNIFTIImageReader::ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo )
+{
+    vtkImageData* data = vtkImageData::SafeDownCast( output );
+
+    if ( this->Mode == FALLBACK )
+    {
+        this->FallbackReader->Update();
+        data->ShallowCopy( this->FallbackReader->GetOutput() );
+        return;
+    }
+
+    if ( this->Mode == MAPPED )
+    {
+        // The whole volume is always produced. Mapped pages are only read when they are used.
+        data->SetExtent( this->DataExtent );
+
+        // Private mapping: the file is never written, even if a filter writes to its input
+        std::shared_ptr<MappedFile> file = MappedFile::open( this->FileName );
+        vtkSmartPointer<vtkDataArray> scalars = MappedFile::createArray(
+            file, static_cast<std::size_t>( this->VoxelOffset ), this->DataScalarType, 1,
+            this->DataSize / vtkDataArray::GetDataTypeSize( this->DataScalarType ) );
+
+        if ( scalars )
+        {
+            data->GetPointData()->SetScalars( scalars );
+            return;
+        }
+
+        vtkWarningMacro( "Cannot map " << this->FileName << ", reading it instead" );
+    }
+
+    // Decompress (or read) the slices of the update extent straight into the output array
+    int updateExtent[6];
+    outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent );
+
+    int extent[6];
+    std::copy( this->DataExtent, this->DataExtent + 6, extent );
+    extent[4] = std::max( this->DataExtent[4], updateExtent[4] );
+    extent[5] = std::min( this->DataExtent[5], updateExtent[5] );
+    if ( extent[5] < extent[4] )
+    {
+        extent[5] = extent[4];
+    }
+
+    data->SetExtent( extent );
+    data->AllocateScalars( this->DataScalarType, 1 );
+
+    vtkIdType sliceBytes = vtkIdType( this->DataExtent[1] - this->DataExtent[0] + 1 ) *
+                           vtkIdType( this->DataExtent[3] - this->DataExtent[2] + 1 ) *
+                           vtkDataArray::GetDataTypeSize( this->DataScalarType );
+
+    // A gz file can only be read forwards, so the file stays open while the slabs are
+    // requested in order (e.g. --convert-bricks, --stream) and is reopened to go back
+    if ( this->StreamFile && extent[4] < this->StreamSlice )
+    {
+        this->CloseStream();
+    }
+
+    if ( !this->StreamFile )
+    {
+        gzFile file = gzopen( this->FileName, "rb" );
+        if ( !file || gzseek( file, static_cast<z_off_t>( this->VoxelOffset ), SEEK_SET ) < 0 )
+        {
+            vtkErrorMacro( "Cannot read the voxels of " << this->FileName );
+            this->SetErrorCode( vtkErrorCode::CannotOpenFileError );
+            if ( file )
+            {
+                gzclose( file );
+            }
+            return;
+        }
+
+        this->StreamFile  = file;
+        this->StreamSlice = this->DataExtent[4];
+    }
+
+    gzFile file = static_cast<gzFile>( this->StreamFile );
+
+    if ( extent[4] > this->StreamSlice &&
+         gzseek( file, static_cast<z_off_t>( ( extent[4] - this->StreamSlice ) * sliceBytes ), SEEK_CUR ) < 0 )
+    {
+        vtkErrorMacro( "The file " << this->FileName << " is shorter than its header says" );
+        this->SetErrorCode( vtkErrorCode::PrematureEndOfFileError );
+        this->CloseStream();
+        return;
+    }
+
+    char* target        = static_cast<char*>( data->GetScalarPointer() );
+    vtkIdType remaining = ( extent[5] - extent[4] + 1 ) * sliceBytes;
+
+    while ( remaining > 0 )
+    {
+        unsigned int chunk = static_cast<unsigned int>( std::min<vtkIdType>( remaining, 1 << 30 ) );
+        int bytesRead = gzread( file, target, chunk );
+
+        if ( bytesRead <= 0 )
+        {
+            vtkErrorMacro( "The file " << this->FileName << " is shorter than its header says" );
+            this->SetErrorCode( vtkErrorCode::PrematureEndOfFileError );
+            this->CloseStream();
+            return;
+        }
+
+        target    += bytesRead;
+        remaining -= bytesRead;
+    }
+
+    this->StreamSlice = extent[5] + 1;
+
+    // Nothing is left to read after the last slice
+    if ( this->StreamSlice > this->DataExtent[5] )
+    {
+        this->CloseStream();
+    }
+}
@@ -0,0 +1,114 @@
+/****************************************************************************
+*   myNIFTIImageReader.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a zero-copy NIfTI reader that memory-maps
+*                   uncompressed .nii files.
+****************************************************************************/
+
+#ifndef MYNIFTIIMAGEREADER_H
+#define MYNIFTIIMAGEREADER_H
+
+#include <vtkImageReader2.h>
+#include <vtkSmartPointer.h>
+
+class vtkNIFTIImageReader;
+
+/*
+*   Reads NIfTI-1 images without copying the voxels.
+*
+*   Uncompressed .nii files are memory-mapped and the voxel region is handed to
+*   VTK as the scalar array of the output, so no voxel is read before it is
+*   used. Startup time and resident memory follow the part of the volume the
+*   pipeline actually touches (e.g. one slab in streaming mode). The mapping is
+*   released when the scalar array is deleted.
+*
+*   Compressed .nii.gz files are decompressed with zlib straight into the
+*   output array, without a temporary copy of the file. Only the slices of the
+*   update extent are decompressed. The file stays open between requests, so
+*   slabs requested front to back (streaming, brick conversion) decompress the
+*   file once in total.
+*
+*   Like vtkNIFTIImageReader, the voxels are not rescaled: the header scaling is
+*   available through GetRescaleSlope() and GetRescaleIntercept() and is only
+*   applied by code that needs calibrated values.
+*
+*   Files this reader does not handle itself (NIfTI-2, byte-swapped files,
+*   more than 3 dimensions, vector or complex voxels, negative qfac, Windows)
+*   are read by an internal vtkNIFTIImageReader, with the same output. That
+*   reader always loads the whole volume.
+*/
+class myNIFTIImageReader : public vtkImageReader2
+{
+public:
+   static myNIFTIImageReader* New();
+
+   vtkTypeMacro( myNIFTIImageReader, vtkImageReader2 );
+
+   /*
+   *   @returns the header scaling of the voxel values (value * slope + intercept)
+   */
+   vtkGetMacro( RescaleSlope, double );
+   vtkGetMacro( RescaleIntercept, double );
+
+   /*
+   *   @returns whether the last read memory-mapped the file
+   */
+   bool IsMemoryMapped() const { return this->Mode == MAPPED; }
+
+   /*
+   *   @returns the name of the method used by the last read
+   *            ("memory-mapped", "decompressed" or "vtkNIFTIImageReader")
+   */
+   const char* GetReadMethod() const;
+
+   /*
+   *   @returns whether an update extent of a few slices reads only those slices
+   *            (or maps the file), false for the internal vtkNIFTIImageReader.
+   *            Valid after UpdateInformation().
+   */
+   bool CanReadSlabs() const { return this->Mode != FALLBACK; }
+
+protected:
+   myNIFTIImageReader();
+   ~myNIFTIImageReader() override;
+
+   void ExecuteInformation() override;
+   void ExecuteDataWithInformation( vtkDataObject* output, vtkInformation* outInfo ) override;
+
+   enum ReadMode
+   {
+      MAPPED,
+      DECOMPRESSED,
+      FALLBACK
+   };
+
+   /*
+   *   Read the header and choose the read mode.
+   *
+   *   @returns a boolean representing whether this reader can read the file itself
+   */
+   bool ReadHeader();
+
+   /*
+   *   Close the compressed file kept open between slab requests.
+   */
+   void CloseStream();
+
+   ReadMode Mode;
+   double RescaleSlope;
+   double RescaleIntercept;
+   vtkIdType VoxelOffset;
+   vtkIdType DataSize;
+   void* StreamFile;       // gzFile of the slab requests, positioned at the start of StreamSlice
+   int StreamSlice;
+
+   vtkSmartPointer<vtkNIFTIImageReader> FallbackReader;
+
+private:
+   myNIFTIImageReader( const myNIFTIImageReader& ) = delete;
+   void operator=( const myNIFTIImageReader& ) = delete;
+};
+
+#endif  // MYNIFTIIMAGEREADER_H
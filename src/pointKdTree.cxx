@@ -0,0 +1,164 @@
+/****************************************************************************
+*   pointKdTree.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of a static KD-tree for closest point
+*                   queries from many threads.
+****************************************************************************/
+
+#include "pointKdTree.hxx"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+// Ranges of at most this many points are searched point by point
+static const vtkIdType LeafSize = 8;
+
+// Ranges smaller than this are not split between threads
+static const vtkIdType ParallelSize = 65536;
+
+PointKdTree::PointKdTree()
+{
+}
+
+void PointKdTree::build( std::vector<float>& coordinates, int threads )
+{
+    points.clear();
+    points.swap( coordinates );
+
+    vtkIdType count = static_cast<vtkIdType>( points.size() / 3 );
+    ids.resize( count );
+    for ( vtkIdType i = 0; i < count; i++ )
+    {
+        ids[i] = i;
+    }
+    axes.assign( count, 0 );
+
+    if ( threads <= 0 )
+    {
+        threads = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+    }
+    buildRange( 0, count, threads );
+
+    // Store the points in tree order, so a search reads neighbouring memory
+    std::vector<float> ordered( points.size() );
+    for ( vtkIdType i = 0; i < count; i++ )
+    {
+        std::copy( &points[3 * ids[i]], &points[3 * ids[i]] + 3, &ordered[3 * i] );
+    }
+    points.swap( ordered );
+}
+
+void PointKdTree::buildRange( vtkIdType begin, vtkIdType end, int threads )
+{
+    if ( end - begin <= LeafSize )
+    {
+        return;
+    }
+
+    // Split along the axis of largest extent, so thin surfaces are cut across
+    float minimum[3], maximum[3];
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        minimum[axis] = maximum[axis] = points[3 * ids[begin] + axis];
+    }
+    for ( vtkIdType i = begin + 1; i < end; i++ )
+    {
+        const float* point = &points[3 * ids[i]];
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            minimum[axis] = std::min( minimum[axis], point[axis] );
+            maximum[axis] = std::max( maximum[axis], point[axis] );
+        }
+    }
+
+    int split = 0;
+    for ( int axis = 1; axis < 3; axis++ )
+    {
+        if ( maximum[axis] - minimum[axis] > maximum[split] - minimum[split] )
+        {
+            split = axis;
+        }
+    }
+
+    vtkIdType middle = begin + ( end - begin ) / 2;
+    const std::vector<float>& coordinates = points;
+    std::nth_element( ids.begin() + begin, ids.begin() + middle, ids.begin() + end,
+                      [&coordinates, split]( vtkIdType a, vtkIdType b )
+                      {
+                          return coordinates[3 * a + split] < coordinates[3 * b + split];
+                      } );
+    axes[middle] = static_cast<unsigned char>( split );
+
+    if ( threads > 1 && end - begin > ParallelSize )
+    {
+        std::thread left( &PointKdTree::buildRange, this, begin, middle, threads / 2 );
+        buildRange( middle + 1, end, threads - threads / 2 );
+        left.join();
+    }
+    else
+    {
+        buildRange( begin, middle, 1 );
+        buildRange( middle + 1, end, 1 );
+    }
+}
+
+vtkIdType PointKdTree::findClosest( const double position[3], double& distance2 ) const
+{
+    float query[3] = { static_cast<float>( position[0] ), static_cast<float>( position[1] ),
+                       static_cast<float>( position[2] ) };
+
+    vtkIdType best = -1;
+    float bestDistance2 = std::numeric_limits<float>::max();
+    search( 0, size(), query, best, bestDistance2 );
+
+    distance2 = bestDistance2;
+    return best < 0 ? -1 : ids[best];
+}
+
+void PointKdTree::search( vtkIdType begin, vtkIdType end, const float position[3], vtkIdType& best,
+                          float& bestDistance2 ) const
+{
+    if ( end - begin <= LeafSize )
+    {
+        for ( vtkIdType i = begin; i < end; i++ )
+        {
+            const float* point = &points[3 * i];
+            float dx = point[0] - position[0];
+            float dy = point[1] - position[1];
+            float dz = point[2] - position[2];
+            float distance2 = dx * dx + dy * dy + dz * dz;
+
+            if ( distance2 < bestDistance2 )
+            {
+                bestDistance2 = distance2;
+                best = i;
+            }
+        }
+        return;
+    }
+
+    vtkIdType middle = begin + ( end - begin ) / 2;
+    search( middle, middle + 1, position, best, bestDistance2 );
+
+    // The side of the position first, the other side only if the splitting plane is closer than the best point
+    float offset = position[axes[middle]] - points[3 * middle + axes[middle]];
+    if ( offset < 0.0f )
+    {
+        search( begin, middle, position, best, bestDistance2 );
+        if ( offset * offset < bestDistance2 )
+        {
+            search( middle + 1, end, position, best, bestDistance2 );
+        }
+    }
+    else
+    {
+        search( middle + 1, end, position, best, bestDistance2 );
+        if ( offset * offset < bestDistance2 )
+        {
+            search( begin, middle, position, best, bestDistance2 );
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/****************************************************************************
+*   pointKdTree.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of a static KD-tree for closest point queries
+*                   from many threads.
+****************************************************************************/
+
+#ifndef POINTKDTREE_H
+#define POINTKDTREE_H
+
+#include <vector>
+
+#include <vtkType.h>
+
+/*
+*   A balanced KD-tree over a fixed set of 3D points, for the closest point
+*   searches of the registration.
+*
+*   The points are reordered into the tree (the median of each node in the
+*   middle of its range, split along the axis of largest extent), so the tree
+*   needs no nodes or pointers: 12 bytes per point plus its id. The first
+*   levels are built on separate threads. Queries only read the tree, so any
+*   number of threads can search it at the same time (vtkKdTreePointLocator
+*   keeps search state in the locator).
+*/
+class PointKdTree
+{
+    public:
+        PointKdTree();
+
+        /*
+        *   Build the tree. Replaces the previous points.
+        *
+        *   @param   coordinates   X, Y and Z of every point (moved into the tree)
+        *   @param   threads       Threads of the build, 0 = all cores
+        */
+        void build( std::vector<float>& coordinates, int threads = 0 );
+
+        /*
+        *   Find the point closest to a position.
+        *
+        *   @param   position    The position
+        *   @param   distance2   Receives the squared distance to the point
+        *
+        *   @returns the index of the point in the coordinates of build(), -1 if the tree is empty
+        */
+        vtkIdType findClosest( const double position[3], double& distance2 ) const;
+
+        /*
+        *   @returns the number of points
+        */
+        vtkIdType size() const { return static_cast<vtkIdType>( ids.size() ); }
+
+    private:
+        void buildRange( vtkIdType begin, vtkIdType end, int threads );
+        void search( vtkIdType begin, vtkIdType end, const float position[3], vtkIdType& best, float& bestDistance2 ) const;
+
+        std::vector<float> points;          // X, Y and Z in tree order
+        std::vector<vtkIdType> ids;         // Index of each point in the coordinates of build()
+        std::vector<unsigned char> axes;    // Split axis of the node whose median is at this position
+};
+
+#endif // POINTKDTREE_H
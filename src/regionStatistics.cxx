@@ -0,0 +1,680 @@
+/****************************************************************************
+*   regionStatistics.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the SNR of user-specified signal and
+*                   noise regions, with robust noise estimators.
+****************************************************************************/
+
+#include "regionStatistics.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkTemplateAliasMacro.h>
+
+// Scale of the MAD to the standard deviation of a normal distribution (1 / Phi^-1( 3/4 ))
+static const double madScale = 1.4826;
+
+// Standard deviation of a Rayleigh distribution divided by its sigma: sqrt( 2 - pi/2 )
+static const double rayleighScale = 0.6551363775620335;
+
+// Bins of the noise histogram of NOISE_MAD: the largest exact value range, and the equal bins of all other images
+static const int noiseBins = 1 << 16;
+
+/*
+*   The histogram of the noise voxels seen by one thread, for the median of NOISE_MAD.
+*/
+struct NoiseSamples
+{
+    std::vector<vtkIdType> bins;
+};
+
+/*
+*   The bins of the noise histogram, like IntensityHistogram: integer images
+*   with a value range of at most noiseBins get one bin per value, all other
+*   images noiseBins equal bins between the minimum and maximum of the image.
+*   The memory does not grow with the number of noise voxels.
+*/
+struct NoiseBinning
+{
+    double minimum;
+    double binWidth;
+    int numberOfBins;
+    bool exact;
+};
+
+static bool insideRegion( const RegionStatistics::Region& region, int x, int y, int z )
+{
+    if ( x < region.extent[0] || x > region.extent[1] || y < region.extent[2] || y > region.extent[3] ||
+         z < region.extent[4] || z > region.extent[5] )
+    {
+        return false;
+    }
+
+    if ( region.mask.empty() )
+    {
+        return true;
+    }
+
+    const int* ext = region.maskExtent;
+    vtkIdType nx = ext[1] - ext[0] + 1;
+    vtkIdType ny = ext[3] - ext[2] + 1;
+
+    return region.mask[( x - ext[0] ) + nx * ( ( y - ext[2] ) + ny * ( z - ext[4] ) )] != 0;
+}
+
+/*
+*   The k-th smallest (from 0) of a set of values given as (value, count),
+*   sorted by value.
+*/
+static double kthOfCounts( const std::vector< std::pair<double, vtkIdType> >& counts, vtkIdType k )
+{
+    for ( std::size_t i = 0; i < counts.size(); i++ )
+    {
+        if ( k < counts[i].second )
+        {
+            return counts[i].first;
+        }
+        k -= counts[i].second;
+    }
+
+    return counts.empty() ? 0.0 : counts.back().first;
+}
+
+static double medianOfCounts( const std::vector< std::pair<double, vtkIdType> >& counts, vtkIdType n )
+{
+    return 0.5 * ( kthOfCounts( counts, ( n - 1 ) / 2 ) + kthOfCounts( counts, n / 2 ) );
+}
+
+/*
+*   Number of voxels below a value, with the voxels of each bin spread evenly
+*   over the bin.
+*
+*   @param   cumulative   Number of voxels below each bin edge (numberOfBins + 1)
+*   @param   binning      The bins
+*   @param   value        The value
+*/
+static double countBelow( const std::vector<double>& cumulative, const NoiseBinning& binning, double value )
+{
+    double position = ( value - binning.minimum ) / binning.binWidth;
+
+    if ( position <= 0.0 )
+    {
+        return 0.0;
+    }
+    if ( position >= binning.numberOfBins )
+    {
+        return cumulative.back();
+    }
+
+    int bin = static_cast<int>( position );
+    return cumulative[bin] + ( position - bin ) * ( cumulative[bin + 1] - cumulative[bin] );
+}
+
+/*
+*   Median absolute deviation of the noise voxels collected by all threads.
+*   Exact for one bin per value. With equal bins, the median and the MAD are
+*   refined inside their bins by spreading the voxels of a bin evenly over it,
+*   so they are accurate to a fraction of a bin width.
+*/
+static double medianAbsoluteDeviation( vtkSMPThreadLocal<NoiseSamples>& samples, const NoiseBinning& binning )
+{
+    std::vector<vtkIdType> bins( binning.numberOfBins, 0 );
+
+    for ( vtkSMPThreadLocal<NoiseSamples>::iterator it = samples.begin(); it != samples.end(); ++it )
+    {
+        for ( std::size_t i = 0; i < it->bins.size(); i++ )
+        {
+            bins[i] += it->bins[i];
+        }
+    }
+
+    if ( binning.exact )
+    {
+        std::vector< std::pair<double, vtkIdType> > counts;
+        vtkIdType n = 0;
+
+        for ( std::size_t i = 0; i < bins.size(); i++ )
+        {
+            if ( bins[i] > 0 )
+            {
+                counts.push_back( std::make_pair( binning.minimum + static_cast<double>( i ), bins[i] ) );
+                n += bins[i];
+            }
+        }
+
+        if ( n == 0 )
+        {
+            return 0.0;
+        }
+
+        double median = medianOfCounts( counts, n );
+
+        for ( std::size_t i = 0; i < counts.size(); i++ )
+        {
+            counts[i].first = std::fabs( counts[i].first - median );
+        }
+        std::sort( counts.begin(), counts.end() );
+
+        return medianOfCounts( counts, n );
+    }
+
+    std::vector<double> cumulative( bins.size() + 1, 0.0 );
+    for ( std::size_t i = 0; i < bins.size(); i++ )
+    {
+        cumulative[i + 1] = cumulative[i] + static_cast<double>( bins[i] );
+    }
+
+    double half = 0.5 * cumulative.back();
+    if ( half == 0.0 )
+    {
+        return 0.0;
+    }
+
+    // The median lies in the first bin whose upper edge has half of the voxels below it
+    std::size_t bin = std::lower_bound( cumulative.begin() + 1, cumulative.end(), half ) - cumulative.begin() - 1;
+    double median   = binning.minimum +
+                      ( bin + ( half - cumulative[bin] ) / ( cumulative[bin + 1] - cumulative[bin] ) ) * binning.binWidth;
+
+    // The voxels within a deviation grow with it, so bisect for the one that holds half of them
+    double low = 0.0, high = binning.numberOfBins * binning.binWidth;
+    for ( int i = 0; i < 64 && high - low > 1e-6 * binning.binWidth; i++ )
+    {
+        double deviation = 0.5 * ( low + high );
+        double inside    = countBelow( cumulative, binning, median + deviation ) -
+                           countBelow( cumulative, binning, median - deviation );
+
+        if ( inside < half )
+        {
+            low = deviation;
+        }
+        else
+        {
+            high = deviation;
+        }
+    }
+
+    return 0.5 * ( low + high );
+}
+
+/*
+*   One slice of one region.
+*/
+struct RegionSlice
+{
+    int region;
+    int z;
+};
+
+/*
+*   Per-slice worker. Each slice of a region writes its own signal (foreground)
+*   and noise (background) sums, reduced afterwards in slice order.
+*/
+template <class T>
+class RegionStatisticsFunctor
+{
+    public:
+        RegionStatisticsFunctor( const T* base, const vtkIdType increments[3], const int extent[6],
+                                 const std::vector<RegionStatistics::Region>& regions,
+                                 const std::vector<RegionSlice>& slices, double lower, double upper,
+                                 bool signalFromThreshold, bool noiseFromThreshold, bool collectNoise,
+                                 const NoiseBinning& binning, std::vector<SNRPartial>& partials,
+                                 vtkSMPThreadLocal<NoiseSamples>& samples )
+            : Base( base ), Regions( regions ), Slices( slices ), Lower( lower ), Upper( upper ),
+              SignalFromThreshold( signalFromThreshold ), NoiseFromThreshold( noiseFromThreshold ),
+              CollectNoise( collectNoise ), Binning( binning ), Scale( 1.0 / binning.binWidth ),
+              Partials( partials ), Samples( samples )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                Increments[i] = increments[i];
+            }
+            for ( int i = 0; i < 6; i++ )
+            {
+                Extent[i] = extent[i];
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            NoiseSamples& samples = Samples.Local();
+            if ( CollectNoise && samples.bins.empty() )
+            {
+                samples.bins.assign( Binning.numberOfBins, 0 );
+            }
+
+            std::vector<int> earlier;
+
+            for ( vtkIdType item = begin; item < end; item++ )
+            {
+                const RegionStatistics::Region& region = Regions[Slices[item].region];
+                int z = Slices[item].z;
+
+                SNRPartial partial;
+
+                for ( int y = region.extent[2]; y <= region.extent[3]; y++ )
+                {
+                    // Earlier regions of the same kind that cross this row already counted their voxels
+                    earlier.clear();
+                    for ( int r = 0; r < Slices[item].region; r++ )
+                    {
+                        const RegionStatistics::Region& other = Regions[r];
+                        if ( other.kind == region.kind && y >= other.extent[2] && y <= other.extent[3] &&
+                             z >= other.extent[4] && z <= other.extent[5] )
+                        {
+                            earlier.push_back( r );
+                        }
+                    }
+
+                    const T* row = Base + ( y - Extent[2] ) * Increments[1] + ( z - Extent[4] ) * Increments[2];
+
+                    double sum[2] = { 0.0, 0.0 }, sumSquares[2] = { 0.0, 0.0 };
+                    vtkIdType count[2] = { 0, 0 };
+
+                    for ( int x = region.extent[0]; x <= region.extent[1]; x++ )
+                    {
+                        if ( !region.mask.empty() && !insideRegion( region, x, y, z ) )
+                        {
+                            continue;
+                        }
+
+                        bool counted = false;
+                        for ( std::size_t e = 0; e < earlier.size() && !counted; e++ )
+                        {
+                            counted = insideRegion( Regions[earlier[e]], x, y, z );
+                        }
+                        if ( counted )
+                        {
+                            continue;
+                        }
+
+                        double value = static_cast<double>( row[( x - Extent[0] ) * Increments[0]] );
+
+                        // 1 for signal, 0 for noise, -1 for neither
+                        int side = ( region.kind == RegionStatistics::KIND_SIGNAL ) ? 1 : 0;
+                        if ( region.kind == RegionStatistics::KIND_THRESHOLD )
+                        {
+                            bool inside = ( value >= Lower ) && ( value <= Upper );
+                            side = inside ? ( SignalFromThreshold ? 1 : -1 ) : ( NoiseFromThreshold ? 0 : -1 );
+                        }
+
+                        if ( side < 0 )
+                        {
+                            continue;
+                        }
+
+                        count[side]++;
+                        sum[side]        += value;
+                        sumSquares[side] += value * value;
+
+                        if ( side == 0 && CollectNoise )
+                        {
+                            addSample( samples, value );
+                        }
+                    }
+
+                    partial.foreground.addBlock( count[1], sum[1], sumSquares[1] );
+                    partial.background.addBlock( count[0], sum[0], sumSquares[0] );
+                }
+
+                Partials[item] = partial;
+            }
+        }
+
+    private:
+        void addSample( NoiseSamples& samples, double value ) const
+        {
+            // The maximum (and NaN) would fall outside the last (first) bin
+            double position = ( value - Binning.minimum ) * Scale;
+            int bin = ( position > 0.0 ) ? static_cast<int>( std::min( position, Binning.numberOfBins - 1.0 ) ) : 0;
+
+            samples.bins[bin]++;
+        }
+
+        const T* Base;
+        vtkIdType Increments[3];
+        int Extent[6];
+        const std::vector<RegionStatistics::Region>& Regions;
+        const std::vector<RegionSlice>& Slices;
+        double Lower;
+        double Upper;
+        bool SignalFromThreshold;
+        bool NoiseFromThreshold;
+        bool CollectNoise;
+        NoiseBinning Binning;
+        double Scale;
+        std::vector<SNRPartial>& Partials;
+        vtkSMPThreadLocal<NoiseSamples>& Samples;
+};
+
+template <class T>
+static void RegionStatisticsExecute( const T* base, const vtkIdType increments[3], const int extent[6],
+                                     const std::vector<RegionStatistics::Region>& regions,
+                                     const std::vector<RegionSlice>& slices, double lower, double upper,
+                                     bool signalFromThreshold, bool noiseFromThreshold, bool collectNoise,
+                                     const NoiseBinning& binning, std::vector<SNRPartial>& partials,
+                                     vtkSMPThreadLocal<NoiseSamples>& samples )
+{
+    RegionStatisticsFunctor<T> functor( base, increments, extent, regions, slices, lower, upper,
+                                        signalFromThreshold, noiseFromThreshold, collectNoise, binning, partials,
+                                        samples );
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( slices.size() ), 1, functor );
+}
+
+template <class T>
+static void maskToBytes( const T* base, const vtkIdType increments[3], const int extent[6],
+                         std::vector<unsigned char>& mask, int bounds[6] )
+{
+    bounds[0] = bounds[2] = bounds[4] = std::numeric_limits<int>::max();
+    bounds[1] = bounds[3] = bounds[5] = std::numeric_limits<int>::min();
+
+    mask.reserve( vtkIdType( extent[1] - extent[0] + 1 ) * ( extent[3] - extent[2] + 1 ) * ( extent[5] - extent[4] + 1 ) );
+
+    for ( int z = extent[4]; z <= extent[5]; z++ )
+    {
+        for ( int y = extent[2]; y <= extent[3]; y++ )
+        {
+            const T* row = base + ( y - extent[2] ) * increments[1] + ( z - extent[4] ) * increments[2];
+
+            for ( int x = extent[0]; x <= extent[1]; x++ )
+            {
+                bool inside = row[( x - extent[0] ) * increments[0]] != 0;
+
+                mask.push_back( inside ? 1 : 0 );
+
+                if ( inside )
+                {
+                    bounds[0] = std::min( bounds[0], x );
+                    bounds[1] = std::max( bounds[1], x );
+                    bounds[2] = std::min( bounds[2], y );
+                    bounds[3] = std::max( bounds[3], y );
+                    bounds[4] = std::min( bounds[4], z );
+                    bounds[5] = std::max( bounds[5], z );
+                }
+            }
+        }
+    }
+}
+
+/******************* Helper class "RegionResult" functions *******************/
+RegionResult::RegionResult() : medianAbsoluteDeviation( 0.0 )
+{
+}
+
+double RegionResult::getNoise( NoiseEstimator estimator ) const
+{
+    switch ( estimator )
+    {
+        case NOISE_MAD:
+            return madScale * medianAbsoluteDeviation;
+
+        case NOISE_RAYLEIGH:
+            return noise.getStandardDeviation() / rayleighScale;
+
+        default:
+            return noise.getStandardDeviation();
+    }
+}
+
+double RegionResult::getSNR( NoiseEstimator estimator ) const
+{
+    return signal.mean / getNoise( estimator );
+}
+/***************************************************************************/
+
+/***************** Helper class "RegionStatistics" functions *****************/
+RegionStatistics::RegionStatistics()
+    : lowerThreshold( 0.0 ), upperThreshold( 0.0 ), noiseEstimator( NOISE_STD )
+{
+}
+
+void RegionStatistics::setThresholds( double lower, double upper )
+{
+    lowerThreshold = lower;
+    upperThreshold = upper;
+}
+
+void RegionStatistics::addSignalRegion( const RegionBox& box )
+{
+    Region region;
+    region.kind = KIND_SIGNAL;
+    std::copy( box.extent, box.extent + 6, region.extent );
+    std::copy( box.extent, box.extent + 6, region.maskExtent );
+
+    regions.push_back( region );
+}
+
+void RegionStatistics::addNoiseRegion( const RegionBox& box )
+{
+    Region region;
+    region.kind = KIND_NOISE;
+    std::copy( box.extent, box.extent + 6, region.extent );
+    std::copy( box.extent, box.extent + 6, region.maskExtent );
+
+    regions.push_back( region );
+}
+
+bool RegionStatistics::addSignalMask( vtkImageData* mask )
+{
+    return addMask( KIND_SIGNAL, mask );
+}
+
+bool RegionStatistics::addNoiseMask( vtkImageData* mask )
+{
+    return addMask( KIND_NOISE, mask );
+}
+
+bool RegionStatistics::addMask( int kind, vtkImageData* mask )
+{
+    Region region;
+    region.kind = kind;
+    mask->GetExtent( region.maskExtent );
+
+    vtkIdType increments[3];
+    mask->GetIncrements( increments );
+
+    void* base = mask->GetScalarPointer( region.maskExtent[0], region.maskExtent[2], region.maskExtent[4] );
+
+    switch ( mask->GetScalarType() )
+    {
+        vtkTemplateAliasMacro( maskToBytes( static_cast<const VTK_TT*>( base ), increments, region.maskExtent,
+                                            region.mask, region.extent ) );
+
+        default:
+        {
+            return false;
+        }
+    }
+
+    // The region only reads the bounding box of the mask
+    if ( region.extent[0] > region.extent[1] )
+    {
+        return false;
+    }
+
+    regions.push_back( region );
+    return true;
+}
+
+RegionResult RegionStatistics::compute( vtkImageData* image, std::string* error ) const
+{
+    RegionResult result;
+
+    int extent[6];
+    image->GetExtent( extent );
+
+    bool signalFromThreshold = true, noiseFromThreshold = true;
+
+    // The regions clipped to the image, followed by the whole image if a side has no region
+    std::vector<Region> clipped;
+
+    for ( std::size_t r = 0; r < regions.size(); r++ )
+    {
+        const Region& region = regions[r];
+
+        if ( !region.mask.empty() && !std::equal( region.maskExtent, region.maskExtent + 6, extent ) )
+        {
+            if ( error )
+            {
+                *error = "The mask extent does not match the image extent.";
+            }
+            return RegionResult();
+        }
+
+        Region clip = region;
+        for ( int i = 0; i < 6; i += 2 )
+        {
+            clip.extent[i]     = std::max( region.extent[i], extent[i] );
+            clip.extent[i + 1] = std::min( region.extent[i + 1], extent[i + 1] );
+        }
+
+        if ( clip.extent[0] > clip.extent[1] || clip.extent[2] > clip.extent[3] || clip.extent[4] > clip.extent[5] )
+        {
+            if ( error )
+            {
+                std::ostringstream text;
+                text << "The region " << region.extent[0] << "," << region.extent[1] << "," << region.extent[2] << ","
+                     << region.extent[3] << "," << region.extent[4] << "," << region.extent[5]
+                     << " is outside the image.";
+                *error = text.str();
+            }
+            return RegionResult();
+        }
+
+        signalFromThreshold = signalFromThreshold && region.kind != KIND_SIGNAL;
+        noiseFromThreshold  = noiseFromThreshold && region.kind != KIND_NOISE;
+
+        clipped.push_back( clip );
+    }
+
+    if ( signalFromThreshold || noiseFromThreshold )
+    {
+        Region whole;
+        whole.kind = KIND_THRESHOLD;
+        std::copy( extent, extent + 6, whole.extent );
+        std::copy( extent, extent + 6, whole.maskExtent );
+
+        clipped.push_back( whole );
+    }
+
+    std::vector<RegionSlice> slices;
+    for ( std::size_t r = 0; r < clipped.size(); r++ )
+    {
+        for ( int z = clipped[r].extent[4]; z <= clipped[r].extent[5]; z++ )
+        {
+            RegionSlice slice = { static_cast<int>( r ), z };
+            slices.push_back( slice );
+        }
+    }
+
+    std::vector<SNRPartial> partials( slices.size() );
+    vtkSMPThreadLocal<NoiseSamples> samples;
+    bool collectNoise = ( noiseEstimator == NOISE_MAD );
+
+    NoiseBinning binning = { 0.0, 1.0, 1, true };
+    if ( collectNoise )
+    {
+        // The range of the whole image contains the range of the noise voxels
+        double range[2];
+        image->GetPointData()->GetScalars()->GetRange( range, 0 );
+
+        int scalarType = image->GetScalarType();
+        bool integral  = ( scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE );
+
+        if ( range[0] <= range[1] )
+        {
+            binning.minimum = range[0];
+            binning.exact   = integral && ( range[1] - range[0] + 1.0 <= noiseBins );
+
+            if ( binning.exact )
+            {
+                binning.numberOfBins = static_cast<int>( range[1] - range[0] ) + 1;
+            }
+            else
+            {
+                binning.numberOfBins = noiseBins;
+                binning.binWidth     = ( range[1] > range[0] ) ? ( range[1] - range[0] ) / noiseBins : 1.0;
+            }
+        }
+    }
+
+    vtkIdType increments[3];
+    image->GetIncrements( increments );
+
+    void* base = image->GetScalarPointer( extent[0], extent[2], extent[4] );
+
+    switch ( image->GetScalarType() )
+    {
+        vtkTemplateAliasMacro( RegionStatisticsExecute( static_cast<const VTK_TT*>( base ), increments, extent,
+                                                        clipped, slices, lowerThreshold, upperThreshold,
+                                                        signalFromThreshold, noiseFromThreshold, collectNoise,
+                                                        binning, partials, samples ) );
+
+        default:
+        {
+            if ( error )
+            {
+                *error = "Unsupported scalar type for the SNR calculation.";
+            }
+            return result;
+        }
+    }
+
+    // Reduce in slice order so the result is independent of the thread scheduling
+    SNRPartial total;
+    for ( std::size_t i = 0; i < partials.size(); i++ )
+    {
+        total.merge( partials[i] );
+    }
+
+    result.signal = total.foreground;
+    result.noise  = total.background;
+
+    if ( collectNoise )
+    {
+        result.medianAbsoluteDeviation = medianAbsoluteDeviation( samples, binning );
+    }
+
+    return result;
+}
+
+const char* RegionStatistics::getEstimatorName( NoiseEstimator estimator )
+{
+    switch ( estimator )
+    {
+        case NOISE_MAD:
+            return "mad";
+
+        case NOISE_RAYLEIGH:
+            return "rayleigh";
+
+        default:
+            return "std";
+    }
+}
+
+bool RegionStatistics::estimatorFromName( const std::string& name, NoiseEstimator& estimator )
+{
+    const NoiseEstimator estimators[] = { NOISE_STD, NOISE_MAD, NOISE_RAYLEIGH };
+
+    for ( NoiseEstimator candidate : estimators )
+    {
+        if ( name == getEstimatorName( candidate ) )
+        {
+            estimator = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+/***************************************************************************/
@@ -0,0 +1,154 @@
+/****************************************************************************
+*   regionStatistics.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the SNR of user-specified signal and
+*                   noise regions, with robust noise estimators.
+****************************************************************************/
+
+#ifndef REGIONSTATISTICS_H
+#define REGIONSTATISTICS_H
+
+#include "snrStatistics.hxx"
+
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   A box of voxels (xMin, xMax, yMin, yMax, zMin, zMax), inclusive.
+*/
+struct RegionBox
+{
+    int extent[6];
+};
+
+/*
+*   How the noise (standard deviation of the noise) is estimated from the
+*   noise voxels.
+*/
+enum NoiseEstimator
+{
+    NOISE_STD = 0,      // Standard deviation of the noise voxels
+    NOISE_MAD,          // 1.4826 x median absolute deviation: ignores outliers (e.g. ghosting, artefacts)
+    NOISE_RAYLEIGH      // Standard deviation / sqrt( 2 - pi/2 ): the Gaussian noise under a magnitude MR background
+};
+
+/*
+*   The signal and noise of one image.
+*/
+struct RegionResult
+{
+    RegionResult();
+
+    /*
+    *   @returns the noise standard deviation for an estimator
+    */
+    double getNoise( NoiseEstimator estimator ) const;
+
+    /*
+    *   @returns the mean of the signal divided by the noise
+    */
+    double getSNR( NoiseEstimator estimator ) const;
+
+    SNRAccumulator signal;
+    SNRAccumulator noise;
+    double medianAbsoluteDeviation;     // Of the noise voxels, only computed for NOISE_MAD
+};
+
+/*
+*   The SNR of an image from signal and noise regions: boxes and masks
+*   (nonzero voxels of an image on the same grid). Only the voxels inside the
+*   regions are read, in one pass threaded over Z with vtkSMPTools, so a small
+*   air region costs a small fraction of a pass over the whole volume. A voxel
+*   in several regions of the same kind is counted once.
+*
+*   Without signal regions, the signal is every voxel in [lower, upper];
+*   without noise regions, the noise is every voxel outside it (the threshold
+*   SNR of SNRStatistics). That side then reads the whole image.
+*
+*   For NOISE_MAD the noise voxels are also collected in a histogram of at
+*   most 65536 bins: one per value for integer images with a narrow enough
+*   range (exact MAD), equal bins between the image minimum and maximum for
+*   all others (MAD accurate to a fraction of a bin width).
+*/
+class RegionStatistics
+{
+    public:
+        RegionStatistics();
+
+        void setThresholds( double lower, double upper );
+        void setNoiseEstimator( NoiseEstimator estimator ) { noiseEstimator = estimator; }
+        NoiseEstimator getNoiseEstimator() const { return noiseEstimator; }
+
+        void addSignalRegion( const RegionBox& box );
+        void addNoiseRegion( const RegionBox& box );
+
+        /*
+        *   Add the nonzero voxels of a mask as a signal or noise region. The mask
+        *   must have the extent of the images.
+        *
+        *   @param   mask   The mask (any scalar type, first component)
+        *
+        *   @returns false if the mask has no nonzero voxel
+        */
+        bool addSignalMask( vtkImageData* mask );
+        bool addNoiseMask( vtkImageData* mask );
+
+        /*
+        *   @returns whether any signal or noise region is set
+        */
+        bool hasRegions() const { return !regions.empty(); }
+
+        /*
+        *   Compute the signal and noise of the first component of an image.
+        *   May be called from several threads at the same time.
+        *
+        *   @param   image   The image to process
+        *   @param   error   Receives the reason if the regions do not fit the image
+        *
+        *   @returns the statistics, empty on an error
+        */
+        RegionResult compute( vtkImageData* image, std::string* error = nullptr ) const;
+
+        /*
+        *   @returns the name of an estimator ("std", "mad" or "rayleigh")
+        */
+        static const char* getEstimatorName( NoiseEstimator estimator );
+
+        /*
+        *   @param   name         "std", "mad" or "rayleigh"
+        *   @param   estimator    Receives the estimator
+        *
+        *   @returns false if there is no estimator with that name
+        */
+        static bool estimatorFromName( const std::string& name, NoiseEstimator& estimator );
+
+        enum Kind
+        {
+            KIND_SIGNAL = 0,
+            KIND_NOISE,
+            KIND_THRESHOLD      // The whole image, split by the thresholds
+        };
+
+        struct Region
+        {
+            int kind;
+            int extent[6];
+            int maskExtent[6];
+            std::vector<unsigned char> mask;   // Empty for a box
+        };
+
+    private:
+        bool addMask( int kind, vtkImageData* mask );
+
+        double lowerThreshold;
+        double upperThreshold;
+        NoiseEstimator noiseEstimator;
+        std::vector<Region> regions;
+};
+
+#endif // REGIONSTATISTICS_H
@@ -0,0 +1,260 @@
+/****************************************************************************
+*   sliceCache.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the on-demand filtered slice cache
+*                   used by the lazy viewer.
+****************************************************************************/
+
+#include "sliceCache.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+
+SliceCache::SliceCache()
+    : capacity( 64 ), prefetchDepth( 4 ), hits( 0 ), misses( 0 ), stopping( false )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = 0;
+    }
+}
+
+SliceCache::~SliceCache()
+{
+    stopPrefetch();
+}
+
+void SliceCache::setInput( vtkImageData* image )
+{
+    input = image;
+    input->GetExtent( extent );
+}
+
+int SliceCache::addFilter( const FilterFactory& factory )
+{
+    // Every instance reads its own data object, so the two pipelines never share state
+    vtkSmartPointer<vtkImageAlgorithm> instances[2] = { factory(), factory() };
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+        copy->ShallowCopy( input );
+        instances[i]->SetInputData( copy );
+    }
+
+    factories.push_back( factory );
+    renderFilters.push_back( instances[0] );
+    prefetchFilters.push_back( instances[1] );
+
+    return static_cast<int>( factories.size() ) - 1;
+}
+
+void SliceCache::setCapacity( int slices )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    capacity = std::max( 1, slices );
+}
+
+void SliceCache::setPrefetchDepth( int slices )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    prefetchDepth = std::max( 0, slices );
+}
+
+vtkSmartPointer<vtkImageData> SliceCache::getSlice( int filter, int slice )
+{
+    SliceKey key( filter, slice );
+
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+
+        // A slice the prefetch thread is working on is nearly done, so wait for it
+        sliceDone.wait( lock, [this, &key]()
+        {
+            return std::find( inProgress.begin(), inProgress.end(), key ) == inProgress.end();
+        } );
+
+        std::map<SliceKey, Entry>::iterator it = entries.find( key );
+        if ( it != entries.end() )
+        {
+            recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.position );
+            hits++;
+            return it->second.image;
+        }
+
+        misses++;
+        inProgress.push_back( key );
+    }
+
+    vtkSmartPointer<vtkImageData> image = filterSlice( renderFilters[filter], slice );
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        insert( key, image );
+        inProgress.erase( std::find( inProgress.begin(), inProgress.end(), key ) );
+    }
+    sliceDone.notify_all();
+
+    return image;
+}
+
+void SliceCache::prefetch( int slice, int direction )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+
+        // Only the latest scroll position matters
+        queue.clear();
+        for ( int d = 1; d <= prefetchDepth; d++ )
+        {
+            int z = slice + ( direction < 0 ? -d : d );
+            if ( z < extent[4] || z > extent[5] )
+            {
+                break;
+            }
+
+            for ( std::size_t i = 0; i < factories.size(); i++ )
+            {
+                queue.push_back( SliceKey( static_cast<int>( i ), z ) );
+            }
+        }
+
+        if ( queue.empty() )
+        {
+            return;
+        }
+    }
+
+    if ( !worker.joinable() )
+    {
+        worker = std::thread( &SliceCache::prefetchLoop, this );
+    }
+    wake.notify_one();
+}
+
+long SliceCache::getHits() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return hits;
+}
+
+long SliceCache::getMisses() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return misses;
+}
+
+vtkSmartPointer<vtkImageData> SliceCache::filterSlice( vtkImageAlgorithm* filter, int slice ) const
+{
+    // Request one slice. The filters pad the request to their kernel size themselves.
+    int sliceExtent[6] = { extent[0], extent[1], extent[2], extent[3], slice, slice };
+    filter->UpdateExtent( sliceExtent );
+
+    vtkImageData* output = vtkImageData::SafeDownCast( filter->GetOutputDataObject( 0 ) );
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent( sliceExtent );
+    image->SetSpacing( input->GetSpacing() );
+    image->SetOrigin( input->GetOrigin() );
+
+    if ( !output || !output->GetPointData()->GetScalars() )
+    {
+        image->AllocateScalars( input->GetScalarType(), 1 );
+        std::memset( image->GetScalarPointer(), 0, image->GetNumberOfPoints() * image->GetScalarSize() );
+        return image;
+    }
+
+    image->AllocateScalars( output->GetScalarType(), output->GetNumberOfScalarComponents() );
+
+    // Copy only the requested slice: some filters produce more than was asked for
+    std::size_t rowBytes = static_cast<std::size_t>( extent[1] - extent[0] + 1 ) *
+                           output->GetNumberOfScalarComponents() * output->GetScalarSize();
+
+    for ( int y = extent[2]; y <= extent[3]; y++ )
+    {
+        std::memcpy( image->GetScalarPointer( extent[0], y, slice ),
+                     output->GetScalarPointer( extent[0], y, slice ), rowBytes );
+    }
+
+    return image;
+}
+
+void SliceCache::insert( const SliceKey& key, vtkImageData* image )
+{
+    std::map<SliceKey, Entry>::iterator it = entries.find( key );
+    if ( it != entries.end() )
+    {
+        it->second.image = image;
+        recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.position );
+        return;
+    }
+
+    recentlyUsed.push_front( key );
+
+    Entry entry;
+    entry.image    = image;
+    entry.position = recentlyUsed.begin();
+    entries[key]   = entry;
+
+    // The mappers hold their own reference, so an evicted slice stays valid while it is displayed
+    std::size_t maximum = static_cast<std::size_t>( capacity ) * std::max<std::size_t>( 1, factories.size() );
+    while ( entries.size() > maximum )
+    {
+        entries.erase( recentlyUsed.back() );
+        recentlyUsed.pop_back();
+    }
+}
+
+void SliceCache::prefetchLoop()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+
+    while ( true )
+    {
+        wake.wait( lock, [this]() { return stopping || !queue.empty(); } );
+
+        if ( stopping )
+        {
+            return;
+        }
+
+        SliceKey key = queue.front();
+        queue.pop_front();
+
+        if ( entries.count( key ) || std::find( inProgress.begin(), inProgress.end(), key ) != inProgress.end() )
+        {
+            continue;
+        }
+
+        inProgress.push_back( key );
+        lock.unlock();
+
+        vtkSmartPointer<vtkImageData> image = filterSlice( prefetchFilters[key.first], key.second );
+
+        lock.lock();
+        insert( key, image );
+        inProgress.erase( std::find( inProgress.begin(), inProgress.end(), key ) );
+        sliceDone.notify_all();
+    }
+}
+
+void SliceCache::stopPrefetch()
+{
+    if ( !worker.joinable() )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopping = true;
+    }
+    wake.notify_all();
+
+    worker.join();
+}
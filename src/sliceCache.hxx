@@ -0,0 +1,151 @@
+/****************************************************************************
+*   sliceCache.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the on-demand filtered slice cache used
+*                   by the lazy viewer.
+****************************************************************************/
+
+#ifndef SLICECACHE_H
+#define SLICECACHE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageAlgorithm.h>
+
+/*
+*   Filters single Z slices of a volume when they are displayed, instead of
+*   filtering the whole volume before the viewer opens.
+*
+*   Each filter is built twice from its factory: one instance for the render
+*   thread and one for the prefetch thread, each reading its own shallow copy
+*   of the input (the voxels are shared). A slice is requested with a one-slice
+*   update extent, so the filters only read the neighbouring slices their
+*   kernel needs. Filters that always run over the whole input (the recursive
+*   Gaussian) pay for the whole volume once; later slices come from their
+*   cached output.
+*
+*   Filtered slices are kept in a least recently used cache of a fixed number
+*   of slices per filter. After each slice change the next slices in the scroll
+*   direction are filtered by the prefetch thread, so scrolling at a steady pace
+*   finds them ready.
+*/
+class SliceCache
+{
+    public:
+        typedef std::function< vtkSmartPointer<vtkImageAlgorithm>() > FilterFactory;
+
+        SliceCache();
+        ~SliceCache();
+
+        /*
+        *   Set the volume to filter. Must be called before addFilter().
+        *
+        *   @param   image   The original image
+        */
+        void setInput( vtkImageData* image );
+
+        /*
+        *   Add a filter.
+        *
+        *   @param   factory   Creates a new, unconnected instance of the filter
+        *
+        *   @returns the index of the filter for getSlice()
+        */
+        int addFilter( const FilterFactory& factory );
+
+        /*
+        *   Set the number of slices kept per filter (default 64).
+        *
+        *   @param   slices   Slices per filter (>= 1)
+        */
+        void setCapacity( int slices );
+
+        /*
+        *   Set the number of slices prefetched in the scroll direction (default 4).
+        *
+        *   @param   slices   Slices to prefetch, 0 = no prefetching
+        */
+        void setPrefetchDepth( int slices );
+
+        /*
+        *   Get a filtered slice, filtering it now if it is not cached. Waits for
+        *   the prefetch thread instead if it is filtering that slice already.
+        *
+        *   @param   filter   Index returned by addFilter()
+        *   @param   slice    The Z index
+        *
+        *   @returns an image with the XY extent of the input and a Z extent of [slice, slice]
+        */
+        vtkSmartPointer<vtkImageData> getSlice( int filter, int slice );
+
+        /*
+        *   Queue the slices after a displayed one for the prefetch thread.
+        *   Replaces any slices that are still queued.
+        *
+        *   @param   slice       The displayed slice
+        *   @param   direction   +1 when scrolling forward, -1 backward
+        */
+        void prefetch( int slice, int direction );
+
+        /*
+        *   @returns the number of getSlice() calls that found their slice in the cache
+        */
+        long getHits() const;
+
+        /*
+        *   @returns the number of getSlice() calls that had to filter their slice
+        */
+        long getMisses() const;
+
+    private:
+        SliceCache( const SliceCache& ) = delete;
+        void operator=( const SliceCache& ) = delete;
+
+        typedef std::pair<int, int> SliceKey;   // (filter, slice)
+
+        struct Entry
+        {
+            vtkSmartPointer<vtkImageData> image;
+            std::list<SliceKey>::iterator position;
+        };
+
+        vtkSmartPointer<vtkImageData> filterSlice( vtkImageAlgorithm* filter, int slice ) const;
+        void insert( const SliceKey& key, vtkImageData* image );
+        void prefetchLoop();
+        void stopPrefetch();
+
+        vtkSmartPointer<vtkImageData> input;
+        int extent[6];
+        std::vector<FilterFactory> factories;
+        std::vector< vtkSmartPointer<vtkImageAlgorithm> > renderFilters;
+        std::vector< vtkSmartPointer<vtkImageAlgorithm> > prefetchFilters;
+        int capacity;
+        int prefetchDepth;
+
+        // Everything below is guarded by mutex
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable sliceDone;
+        std::map<SliceKey, Entry> entries;
+        std::list<SliceKey> recentlyUsed;       // Most recently used first
+        std::vector<SliceKey> inProgress;
+        std::deque<SliceKey> queue;
+        long hits;
+        long misses;
+        bool stopping;
+        std::thread worker;
+};
+
+#endif // SLICECACHE_H
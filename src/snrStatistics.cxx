@@ -0,0 +1,315 @@
+/****************************************************************************
+*   snrStatistics.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the foreground/background statistics
+*                   used to calculate the SNR of an image.
+****************************************************************************/
+
+#include "snrStatistics.hxx"
+#include "thresholdKernel.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+/******************* Helper class "SNRAccumulator" functions *****************/
+SNRAccumulator::SNRAccumulator() : count( 0 ), mean( 0.0 ), m2( 0.0 )
+{
+}
+
+void SNRAccumulator::addBlock( vtkIdType n, double sum, double sumSquares )
+{
+    if ( n <= 0 )
+    {
+        return;
+    }
+
+    SNRAccumulator block;
+    block.count = n;
+    block.mean  = sum / n;
+    block.m2    = std::max( 0.0, sumSquares - sum * block.mean );
+
+    merge( block );
+}
+
+void SNRAccumulator::merge( const SNRAccumulator& other )
+{
+    if ( other.count == 0 )
+    {
+        return;
+    }
+
+    if ( count == 0 )
+    {
+        *this = other;
+        return;
+    }
+
+    vtkIdType n  = count + other.count;
+    double delta = other.mean - mean;
+
+    mean += delta * other.count / n;
+    m2   += other.m2 + delta * delta * ( double( count ) * other.count / n );
+    count = n;
+}
+
+double SNRAccumulator::getVariance() const
+{
+    return ( count > 0 ) ? m2 / count : 0.0;
+}
+
+double SNRAccumulator::getStandardDeviation() const
+{
+    return sqrt( getVariance() );
+}
+/***************************************************************************/
+
+/********************* Helper class "SNRPartial" functions *******************/
+void SNRPartial::merge( const SNRPartial& other )
+{
+    foreground.merge( other.foreground );
+    background.merge( other.background );
+}
+
+double SNRPartial::getSNR() const
+{
+    return foreground.mean / background.getStandardDeviation();
+}
+/***************************************************************************/
+
+/*
+*   Classify one row of voxels and add it to the foreground (index 1) and
+*   background (index 0) sums. Generic version for any scalar type and stride.
+*/
+template <class T>
+static void accumulateRowGeneric( const T* row, vtkIdType n, vtkIdType stride,
+                                  double lower, double upper, ThresholdSums& sums )
+{
+    for ( vtkIdType x = 0; x < n; x++ )
+    {
+        double voxel = static_cast<double>( row[x * stride] );
+        int inside   = ( voxel >= lower ) & ( voxel <= upper );
+
+        sums.count[inside]++;
+        sums.sum[inside]        += voxel;
+        sums.sumSquares[inside] += voxel * voxel;
+    }
+}
+
+template <class T>
+static void accumulateRow( const T* row, vtkIdType n, vtkIdType stride,
+                           double lower, double upper, ThresholdSums& sums )
+{
+    accumulateRowGeneric( row, n, stride, lower, upper, sums );
+}
+
+/*
+*   Contiguous rows of the common CT/MR voxel types go through the SIMD kernels.
+*/
+static void accumulateRow( const short* row, vtkIdType n, vtkIdType stride,
+                           double lower, double upper, ThresholdSums& sums )
+{
+    if ( stride == 1 )
+    {
+        thresholdAccumulate( row, static_cast<std::size_t>( n ), lower, upper, sums );
+    }
+    else
+    {
+        accumulateRowGeneric( row, n, stride, lower, upper, sums );
+    }
+}
+
+static void accumulateRow( const unsigned short* row, vtkIdType n, vtkIdType stride,
+                           double lower, double upper, ThresholdSums& sums )
+{
+    if ( stride == 1 )
+    {
+        thresholdAccumulate( row, static_cast<std::size_t>( n ), lower, upper, sums );
+    }
+    else
+    {
+        accumulateRowGeneric( row, n, stride, lower, upper, sums );
+    }
+}
+
+static void accumulateRow( const float* row, vtkIdType n, vtkIdType stride,
+                           double lower, double upper, ThresholdSums& sums )
+{
+    if ( stride == 1 )
+    {
+        thresholdAccumulate( row, static_cast<std::size_t>( n ), lower, upper, sums );
+    }
+    else
+    {
+        accumulateRowGeneric( row, n, stride, lower, upper, sums );
+    }
+}
+
+/*
+*   Per-slab worker. Each row is reduced to raw sums (exact for integer data),
+*   which are then merged into the slab accumulators.
+*/
+template <class T>
+class SNRStatisticsFunctor
+{
+    public:
+        SNRStatisticsFunctor( const T* base, const vtkIdType increments[3], const int extent[6],
+                              int slabSize, double lower, double upper, std::vector<SNRPartial>& partials )
+            : Base( base ), SlabSize( slabSize ), Lower( lower ), Upper( upper ), Partials( partials )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                Increments[i] = increments[i];
+            }
+            for ( int i = 0; i < 6; i++ )
+            {
+                Extent[i] = extent[i];
+            }
+        }
+
+        void operator()( vtkIdType begin, vtkIdType end ) const
+        {
+            vtkIdType rowLength = Extent[1] - Extent[0] + 1;
+
+            for ( vtkIdType slab = begin; slab < end; slab++ )
+            {
+                int zStart = Extent[4] + int( slab ) * SlabSize;
+                int zEnd   = std::min( zStart + SlabSize - 1, Extent[5] );
+
+                SNRPartial partial;
+
+                for ( int z = zStart; z <= zEnd; z++ )
+                {
+                    const T* slicePtr = Base + ( z - Extent[4] ) * Increments[2];
+
+                    for ( int y = 0; y <= Extent[3] - Extent[2]; y++ )
+                    {
+                        const T* rowPtr = slicePtr + y * Increments[1];
+
+                        ThresholdSums sums;
+                        resetThresholdSums( sums );
+                        accumulateRow( rowPtr, rowLength, Increments[0], Lower, Upper, sums );
+
+                        partial.foreground.addBlock( sums.count[1], sums.sum[1], sums.sumSquares[1] );
+                        partial.background.addBlock( sums.count[0], sums.sum[0], sums.sumSquares[0] );
+                    }
+                }
+
+                Partials[slab] = partial;
+            }
+        }
+
+    private:
+        const T* Base;
+        vtkIdType Increments[3];
+        int Extent[6];
+        int SlabSize;
+        double Lower;
+        double Upper;
+        std::vector<SNRPartial>& Partials;
+};
+
+template <class T>
+void SNRStatisticsExecute( const T* base, const vtkIdType increments[3], const int extent[6],
+                           int slabSize, double lower, double upper, std::vector<SNRPartial>& partials )
+{
+    SNRStatisticsFunctor<T> functor( base, increments, extent, slabSize, lower, upper, partials );
+    vtkSMPTools::For( 0, static_cast<vtkIdType>( partials.size() ), 1, functor );
+}
+
+/******************* Helper class "SNRStatistics" functions ******************/
+SNRStatistics::SNRStatistics()
+    : lowerThreshold( 0.0 ), upperThreshold( 0.0 ), useExtent( false ), slabSize( 4 )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = 0;
+    }
+}
+
+void SNRStatistics::setThresholds( double lower, double upper )
+{
+    lowerThreshold = lower;
+    upperThreshold = upper;
+}
+
+void SNRStatistics::setExtent( const int newExtent[6] )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = newExtent[i];
+    }
+    useExtent = true;
+}
+
+void SNRStatistics::clearExtent()
+{
+    useExtent = false;
+}
+
+void SNRStatistics::setSlabSize( int slices )
+{
+    slabSize = std::max( 1, slices );
+}
+
+SNRPartial SNRStatistics::compute( vtkImageData* image )
+{
+    partials.clear();
+
+    int wholeExtent[6];
+    image->GetExtent( wholeExtent );
+
+    // Clip the requested extent to the image
+    int ext[6];
+    for ( int i = 0; i < 6; i += 2 )
+    {
+        ext[i]     = useExtent ? std::max( extent[i], wholeExtent[i] ) : wholeExtent[i];
+        ext[i + 1] = useExtent ? std::min( extent[i + 1], wholeExtent[i + 1] ) : wholeExtent[i + 1];
+    }
+
+    SNRPartial result;
+
+    if ( ext[0] > ext[1] || ext[2] > ext[3] || ext[4] > ext[5] )
+    {
+        return result;
+    }
+
+    int numSlabs = ( ext[5] - ext[4] ) / slabSize + 1;
+    partials.resize( numSlabs );
+
+    vtkIdType increments[3];
+    image->GetIncrements( increments );
+
+    void* base = image->GetScalarPointer( ext[0], ext[2], ext[4] );
+
+    switch ( image->GetScalarType() )
+    {
+        vtkTemplateAliasMacro( SNRStatisticsExecute( static_cast<const VTK_TT*>( base ), increments, ext,
+                                                     slabSize, lowerThreshold, upperThreshold, partials ) );
+
+        default:
+        {
+            std::cerr << "ERROR: Unsupported scalar type for the SNR calculation. \n";
+            return result;
+        }
+    }
+
+    // Reduce in slab order so the result is independent of the thread scheduling
+    for ( std::size_t i = 0; i < partials.size(); i++ )
+    {
+        result.merge( partials[i] );
+    }
+
+    return result;
+}
+
+const std::vector<SNRPartial>& SNRStatistics::getPartials() const
+{
+    return partials;
+}
+/***************************************************************************/
@@ -0,0 +1,149 @@
+/****************************************************************************
+*   snrStatistics.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the foreground/background statistics
+*                   used to calculate the SNR of an image.
+****************************************************************************/
+
+#ifndef SNRSTATISTICS_H
+#define SNRSTATISTICS_H
+
+#include <vector>
+
+#include <vtkType.h>
+#include <vtkImageData.h>
+
+/*
+*   Running count, mean and sum of squared deviations (M2) of a set of voxels.
+*   Blocks are combined with the pairwise update of Chan et al., so partial
+*   results from different slabs/threads can be merged without losing precision.
+*/
+class SNRAccumulator
+{
+    public:
+        SNRAccumulator();
+
+        /*
+        *   Merge a block of voxels given by its raw sums.
+        *
+        *   @param   n            Number of voxels in the block
+        *   @param   sum          Sum of the voxel values
+        *   @param   sumSquares   Sum of the squared voxel values
+        */
+        void addBlock( vtkIdType n, double sum, double sumSquares );
+
+        /*
+        *   Merge another accumulator into this one.
+        *
+        *   @param   other   The accumulator to merge
+        */
+        void merge( const SNRAccumulator& other );
+
+        /*
+        *   @returns the population variance (M2 / count), 0 if empty
+        */
+        double getVariance() const;
+
+        /*
+        *   @returns the population standard deviation
+        */
+        double getStandardDeviation() const;
+
+        vtkIdType count;
+        double mean;
+        double m2;
+};
+
+/*
+*   Foreground (inside [lower, upper]) and background statistics of one image,
+*   or of one slab of an image.
+*/
+class SNRPartial
+{
+    public:
+        /*
+        *   Merge the statistics of another slab into this one.
+        *
+        *   @param   other   The partial result to merge
+        */
+        void merge( const SNRPartial& other );
+
+        /*
+        *   @returns the mean of the foreground divided by the standard
+        *            deviation of the background
+        */
+        double getSNR() const;
+
+        SNRAccumulator foreground;
+        SNRAccumulator background;
+};
+
+/*
+*   Computes foreground/background statistics of an image in a single pass.
+*
+*   The scalar type is dispatched once and the voxels are read through raw pointers.
+*   The Z range is split into fixed slabs that are processed in parallel with
+*   vtkSMPTools. Each slab writes its own partial result, and the partials are
+*   reduced in slab order so the result does not depend on the number of threads.
+*/
+class SNRStatistics
+{
+    public:
+        SNRStatistics();
+
+        /*
+        *   Set the foreground threshold range. Voxels in [lower, upper] are
+        *   foreground, all others are background.
+        *
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        */
+        void setThresholds( double lower, double upper );
+
+        /*
+        *   Restrict the calculation to a sub-extent of the image.
+        *   By default the whole image extent is used.
+        *
+        *   @param   extent   The extent (xMin, xMax, yMin, yMax, zMin, zMax)
+        */
+        void setExtent( const int extent[6] );
+
+        /*
+        *   Use the whole extent of each image (default).
+        */
+        void clearExtent();
+
+        /*
+        *   Set the number of slices in each slab (and thus in each partial result).
+        *
+        *   @param   slices   Number of Z slices per slab (>= 1)
+        */
+        void setSlabSize( int slices );
+
+        /*
+        *   Compute the statistics of the first component of an image.
+        *
+        *   @param   image   The image to process
+        *
+        *   @returns the statistics of the whole (or selected) extent
+        */
+        SNRPartial compute( vtkImageData* image );
+
+        /*
+        *   @returns the per-slab partial results of the last call to compute(),
+        *            ordered by Z
+        */
+        const std::vector<SNRPartial>& getPartials() const;
+
+    private:
+        double lowerThreshold;
+        double upperThreshold;
+        int extent[6];
+        bool useExtent;
+        int slabSize;
+        std::vector<SNRPartial> partials;
+};
+
+#endif // SNRSTATISTICS_H
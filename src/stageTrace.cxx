@@ -0,0 +1,354 @@
+/****************************************************************************
+*   stageTrace.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the scoped stage timers and the trace
+*                   recorder (Chrome trace JSON and summary table).
+****************************************************************************/
+
+#include "stageTrace.hxx"
+#include "jsonText.hxx"
+#include "memoryUsage.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*
+*   The recorded events, shared by all threads.
+*/
+struct TraceStorage
+{
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::map<int, std::string> threadNames;
+    std::chrono::steady_clock::time_point epoch;
+    std::string fileName;
+};
+
+static TraceStorage& storage()
+{
+    static TraceStorage traceStorage;
+    return traceStorage;
+}
+
+static std::atomic<int> nextThreadIndex( 0 );
+
+#ifdef _WIN32
+static double fileTimeMicroseconds( const FILETIME& time )
+{
+    ULARGE_INTEGER ticks;
+    ticks.LowPart  = time.dwLowDateTime;
+    ticks.HighPart = time.dwHighDateTime;
+
+    // 100 ns ticks
+    return ticks.QuadPart / 10.0;
+}
+#endif
+
+static double getThreadCpuMicroseconds()
+{
+#ifdef _WIN32
+    FILETIME creation, exited, kernel, user;
+    if ( !GetThreadTimes( GetCurrentThread(), &creation, &exited, &kernel, &user ) )
+    {
+        return 0.0;
+    }
+    return fileTimeMicroseconds( kernel ) + fileTimeMicroseconds( user );
+#else
+    timespec time;
+    if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &time ) != 0 )
+    {
+        return 0.0;
+    }
+    return time.tv_sec * 1.0e6 + time.tv_nsec / 1.0e3;
+#endif
+}
+
+static double getProcessCpuMicroseconds()
+{
+#ifdef _WIN32
+    FILETIME creation, exited, kernel, user;
+    if ( !GetProcessTimes( GetCurrentProcess(), &creation, &exited, &kernel, &user ) )
+    {
+        return 0.0;
+    }
+    return fileTimeMicroseconds( kernel ) + fileTimeMicroseconds( user );
+#else
+    timespec time;
+    if ( clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &time ) != 0 )
+    {
+        return 0.0;
+    }
+    return time.tv_sec * 1.0e6 + time.tv_nsec / 1.0e3;
+#endif
+}
+
+/******************** Helper class "TraceRecorder" functions ********************/
+std::atomic<bool> TraceRecorder::enabled( false );
+
+void TraceRecorder::enable( const std::string& fileName )
+{
+    TraceStorage& trace = storage();
+    {
+        std::lock_guard<std::mutex> lock( trace.mutex );
+        trace.epoch    = std::chrono::steady_clock::now();
+        trace.fileName = fileName;
+    }
+
+    enabled = true;
+    setThreadName( "main" );
+}
+
+void TraceRecorder::addEvent( const TraceEvent& event )
+{
+    TraceStorage& trace = storage();
+    std::lock_guard<std::mutex> lock( trace.mutex );
+    trace.events.push_back( event );
+}
+
+void TraceRecorder::setThreadName( const std::string& name )
+{
+    if ( !isEnabled() )
+    {
+        return;
+    }
+
+    int thread = getThreadIndex();
+
+    TraceStorage& trace = storage();
+    std::lock_guard<std::mutex> lock( trace.mutex );
+    trace.threadNames[thread] = name;
+}
+
+int TraceRecorder::getThreadIndex()
+{
+    thread_local int index = -1;
+    if ( index < 0 )
+    {
+        index = nextThreadIndex++;
+    }
+
+    return index;
+}
+
+double TraceRecorder::getMicroseconds()
+{
+    return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - storage().epoch ).count();
+}
+
+const std::string& TraceRecorder::getFileName()
+{
+    return storage().fileName;
+}
+
+bool TraceRecorder::write()
+{
+    TraceStorage& trace = storage();
+    std::lock_guard<std::mutex> lock( trace.mutex );
+
+    std::ofstream file( trace.fileName.c_str() );
+    if ( !file )
+    {
+        return false;
+    }
+
+    file << std::fixed << std::setprecision( 3 ) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    const char* separator = "\n";
+    for ( std::map<int, std::string>::const_iterator it = trace.threadNames.begin(); it != trace.threadNames.end(); ++it )
+    {
+        file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->first
+             << ",\"args\":{\"name\":" << jsonString( it->second ) << "}}";
+        separator = ",\n";
+    }
+
+    // One complete ("X") event per scope, and a memory counter sample at its end
+    for ( std::size_t i = 0; i < trace.events.size(); i++ )
+    {
+        const TraceEvent& event = trace.events[i];
+
+        file << separator << "{\"name\":" << jsonString( event.name ) << ",\"cat\":" << jsonString( event.category )
+             << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.startMicroseconds
+             << ",\"dur\":" << event.wallMicroseconds << ",\"args\":{\"thread_cpu_ms\":"
+             << event.threadCpuMicroseconds / 1.0e3 << ",\"process_cpu_ms\":" << event.processCpuMicroseconds / 1.0e3
+             << ",\"bytes\":" << event.bytes << ",\"rss_mb\":" << event.residentMB << ",\"peak_rss_mb\":"
+             << event.peakResidentMB << "}}";
+        separator = ",\n";
+
+        file << separator << "{\"name\":\"memory\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+             << event.startMicroseconds + event.wallMicroseconds << ",\"args\":{\"rss_mb\":" << event.residentMB
+             << ",\"peak_rss_mb\":" << event.peakResidentMB << "}}";
+    }
+
+    file << "\n]}\n";
+
+    return static_cast<bool>( file );
+}
+
+void TraceRecorder::printSummary( std::ostream& out )
+{
+    struct StageSummary
+    {
+        std::string name;
+        int calls;
+        std::set<int> threads;
+        double wallMicroseconds;
+        double threadCpuMicroseconds;
+        double processCpuMicroseconds;
+        double bytes;
+        double peakResidentMB;
+    };
+
+    std::vector<StageSummary> stages;
+    std::map<std::string, std::size_t> stageIndex;
+
+    {
+        TraceStorage& trace = storage();
+        std::lock_guard<std::mutex> lock( trace.mutex );
+
+        for ( std::size_t i = 0; i < trace.events.size(); i++ )
+        {
+            const TraceEvent& event = trace.events[i];
+
+            std::map<std::string, std::size_t>::iterator it = stageIndex.find( event.name );
+            if ( it == stageIndex.end() )
+            {
+                StageSummary stage = { event.name, 0, std::set<int>(), 0.0, 0.0, 0.0, 0.0, 0.0 };
+                it = stageIndex.insert( std::make_pair( event.name, stages.size() ) ).first;
+                stages.push_back( stage );
+            }
+
+            StageSummary& stage = stages[it->second];
+            stage.calls++;
+            stage.threads.insert( event.thread );
+            stage.wallMicroseconds       += event.wallMicroseconds;
+            stage.threadCpuMicroseconds  += event.threadCpuMicroseconds;
+            stage.processCpuMicroseconds += event.processCpuMicroseconds;
+            stage.bytes                  += event.bytes;
+            stage.peakResidentMB          = std::max( stage.peakResidentMB, event.peakResidentMB );
+        }
+    }
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    // Overlapping scopes (e.g. filters running at the same time) each count the whole process CPU time
+    out << "\n**Stage timings** \n";
+    out << std::left << std::setw( 22 ) << "Stage" << std::right << std::setw( 7 ) << "Calls" << std::setw( 9 )
+        << "Threads" << std::setw( 10 ) << "Wall s" << std::setw( 12 ) << "Thread CPU" << std::setw( 13 )
+        << "Process CPU" << std::setw( 11 ) << "MB" << std::setw( 10 ) << "MB/s" << std::setw( 11 ) << "Peak MB" << "\n";
+
+    out << std::fixed;
+    for ( std::size_t i = 0; i < stages.size(); i++ )
+    {
+        const StageSummary& stage = stages[i];
+        double seconds   = stage.wallMicroseconds / 1.0e6;
+        double megabytes = stage.bytes / ( 1024.0 * 1024.0 );
+
+        out << std::left << std::setw( 22 ) << stage.name.substr( 0, 21 ) << std::right << std::setw( 7 )
+            << stage.calls << std::setw( 9 ) << stage.threads.size() << std::setprecision( 3 ) << std::setw( 10 )
+            << seconds << std::setw( 12 ) << stage.threadCpuMicroseconds / 1.0e6 << std::setw( 13 )
+            << stage.processCpuMicroseconds / 1.0e6 << std::setprecision( 1 ) << std::setw( 11 ) << megabytes
+            << std::setw( 10 ) << ( seconds > 0.0 ? megabytes / seconds : 0.0 ) << std::setw( 11 )
+            << stage.peakResidentMB << "\n";
+    }
+
+    out.flags( flags );
+    out.precision( precision );
+}
+/***************************************************************************/
+
+/******************** Helper class "ScopedTimer" functions ********************/
+ScopedTimer::ScopedTimer( const char* stageName, const char* stageCategory )
+    : active( TraceRecorder::isEnabled() ), category( stageCategory ), bytes( 0.0 )
+{
+    if ( active )
+    {
+        name = stageName;
+        start();
+    }
+}
+
+ScopedTimer::ScopedTimer( const std::string& stageName, const char* stageCategory )
+    : active( TraceRecorder::isEnabled() ), category( stageCategory ), bytes( 0.0 )
+{
+    if ( active )
+    {
+        name = stageName;
+        start();
+    }
+}
+
+void ScopedTimer::start()
+{
+    startMicroseconds      = TraceRecorder::getMicroseconds();
+    threadCpuMicroseconds  = getThreadCpuMicroseconds();
+    processCpuMicroseconds = getProcessCpuMicroseconds();
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if ( !active )
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.name                   = name;
+    event.category               = category;
+    event.thread                 = TraceRecorder::getThreadIndex();
+    event.startMicroseconds      = startMicroseconds;
+    event.wallMicroseconds       = TraceRecorder::getMicroseconds() - startMicroseconds;
+    event.threadCpuMicroseconds  = getThreadCpuMicroseconds() - threadCpuMicroseconds;
+    event.processCpuMicroseconds = getProcessCpuMicroseconds() - processCpuMicroseconds;
+    event.bytes                  = bytes;
+    event.residentMB             = getResidentMemoryMB();
+    event.peakResidentMB         = getPeakResidentMemoryMB();
+
+    TraceRecorder::addEvent( event );
+}
+/***************************************************************************/
+
+/******************** Helper class "TraceSession" functions ********************/
+TraceSession::TraceSession( const std::string& fileName )
+{
+    if ( !fileName.empty() )
+    {
+        TraceRecorder::enable( fileName );
+    }
+}
+
+TraceSession::~TraceSession()
+{
+    if ( !TraceRecorder::isEnabled() )
+    {
+        return;
+    }
+
+    TraceRecorder::printSummary( std::cerr );
+
+    if ( TraceRecorder::write() )
+    {
+        std::cerr << "Saved the trace to " << TraceRecorder::getFileName() << " (chrome://tracing or ui.perfetto.dev) \n";
+    }
+    else
+    {
+        std::cerr << "ERROR: Cannot write the trace to " << TraceRecorder::getFileName() << " \n";
+    }
+}
+/***************************************************************************/
@@ -0,0 +1,149 @@
+/****************************************************************************
+*   stageTrace.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the scoped stage timers and the trace
+*                   recorder (Chrome trace JSON and summary table).
+****************************************************************************/
+
+#ifndef STAGETRACE_H
+#define STAGETRACE_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+/*
+*   One timed scope of a stage.
+*/
+struct TraceEvent
+{
+    std::string name;
+    std::string category;
+    int thread;                     // Small index of the thread (0 = the thread that enabled tracing)
+    double startMicroseconds;       // Since the trace was enabled
+    double wallMicroseconds;
+    double threadCpuMicroseconds;   // CPU time of the thread of the scope
+    double processCpuMicroseconds;  // CPU time of the whole process, including the workers of the stage
+    double bytes;                   // Bytes read and written, as reported by the scope
+    double residentMB;              // Resident memory at the end of the scope
+    double peakResidentMB;          // Peak resident memory of the process at the end of the scope
+};
+
+/*
+*   Collects the events of the ScopedTimers while tracing is enabled, and
+*   writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev) and a
+*   summary table per stage.
+*
+*   Tracing is off until enable() is called. A disabled ScopedTimer only
+*   reads one atomic flag, so the timers can stay in the code.
+*/
+class TraceRecorder
+{
+    public:
+        /*
+        *   Start recording. The calling thread becomes thread 0 ("main").
+        *
+        *   @param   fileName   Chrome trace JSON written by write()
+        */
+        static void enable( const std::string& fileName );
+
+        static bool isEnabled() { return enabled.load( std::memory_order_acquire ); }
+
+        /*
+        *   Record a finished scope (thread-safe).
+        */
+        static void addEvent( const TraceEvent& event );
+
+        /*
+        *   Name the calling thread in the trace (e.g. "batch worker").
+        */
+        static void setThreadName( const std::string& name );
+
+        /*
+        *   @returns the index of the calling thread, assigned on its first call
+        */
+        static int getThreadIndex();
+
+        /*
+        *   @returns the microseconds since enable()
+        */
+        static double getMicroseconds();
+
+        /*
+        *   Write the events to the file given to enable().
+        *
+        *   @returns a boolean representing whether the file was written
+        */
+        static bool write();
+
+        /*
+        *   Print the calls, threads, wall and CPU time, bytes, throughput and
+        *   peak memory of each stage, in the order the stages first finished.
+        *
+        *   @param   out   The stream to print to
+        */
+        static void printSummary( std::ostream& out );
+
+        static const std::string& getFileName();
+
+    private:
+        static std::atomic<bool> enabled;
+};
+
+/*
+*   Times a scope: wall time, CPU time of the thread and of the process,
+*   bytes touched and the resident memory at its end.
+*
+*   ScopedTimer timer( "median", "filter" );
+*   ...
+*   timer.addBytes( inputBytes + outputBytes );
+*/
+class ScopedTimer
+{
+    public:
+        ScopedTimer( const char* name, const char* category );
+        ScopedTimer( const std::string& name, const char* category );
+        ~ScopedTimer();
+
+        /*
+        *   Add to the bytes read and written by the scope.
+        */
+        void addBytes( double count ) { bytes += count; }
+
+        bool isActive() const { return active; }
+
+    private:
+        ScopedTimer( const ScopedTimer& ) = delete;
+        void operator=( const ScopedTimer& ) = delete;
+
+        void start();
+
+        bool active;
+        std::string name;
+        const char* category;
+        double startMicroseconds;
+        double threadCpuMicroseconds;
+        double processCpuMicroseconds;
+        double bytes;
+};
+
+/*
+*   Enables tracing for its lifetime when given a file name, then writes the
+*   trace and prints the summary (at every return of main()). The summary goes
+*   to the standard error, so it never mixes with batch results on the
+*   standard output.
+*/
+class TraceSession
+{
+    public:
+        TraceSession( const std::string& fileName );
+        ~TraceSession();
+
+    private:
+        TraceSession( const TraceSession& ) = delete;
+        void operator=( const TraceSession& ) = delete;
+};
+
+#endif // STAGETRACE_H
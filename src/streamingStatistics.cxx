@@ -0,0 +1,164 @@
+/****************************************************************************
+*   streamingStatistics.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the slab-streaming SNR calculation.
+****************************************************************************/
+
+#include "streamingStatistics.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+/*
+*   The extent a filter requests from its input to produce an extent of its
+*   output (the output extent plus the kernel padding of the filter).
+*
+*   @returns a boolean representing whether the filter has an input
+*/
+static bool getRequestedInputExtent( vtkAlgorithm* filter, const int outputExtent[6], int inputExtent[6] )
+{
+    vtkStreamingDemandDrivenPipeline* executive =
+        vtkStreamingDemandDrivenPipeline::SafeDownCast( filter->GetExecutive() );
+
+    if ( !executive || filter->GetNumberOfInputConnections( 0 ) == 0 )
+    {
+        return false;
+    }
+
+    filter->GetOutputInformation( 0 )->Set( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outputExtent, 6 );
+    executive->PropagateUpdateExtent( 0 );
+    filter->GetInputInformation( 0, 0 )->Get( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), inputExtent );
+
+    return true;
+}
+
+StreamingStatistics::StreamingStatistics()
+    : lowerThreshold( 0.0 ), upperThreshold( 0.0 ), useExtent( false ), slabSize( 16 )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = 0;
+    }
+}
+
+void StreamingStatistics::addSource( vtkAlgorithm* source )
+{
+    sources.push_back( source );
+}
+
+void StreamingStatistics::setThresholds( double lower, double upper )
+{
+    lowerThreshold = lower;
+    upperThreshold = upper;
+}
+
+void StreamingStatistics::setExtent( const int newExtent[6] )
+{
+    for ( int i = 0; i < 6; i++ )
+    {
+        extent[i] = newExtent[i];
+    }
+    useExtent = true;
+}
+
+void StreamingStatistics::setSlabSize( int slices )
+{
+    slabSize = std::max( 1, slices );
+}
+
+std::vector<SNRPartial> StreamingStatistics::run()
+{
+    std::vector<SNRPartial> results( sources.size() );
+
+    if ( sources.empty() )
+    {
+        return results;
+    }
+
+    // All sources share the same input, so the whole extent of the first one is used for all
+    for ( std::size_t i = 0; i < sources.size(); i++ )
+    {
+        sources[i]->UpdateInformation();
+    }
+
+    int wholeExtent[6];
+    sources[0]->GetOutputInformation( 0 )->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent );
+
+    if ( useExtent )
+    {
+        for ( int i = 0; i < 6; i += 2 )
+        {
+            wholeExtent[i]     = std::max( wholeExtent[i], extent[i] );
+            wholeExtent[i + 1] = std::min( wholeExtent[i + 1], extent[i + 1] );
+        }
+    }
+
+    SNRStatistics statistics;
+    statistics.setThresholds( lowerThreshold, upperThreshold );
+    statistics.setSlabSize( slabSize );
+
+    for ( int zStart = wholeExtent[4]; zStart <= wholeExtent[5]; zStart += slabSize )
+    {
+        int slabExtent[6] = { wholeExtent[0], wholeExtent[1],
+                              wholeExtent[2], wholeExtent[3],
+                              zStart, std::min( zStart + slabSize - 1, wholeExtent[5] ) };
+
+        statistics.setExtent( slabExtent );
+        ScopedTimer timer( "stream slab", "statistics" );
+
+        // Each filter pads the slab by its own kernel size. A shared input (the reader) is updated once with
+        // the union of the padded requests, so the requests of the filters and of the reader itself fall
+        // inside the data it already holds and it reads every slab once, not once per consumer.
+        std::vector<vtkAlgorithm*> inputs;
+        std::vector< std::vector<int> > inputExtents;
+
+        for ( std::size_t i = 0; i < sources.size(); i++ )
+        {
+            int requested[6];
+            if ( !getRequestedInputExtent( sources[i], slabExtent, requested ) )
+            {
+                continue;
+            }
+
+            vtkAlgorithm* input = sources[i]->GetInputAlgorithm( 0, 0 );
+            std::size_t j = std::find( inputs.begin(), inputs.end(), input ) - inputs.begin();
+            if ( j == inputs.size() )
+            {
+                inputs.push_back( input );
+                inputExtents.push_back( std::vector<int>( slabExtent, slabExtent + 6 ) );
+            }
+
+            for ( int k = 0; k < 6; k += 2 )
+            {
+                inputExtents[j][k]     = std::min( inputExtents[j][k], requested[k] );
+                inputExtents[j][k + 1] = std::max( inputExtents[j][k + 1], requested[k + 1] );
+            }
+        }
+
+        for ( std::size_t j = 0; j < inputs.size(); j++ )
+        {
+            inputs[j]->UpdateExtent( inputExtents[j].data() );
+        }
+
+        for ( std::size_t i = 0; i < sources.size(); i++ )
+        {
+            // Request only this slab. The filters pad the request to their kernel size themselves.
+            sources[i]->UpdateExtent( slabExtent );
+
+            vtkImageData* slab = vtkImageData::SafeDownCast( sources[i]->GetOutputDataObject( 0 ) );
+            if ( slab )
+            {
+                results[i].merge( statistics.compute( slab ) );
+                timer.addBytes( slab->GetActualMemorySize() * 1024.0 );
+            }
+        }
+    }
+
+    return results;
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+*   streamingStatistics.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the slab-streaming SNR calculation.
+****************************************************************************/
+
+#ifndef STREAMINGSTATISTICS_H
+#define STREAMINGSTATISTICS_H
+
+#include "snrStatistics.hxx"
+
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkAlgorithm.h>
+
+/*
+*   Streams one or more image pipelines over Z-slabs and feeds each slab to
+*   an SNRStatistics accumulator.
+*
+*   Each source is updated with vtkStreamingDemandDrivenPipeline update extents
+*   of at most slabSize slices, so the filters only hold one slab (plus the
+*   kernel padding they request from their input) at a time. Peak memory is
+*   bounded by the slab size instead of the volume size.
+*
+*   Sources that read the same input (the filters of one reader) share it: the
+*   input is updated once per slab with the union of the padded extents they
+*   request, so each slab is read and decoded once.
+*/
+class StreamingStatistics
+{
+    public:
+        StreamingStatistics();
+
+        /*
+        *   Add an algorithm whose first output port is an image to stream.
+        *
+        *   @param   source   The algorithm (reader or filter)
+        */
+        void addSource( vtkAlgorithm* source );
+
+        /*
+        *   Set the foreground threshold range.
+        *
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        */
+        void setThresholds( double lower, double upper );
+
+        /*
+        *   Restrict the calculation to a sub-extent of the input.
+        *   By default the whole extent is used.
+        *
+        *   @param   extent   The extent (xMin, xMax, yMin, yMax, zMin, zMax)
+        */
+        void setExtent( const int extent[6] );
+
+        /*
+        *   Set the number of Z slices requested per update.
+        *
+        *   @param   slices   Number of slices per slab (>= 1)
+        */
+        void setSlabSize( int slices );
+
+        /*
+        *   Run all sources slab by slab.
+        *
+        *   @returns one result per source, in the order they were added
+        */
+        std::vector<SNRPartial> run();
+
+    private:
+        std::vector< vtkSmartPointer<vtkAlgorithm> > sources;
+        double lowerThreshold;
+        double upperThreshold;
+        int extent[6];
+        bool useExtent;
+        int slabSize;
+};
+
+#endif // STREAMINGSTATISTICS_H
@@ -0,0 +1,583 @@
+/****************************************************************************
+*   studyServer.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the local server that answers SNR and
+*                   segmentation queries from studies kept in memory.
+****************************************************************************/
+
+#include "studyServer.hxx"
+#include "metricsCore.hxx"
+#include "bitMask.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <vtksys/SystemTools.hxx>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Longest request line, a client that sends more without a newline is disconnected
+static const std::size_t maximumRequestLength = 64 * 1024;
+
+StudyServer::StudyServer( const ProgramOptions& programOptions )
+    : options( programOptions ), cache( programOptions ), cachedBytes( 0.0 ), hits( 0 ), misses( 0 ),
+      stopping( false ), requests( 0 ), queueMillisecondsTotal( 0.0 ), queueMillisecondsMax( 0.0 ),
+      runMillisecondsTotal( 0.0 )
+{
+    imageNames.push_back( "original" );
+    for ( std::size_t i = 0; i < options.filters.size(); i++ )
+    {
+        imageNames.push_back( options.filters[i].id );
+    }
+
+    int cores       = options.threads > 0 ? options.threads : std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+    workers         = options.workers > 0 ? options.workers : 4;
+    threadsPerStudy = std::max( 1, cores / workers );
+    budgetBytes     = options.serveCacheMB * 1024.0 * 1024.0;
+
+    wakePipe[0] = -1;
+    wakePipe[1] = -1;
+}
+
+StudyServer::~StudyServer()
+{
+#ifndef _WIN32
+    for ( int i = 0; i < 2; i++ )
+    {
+        if ( wakePipe[i] >= 0 )
+        {
+            close( wakePipe[i] );
+        }
+    }
+#endif
+}
+
+int StudyServer::run( const std::string& socketPath )
+{
+#ifdef _WIN32
+    std::cout << "ERROR: --serve needs Unix domain sockets, which this build does not support. \n";
+    return EXIT_FAILURE;
+#else
+    sockaddr_un address;
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+
+    if ( socketPath.empty() || socketPath.size() >= sizeof( address.sun_path ) )
+    {
+        std::cout << "ERROR: The socket path must have 1 to " << sizeof( address.sun_path ) - 1 << " characters. \n";
+        return EXIT_FAILURE;
+    }
+    std::strncpy( address.sun_path, socketPath.c_str(), sizeof( address.sun_path ) - 1 );
+
+    // A socket left by a server that stopped is replaced, one that still answers or any other file is not
+    struct stat status;
+    if ( lstat( socketPath.c_str(), &status ) == 0 )
+    {
+        int probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+        bool running = probe >= 0 && connect( probe, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) == 0;
+        if ( probe >= 0 )
+        {
+            close( probe );
+        }
+
+        if ( !S_ISSOCK( status.st_mode ) || running )
+        {
+            std::cout << "ERROR: " << socketPath << ( running ? " is used by a running server. \n" : " exists and is not a socket. \n" );
+            return EXIT_FAILURE;
+        }
+        unlink( socketPath.c_str() );
+    }
+
+    int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+    // Only the user can connect
+    mode_t previousMask = umask( 0177 );
+    bool bound = listener >= 0 && bind( listener, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) == 0;
+    umask( previousMask );
+
+    if ( !bound || listen( listener, 64 ) != 0 || pipe( wakePipe ) != 0 )
+    {
+        std::cout << "ERROR: Cannot listen on " << socketPath << ": " << std::strerror( errno ) << " \n";
+        if ( listener >= 0 )
+        {
+            close( listener );
+        }
+        return EXIT_FAILURE;
+    }
+
+    // A client that disconnects before its answer must not stop the server
+    signal( SIGPIPE, SIG_IGN );
+
+    std::cout << "Serving on " << socketPath << " with " << workers << " worker(s) and " << options.serveCacheMB
+              << " MB for studies. Send \"shutdown\" to stop. \n";
+
+    for ( int i = 0; i < workers; i++ )
+    {
+        threads.push_back( std::thread( &StudyServer::workerLoop, this ) );
+    }
+
+    std::vector<pollfd> descriptors;
+    std::vector<char> received( 4096 );
+
+    for ( ;; )
+    {
+        descriptors.clear();
+
+        {
+            std::lock_guard<std::mutex> lock( queueMutex );
+            if ( stopping )
+            {
+                break;
+            }
+
+            pollfd entry = { listener, POLLIN, 0 };
+            descriptors.push_back( entry );
+            entry.fd = wakePipe[0];
+            descriptors.push_back( entry );
+
+            for ( std::map<int, Client>::iterator it = clients.begin(); it != clients.end(); ++it )
+            {
+                Client& client = it->second;
+                if ( client.busy )
+                {
+                    continue;
+                }
+
+                // One request per client at a time keeps the answers of a connection in order
+                std::size_t end;
+                while ( !client.busy && ( end = client.buffer.find( '\n' ) ) != std::string::npos )
+                {
+                    Request request;
+                    request.client   = it->first;
+                    request.line     = client.buffer.substr( 0, end );
+                    request.received = Clock::now();
+                    client.buffer.erase( 0, end + 1 );
+
+                    request.line.erase( request.line.find_last_not_of( " \t\r" ) + 1 );
+                    if ( !request.line.empty() )
+                    {
+                        client.busy = true;
+                        queue.push_back( request );
+                        queueChanged.notify_one();
+                    }
+                }
+
+                if ( client.busy )
+                {
+                    continue;
+                }
+
+                entry.fd = it->first;
+                descriptors.push_back( entry );
+            }
+        }
+
+        if ( poll( descriptors.data(), descriptors.size(), -1 ) < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            std::cout << "ERROR: poll() failed: " << std::strerror( errno ) << " \n";
+            break;
+        }
+
+        if ( descriptors[1].revents )
+        {
+            ssize_t drained = read( wakePipe[0], received.data(), received.size() );
+            (void)drained;
+        }
+
+        std::lock_guard<std::mutex> lock( queueMutex );
+
+        if ( descriptors[0].revents & POLLIN )
+        {
+            int client = accept( listener, nullptr, nullptr );
+            if ( client >= 0 )
+            {
+                clients[client].busy = false;
+            }
+        }
+
+        // Only idle clients were polled, so none of them is used by a worker
+        for ( std::size_t i = 2; i < descriptors.size(); i++ )
+        {
+            if ( !descriptors[i].revents )
+            {
+                continue;
+            }
+
+            int fd = descriptors[i].fd;
+            ssize_t count = recv( fd, received.data(), received.size(), 0 );
+
+            if ( count <= 0 || clients[fd].buffer.size() > maximumRequestLength )
+            {
+                close( fd );
+                clients.erase( fd );
+                continue;
+            }
+
+            clients[fd].buffer.append( received.data(), static_cast<std::size_t>( count ) );
+        }
+    }
+
+    // The queued requests are still answered
+    {
+        std::lock_guard<std::mutex> lock( queueMutex );
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    for ( std::size_t i = 0; i < threads.size(); i++ )
+    {
+        threads[i].join();
+    }
+    threads.clear();
+
+    for ( std::map<int, Client>::iterator it = clients.begin(); it != clients.end(); ++it )
+    {
+        close( it->first );
+    }
+    clients.clear();
+    close( listener );
+    unlink( socketPath.c_str() );
+
+    std::cout << "Server stopped after " << requests << " request(s). \n";
+
+    return EXIT_SUCCESS;
+#endif
+}
+
+std::shared_ptr<StudyServer::Study> StudyServer::getStudy( const std::string& path, bool& hit, std::string& error )
+{
+    std::string input      = vtksys::SystemTools::CollapseFullPath( path );
+    long long modifiedTime = static_cast<long long>( vtksys::SystemTools::ModifiedTime( input ) );
+
+    std::unique_lock<std::mutex> lock( studyMutex );
+
+    // A study another worker is loading is waited for, not loaded twice
+    std::map< std::string, std::shared_ptr<Study> >::iterator it;
+    studyLoaded.wait( lock, [this, &it, &input]()
+    {
+        it = studies.find( input );
+        return it == studies.end() || !it->second->loading;
+    } );
+
+    if ( it != studies.end() && it->second->modifiedTime == modifiedTime )
+    {
+        recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second->position );
+        hits++;
+        hit = true;
+        return it->second;
+    }
+
+    // The input changed since it was loaded
+    if ( it != studies.end() )
+    {
+        cachedBytes -= it->second->bytes;
+        recentlyUsed.erase( it->second->position );
+        studies.erase( it );
+    }
+
+    misses++;
+    hit = false;
+
+    std::shared_ptr<Study> study = std::make_shared<Study>();
+    study->input        = input;
+    study->modifiedTime = modifiedTime;
+    study->bytes        = 0.0;
+    study->loading      = true;
+    recentlyUsed.push_front( input );
+    study->position = recentlyUsed.begin();
+    studies[input]  = study;
+
+    lock.unlock();
+    bool loaded = loadStudy( *study, error );
+    lock.lock();
+
+    study->loading = false;
+    if ( loaded )
+    {
+        cachedBytes += study->bytes;
+        evict( input );
+    }
+    else
+    {
+        recentlyUsed.erase( study->position );
+        studies.erase( input );
+    }
+
+    lock.unlock();
+    studyLoaded.notify_all();
+
+    return loaded ? study : std::shared_ptr<Study>();
+}
+
+bool StudyServer::loadStudy( Study& study, std::string& error ) const
+{
+    ScopedTimer timer( "serve load", "server" );
+
+    std::vector< vtkSmartPointer<vtkImageData> > images;
+
+    if ( !cache.load( study.input, images ) )
+    {
+        MetricsCore core;
+        core.setNumberOfThreads( threadsPerStudy );
+        core.setMemoryBudgetMB( options.memoryBudgetMB );
+        core.setFilters( options.filters );
+
+        if ( !core.load( study.input ) || !core.filter() )
+        {
+            error = core.getError();
+            return false;
+        }
+
+        images = core.getFilteredImages();
+        images.insert( images.begin(), core.getInput() );
+        cache.store( study.input, images );
+    }
+
+    // Every threshold pair is answered from the histograms
+    study.histograms.assign( images.size(), IntensityHistogram() );
+
+    for ( std::size_t i = 0; i < images.size(); i++ )
+    {
+        if ( !images[i] || images[i]->GetNumberOfPoints() == 0 )
+        {
+            error = "the " + imageNames[i] + " image is empty";
+            return false;
+        }
+
+        if ( !study.histograms[i].build( images[i] ) )
+        {
+            error = "unsupported scalar type in the " + imageNames[i] + " image";
+            return false;
+        }
+
+        study.bytes += images[i]->GetActualMemorySize() * 1024.0 +
+                       static_cast<double>( study.histograms[i].getNumberOfBins() ) * sizeof( SNRAccumulator );
+    }
+
+    study.images = images;
+
+    return true;
+}
+
+void StudyServer::evict( const std::string& keep )
+{
+    // Least recently used first. Studies still used by a request stay alive until it is answered.
+    // The study just loaded is kept even if it alone is over the budget, so the next query of
+    // it is still a hit; it goes as soon as another study is loaded.
+    std::list<std::string>::iterator it = recentlyUsed.end();
+
+    while ( cachedBytes > budgetBytes && it != recentlyUsed.begin() )
+    {
+        --it;
+
+        std::map< std::string, std::shared_ptr<Study> >::iterator study = studies.find( *it );
+        if ( study->second->loading || *it == keep )
+        {
+            continue;
+        }
+
+        cachedBytes -= study->second->bytes;
+        studies.erase( study );
+        it = recentlyUsed.erase( it );
+    }
+}
+
+std::string StudyServer::answer( const Request& request, bool& stop )
+{
+    std::istringstream fields( request.line );
+    std::string command;
+    fields >> command;
+
+    if ( command == "stats" )
+    {
+        return answerStatistics();
+    }
+
+    if ( command == "shutdown" )
+    {
+        stop = true;
+        return "{ \"status\": \"ok\"";
+    }
+
+    double lower = 0.0, upper = 0.0;
+    std::string input;
+
+    if ( ( command != "snr" && command != "segment" ) || !( fields >> lower >> upper ) ||
+         !std::getline( fields >> std::ws, input ) || input.empty() )
+    {
+        return "{ \"status\": \"error\", \"error\": " +
+               jsonString( "expected \"snr|segment <lower> <upper> <study>\", \"stats\" or \"shutdown\"" );
+    }
+
+    bool hit = false;
+    std::string error;
+    std::shared_ptr<Study> study = getStudy( input, hit, error );
+
+    if ( !study )
+    {
+        return "{ \"status\": \"error\", \"study\": " + jsonString( input ) + ", \"error\": " + jsonString( error );
+    }
+
+    std::ostringstream response;
+    response << "{ \"status\": \"ok\", \"study\": " << jsonString( study->input )
+             << ", \"cache\": \"" << ( hit ? "hit" : "miss" ) << "\""
+             << ", \"lower_threshold\": " << jsonNumber( lower ) << ", \"upper_threshold\": " << jsonNumber( upper );
+
+    for ( std::size_t i = 0; i < study->images.size(); i++ )
+    {
+        response << ", \"" << imageNames[i] << "\": { ";
+
+        if ( command == "snr" )
+        {
+            double used[2];
+            SNRPartial image = study->histograms[i].query( lower, upper, used );
+
+            response << "\"mean_background\": " << jsonNumber( image.background.mean )
+                     << ", \"mean_foreground\": " << jsonNumber( image.foreground.mean )
+                     << ", \"std_background\": " << jsonNumber( image.background.getStandardDeviation() )
+                     << ", \"snr\": " << jsonNumber( image.getSNR() )
+                     << ", \"lower_used\": " << jsonNumber( used[0] ) << ", \"upper_used\": " << jsonNumber( used[1] );
+        }
+        else
+        {
+            // The exact inclusive threshold of the viewer, not the binned histogram
+            BitMask mask;
+            mask.setGeometry( study->images[i] );
+            mask.threshold( study->images[i], lower, upper );
+
+            response << "\"voxels\": " << mask.count() << ", \"volume\": " << jsonNumber( mask.getVolume() );
+        }
+
+        response << " }";
+    }
+
+    return response.str();
+}
+
+std::string StudyServer::answerStatistics()
+{
+    std::ostringstream response;
+    response << std::setprecision( 6 ) << "{ \"status\": \"ok\"";
+
+    {
+        std::lock_guard<std::mutex> lock( studyMutex );
+        long long queries = hits + misses;
+
+        response << ", \"studies\": " << studies.size()
+                 << ", \"cache_mb\": " << jsonNumber( cachedBytes / ( 1024.0 * 1024.0 ) )
+                 << ", \"budget_mb\": " << jsonNumber( options.serveCacheMB )
+                 << ", \"hits\": " << hits << ", \"misses\": " << misses
+                 << ", \"hit_rate\": " << jsonNumber( queries > 0 ? static_cast<double>( hits ) / queries : 0.0 );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( queueMutex );
+
+        response << ", \"workers\": " << workers << ", \"queued\": " << queue.size() << ", \"requests\": " << requests
+                 << ", \"queue_ms_mean\": " << jsonNumber( requests > 0 ? queueMillisecondsTotal / requests : 0.0 )
+                 << ", \"queue_ms_max\": " << jsonNumber( queueMillisecondsMax )
+                 << ", \"run_ms_mean\": " << jsonNumber( requests > 0 ? runMillisecondsTotal / requests : 0.0 );
+    }
+
+    return response.str();
+}
+
+void StudyServer::workerLoop()
+{
+#ifndef _WIN32
+    TraceRecorder::setThreadName( "server worker" );
+
+    for ( ;; )
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock( queueMutex );
+            queueChanged.wait( lock, [this]() { return stopping || !queue.empty(); } );
+
+            if ( queue.empty() )
+            {
+                return;
+            }
+
+            request = queue.front();
+            queue.pop_front();
+        }
+
+        Clock::time_point start = Clock::now();
+        double queueMilliseconds = std::chrono::duration<double, std::milli>( start - request.received ).count();
+
+        bool stop = false;
+        std::string response;
+
+        try
+        {
+            ScopedTimer timer( "serve request", "server" );
+            response = answer( request, stop );
+        }
+        catch ( const std::exception& exception )
+        {
+            response = "{ \"status\": \"error\", \"error\": " + jsonString( exception.what() );
+        }
+
+        double runMilliseconds = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+
+        // Every answer is one line: the fields of the request, then its latencies
+        std::ostringstream timing;
+        timing << std::fixed << std::setprecision( 3 ) << ", \"queue_ms\": " << queueMilliseconds
+               << ", \"run_ms\": " << runMilliseconds << " }\n";
+        response += timing.str();
+
+        // A client that went away is closed by the poll() loop
+        for ( std::size_t sent = 0; sent < response.size(); )
+        {
+            ssize_t count = send( request.client, response.data() + sent, response.size() - sent, 0 );
+            if ( count <= 0 && errno != EINTR )
+            {
+                break;
+            }
+            sent += count > 0 ? static_cast<std::size_t>( count ) : 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( queueMutex );
+
+            requests++;
+            queueMillisecondsTotal += queueMilliseconds;
+            queueMillisecondsMax    = std::max( queueMillisecondsMax, queueMilliseconds );
+            runMillisecondsTotal   += runMilliseconds;
+
+            clients[request.client].busy = false;
+            stopping = stopping || stop;
+        }
+        wake();
+    }
+#endif
+}
+
+void StudyServer::wake()
+{
+#ifndef _WIN32
+    char byte = 1;
+    ssize_t written = write( wakePipe[1], &byte, 1 );
+    (void)written;
+#endif
+}
@@ -0,0 +1,140 @@
+/****************************************************************************
+*   studyServer.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the local server that answers SNR and
+*                   segmentation queries from studies kept in memory.
+****************************************************************************/
+
+#ifndef STUDYSERVER_H
+#define STUDYSERVER_H
+
+#include "helperFunctions.hxx"
+#include "intensityHistogram.hxx"
+#include "volumeCache.hxx"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   A long-running service on a Unix domain socket (--serve) for scripts that
+*   query the same studies again and again.
+*
+*   Each request is one line and gets one JSON line back:
+*
+*       snr <lower> <upper> <study>        SNR of the original and every filtered image
+*       segment <lower> <upper> <study>    Voxels and volume inside [lower, upper] of every image
+*       stats                              Cache hit rate, memory and request latencies
+*       shutdown                           Answer, then stop the server
+*
+*   The first query of a study loads it (from the volume cache when possible),
+*   applies the filters of the server and builds an intensity histogram of
+*   every image. The images and histograms stay in memory, least recently used
+*   studies first out when the budget is exceeded (the most recently loaded
+*   study is always kept, even if it alone is larger), so later queries of any
+*   thresholds are answered from the histograms (as in --sweep) in milliseconds.
+*   A study whose input was modified is loaded again.
+*
+*   Requests are answered by a pool of worker threads. The requests of one
+*   connection are answered in order; different connections are answered at
+*   the same time. Each response reports how long the request waited in the
+*   queue and how long it ran.
+*/
+class StudyServer
+{
+    public:
+        StudyServer( const ProgramOptions& options );
+        ~StudyServer();
+
+        /*
+        *   Serve until a shutdown request.
+        *
+        *   @param   socketPath   Path of the Unix domain socket (only the user can connect)
+        *
+        *   @returns EXIT_SUCCESS after a shutdown, EXIT_FAILURE if the socket cannot be created
+        */
+        int run( const std::string& socketPath );
+
+    private:
+        StudyServer( const StudyServer& ) = delete;
+        void operator=( const StudyServer& ) = delete;
+
+        typedef std::chrono::steady_clock Clock;
+
+        struct Study
+        {
+            std::string input;
+            long long modifiedTime;
+            std::vector< vtkSmartPointer<vtkImageData> > images;   // Original, then the filters
+            std::vector<IntensityHistogram> histograms;
+            double bytes;
+            bool loading;
+            std::list<std::string>::iterator position;
+        };
+
+        struct Request
+        {
+            int client;
+            std::string line;
+            Clock::time_point received;
+        };
+
+        struct Client
+        {
+            std::string buffer;         // Received text that is not yet a request
+            bool busy;                  // A request of this client is queued or running
+        };
+
+        std::shared_ptr<Study> getStudy( const std::string& input, bool& hit, std::string& error );
+        bool loadStudy( Study& study, std::string& error ) const;
+        void evict( const std::string& keep );
+
+        std::string answer( const Request& request, bool& stop );
+        std::string answerStatistics();
+        void workerLoop();
+        void wake();
+
+        ProgramOptions options;
+        VolumeCache cache;
+        std::vector<std::string> imageNames;        // "original", then the filter ids
+        int workers;
+        int threadsPerStudy;
+        double budgetBytes;
+
+        // Studies, guarded by studyMutex
+        std::mutex studyMutex;
+        std::condition_variable studyLoaded;
+        std::map< std::string, std::shared_ptr<Study> > studies;
+        std::list<std::string> recentlyUsed;        // Most recently used first
+        double cachedBytes;
+        long long hits;
+        long long misses;
+
+        // Clients, queue and latency counters, guarded by queueMutex
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::map<int, Client> clients;
+        std::deque<Request> queue;
+        bool stopping;
+        long long requests;
+        double queueMillisecondsTotal;
+        double queueMillisecondsMax;
+        double runMillisecondsTotal;
+
+        int wakePipe[2];                            // Wakes the poll() loop when a client is ready again
+        std::vector<std::thread> threads;
+};
+
+#endif // STUDYSERVER_H
@@ -0,0 +1,330 @@
+/****************************************************************************
+*   surfaceExtractor.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the parallel surface extraction and
+*                   decimation of the segmentation.
+****************************************************************************/
+
+#include "surfaceExtractor.hxx"
+#include "memoryUsage.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <iomanip>
+
+#include <vtkExtractVOI.h>
+#include <vtkImageThreshold.h>
+#include <vtkFlyingEdges3D.h>
+#include <vtkDecimatePro.h>
+#include <vtkAppendPolyData.h>
+#include <vtkCleanPolyData.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkSTLWriter.h>
+#include <vtkSTLReader.h>
+#include <vtkOBJReader.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkErrorCode.h>
+#include <vtkSMPTools.h>
+
+/*
+*   Run work( slab ) for every slab on the vtkSMPTools pool. The vtkSMPTools
+*   loops of the filters inside a slab (vtkFlyingEdges3D) are nested in this
+*   one, so they run on the thread of the slab (or share the pool with TBB)
+*   instead of starting a pool of their own per slab.
+*/
+static void forEachSlab( int slabs, const std::function<void( int )>& work )
+{
+    vtkSMPTools::For( 0, slabs, 1, [&work]( vtkIdType begin, vtkIdType end )
+    {
+        for ( vtkIdType slab = begin; slab < end; slab++ )
+        {
+            work( static_cast<int>( slab ) );
+        }
+    } );
+}
+
+static double secondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+SurfaceExtractor::SurfaceExtractor()
+    : lowerThreshold( 0.0 ), upperThreshold( 0.0 ), triangleBudget( 0 ), slabCount( 0 )
+{
+}
+
+void SurfaceExtractor::setThresholds( double lower, double upper )
+{
+    lowerThreshold = lower;
+    upperThreshold = upper;
+}
+
+void SurfaceExtractor::setTriangleBudget( vtkIdType triangles )
+{
+    triangleBudget = std::max<vtkIdType>( 0, triangles );
+}
+
+void SurfaceExtractor::setSlabs( int slabs )
+{
+    slabCount = std::max( 0, slabs );
+}
+
+vtkSmartPointer<vtkPolyData> SurfaceExtractor::extract( vtkImageData* image )
+{
+    stages.clear();
+    ScopedTimer timer( "surface", "surface" );
+
+    int extent[6];
+    image->GetExtent( extent );
+
+    // At least 8 layers of cells per slab, so the shared boundary slices stay a small part of the work
+    int threads = slabCount > 0 ? slabCount : std::max( 1, vtkSMPTools::GetEstimatedNumberOfThreads() );
+    int layers  = extent[5] - extent[4];
+    int slabs   = std::max( 1, std::min( threads, layers / 8 ) );
+
+    // The pipelines of the threads must not share a data object
+    std::vector< vtkSmartPointer<vtkImageData> > inputs( slabs );
+    for ( int slab = 0; slab < slabs; slab++ )
+    {
+        inputs[slab] = vtkSmartPointer<vtkImageData>::New();
+        inputs[slab]->ShallowCopy( image );
+    }
+
+    std::vector< vtkSmartPointer<vtkPolyData> > surfaces( slabs );
+
+    /****************************** Extract ********************************/
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    forEachSlab( slabs, [&]( int slab )
+    {
+        ScopedTimer slabTimer( "surface slab", "surface" );
+
+        // Slab i holds the cells between its first and last slice. The last slice is the first of the next slab.
+        int zMin = extent[4] + static_cast<int>( static_cast<long long>( layers ) * slab / slabs );
+        int zMax = extent[4] + static_cast<int>( static_cast<long long>( layers ) * ( slab + 1 ) / slabs );
+
+        vtkSmartPointer<vtkExtractVOI> voi = vtkSmartPointer<vtkExtractVOI>::New();
+        voi->SetInputData( inputs[slab] );
+        voi->SetVOI( extent[0], extent[1], extent[2], extent[3], zMin, zMax );
+
+        vtkSmartPointer<vtkImageThreshold> threshold = vtkSmartPointer<vtkImageThreshold>::New();
+        threshold->SetInputConnection( voi->GetOutputPort() );
+        threshold->ThresholdBetween( lowerThreshold, upperThreshold );
+        threshold->ReplaceInOn();
+        threshold->SetInValue( 1 );
+        threshold->ReplaceOutOn();
+        threshold->SetOutValue( 0 );
+        threshold->SetOutputScalarTypeToUnsignedChar();
+        threshold->SetNumberOfThreads( 1 );
+
+        vtkSmartPointer<vtkFlyingEdges3D> edges = vtkSmartPointer<vtkFlyingEdges3D>::New();
+        edges->SetInputConnection( threshold->GetOutputPort() );
+        edges->SetValue( 0, 0.5 );
+        edges->ComputeNormalsOff();
+        edges->ComputeGradientsOff();
+        edges->ComputeScalarsOff();
+        edges->Update();
+
+        // Copy the output, so the slab images are freed with the pipeline
+        surfaces[slab] = vtkSmartPointer<vtkPolyData>::New();
+        surfaces[slab]->ShallowCopy( edges->GetOutput() );
+    } );
+
+    vtkIdType triangles = 0;
+    for ( int slab = 0; slab < slabs; slab++ )
+    {
+        triangles += surfaces[slab]->GetNumberOfPolys();
+    }
+    inputs.clear();
+
+    addStage( "extract", secondsSince( start ), triangles );
+
+    /****************************** Decimate *******************************/
+    if ( triangleBudget > 0 && triangles > triangleBudget )
+    {
+        start = std::chrono::steady_clock::now();
+
+        // Every slab is reduced by the same fraction
+        double reduction = 1.0 - double( triangleBudget ) / double( triangles );
+
+        forEachSlab( slabs, [&]( int slab )
+        {
+            vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
+            decimate->SetInputData( surfaces[slab] );
+            decimate->SetTargetReduction( reduction );
+            decimate->PreserveTopologyOff();
+            decimate->BoundaryVertexDeletionOff();
+            decimate->Update();
+
+            surfaces[slab] = vtkSmartPointer<vtkPolyData>::New();
+            surfaces[slab]->ShallowCopy( decimate->GetOutput() );
+        } );
+
+        triangles = 0;
+        for ( int slab = 0; slab < slabs; slab++ )
+        {
+            triangles += surfaces[slab]->GetNumberOfPolys();
+        }
+
+        addStage( "decimate", secondsSince( start ), triangles );
+    }
+
+    if ( slabs == 1 )
+    {
+        return surfaces[0];
+    }
+
+    /******************************** Merge ********************************/
+    start = std::chrono::steady_clock::now();
+
+    vtkSmartPointer<vtkAppendPolyData> append = vtkSmartPointer<vtkAppendPolyData>::New();
+    for ( int slab = 0; slab < slabs; slab++ )
+    {
+        append->AddInputData( surfaces[slab] );
+    }
+
+    // The boundary points of neighbouring slabs are identical, so they merge without a tolerance
+    vtkSmartPointer<vtkCleanPolyData> clean = vtkSmartPointer<vtkCleanPolyData>::New();
+    clean->SetInputConnection( append->GetOutputPort() );
+    clean->PointMergingOn();
+    clean->SetTolerance( 0.0 );
+    clean->ConvertPolysToLinesOff();
+    clean->ConvertLinesToPointsOff();
+    clean->Update();
+
+    vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->ShallowCopy( clean->GetOutput() );
+
+    addStage( "merge", secondsSince( start ), surface->GetNumberOfPolys() );
+
+    return surface;
+}
+
+void SurfaceExtractor::printStages( std::ostream& out ) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::fixed << std::setprecision( 2 );
+    for ( std::size_t i = 0; i < stages.size(); i++ )
+    {
+        const Stage& stage = stages[i];
+        out << "Surface " << std::left << std::setw( 9 ) << stage.name << std::right << stage.seconds << " s, "
+            << stage.triangles << " triangles, resident memory " << stage.residentMB << " MB (peak "
+            << stage.peakResidentMB << " MB) \n";
+    }
+
+    out.flags( flags );
+    out.precision( precision );
+}
+
+bool SurfaceExtractor::write( vtkPolyData* surface, const std::string& fileName )
+{
+    std::string extension = fileName.substr( std::min( fileName.size(), fileName.find_last_of( '.' ) ) );
+    std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+
+    if ( extension == ".stl" )
+    {
+        vtkSmartPointer<vtkSTLWriter> writer = vtkSmartPointer<vtkSTLWriter>::New();
+        writer->SetInputData( surface );
+        writer->SetFileName( fileName.c_str() );
+        writer->SetFileTypeToBinary();
+        writer->Write();
+
+        return writer->GetErrorCode() == vtkErrorCode::NoError;
+    }
+
+    if ( extension != ".obj" )
+    {
+        std::cout << "ERROR: The surface must be written to a .stl or .obj file. \n";
+        return false;
+    }
+
+    std::ofstream file( fileName.c_str() );
+    if ( !file )
+    {
+        return false;
+    }
+
+    file << "# Segmentation surface: " << surface->GetNumberOfPoints() << " vertices, "
+         << surface->GetNumberOfPolys() << " triangles \n";
+    file << std::setprecision( 9 );
+
+    double point[3];
+    for ( vtkIdType i = 0; i < surface->GetNumberOfPoints(); i++ )
+    {
+        surface->GetPoint( i, point );
+        file << "v " << point[0] << " " << point[1] << " " << point[2] << "\n";
+    }
+
+    // OBJ vertices are numbered from 1
+    vtkCellArray* polys = surface->GetPolys();
+    vtkIdType count;
+    vtkIdType* ids;
+
+    for ( polys->InitTraversal(); polys->GetNextCell( count, ids ); )
+    {
+        file << "f";
+        for ( vtkIdType j = 0; j < count; j++ )
+        {
+            file << " " << ids[j] + 1;
+        }
+        file << "\n";
+    }
+
+    return static_cast<bool>( file );
+}
+
+vtkSmartPointer<vtkPolyData> SurfaceExtractor::read( const std::string& fileName )
+{
+    std::string extension = fileName.substr( std::min( fileName.size(), fileName.find_last_of( '.' ) ) );
+    std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+
+    vtkSmartPointer<vtkPolyDataAlgorithm> reader;
+    if ( extension == ".stl" )
+    {
+        vtkSmartPointer<vtkSTLReader> stlReader = vtkSmartPointer<vtkSTLReader>::New();
+        stlReader->SetFileName( fileName.c_str() );
+        reader = stlReader;
+    }
+    else if ( extension == ".obj" )
+    {
+        vtkSmartPointer<vtkOBJReader> objReader = vtkSmartPointer<vtkOBJReader>::New();
+        objReader->SetFileName( fileName.c_str() );
+        reader = objReader;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    reader->Update();
+    if ( reader->GetErrorCode() != vtkErrorCode::NoError || reader->GetOutput()->GetNumberOfPoints() == 0 )
+    {
+        return nullptr;
+    }
+
+    vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->ShallowCopy( reader->GetOutput() );
+
+    return surface;
+}
+
+void SurfaceExtractor::addStage( const std::string& name, double seconds, vtkIdType triangles )
+{
+    Stage stage;
+    stage.name           = name;
+    stage.seconds        = seconds;
+    stage.triangles      = triangles;
+    stage.residentMB     = getResidentMemoryMB();
+    stage.peakResidentMB = getPeakResidentMemoryMB();
+    stages.push_back( stage );
+}
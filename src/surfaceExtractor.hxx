@@ -0,0 +1,117 @@
+/****************************************************************************
+*   surfaceExtractor.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the parallel surface extraction and
+*                   decimation of the segmentation.
+****************************************************************************/
+
+#ifndef SURFACEEXTRACTOR_H
+#define SURFACEEXTRACTOR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+
+/*
+*   Extracts the surface of the voxels inside a threshold range and decimates
+*   it to a triangle budget.
+*
+*   The volume is split into Z slabs that share their boundary slice, and the
+*   slabs are processed in parallel on the vtkSMPTools pool, each on a single
+*   thread (the filters inside a slab do not start threads of their own):
+*   vtkExtractVOI, vtkImageThreshold
+*   (inside = 1) and vtkFlyingEdges3D at 0.5, then vtkDecimatePro with the
+*   boundary vertices kept, so the cut edges of neighbouring slabs still match.
+*   The slab surfaces are appended and their shared points merged.
+*
+*   Every stage (extract, decimate, merge) records its time, triangle count,
+*   resident memory after the stage and the peak resident memory so far.
+*/
+class SurfaceExtractor
+{
+    public:
+        struct Stage
+        {
+            std::string name;
+            double seconds;
+            vtkIdType triangles;
+            double residentMB;
+            double peakResidentMB;
+        };
+
+        SurfaceExtractor();
+
+        /*
+        *   Set the threshold range of the segmentation (inclusive).
+        */
+        void setThresholds( double lower, double upper );
+
+        /*
+        *   Set the number of triangles to decimate to.
+        *
+        *   @param   triangles   Triangle budget, 0 = no decimation
+        */
+        void setTriangleBudget( vtkIdType triangles );
+
+        /*
+        *   Set the number of slabs. The slabs share the vtkSMPTools pool, so
+        *   at most its number of threads run at a time.
+        *
+        *   @param   slabs   Slabs, 0 = one per thread of the pool (default)
+        */
+        void setSlabs( int slabs );
+
+        /*
+        *   Extract the surface.
+        *
+        *   @param   image   The image to segment
+        *
+        *   @returns the surface (triangles), empty if nothing is inside the thresholds
+        */
+        vtkSmartPointer<vtkPolyData> extract( vtkImageData* image );
+
+        const std::vector<Stage>& getStages() const { return stages; }
+
+        /*
+        *   Print the time, triangles and memory of each stage of the last extract().
+        *
+        *   @param   out   The stream to print to
+        */
+        void printStages( std::ostream& out ) const;
+
+        /*
+        *   Write a surface as binary STL (.stl) or Wavefront OBJ (.obj).
+        *
+        *   @param   surface    The surface
+        *   @param   fileName   Output file, the extension selects the format
+        *
+        *   @returns a boolean representing whether the file was written
+        */
+        static bool write( vtkPolyData* surface, const std::string& fileName );
+
+        /*
+        *   Read a surface from binary or ASCII STL (.stl) or Wavefront OBJ (.obj).
+        *
+        *   @param   fileName   Input file, the extension selects the format
+        *
+        *   @returns the surface, nullptr if the file cannot be read or has no points
+        */
+        static vtkSmartPointer<vtkPolyData> read( const std::string& fileName );
+
+    private:
+        void addStage( const std::string& name, double seconds, vtkIdType triangles );
+
+        double lowerThreshold;
+        double upperThreshold;
+        vtkIdType triangleBudget;
+        int slabCount;
+        std::vector<Stage> stages;
+};
+
+#endif // SURFACEEXTRACTOR_H
@@ -0,0 +1,368 @@
+/****************************************************************************
+*   surfaceRegistration.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the multi-scale rigid registration of a
+*                   surface to a reference surface (ICP).
+****************************************************************************/
+
+#include "surfaceRegistration.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+#include <vtkPoints.h>
+#include <vtkLandmarkTransform.h>
+#include <vtkTransform.h>
+#include <vtkImageReslice.h>
+#include <vtkSMPTools.h>
+
+static double secondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+SurfaceRegistration::SurfaceRegistration()
+    : levelCount( 3 ), samplePoints( 50000 ), maxIterations( 50 ), tolerance( 0.001 ), timeLimit( 30.0 ), threads( 0 ),
+      matrix( vtkSmartPointer<vtkMatrix4x4>::New() ), treeSeconds( 0.0 ), timedOut( false )
+{
+}
+
+void SurfaceRegistration::setLevels( int levels )
+{
+    levelCount = std::max( 1, levels );
+}
+
+void SurfaceRegistration::setSamplePoints( vtkIdType points )
+{
+    samplePoints = std::max<vtkIdType>( 0, points );
+}
+
+void SurfaceRegistration::setMaxIterations( int iterations )
+{
+    maxIterations = std::max( 1, iterations );
+}
+
+void SurfaceRegistration::setTolerance( double relativeChange )
+{
+    tolerance = std::max( 0.0, relativeChange );
+}
+
+void SurfaceRegistration::setTimeLimit( double seconds )
+{
+    timeLimit = std::max( 0.0, seconds );
+}
+
+void SurfaceRegistration::setNumberOfThreads( int count )
+{
+    threads = std::max( 0, count );
+}
+
+bool SurfaceRegistration::align( vtkPolyData* moving, vtkPolyData* reference )
+{
+    ScopedTimer timer( "registration", "registration" );
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    matrix->Identity();
+    levels.clear();
+    treeSeconds = 0.0;
+    timedOut = false;
+    error.clear();
+
+    vtkIdType movingCount    = moving ? moving->GetNumberOfPoints() : 0;
+    vtkIdType referenceCount = reference ? reference->GetNumberOfPoints() : 0;
+    if ( movingCount < 3 || referenceCount < 3 )
+    {
+        error = movingCount < 3 ? "the surface has fewer than 3 points" : "the reference has fewer than 3 points";
+        return false;
+    }
+
+    /***************************** Reference tree ***************************/
+    double referenceCentroid[3] = { 0.0, 0.0, 0.0 };
+    {
+        ScopedTimer treeTimer( "registration tree", "registration" );
+
+        std::vector<float> coordinates( 3 * referenceCount );
+        double point[3];
+        for ( vtkIdType i = 0; i < referenceCount; i++ )
+        {
+            reference->GetPoint( i, point );
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                coordinates[3 * i + axis] = static_cast<float>( point[axis] );
+                referenceCentroid[axis] += point[axis];
+            }
+        }
+        treeTimer.addBytes( 12.0 * referenceCount );
+
+        tree.build( coordinates, threads );
+        treeSeconds = secondsSince( start );
+    }
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        referenceCentroid[axis] /= referenceCount;
+    }
+
+    /******************************** Samples *******************************/
+    // A random subset, the same in every run. The samples of a level are the first of the next.
+    vtkIdType finestCount = ( samplePoints > 0 ) ? std::min( samplePoints, movingCount ) : movingCount;
+
+    std::vector<vtkIdType> order( movingCount );
+    for ( vtkIdType i = 0; i < movingCount; i++ )
+    {
+        order[i] = i;
+    }
+
+    std::mt19937_64 random( 1 );
+    for ( vtkIdType i = 0; i < finestCount && finestCount < movingCount; i++ )
+    {
+        std::uniform_int_distribution<vtkIdType> pick( i, movingCount - 1 );
+        std::swap( order[i], order[pick( random )] );
+    }
+
+    std::vector<double> samples( 3 * finestCount );
+    double movingCentroid[3] = { 0.0, 0.0, 0.0 };
+    for ( vtkIdType i = 0; i < finestCount; i++ )
+    {
+        moving->GetPoint( order[i], &samples[3 * i] );
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            movingCentroid[axis] += samples[3 * i + axis];
+        }
+    }
+    order.clear();
+
+    // Start with the centroids on top of each other
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        matrix->SetElement( axis, 3, referenceCentroid[axis] - movingCentroid[axis] / finestCount );
+    }
+
+    /********************************* Levels *******************************/
+    std::vector<double> moved( 3 * finestCount );
+    std::vector<vtkIdType> closest( finestCount );
+    std::vector<double> distances2( finestCount );
+    std::vector<double> sorted;
+
+    vtkSmartPointer<vtkPoints> sourcePoints = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkPoints> targetPoints = vtkSmartPointer<vtkPoints>::New();
+    sourcePoints->SetDataTypeToDouble();
+    targetPoints->SetDataTypeToDouble();
+
+    vtkSmartPointer<vtkLandmarkTransform> landmarks = vtkSmartPointer<vtkLandmarkTransform>::New();
+    landmarks->SetModeToRigidBody();
+    landmarks->SetSourceLandmarks( sourcePoints );
+    landmarks->SetTargetLandmarks( targetPoints );
+
+    vtkSmartPointer<vtkMatrix4x4> product = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> best    = vtkSmartPointer<vtkMatrix4x4>::New();
+
+    const PointKdTree& referenceTree = this->tree;
+    auto findClosest = [&referenceTree, &moved, &closest, &distances2]( vtkIdType begin, vtkIdType end )
+    {
+        for ( vtkIdType i = begin; i < end; i++ )
+        {
+            closest[i] = referenceTree.findClosest( &moved[3 * i], distances2[i] );
+        }
+    };
+
+    for ( int levelIndex = 0; levelIndex < levelCount && !timedOut; levelIndex++ )
+    {
+        ScopedTimer levelTimer( "registration level", "registration" );
+        std::chrono::steady_clock::time_point levelStart = std::chrono::steady_clock::now();
+
+        // Each level has 8 times the samples of the level before, and at least 64
+        vtkIdType count = finestCount;
+        for ( int i = levelIndex + 1; i < levelCount && count > 64; i++ )
+        {
+            count = std::max<vtkIdType>( 64, count / 8 );
+        }
+
+        Level level;
+        level.points         = count;
+        level.pairs          = 0;
+        level.iterations     = 0;
+        level.seconds        = 0.0;
+        level.meanDistance   = 0.0;
+        level.sampleDistance = 0.0;
+        level.bestDistance   = -1.0;
+        level.bestIteration  = 0;
+        level.converged      = false;
+
+        double previousMean = -1.0;
+        best->DeepCopy( matrix );
+
+        while ( level.iterations < maxIterations )
+        {
+            if ( timeLimit > 0.0 && secondsSince( start ) >= timeLimit )
+            {
+                timedOut = true;
+                break;
+            }
+
+            // Move the samples with the transform so far, then pair each with its closest reference point
+            for ( vtkIdType i = 0; i < count; i++ )
+            {
+                double point[4] = { samples[3 * i], samples[3 * i + 1], samples[3 * i + 2], 1.0 };
+                matrix->MultiplyPoint( point, point );
+                std::copy( point, point + 3, &moved[3 * i] );
+            }
+
+            vtkSMPTools::For( 0, count, findClosest );
+
+            // Pairs further apart than 3 times the median distance are outliers
+            sorted.assign( distances2.begin(), distances2.begin() + count );
+            std::nth_element( sorted.begin(), sorted.begin() + count / 2, sorted.end() );
+            double limit2 = 9.0 * sorted[count / 2];
+
+            sourcePoints->Reset();
+            targetPoints->Reset();
+
+            double distanceSum = 0.0, sampleSum = 0.0;
+            double point[3];
+            for ( vtkIdType i = 0; i < count; i++ )
+            {
+                double distance = std::sqrt( distances2[i] );
+                sampleSum += distance;
+
+                if ( distances2[i] <= limit2 )
+                {
+                    reference->GetPoint( closest[i], point );
+                    sourcePoints->InsertNextPoint( &moved[3 * i] );
+                    targetPoints->InsertNextPoint( point );
+                    distanceSum += distance;
+                }
+            }
+
+            level.iterations++;
+            level.pairs          = sourcePoints->GetNumberOfPoints();
+            level.meanDistance   = distanceSum / std::max<vtkIdType>( 1, level.pairs );
+            level.sampleDistance = sampleSum / count;
+
+            // The transform that was just measured, if it is the closest of the level so far. The inlier
+            // cutoff changes every iteration, so transforms are compared over all samples of the level.
+            if ( level.bestDistance < 0.0 || level.sampleDistance < level.bestDistance )
+            {
+                level.bestDistance  = level.sampleDistance;
+                level.bestIteration = level.iterations;
+                best->DeepCopy( matrix );
+            }
+
+            // The surfaces already touch, or the pairs stopped improving
+            if ( level.meanDistance == 0.0 || level.pairs < 3 ||
+                 ( previousMean >= 0.0 && std::abs( previousMean - level.meanDistance ) <= tolerance * previousMean ) )
+            {
+                level.converged = true;
+                break;
+            }
+            previousMean = level.meanDistance;
+
+            sourcePoints->Modified();
+            targetPoints->Modified();
+            landmarks->Modified();
+            landmarks->Update();
+
+            vtkMatrix4x4::Multiply4x4( landmarks->GetMatrix(), matrix, product );
+            matrix->DeepCopy( product );
+        }
+
+        // The next level (or the result) starts from the best transform of this level. The first
+        // iteration of the next level measures it again on more samples, so a transform is only
+        // compared with others measured on the same samples.
+        matrix->DeepCopy( best );
+
+        level.seconds = secondsSince( levelStart );
+        if ( level.iterations > 0 )
+        {
+            levels.push_back( level );
+        }
+    }
+
+    return true;
+}
+
+double SurfaceRegistration::getIterationsPerSecond() const
+{
+    int iterations = 0;
+    double seconds = 0.0;
+    for ( std::size_t i = 0; i < levels.size(); i++ )
+    {
+        iterations += levels[i].iterations;
+        seconds    += levels[i].seconds;
+    }
+
+    return seconds > 0.0 ? iterations / seconds : 0.0;
+}
+
+void SurfaceRegistration::printLevels( std::ostream& out ) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::fixed << std::setprecision( 2 );
+    out << "Registration tree " << tree.size() << " reference points, " << treeSeconds << " s \n";
+
+    for ( std::size_t i = 0; i < levels.size(); i++ )
+    {
+        const Level& level = levels[i];
+        double rate = level.seconds > 0.0 ? level.iterations / level.seconds : 0.0;
+
+        out << "Registration level " << i + 1 << ": " << level.points << " points, " << level.iterations
+            << " iteration(s) in " << level.seconds << " s (" << rate << " iterations/s), mean distance "
+            << std::setprecision( 4 ) << level.meanDistance << std::setprecision( 2 ) << " over " << level.pairs
+            << " pairs" << ( level.converged ? ", converged" : "" );
+
+        if ( level.bestDistance >= 0.0 && level.bestIteration != level.iterations )
+        {
+            out << ", best mean distance of all samples " << std::setprecision( 4 ) << level.bestDistance
+                << std::setprecision( 2 ) << " at iteration " << level.bestIteration << " (kept, last "
+                << std::setprecision( 4 ) << level.sampleDistance << std::setprecision( 2 ) << ")";
+        }
+        out << " \n";
+    }
+
+    if ( timedOut )
+    {
+        out << "Registration stopped at the time limit, using the best transform found so far. \n";
+    }
+
+    out.flags( flags );
+    out.precision( precision );
+}
+
+vtkSmartPointer<vtkImageData> SurfaceRegistration::resample( vtkImageData* image, vtkMatrix4x4* matrix, vtkImageData* reference,
+                                                             int threads )
+{
+    ScopedTimer timer( "registration resample", "registration" );
+
+    // The reslice transform maps output positions (the reference frame) to input positions
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->SetMatrix( matrix );
+    transform->Inverse();
+
+    vtkImageData* grid = reference ? reference : image;
+
+    vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+    reslice->SetInputData( image );
+    reslice->SetResliceTransform( transform );
+    reslice->SetOutputSpacing( grid->GetSpacing() );
+    reslice->SetOutputOrigin( grid->GetOrigin() );
+    reslice->SetOutputExtent( grid->GetExtent() );
+    reslice->SetInterpolationModeToLinear();
+    reslice->SetBackgroundLevel( image->GetScalarRange()[0] );
+    reslice->SetNumberOfThreads( threads > 0 ? threads : std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) ) );
+    reslice->Update();
+
+    vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+    output->ShallowCopy( reslice->GetOutput() );
+    timer.addBytes( output->GetActualMemorySize() * 1024.0 );
+
+    return output;
+}
@@ -0,0 +1,163 @@
+/****************************************************************************
+*   surfaceRegistration.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the multi-scale rigid registration of a
+*                   surface to a reference surface (ICP).
+****************************************************************************/
+
+#ifndef SURFACEREGISTRATION_H
+#define SURFACEREGISTRATION_H
+
+#include "pointKdTree.hxx"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPolyData.h>
+
+/*
+*   Rigidly aligns a surface (the moving surface, e.g. the segmentation of a
+*   study) to a reference surface with the iterative closest point method.
+*
+*   The reference points are put in a PointKdTree once. The moving surface is
+*   sampled coarse to fine: every level uses a random subset of its points,
+*   8 times larger than the level before (the finest with the sample size),
+*   starting from the transform of the level before. Each iteration
+*   - finds the closest reference point of every sample on all cores,
+*   - drops the pairs further apart than 3 times the median distance, so parts
+*     of one surface without a counterpart in the other do not pull it away,
+*   - solves the rigid transform of the remaining pairs (vtkLandmarkTransform).
+*   A level ends when the mean distance changes by less than the tolerance or
+*   after the maximum iterations, and keeps the transform with the lowest mean
+*   distance over all its samples, outliers included (an iteration can make it
+*   worse, e.g. when outliers change; the inlier mean is not comparable between
+*   iterations, as the cutoff moves with the median),
+*   which the next level starts from. All levels stop when the time limit is
+*   reached, keeping the best transform found so far, so millions of points
+*   take a bounded time.
+*/
+class SurfaceRegistration
+{
+    public:
+        struct Level
+        {
+            vtkIdType points;           // Samples of the moving surface
+            vtkIdType pairs;            // Pairs kept in the last iteration
+            int iterations;
+            double seconds;
+            double meanDistance;        // Mean distance of the kept pairs in the last iteration
+            double sampleDistance;      // Mean distance of all samples in the last iteration
+            double bestDistance;        // Lowest mean distance of all samples of the level, -1 = none
+            int bestIteration;          // Iteration of the lowest one (1 = the first)
+            bool converged;
+        };
+
+        SurfaceRegistration();
+
+        /*
+        *   @param   levels   Levels of the coarse to fine sampling (default 3)
+        */
+        void setLevels( int levels );
+
+        /*
+        *   @param   points   Samples of the finest level (default 50000), 0 = every point
+        */
+        void setSamplePoints( vtkIdType points );
+
+        /*
+        *   @param   iterations   Maximum iterations of each level (default 50)
+        */
+        void setMaxIterations( int iterations );
+
+        /*
+        *   @param   tolerance   Relative change of the mean distance that ends a level (default 0.001)
+        */
+        void setTolerance( double tolerance );
+
+        /*
+        *   @param   seconds   Limit of the whole registration, including the tree (default 30), 0 = no limit
+        */
+        void setTimeLimit( double seconds );
+
+        /*
+        *   @param   threads   Threads of the tree and the searches, 0 = all cores (default)
+        */
+        void setNumberOfThreads( int threads );
+
+        /*
+        *   Find the rigid transform that moves a surface onto the reference.
+        *   The centroids of the points are matched first.
+        *
+        *   @param   moving      The surface to move
+        *   @param   reference   The reference surface
+        *
+        *   @returns a boolean representing whether both surfaces have points
+        */
+        bool align( vtkPolyData* moving, vtkPolyData* reference );
+
+        /*
+        *   @returns the transform from the moving surface to the reference with the lowest
+        *            mean distance of the last level (identity before align())
+        */
+        vtkMatrix4x4* getMatrix() const { return matrix; }
+
+        const std::vector<Level>& getLevels() const { return levels; }
+
+        /*
+        *   @returns whether the last align() was stopped by the time limit
+        */
+        bool reachedTimeLimit() const { return timedOut; }
+
+        /*
+        *   @returns the iterations of all levels of the last align() per second of their run time
+        */
+        double getIterationsPerSecond() const;
+
+        /*
+        *   Print the tree time and the points, iterations, iterations per second
+        *   and mean distance of each level of the last align(), and the best mean
+        *   distance of all samples when it was not the last.
+        *
+        *   @param   out   The stream to print to
+        */
+        void printLevels( std::ostream& out ) const;
+
+        const std::string& getError() const { return error; }
+
+        /*
+        *   Resample an image into the reference frame (vtkImageReslice, trilinear,
+        *   threaded). Voxels that map outside the image get its minimum.
+        *
+        *   @param   image       The image of the moving surface
+        *   @param   matrix      The transform from the image to the reference (see getMatrix())
+        *   @param   reference   Image whose grid the output takes, nullptr = the grid of the image
+        *   @param   threads     Threads of the resampling, 0 = all cores
+        *
+        *   @returns the resampled image
+        */
+        static vtkSmartPointer<vtkImageData> resample( vtkImageData* image, vtkMatrix4x4* matrix, vtkImageData* reference,
+                                                       int threads );
+
+    private:
+        int levelCount;
+        vtkIdType samplePoints;
+        int maxIterations;
+        double tolerance;
+        double timeLimit;
+        int threads;
+
+        vtkSmartPointer<vtkMatrix4x4> matrix;
+        PointKdTree tree;
+        double treeSeconds;
+        std::vector<Level> levels;
+        bool timedOut;
+        std::string error;
+};
+
+#endif // SURFACEREGISTRATION_H
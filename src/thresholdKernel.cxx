@@ -0,0 +1,771 @@
+/****************************************************************************
+*   thresholdKernel.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the branch-free threshold classify,
+*                   accumulate and pack kernels (scalar, SSE4.2 and AVX2).
+****************************************************************************/
+
+#include "thresholdKernel.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define THRESHOLD_KERNEL_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define THRESHOLD_KERNEL_TARGET(isa)
+    #else
+        #define THRESHOLD_KERNEL_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#else
+    #define THRESHOLD_KERNEL_X86 0
+#endif
+
+/*
+*   Exact integer totals, converted to ThresholdSums once per call.
+*/
+struct IntegerSums
+{
+    long long count[2];
+    long long sum[2];
+    unsigned long long sumSquares[2];
+};
+
+/*
+*   Number of SIMD iterations between flushes of the 32-bit lane sums.
+*   65535 * 16384 stays below 2^31.
+*/
+static const std::size_t INTEGER_BLOCK_ITERATIONS = 16384;
+
+/*
+*   Convert the thresholds to an inclusive integer range [lo, hi].
+*   Returns an empty range (lo > hi) when no integer lies in [lower, upper].
+*/
+static void integerBounds( double lower, double upper, int& lo, int& hi )
+{
+    double l = std::ceil( lower );
+    double h = std::floor( upper );
+
+    if ( !( l <= h ) )
+    {
+        lo = 1;
+        hi = 0;
+        return;
+    }
+
+    // All 16-bit values lie well inside this range
+    l = std::max( l, -1000000.0 );
+    h = std::min( h, 1000000.0 );
+
+    lo = int( l );
+    hi = int( h );
+}
+
+/*
+*   Convert the thresholds to floats so that (x >= lo && x <= hi) gives the
+*   same answer as comparing the float x against the double thresholds.
+*/
+static void floatBounds( double lower, double upper, float& lo, float& hi )
+{
+    lo = static_cast<float>( lower );
+    if ( double( lo ) < lower )
+    {
+        lo = std::nextafter( lo, std::numeric_limits<float>::infinity() );
+    }
+
+    hi = static_cast<float>( upper );
+    if ( double( hi ) > upper )
+    {
+        hi = std::nextafter( hi, -std::numeric_limits<float>::infinity() );
+    }
+}
+
+/******************************* Scalar kernels ******************************/
+template <class T>
+static void accumulateIntegerScalar( const T* data, std::size_t n, int lo, int hi, IntegerSums& sums )
+{
+    for ( std::size_t i = 0; i < n; i++ )
+    {
+        long long voxel = data[i];
+        int inside      = ( voxel >= lo ) & ( voxel <= hi );
+
+        sums.count[inside]++;
+        sums.sum[inside]        += voxel;
+        sums.sumSquares[inside] += static_cast<unsigned long long>( voxel * voxel );
+    }
+}
+
+static void accumulateFloatScalar( const float* data, std::size_t n, float lo, float hi, ThresholdSums& sums )
+{
+    for ( std::size_t i = 0; i < n; i++ )
+    {
+        double voxel = data[i];
+        int inside   = ( data[i] >= lo ) & ( data[i] <= hi );
+
+        sums.count[inside]++;
+        sums.sum[inside]        += voxel;
+        sums.sumSquares[inside] += voxel * voxel;
+    }
+}
+
+template <class T, class B>
+static void packScalar( const T* data, std::size_t n, B lo, B hi, std::uint64_t* bits )
+{
+    for ( std::size_t i = 0; i < n; i += 64 )
+    {
+        std::size_t count  = std::min<std::size_t>( 64, n - i );
+        std::uint64_t word = 0;
+
+        for ( std::size_t k = 0; k < count; k++ )
+        {
+            word |= std::uint64_t( ( data[i + k] >= lo ) & ( data[i + k] <= hi ) ) << k;
+        }
+
+        bits[i / 64] = word;
+    }
+}
+
+static long long countBitsScalar( const std::uint64_t* words, std::size_t n )
+{
+    long long count = 0;
+    for ( std::size_t i = 0; i < n; i++ )
+    {
+        std::uint64_t word = words[i];
+        word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+        word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+        word = ( word + ( word >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+        count += static_cast<long long>( ( word * 0x0101010101010101ULL ) >> 56 );
+    }
+
+    return count;
+}
+/***************************************************************************/
+
+#if THRESHOLD_KERNEL_X86
+/******************************* SSE4.2 kernels ******************************/
+template <bool IsSigned>
+THRESHOLD_KERNEL_TARGET("sse4.2")
+static void accumulateIntegerSSE42( const void* input, std::size_t n, int lo, int hi, IntegerSums& sums )
+{
+    const unsigned short* data = static_cast<const unsigned short*>( input );
+
+    const __m128i vLo = _mm_set1_epi32( lo );
+    const __m128i vHi = _mm_set1_epi32( hi );
+
+    __m128i sqFg = _mm_setzero_si128();
+    __m128i sqBg = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    while ( i + 4 <= n )
+    {
+        __m128i sumFg = _mm_setzero_si128();
+        __m128i sumBg = _mm_setzero_si128();
+        __m128i cntBg = _mm_setzero_si128();
+
+        std::size_t blockEnd = std::min( n - n % 4, i + 4 * INTEGER_BLOCK_ITERATIONS );
+        for ( ; i < blockEnd; i += 4 )
+        {
+            __m128i raw = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( data + i ) );
+            __m128i v   = IsSigned ? _mm_cvtepi16_epi32( raw ) : _mm_cvtepu16_epi32( raw );
+
+            __m128i outside = _mm_or_si128( _mm_cmpgt_epi32( vLo, v ), _mm_cmpgt_epi32( v, vHi ) );
+            __m128i fg      = _mm_andnot_si128( outside, v );
+            __m128i bg      = _mm_and_si128( outside, v );
+
+            sumFg = _mm_add_epi32( sumFg, fg );
+            sumBg = _mm_add_epi32( sumBg, bg );
+            cntBg = _mm_sub_epi32( cntBg, outside );
+
+            // Squares fit in 32 unsigned bits for 16-bit input
+            __m128i sq   = _mm_mullo_epi32( v, v );
+            __m128i sqF  = _mm_andnot_si128( outside, sq );
+            __m128i sqB  = _mm_and_si128( outside, sq );
+            sqFg = _mm_add_epi64( sqFg, _mm_cvtepu32_epi64( sqF ) );
+            sqFg = _mm_add_epi64( sqFg, _mm_cvtepu32_epi64( _mm_srli_si128( sqF, 8 ) ) );
+            sqBg = _mm_add_epi64( sqBg, _mm_cvtepu32_epi64( sqB ) );
+            sqBg = _mm_add_epi64( sqBg, _mm_cvtepu32_epi64( _mm_srli_si128( sqB, 8 ) ) );
+        }
+
+        int laneFg[4], laneBg[4], laneCnt[4];
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( laneFg ), sumFg );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( laneBg ), sumBg );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( laneCnt ), cntBg );
+
+        for ( int lane = 0; lane < 4; lane++ )
+        {
+            sums.sum[1]   += laneFg[lane];
+            sums.sum[0]   += laneBg[lane];
+            sums.count[0] += laneCnt[lane];
+        }
+    }
+
+    unsigned long long laneSq[2];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( laneSq ), sqFg );
+    sums.sumSquares[1] += laneSq[0] + laneSq[1];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( laneSq ), sqBg );
+    sums.sumSquares[0] += laneSq[0] + laneSq[1];
+
+    if ( IsSigned )
+    {
+        accumulateIntegerScalar( reinterpret_cast<const short*>( data ) + i, n - i, lo, hi, sums );
+    }
+    else
+    {
+        accumulateIntegerScalar( data + i, n - i, lo, hi, sums );
+    }
+}
+
+THRESHOLD_KERNEL_TARGET("sse4.2")
+static void accumulateFloatSSE42( const float* data, std::size_t n, float lo, float hi, ThresholdSums& sums )
+{
+    const __m128 vLo = _mm_set1_ps( lo );
+    const __m128 vHi = _mm_set1_ps( hi );
+
+    __m128d sumFg = _mm_setzero_pd(), sumBg = _mm_setzero_pd();
+    __m128d sqFg  = _mm_setzero_pd(), sqBg  = _mm_setzero_pd();
+    __m128i cntFg = _mm_setzero_si128();
+
+    std::size_t i = 0;
+    for ( ; i + 4 <= n; i += 4 )
+    {
+        __m128 v      = _mm_loadu_ps( data + i );
+        __m128 inside = _mm_and_ps( _mm_cmpge_ps( v, vLo ), _mm_cmple_ps( v, vHi ) );
+        __m128 fg     = _mm_and_ps( inside, v );
+        __m128 bg     = _mm_andnot_ps( inside, v );
+
+        cntFg = _mm_sub_epi32( cntFg, _mm_castps_si128( inside ) );
+
+        __m128d fgLo = _mm_cvtps_pd( fg ), fgHi = _mm_cvtps_pd( _mm_movehl_ps( fg, fg ) );
+        __m128d bgLo = _mm_cvtps_pd( bg ), bgHi = _mm_cvtps_pd( _mm_movehl_ps( bg, bg ) );
+
+        sumFg = _mm_add_pd( sumFg, _mm_add_pd( fgLo, fgHi ) );
+        sumBg = _mm_add_pd( sumBg, _mm_add_pd( bgLo, bgHi ) );
+        sqFg  = _mm_add_pd( sqFg, _mm_add_pd( _mm_mul_pd( fgLo, fgLo ), _mm_mul_pd( fgHi, fgHi ) ) );
+        sqBg  = _mm_add_pd( sqBg, _mm_add_pd( _mm_mul_pd( bgLo, bgLo ), _mm_mul_pd( bgHi, bgHi ) ) );
+    }
+
+    double lane[2];
+    _mm_storeu_pd( lane, sumFg ); sums.sum[1]        += lane[0] + lane[1];
+    _mm_storeu_pd( lane, sumBg ); sums.sum[0]        += lane[0] + lane[1];
+    _mm_storeu_pd( lane, sqFg );  sums.sumSquares[1] += lane[0] + lane[1];
+    _mm_storeu_pd( lane, sqBg );  sums.sumSquares[0] += lane[0] + lane[1];
+
+    int laneCnt[4];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( laneCnt ), cntFg );
+    long long countFg = (long long)laneCnt[0] + laneCnt[1] + laneCnt[2] + laneCnt[3];
+    sums.count[1] += countFg;
+    sums.count[0] += static_cast<long long>( i ) - countFg;
+
+    accumulateFloatScalar( data + i, n - i, lo, hi, sums );
+}
+
+/*
+*   The pack kernels do whole words only and return the voxels done; the
+*   caller packs the rest. Unsigned voxels have their sign bit flipped (bias)
+*   so the signed 16-bit compares order them correctly.
+*/
+template <bool IsSigned>
+THRESHOLD_KERNEL_TARGET("sse4.2")
+static std::size_t packIntegerSSE42( const void* input, std::size_t n, short lo, short hi, std::uint64_t* bits )
+{
+    const short* data = static_cast<const short*>( input );
+
+    const __m128i vLo  = _mm_set1_epi16( lo );
+    const __m128i vHi  = _mm_set1_epi16( hi );
+    const __m128i bias = _mm_set1_epi16( IsSigned ? 0 : static_cast<short>( -32768 ) );
+
+    std::size_t i = 0;
+    for ( ; i + 64 <= n; i += 64 )
+    {
+        std::uint64_t outside = 0;
+        for ( int k = 0; k < 64; k += 16 )
+        {
+            __m128i a = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i + k ) ), bias );
+            __m128i b = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i + k + 8 ) ), bias );
+
+            __m128i outA = _mm_or_si128( _mm_cmpgt_epi16( vLo, a ), _mm_cmpgt_epi16( a, vHi ) );
+            __m128i outB = _mm_or_si128( _mm_cmpgt_epi16( vLo, b ), _mm_cmpgt_epi16( b, vHi ) );
+
+            // One byte per voxel, then one bit per voxel
+            unsigned mask = static_cast<unsigned>( _mm_movemask_epi8( _mm_packs_epi16( outA, outB ) ) );
+            outside |= std::uint64_t( mask ) << k;
+        }
+
+        bits[i / 64] = ~outside;
+    }
+
+    return i;
+}
+
+THRESHOLD_KERNEL_TARGET("sse4.2")
+static std::size_t packFloatSSE42( const float* data, std::size_t n, float lo, float hi, std::uint64_t* bits )
+{
+    const __m128 vLo = _mm_set1_ps( lo );
+    const __m128 vHi = _mm_set1_ps( hi );
+
+    std::size_t i = 0;
+    for ( ; i + 64 <= n; i += 64 )
+    {
+        std::uint64_t word = 0;
+        for ( int k = 0; k < 64; k += 4 )
+        {
+            __m128 v      = _mm_loadu_ps( data + i + k );
+            __m128 inside = _mm_and_ps( _mm_cmpge_ps( v, vLo ), _mm_cmple_ps( v, vHi ) );
+
+            word |= std::uint64_t( static_cast<unsigned>( _mm_movemask_ps( inside ) ) ) << k;
+        }
+
+        bits[i / 64] = word;
+    }
+
+    return i;
+}
+
+THRESHOLD_KERNEL_TARGET("popcnt")
+static long long countBitsPopcnt( const std::uint64_t* words, std::size_t n )
+{
+    long long count = 0;
+    for ( std::size_t i = 0; i < n; i++ )
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        count += static_cast<long long>( _mm_popcnt_u64( words[i] ) );
+#else
+        count += _mm_popcnt_u32( static_cast<unsigned int>( words[i] ) ) +
+                 _mm_popcnt_u32( static_cast<unsigned int>( words[i] >> 32 ) );
+#endif
+    }
+
+    return count;
+}
+/***************************************************************************/
+
+/******************************** AVX2 kernels *******************************/
+template <bool IsSigned>
+THRESHOLD_KERNEL_TARGET("avx2")
+static void accumulateIntegerAVX2( const void* input, std::size_t n, int lo, int hi, IntegerSums& sums )
+{
+    const unsigned short* data = static_cast<const unsigned short*>( input );
+
+    const __m256i vLo = _mm256_set1_epi32( lo );
+    const __m256i vHi = _mm256_set1_epi32( hi );
+
+    __m256i sqFg = _mm256_setzero_si256();
+    __m256i sqBg = _mm256_setzero_si256();
+
+    std::size_t i = 0;
+    while ( i + 8 <= n )
+    {
+        __m256i sumFg = _mm256_setzero_si256();
+        __m256i sumBg = _mm256_setzero_si256();
+        __m256i cntBg = _mm256_setzero_si256();
+
+        std::size_t blockEnd = std::min( n - n % 8, i + 8 * INTEGER_BLOCK_ITERATIONS );
+        for ( ; i < blockEnd; i += 8 )
+        {
+            __m128i raw = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) );
+            __m256i v   = IsSigned ? _mm256_cvtepi16_epi32( raw ) : _mm256_cvtepu16_epi32( raw );
+
+            __m256i outside = _mm256_or_si256( _mm256_cmpgt_epi32( vLo, v ), _mm256_cmpgt_epi32( v, vHi ) );
+            __m256i fg      = _mm256_andnot_si256( outside, v );
+            __m256i bg      = _mm256_and_si256( outside, v );
+
+            sumFg = _mm256_add_epi32( sumFg, fg );
+            sumBg = _mm256_add_epi32( sumBg, bg );
+            cntBg = _mm256_sub_epi32( cntBg, outside );
+
+            // Squares fit in 32 unsigned bits for 16-bit input
+            __m256i sq  = _mm256_mullo_epi32( v, v );
+            __m256i sqF = _mm256_andnot_si256( outside, sq );
+            __m256i sqB = _mm256_and_si256( outside, sq );
+            sqFg = _mm256_add_epi64( sqFg, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( sqF ) ) );
+            sqFg = _mm256_add_epi64( sqFg, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( sqF, 1 ) ) );
+            sqBg = _mm256_add_epi64( sqBg, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( sqB ) ) );
+            sqBg = _mm256_add_epi64( sqBg, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( sqB, 1 ) ) );
+        }
+
+        int laneFg[8], laneBg[8], laneCnt[8];
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneFg ), sumFg );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneBg ), sumBg );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneCnt ), cntBg );
+
+        for ( int lane = 0; lane < 8; lane++ )
+        {
+            sums.sum[1]   += laneFg[lane];
+            sums.sum[0]   += laneBg[lane];
+            sums.count[0] += laneCnt[lane];
+        }
+    }
+
+    unsigned long long laneSq[4];
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneSq ), sqFg );
+    sums.sumSquares[1] += laneSq[0] + laneSq[1] + laneSq[2] + laneSq[3];
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneSq ), sqBg );
+    sums.sumSquares[0] += laneSq[0] + laneSq[1] + laneSq[2] + laneSq[3];
+
+    if ( IsSigned )
+    {
+        accumulateIntegerScalar( reinterpret_cast<const short*>( data ) + i, n - i, lo, hi, sums );
+    }
+    else
+    {
+        accumulateIntegerScalar( data + i, n - i, lo, hi, sums );
+    }
+}
+
+THRESHOLD_KERNEL_TARGET("avx2")
+static void accumulateFloatAVX2( const float* data, std::size_t n, float lo, float hi, ThresholdSums& sums )
+{
+    const __m256 vLo = _mm256_set1_ps( lo );
+    const __m256 vHi = _mm256_set1_ps( hi );
+
+    __m256d sumFg = _mm256_setzero_pd(), sumBg = _mm256_setzero_pd();
+    __m256d sqFg  = _mm256_setzero_pd(), sqBg  = _mm256_setzero_pd();
+    __m256i cntFg = _mm256_setzero_si256();
+
+    std::size_t i = 0;
+    for ( ; i + 8 <= n; i += 8 )
+    {
+        __m256 v      = _mm256_loadu_ps( data + i );
+        __m256 inside = _mm256_and_ps( _mm256_cmp_ps( v, vLo, _CMP_GE_OQ ), _mm256_cmp_ps( v, vHi, _CMP_LE_OQ ) );
+        __m256 fg     = _mm256_and_ps( inside, v );
+        __m256 bg     = _mm256_andnot_ps( inside, v );
+
+        cntFg = _mm256_sub_epi32( cntFg, _mm256_castps_si256( inside ) );
+
+        __m256d fgLo = _mm256_cvtps_pd( _mm256_castps256_ps128( fg ) );
+        __m256d fgHi = _mm256_cvtps_pd( _mm256_extractf128_ps( fg, 1 ) );
+        __m256d bgLo = _mm256_cvtps_pd( _mm256_castps256_ps128( bg ) );
+        __m256d bgHi = _mm256_cvtps_pd( _mm256_extractf128_ps( bg, 1 ) );
+
+        sumFg = _mm256_add_pd( sumFg, _mm256_add_pd( fgLo, fgHi ) );
+        sumBg = _mm256_add_pd( sumBg, _mm256_add_pd( bgLo, bgHi ) );
+        sqFg  = _mm256_add_pd( sqFg, _mm256_add_pd( _mm256_mul_pd( fgLo, fgLo ), _mm256_mul_pd( fgHi, fgHi ) ) );
+        sqBg  = _mm256_add_pd( sqBg, _mm256_add_pd( _mm256_mul_pd( bgLo, bgLo ), _mm256_mul_pd( bgHi, bgHi ) ) );
+    }
+
+    double lane[4];
+    _mm256_storeu_pd( lane, sumFg ); sums.sum[1]        += lane[0] + lane[1] + lane[2] + lane[3];
+    _mm256_storeu_pd( lane, sumBg ); sums.sum[0]        += lane[0] + lane[1] + lane[2] + lane[3];
+    _mm256_storeu_pd( lane, sqFg );  sums.sumSquares[1] += lane[0] + lane[1] + lane[2] + lane[3];
+    _mm256_storeu_pd( lane, sqBg );  sums.sumSquares[0] += lane[0] + lane[1] + lane[2] + lane[3];
+
+    int laneCnt[8];
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( laneCnt ), cntFg );
+    long long countFg = 0;
+    for ( int k = 0; k < 8; k++ )
+    {
+        countFg += laneCnt[k];
+    }
+    sums.count[1] += countFg;
+    sums.count[0] += static_cast<long long>( i ) - countFg;
+
+    accumulateFloatScalar( data + i, n - i, lo, hi, sums );
+}
+
+template <bool IsSigned>
+THRESHOLD_KERNEL_TARGET("avx2")
+static std::size_t packIntegerAVX2( const void* input, std::size_t n, short lo, short hi, std::uint64_t* bits )
+{
+    const short* data = static_cast<const short*>( input );
+
+    const __m256i vLo  = _mm256_set1_epi16( lo );
+    const __m256i vHi  = _mm256_set1_epi16( hi );
+    const __m256i bias = _mm256_set1_epi16( IsSigned ? 0 : static_cast<short>( -32768 ) );
+
+    std::size_t i = 0;
+    for ( ; i + 64 <= n; i += 64 )
+    {
+        std::uint64_t outside = 0;
+        for ( int k = 0; k < 64; k += 32 )
+        {
+            __m256i a = _mm256_xor_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i + k ) ), bias );
+            __m256i b = _mm256_xor_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i + k + 16 ) ), bias );
+
+            __m256i outA = _mm256_or_si256( _mm256_cmpgt_epi16( vLo, a ), _mm256_cmpgt_epi16( a, vHi ) );
+            __m256i outB = _mm256_or_si256( _mm256_cmpgt_epi16( vLo, b ), _mm256_cmpgt_epi16( b, vHi ) );
+
+            // The pack interleaves the 128-bit lanes of a and b, the permute restores the voxel order
+            __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi16( outA, outB ), 0xD8 );
+            outside |= std::uint64_t( static_cast<unsigned>( _mm256_movemask_epi8( packed ) ) ) << k;
+        }
+
+        bits[i / 64] = ~outside;
+    }
+
+    return i;
+}
+
+THRESHOLD_KERNEL_TARGET("avx2")
+static std::size_t packFloatAVX2( const float* data, std::size_t n, float lo, float hi, std::uint64_t* bits )
+{
+    const __m256 vLo = _mm256_set1_ps( lo );
+    const __m256 vHi = _mm256_set1_ps( hi );
+
+    std::size_t i = 0;
+    for ( ; i + 64 <= n; i += 64 )
+    {
+        std::uint64_t word = 0;
+        for ( int k = 0; k < 64; k += 8 )
+        {
+            __m256 v      = _mm256_loadu_ps( data + i + k );
+            __m256 inside = _mm256_and_ps( _mm256_cmp_ps( v, vLo, _CMP_GE_OQ ), _mm256_cmp_ps( v, vHi, _CMP_LE_OQ ) );
+
+            word |= std::uint64_t( static_cast<unsigned>( _mm256_movemask_ps( inside ) ) ) << k;
+        }
+
+        bits[i / 64] = word;
+    }
+
+    return i;
+}
+/***************************************************************************/
+#endif // THRESHOLD_KERNEL_X86
+
+/******************************* CPU dispatch ********************************/
+static ThresholdKernelISA detectThresholdKernelISA()
+{
+#if THRESHOLD_KERNEL_X86
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid( info, 0 );
+        int maxLeaf = info[0];
+
+        __cpuid( info, 1 );
+        bool sse42   = ( info[2] & ( 1 << 20 ) ) != 0 && ( info[2] & ( 1 << 23 ) ) != 0;   // With POPCNT
+        bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+        bool avx     = ( info[2] & ( 1 << 28 ) ) != 0;
+
+        bool avx2 = false;
+        if ( maxLeaf >= 7 && osxsave && avx && ( _xgetbv( 0 ) & 0x6 ) == 0x6 )
+        {
+            __cpuidex( info, 7, 0 );
+            avx2 = ( info[1] & ( 1 << 5 ) ) != 0;
+        }
+
+        if ( avx2 )  return THRESHOLD_KERNEL_AVX2;
+        if ( sse42 ) return THRESHOLD_KERNEL_SSE42;
+    #else
+        __builtin_cpu_init();
+        // Every CPU with SSE4.2 has POPCNT, but it is a separate feature flag
+        bool popcnt = __builtin_cpu_supports( "popcnt" );
+        if ( __builtin_cpu_supports( "avx2" ) && popcnt )   return THRESHOLD_KERNEL_AVX2;
+        if ( __builtin_cpu_supports( "sse4.2" ) && popcnt ) return THRESHOLD_KERNEL_SSE42;
+    #endif
+#endif
+    return THRESHOLD_KERNEL_SCALAR;
+}
+
+static ThresholdKernelISA& activeThresholdKernelISA()
+{
+    static ThresholdKernelISA isa = detectThresholdKernelISA();
+    return isa;
+}
+
+ThresholdKernelISA getSupportedThresholdKernelISA()
+{
+    static const ThresholdKernelISA supported = detectThresholdKernelISA();
+    return supported;
+}
+
+ThresholdKernelISA getThresholdKernelISA()
+{
+    return activeThresholdKernelISA();
+}
+
+void setThresholdKernelISA( ThresholdKernelISA isa )
+{
+    activeThresholdKernelISA() = std::min( isa, getSupportedThresholdKernelISA() );
+}
+
+const char* getThresholdKernelISAName( ThresholdKernelISA isa )
+{
+    switch ( isa )
+    {
+        case THRESHOLD_KERNEL_AVX2:  return "AVX2";
+        case THRESHOLD_KERNEL_SSE42: return "SSE4.2";
+        default:                     return "scalar";
+    }
+}
+/***************************************************************************/
+
+/***************************** Public entry points ***************************/
+void resetThresholdSums( ThresholdSums& sums )
+{
+    for ( int i = 0; i < 2; i++ )
+    {
+        sums.count[i]      = 0;
+        sums.sum[i]        = 0.0;
+        sums.sumSquares[i] = 0.0;
+    }
+}
+
+template <bool IsSigned, class T>
+static void thresholdAccumulateInteger( const T* data, std::size_t n, double lower, double upper, ThresholdSums& sums )
+{
+    int lo, hi;
+    integerBounds( lower, upper, lo, hi );
+
+    IntegerSums exact = { { 0, 0 }, { 0, 0 }, { 0, 0 } };
+
+    switch ( activeThresholdKernelISA() )
+    {
+#if THRESHOLD_KERNEL_X86
+        case THRESHOLD_KERNEL_AVX2:
+            accumulateIntegerAVX2<IsSigned>( data, n, lo, hi, exact );
+            break;
+        case THRESHOLD_KERNEL_SSE42:
+            accumulateIntegerSSE42<IsSigned>( data, n, lo, hi, exact );
+            break;
+#endif
+        default:
+            accumulateIntegerScalar( data, n, lo, hi, exact );
+            break;
+    }
+
+    // The SIMD kernels only count the background, the rest is foreground
+    exact.count[1] = static_cast<long long>( n ) - exact.count[0];
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        sums.count[i]      += exact.count[i];
+        sums.sum[i]        += static_cast<double>( exact.sum[i] );
+        sums.sumSquares[i] += static_cast<double>( exact.sumSquares[i] );
+    }
+}
+
+void thresholdAccumulate( const short* data, std::size_t n, double lower, double upper, ThresholdSums& sums )
+{
+    thresholdAccumulateInteger<true>( data, n, lower, upper, sums );
+}
+
+void thresholdAccumulate( const unsigned short* data, std::size_t n, double lower, double upper, ThresholdSums& sums )
+{
+    thresholdAccumulateInteger<false>( data, n, lower, upper, sums );
+}
+
+void thresholdAccumulate( const float* data, std::size_t n, double lower, double upper, ThresholdSums& sums )
+{
+    float lo, hi;
+    floatBounds( lower, upper, lo, hi );
+
+    switch ( activeThresholdKernelISA() )
+    {
+#if THRESHOLD_KERNEL_X86
+        case THRESHOLD_KERNEL_AVX2:
+            accumulateFloatAVX2( data, n, lo, hi, sums );
+            break;
+        case THRESHOLD_KERNEL_SSE42:
+            accumulateFloatSSE42( data, n, lo, hi, sums );
+            break;
+#endif
+        default:
+            accumulateFloatScalar( data, n, lo, hi, sums );
+            break;
+    }
+}
+/***************************************************************************/
+
+/*
+*   The integer thresholds as signed 16-bit compare bounds of a type, biased
+*   like the voxels of the integer pack kernels.
+*
+*   @returns false when no value of the type is inside
+*/
+static bool packBounds( int lo, int hi, bool isSigned, short& lo16, short& hi16 )
+{
+    int minimum = isSigned ? -32768 : 0;
+    int maximum = isSigned ? 32767 : 65535;
+    int bias    = isSigned ? 0 : -32768;
+
+    lo = std::max( lo, minimum );
+    hi = std::min( hi, maximum );
+    if ( lo > hi )
+    {
+        return false;
+    }
+
+    lo16 = static_cast<short>( lo + bias );
+    hi16 = static_cast<short>( hi + bias );
+    return true;
+}
+
+template <bool IsSigned, class T>
+static void thresholdPackInteger( const T* data, std::size_t n, double lower, double upper, std::uint64_t* bits )
+{
+    int lo, hi;
+    integerBounds( lower, upper, lo, hi );
+
+    short lo16, hi16;
+    if ( !packBounds( lo, hi, IsSigned, lo16, hi16 ) )
+    {
+        std::fill( bits, bits + ( n + 63 ) / 64, std::uint64_t( 0 ) );
+        return;
+    }
+
+    std::size_t done = 0;
+    switch ( activeThresholdKernelISA() )
+    {
+#if THRESHOLD_KERNEL_X86
+        case THRESHOLD_KERNEL_AVX2:
+            done = packIntegerAVX2<IsSigned>( data, n, lo16, hi16, bits );
+            break;
+        case THRESHOLD_KERNEL_SSE42:
+            done = packIntegerSSE42<IsSigned>( data, n, lo16, hi16, bits );
+            break;
+#endif
+        default:
+            break;
+    }
+
+    packScalar( data + done, n - done, lo, hi, bits + done / 64 );
+}
+
+void thresholdPack( const short* data, std::size_t n, double lower, double upper, std::uint64_t* bits )
+{
+    thresholdPackInteger<true>( data, n, lower, upper, bits );
+}
+
+void thresholdPack( const unsigned short* data, std::size_t n, double lower, double upper, std::uint64_t* bits )
+{
+    thresholdPackInteger<false>( data, n, lower, upper, bits );
+}
+
+void thresholdPack( const float* data, std::size_t n, double lower, double upper, std::uint64_t* bits )
+{
+    float lo, hi;
+    floatBounds( lower, upper, lo, hi );
+
+    std::size_t done = 0;
+    switch ( activeThresholdKernelISA() )
+    {
+#if THRESHOLD_KERNEL_X86
+        case THRESHOLD_KERNEL_AVX2:
+            done = packFloatAVX2( data, n, lo, hi, bits );
+            break;
+        case THRESHOLD_KERNEL_SSE42:
+            done = packFloatSSE42( data, n, lo, hi, bits );
+            break;
+#endif
+        default:
+            break;
+    }
+
+    packScalar( data + done, n - done, lo, hi, bits + done / 64 );
+}
+
+long long countBits( const std::uint64_t* words, std::size_t n )
+{
+#if THRESHOLD_KERNEL_X86
+    if ( activeThresholdKernelISA() != THRESHOLD_KERNEL_SCALAR )
+    {
+        return countBitsPopcnt( words, n );
+    }
+#endif
+
+    return countBitsScalar( words, n );
+}
@@ -0,0 +1,108 @@
+/****************************************************************************
+*   thresholdKernel.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the branch-free threshold classify,
+*                   accumulate and pack kernels (scalar, SSE4.2 and AVX2).
+****************************************************************************/
+
+#ifndef THRESHOLDKERNEL_H
+#define THRESHOLDKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+*   Instruction sets the kernels can run with. The best supported one is
+*   selected at runtime from the CPU features.
+*/
+enum ThresholdKernelISA
+{
+    THRESHOLD_KERNEL_SCALAR = 0,
+    THRESHOLD_KERNEL_SSE42  = 1,
+    THRESHOLD_KERNEL_AVX2   = 2
+};
+
+/*
+*   Masked sums of one call. Index 1 holds the foreground (voxels inside
+*   [lower, upper]), index 0 the background.
+*/
+struct ThresholdSums
+{
+    long long count[2];
+    double sum[2];
+    double sumSquares[2];
+};
+
+/*
+*   Reset a set of sums to zero.
+*
+*   @param   sums   The sums to reset
+*/
+void resetThresholdSums( ThresholdSums& sums );
+
+/*
+*   @returns the best instruction set supported by the CPU (and by the build)
+*/
+ThresholdKernelISA getSupportedThresholdKernelISA();
+
+/*
+*   @returns the instruction set currently used by thresholdAccumulate()
+*/
+ThresholdKernelISA getThresholdKernelISA();
+
+/*
+*   Force the instruction set used by thresholdAccumulate(). Requests for an
+*   unsupported instruction set fall back to the best supported one.
+*
+*   @param   isa   The instruction set to use
+*/
+void setThresholdKernelISA( ThresholdKernelISA isa );
+
+/*
+*   @returns a printable name for an instruction set
+*/
+const char* getThresholdKernelISAName( ThresholdKernelISA isa );
+
+/*
+*   Classify n contiguous voxels against [lower, upper] and add their counts,
+*   sums and sums of squares to the foreground/background totals in sums.
+*   Integer data is accumulated exactly.
+*
+*   @param   data    Pointer to the first voxel
+*   @param   n       Number of voxels
+*   @param   lower   The lower threshold
+*   @param   upper   The upper threshold
+*   @param   sums    The totals to add to
+*/
+void thresholdAccumulate( const short* data, std::size_t n, double lower, double upper, ThresholdSums& sums );
+void thresholdAccumulate( const unsigned short* data, std::size_t n, double lower, double upper, ThresholdSums& sums );
+void thresholdAccumulate( const float* data, std::size_t n, double lower, double upper, ThresholdSums& sums );
+
+/*
+*   Classify n contiguous voxels against [lower, upper] and pack the result
+*   one bit per voxel: bit k of bits[w] is set when voxel 64 * w + k is inside.
+*   All (n + 63) / 64 words are written, the unused bits of the last one are 0.
+*
+*   @param   data    Pointer to the first voxel
+*   @param   n       Number of voxels
+*   @param   lower   The lower threshold
+*   @param   upper   The upper threshold
+*   @param   bits    Receives the packed voxels
+*/
+void thresholdPack( const short* data, std::size_t n, double lower, double upper, std::uint64_t* bits );
+void thresholdPack( const unsigned short* data, std::size_t n, double lower, double upper, std::uint64_t* bits );
+void thresholdPack( const float* data, std::size_t n, double lower, double upper, std::uint64_t* bits );
+
+/*
+*   Count the set bits of n words (POPCNT when the SSE4.2 or AVX2 kernels are used).
+*
+*   @param   words   Pointer to the first word
+*   @param   n       Number of words
+*
+*   @returns the number of set bits
+*/
+long long countBits( const std::uint64_t* words, std::size_t n );
+
+#endif // THRESHOLDKERNEL_H
@@ -0,0 +1,206 @@
+/****************************************************************************
+*   thresholdKernelBench.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Micro-benchmark of the threshold classify, accumulate and
+*                   pack kernels against the GetScalarComponentAsDouble() loop.
+****************************************************************************/
+
+#include "thresholdKernel.hxx"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   The original per-voxel path from main(): one virtual call and type dispatch per voxel.
+*/
+static double runComponentLoop( vtkImageData* image, double lower, double upper, ThresholdSums& sums )
+{
+    int* dims = image->GetDimensions();
+
+    resetThresholdSums( sums );
+
+    auto start = std::chrono::steady_clock::now();
+    for ( int z = 0; z < dims[2]; z++ )
+    {
+        for ( int y = 0; y < dims[1]; y++ )
+        {
+            for ( int x = 0; x < dims[0]; x++ )
+            {
+                double voxel = image->GetScalarComponentAsDouble( x, y, z, 0 );
+
+                if ( voxel <= upper && voxel >= lower )
+                {
+                    sums.count[1]++;
+                    sums.sum[1]        += voxel;
+                    sums.sumSquares[1] += voxel * voxel;
+                }
+                else
+                {
+                    sums.count[0]++;
+                    sums.sum[0]        += voxel;
+                    sums.sumSquares[0] += voxel * voxel;
+                }
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>( end - start ).count();
+}
+
+/*
+*   Whether two totals agree up to the rounding of a different summation order.
+*/
+static bool closeTo( double value, double expected )
+{
+    return std::abs( value - expected ) <= 1e-9 * std::max( 1.0, std::abs( expected ) );
+}
+
+/*
+*   Compare the counts, sums and sums of squares of a kernel with the reference loop.
+*
+*   @returns an empty string when they match, else the first quantity that differs
+*/
+static std::string compareSums( const ThresholdSums& sums, const ThresholdSums& reference )
+{
+    for ( int i = 0; i < 2; i++ )
+    {
+        if ( sums.count[i] != reference.count[i] )
+        {
+            return "  COUNT MISMATCH";
+        }
+        if ( !closeTo( sums.sum[i], reference.sum[i] ) )
+        {
+            return "  SUM MISMATCH";
+        }
+        if ( !closeTo( sums.sumSquares[i], reference.sumSquares[i] ) )
+        {
+            return "  SUM OF SQUARES MISMATCH";
+        }
+    }
+
+    return "";
+}
+
+/*
+*   The kernel path, called once per row like SNRStatistics does.
+*/
+template <class T>
+static double runKernel( vtkImageData* image, double lower, double upper, ThresholdSums& sums )
+{
+    int* dims      = image->GetDimensions();
+    const T* data  = static_cast<const T*>( image->GetScalarPointer() );
+    std::size_t rows = std::size_t( dims[1] ) * dims[2];
+
+    resetThresholdSums( sums );
+
+    auto start = std::chrono::steady_clock::now();
+    for ( std::size_t row = 0; row < rows; row++ )
+    {
+        thresholdAccumulate( data + row * dims[0], dims[0], lower, upper, sums );
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>( end - start ).count();
+}
+
+/*
+*   The bit mask path: one slice per call like BitMask::thresholdSlice(), then a popcount.
+*/
+template <class T>
+static double runPack( vtkImageData* image, double lower, double upper, long long& count )
+{
+    int* dims          = image->GetDimensions();
+    const T* data      = static_cast<const T*>( image->GetScalarPointer() );
+    std::size_t slice  = std::size_t( dims[0] ) * dims[1];
+    std::size_t words  = ( slice + 63 ) / 64;
+    std::vector<std::uint64_t> bits( words * dims[2] );
+
+    auto start = std::chrono::steady_clock::now();
+    for ( int z = 0; z < dims[2]; z++ )
+    {
+        thresholdPack( data + z * slice, slice, lower, upper, &bits[z * words] );
+    }
+    count = countBits( bits.data(), bits.size() );
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>( end - start ).count();
+}
+
+template <class T>
+static void benchmarkType( const std::string& name, int scalarType, int size, double lower, double upper )
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions( size, size, size );
+    image->AllocateScalars( scalarType, 1 );
+
+    // Noisy two-class phantom: alternating rows around 100 (background) and 1000 (foreground)
+    std::mt19937 generator( 42 );
+    std::normal_distribution<double> noise( 0.0, 50.0 );
+    T* data = static_cast<T*>( image->GetScalarPointer() );
+    vtkIdType numVoxels = image->GetNumberOfPoints();
+    for ( vtkIdType i = 0; i < numVoxels; i++ )
+    {
+        double value = ( ( i / size ) % 2 == 0 ? 100.0 : 1000.0 ) + noise( generator );
+        data[i] = static_cast<T>( std::numeric_limits<T>::is_signed ? value : std::max( 0.0, value ) );
+    }
+
+    ThresholdSums reference, sums;
+    double voxels = double( numVoxels );
+
+    std::cout << "\n" << name << " (" << size << "^3 voxels)\n";
+
+    double seconds = runComponentLoop( image, lower, upper, reference );
+    std::cout << "  GetScalarComponentAsDouble: " << std::setw( 12 ) << voxels / seconds << " voxels/s\n";
+
+    for ( int isa = THRESHOLD_KERNEL_SCALAR; isa <= getSupportedThresholdKernelISA(); isa++ )
+    {
+        setThresholdKernelISA( ThresholdKernelISA( isa ) );
+        seconds = runKernel<T>( image, lower, upper, sums );
+
+        std::cout << "  kernel (" << std::setw( 6 ) << getThresholdKernelISAName( ThresholdKernelISA( isa ) ) << "):    "
+                  << std::setw( 12 ) << voxels / seconds << " voxels/s" << compareSums( sums, reference ) << "\n";
+
+        long long count = 0;
+        seconds = runPack<T>( image, lower, upper, count );
+        std::cout << "  pack   (" << std::setw( 6 ) << getThresholdKernelISAName( ThresholdKernelISA( isa ) ) << "):    "
+                  << std::setw( 12 ) << voxels / seconds << " voxels/s"
+                  << ( count == reference.count[1] ? "" : "  COUNT MISMATCH" ) << "\n";
+    }
+
+    setThresholdKernelISA( getSupportedThresholdKernelISA() );
+}
+
+int main( int argc, char* argv[] )
+{
+    int size = ( argc > 1 ) ? atoi( argv[1] ) : 256;
+    if ( size <= 0 )
+    {
+        std::cout << "Usage: " << argv[0] << " [volume edge length] \n";
+        return EXIT_FAILURE;
+    }
+
+    double lower = 500.0, upper = 2000.0;
+
+    std::cout << std::scientific << std::setprecision( 3 );
+    std::cout << "Detected instruction set: " << getThresholdKernelISAName( getSupportedThresholdKernelISA() ) << "\n";
+
+    benchmarkType<short>( "int16", VTK_SHORT, size, lower, upper );
+    benchmarkType<unsigned short>( "uint16", VTK_UNSIGNED_SHORT, size, lower, upper );
+    benchmarkType<float>( "float", VTK_FLOAT, size, lower, upper );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+/****************************************************************************
+*   thresholdOverlay.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the segmentation overlay that follows
+*                   interactive threshold changes.
+****************************************************************************/
+
+#include "thresholdOverlay.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#include <vtkSMPTools.h>
+
+ThresholdOverlay::ThresholdOverlay()
+    : histogramsBuilt( false ), lowerThreshold( 0.0 ), upperThreshold( 0.0 ), thresholdStep( 1.0 ),
+      minSlice( 0 ), numberOfSlices( 0 ), generation( 0 ), completedGeneration( 0 ), focusSlice( 0 ),
+      stopping( false )
+{
+}
+
+ThresholdOverlay::~ThresholdOverlay()
+{
+    stopBackground();
+}
+
+void ThresholdOverlay::setInput( vtkImageData* image )
+{
+    stopBackground();
+
+    input = image;
+
+    int extent[6];
+    image->GetExtent( extent );
+
+    // One bit per voxel: 1/32 of the float segmentation it replaces
+    mask.setGeometry( image );
+    maskTime.Modified();
+
+    minSlice       = extent[4];
+    numberOfSlices = extent[5] - extent[4] + 1;
+
+    sliceLocks.reset( new std::mutex[numberOfSlices] );
+    sliceGenerations.assign( numberOfSlices, 0 );
+
+    generation          = 0;
+    completedGeneration = 0;
+    stopping            = false;
+
+    double range[2];
+    image->GetScalarRange( range );
+    thresholdStep = ( range[1] - range[0] ) / 200.0;
+
+    if ( image->GetScalarType() != VTK_FLOAT && image->GetScalarType() != VTK_DOUBLE )
+    {
+        thresholdStep = std::max( 1.0, std::floor( thresholdStep + 0.5 ) );
+    }
+    else if ( thresholdStep <= 0.0 )
+    {
+        thresholdStep = 1.0;
+    }
+}
+
+void ThresholdOverlay::setThresholdFilter( vtkImageThreshold* filter )
+{
+    thresholdFilter = filter;
+}
+
+bool ThresholdOverlay::buildHistograms( const std::vector<vtkImageData*>& images, const int extent[6] )
+{
+    bool built = true;
+
+    histograms.resize( images.size() );
+    for ( std::size_t i = 0; i < images.size(); i++ )
+    {
+        histograms[i].setExtent( extent );
+        built = histograms[i].build( images[i] ) && built;
+    }
+
+    histogramsBuilt = built;
+    return built;
+}
+
+void ThresholdOverlay::setThresholds( double lower, double upper, int slice )
+{
+    int sliceGeneration;
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        lowerThreshold  = lower;
+        upperThreshold  = upper;
+        sliceGeneration = ++generation;
+        focusSlice      = slice;
+    }
+
+    if ( thresholdFilter )
+    {
+        thresholdFilter->ThresholdBetween( lower, upper );
+    }
+
+    if ( !input )
+    {
+        return;
+    }
+
+    // The displayed slice now, everything else in the background
+    updateSlice( std::min( std::max( slice - minSlice, 0 ), numberOfSlices - 1 ), sliceGeneration, lower, upper );
+    maskTime.Modified();
+
+    if ( !worker.joinable() )
+    {
+        worker = std::thread( &ThresholdOverlay::backgroundLoop, this );
+    }
+    wake.notify_one();
+}
+
+void ThresholdOverlay::showSlice( int slice )
+{
+    focusSlice = slice;
+
+    if ( !input || slice < minSlice || slice >= minSlice + numberOfSlices )
+    {
+        return;
+    }
+
+    // Only this thread changes the thresholds, so they can be read without the lock
+    if ( updateSlice( slice - minSlice, generation, lowerThreshold, upperThreshold ) )
+    {
+        maskTime.Modified();
+    }
+}
+
+void ThresholdOverlay::expandSlice( int slice, const int rect[4], unsigned char* rgba, const unsigned char inside[4],
+                                    const unsigned char outside[4] )
+{
+    std::lock_guard<std::mutex> lock( sliceLocks[slice - minSlice] );
+    mask.expandSlice( slice, rect, rgba, inside, outside );
+}
+
+vtkSmartPointer<vtkImageData> ThresholdOverlay::createSegmentationImage( unsigned char value )
+{
+    if ( !input )
+    {
+        return nullptr;
+    }
+
+    const int* extent = mask.getExtent();
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent( extent[0], extent[1], extent[2], extent[3], extent[4], extent[5] );
+    image->SetSpacing( input->GetSpacing() );
+    image->SetOrigin( input->GetOrigin() );
+    image->AllocateScalars( VTK_UNSIGNED_CHAR, 1 );
+
+    for ( int slice = 0; slice < numberOfSlices; slice++ )
+    {
+        std::lock_guard<std::mutex> lock( sliceLocks[slice] );
+        mask.expandSlice( minSlice + slice, image, value );
+    }
+
+    return image;
+}
+
+SNRPartial ThresholdOverlay::getStatistics( int image, double effective[2] ) const
+{
+    return histograms[image].query( lowerThreshold, upperThreshold, effective );
+}
+
+bool ThresholdOverlay::isComplete() const
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    return completedGeneration == generation;
+}
+
+void ThresholdOverlay::waitUntilComplete()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+    finished.wait( lock, [this]() { return completedGeneration == generation || stopping; } );
+}
+
+bool ThresholdOverlay::updateSlice( int slice, int sliceGeneration, double lower, double upper )
+{
+    std::lock_guard<std::mutex> lock( sliceLocks[slice] );
+
+    // Generations only grow: a slice done for newer thresholds is left alone
+    if ( sliceGenerations[slice] >= sliceGeneration )
+    {
+        return false;
+    }
+
+    // Packed with the SIMD threshold kernels, 64 voxels per word
+    mask.thresholdSlice( input, minSlice + slice, lower, upper );
+
+    sliceGenerations[slice] = sliceGeneration;
+    return true;
+}
+
+void ThresholdOverlay::backgroundLoop()
+{
+    TraceRecorder::setThreadName( "threshold overlay" );
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    while ( true )
+    {
+        wake.wait( lock, [this]() { return stopping || completedGeneration != generation; } );
+
+        if ( stopping )
+        {
+            return;
+        }
+
+        int current  = generation;
+        double lower = lowerThreshold;
+        double upper = upperThreshold;
+        int focus    = std::min( std::max( focusSlice - minSlice, 0 ), numberOfSlices - 1 );
+        lock.unlock();
+
+        // Nearest slices first (focus, focus - 1, focus + 1, ...), so scrolling finds them done
+        std::vector<int> order;
+        order.reserve( numberOfSlices );
+        for ( int step = 0; step <= 2 * numberOfSlices; step++ )
+        {
+            int offset = ( step + 1 ) / 2;
+            int slice  = ( step % 2 == 0 ) ? focus + offset : focus - offset;
+
+            if ( slice >= 0 && slice < numberOfSlices )
+            {
+                order.push_back( slice );
+            }
+        }
+
+        auto thresholdSlices = [&]( vtkIdType begin, vtkIdType end )
+        {
+            for ( vtkIdType i = begin; i < end; i++ )
+            {
+                updateSlice( order[i], current, lower, upper );
+            }
+        };
+
+        // A few slices per thread at a time, so new thresholds interrupt the pass quickly
+        vtkIdType batch = 2 * std::max( 1, vtkSMPTools::GetEstimatedNumberOfThreads() );
+
+        ScopedTimer timer( "threshold overlay", "segmentation" );
+        bool complete = true;
+        for ( vtkIdType begin = 0; begin < static_cast<vtkIdType>( order.size() ); begin += batch )
+        {
+            if ( generation != current || stopping )
+            {
+                complete = false;
+                break;
+            }
+
+            vtkSMPTools::For( begin, std::min( begin + batch, static_cast<vtkIdType>( order.size() ) ), 1,
+                              thresholdSlices );
+        }
+
+        lock.lock();
+        if ( complete )
+        {
+            completedGeneration = current;
+            finished.notify_all();
+        }
+    }
+}
+
+void ThresholdOverlay::stopBackground()
+{
+    if ( !worker.joinable() )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopping = true;
+    }
+    wake.notify_all();
+    finished.notify_all();
+
+    worker.join();
+}
@@ -0,0 +1,207 @@
+/****************************************************************************
+*   thresholdOverlay.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the segmentation overlay that follows
+*                   interactive threshold changes.
+****************************************************************************/
+
+#ifndef THRESHOLDOVERLAY_H
+#define THRESHOLDOVERLAY_H
+
+#include "snrStatistics.hxx"
+#include "intensityHistogram.hxx"
+#include "bitMask.hxx"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkImageThreshold.h>
+#include <vtkTimeStamp.h>
+
+/*
+*   The segmentation ([lower, upper] = 1, everything else = 0) shown over the
+*   original image, kept up to date while the thresholds are changed. It is
+*   held as a BitMask (one bit per voxel) and only expanded to RGBA for the
+*   displayed slice (see myMaskSliceSource).
+*
+*   A threshold change only thresholds the displayed slice, so the overlay is
+*   updated within a frame. A background thread then re-thresholds the other
+*   slices, nearest to the displayed one first and a few at a time with
+*   vtkSMPTools, and restarts whenever the thresholds change again. A slice that is shown before the thread reaches it
+*   is thresholded on the spot.
+*
+*   The SNR of the original and filtered images for new thresholds is
+*   answered from an IntensityHistogram per image, built once, so it does not
+*   touch the images either.
+*
+*   In streaming mode there is no volume to segment: the thresholds are passed
+*   on to the vtkImageThreshold of the displayed slice instead, and there are
+*   no histograms.
+*/
+class ThresholdOverlay
+{
+    public:
+        ThresholdOverlay();
+        ~ThresholdOverlay();
+
+        /*
+        *   Set the image to segment and allocate the mask (same geometry).
+        *   Nothing is thresholded until setThresholds() is called.
+        *
+        *   @param   image   The original image
+        */
+        void setInput( vtkImageData* image );
+
+        /*
+        *   Set a threshold filter that gets every new threshold pair (streaming mode).
+        *
+        *   @param   filter   The filter of the displayed slice
+        */
+        void setThresholdFilter( vtkImageThreshold* filter );
+
+        /*
+        *   Build the histograms used by getStatistics(). May run on another
+        *   thread while the viewer is open: hasHistograms() turns true once
+        *   all of them are built.
+        *
+        *   @param   images   The original image, then the filtered images
+        *   @param   extent   The extent the SNR is calculated over
+        *
+        *   @returns a boolean representing whether all histograms were built
+        */
+        bool buildHistograms( const std::vector<vtkImageData*>& images, const int extent[6] );
+
+        /*
+        *   @returns whether getStatistics() can be used
+        */
+        bool hasHistograms() const { return histogramsBuilt; }
+
+        /*
+        *   @returns whether there is a mask (an input image was set)
+        */
+        bool hasMask() const { return input != nullptr; }
+
+        /*
+        *   @returns the mask. The background thread writes it until isComplete().
+        */
+        const BitMask& getMask() const { return mask; }
+
+        /*
+        *   @returns the time of the last change of the mask by setThresholds() or showSlice()
+        */
+        vtkMTimeType getMaskMTime() const { return maskTime.GetMTime(); }
+
+        /*
+        *   Expand a rectangle of one slice of the mask into RGBA pixels, while
+        *   the background thread cannot write it.
+        *
+        *   @param   slice     The slice
+        *   @param   rect      xMin, xMax, yMin, yMax
+        *   @param   rgba      Receives 4 bytes per pixel
+        *   @param   inside    Colour of the voxels inside the thresholds
+        *   @param   outside   Colour of the other voxels
+        */
+        void expandSlice( int slice, const int rect[4], unsigned char* rgba, const unsigned char inside[4],
+                          const unsigned char outside[4] );
+
+        /*
+        *   Expand the whole mask into an unsigned char volume (e.g. for volume
+        *   rendering), slice by slice as they are now.
+        *
+        *   @param   value   Value of the voxels inside (the others are 0)
+        *
+        *   @returns the volume, or nullptr without an input image
+        */
+        vtkSmartPointer<vtkImageData> createSegmentationImage( unsigned char value );
+
+        /*
+        *   Change the thresholds. The given slice is thresholded before this
+        *   returns, the rest of the volume in the background.
+        *
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        *   @param   slice   The displayed slice
+        */
+        void setThresholds( double lower, double upper, int slice );
+
+        /*
+        *   Make sure a slice is up to date before it is displayed.
+        *
+        *   @param   slice   The slice that is about to be displayed
+        */
+        void showSlice( int slice );
+
+        double getLowerThreshold() const { return lowerThreshold; }
+        double getUpperThreshold() const { return upperThreshold; }
+
+        /*
+        *   @returns the threshold change per key press: 1/200 of the intensity
+        *            range of the input, at least 1 for integer images
+        */
+        double getThresholdStep() const { return thresholdStep; }
+
+        /*
+        *   Statistics of one image for the current thresholds, from its histogram.
+        *
+        *   @param   image       0 = original, 1... = the filtered images
+        *   @param   effective   If not null, receives the threshold range that was used
+        *
+        *   @returns the foreground/background statistics
+        */
+        SNRPartial getStatistics( int image, double effective[2] = nullptr ) const;
+
+        /*
+        *   @returns whether every slice is thresholded with the current thresholds
+        */
+        bool isComplete() const;
+
+        /*
+        *   Block until the whole segmentation matches the current thresholds.
+        */
+        void waitUntilComplete();
+
+    private:
+        ThresholdOverlay( const ThresholdOverlay& ) = delete;
+        void operator=( const ThresholdOverlay& ) = delete;
+
+        bool updateSlice( int slice, int sliceGeneration, double lower, double upper );
+        void backgroundLoop();
+        void stopBackground();
+
+        vtkSmartPointer<vtkImageData> input;
+        BitMask mask;
+        vtkTimeStamp maskTime;
+        vtkSmartPointer<vtkImageThreshold> thresholdFilter;
+        std::vector<IntensityHistogram> histograms;
+        std::atomic<bool> histogramsBuilt;
+
+        double lowerThreshold;
+        double upperThreshold;
+        double thresholdStep;
+        int minSlice;
+        int numberOfSlices;
+
+        // Slice z holds the segmentation of generation sliceGenerations[z], guarded by sliceLocks[z]
+        std::unique_ptr<std::mutex[]> sliceLocks;
+        std::vector<int> sliceGenerations;
+
+        // Current generation and thresholds for the background thread, guarded by mutex
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::atomic<int> generation;
+        int completedGeneration;
+        std::atomic<int> focusSlice;
+        std::atomic<bool> stopping;
+        std::thread worker;
+};
+
+#endif // THRESHOLDOVERLAY_H
@@ -0,0 +1,416 @@
+/****************************************************************************
+*   volumeCache.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the on-disk cache of the original and
+*                   filtered volumes.
+****************************************************************************/
+
+#include "volumeCache.hxx"
+#include "mappedFile.hxx"
+#include "stageTrace.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// Changing the layout or the filters' behaviour must change the version
+static const char cacheMagic[8] = { 'V', 'T', 'K', 'M', 'C', 'A', 'C', 'H' };
+static const int cacheVersion   = 3;
+static const std::size_t cacheAlignment = 4096;
+
+/*
+*   Fixed-size header at the start of a cache file, followed by one
+*   CacheImage per image and the full entry key. The cache is local to one
+*   machine, so the fields are stored in native byte order.
+*/
+struct CacheHeader
+{
+    char magic[8];
+    int version;
+    int headerSize;
+    int imageCount;
+    long long keyBytes;
+    int extent[6];
+    double spacing[3];
+    double origin[3];
+};
+
+struct CacheImage
+{
+    int scalarType;
+    int components;
+    long long offset;
+    long long bytes;
+};
+
+/*
+*   64-bit FNV-1a hash of a string.
+*/
+static unsigned long long fnv1a( const std::string& text )
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for ( std::size_t i = 0; i < text.size(); i++ )
+    {
+        hash ^= static_cast<unsigned char>( text[i] );
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::size_t alignUp( std::size_t value )
+{
+    return ( value + cacheAlignment - 1 ) / cacheAlignment * cacheAlignment;
+}
+
+/*
+*   @returns the process ID, so temporary files of concurrent processes differ
+*/
+static long processId()
+{
+#ifdef _WIN32
+    return static_cast<long>( _getpid() );
+#else
+    return static_cast<long>( getpid() );
+#endif
+}
+
+static std::atomic<unsigned long> temporaryCounter( 0 );
+
+VolumeCache::VolumeCache( const ProgramOptions& options )
+    : enabled( options.useCache ), directory( options.cacheDirectory ),
+      maximumBytes( options.cacheSizeMB * 1024.0 * 1024.0 ),
+      filters( options.filters )
+{
+    if ( !enabled )
+    {
+        return;
+    }
+
+    if ( directory.empty() )
+    {
+        std::string base;
+        if ( vtksys::SystemTools::GetEnv( "VTKMETRICS_CACHE_DIR", base ) )
+        {
+            directory = base;
+        }
+        else if ( vtksys::SystemTools::GetEnv( "LOCALAPPDATA", base ) )
+        {
+            directory = base + "/vtkMetrics";
+        }
+        else if ( vtksys::SystemTools::GetEnv( "HOME", base ) )
+        {
+            directory = base + "/.cache/vtkMetrics";
+        }
+    }
+
+    enabled = !directory.empty() && vtksys::SystemTools::MakeDirectory( directory );
+}
+
+std::string VolumeCache::getEntryKey( const std::string& input ) const
+{
+    std::string fullPath = vtksys::SystemTools::CollapseFullPath( input );
+
+    std::ostringstream key;
+    key << "v" << cacheVersion << "|" << fullPath;
+
+    // Size and modification time of the input (of every file in a DICOM directory)
+    if ( vtksys::SystemTools::FileIsDirectory( fullPath ) )
+    {
+        vtksys::Directory files;
+        files.Load( fullPath );
+
+        std::vector<std::string> names;
+        for ( unsigned long i = 0; i < files.GetNumberOfFiles(); i++ )
+        {
+            names.push_back( files.GetFile( i ) );
+        }
+        std::sort( names.begin(), names.end() );
+
+        for ( std::size_t i = 0; i < names.size(); i++ )
+        {
+            std::string path = fullPath + "/" + names[i];
+            key << "|" << names[i] << ":" << vtksys::SystemTools::FileLength( path )
+                << ":" << vtksys::SystemTools::ModifiedTime( path );
+        }
+    }
+    else
+    {
+        key << "|" << vtksys::SystemTools::FileLength( fullPath ) << ":" << vtksys::SystemTools::ModifiedTime( fullPath );
+    }
+
+    // Every filter with all its parameters, in order
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        key << "|" << filters[i].toString();
+    }
+
+    return key.str();
+}
+
+std::string VolumeCache::getEntryPath( const std::string& input ) const
+{
+    return getKeyPath( getEntryKey( input ) );
+}
+
+std::string VolumeCache::getKeyPath( const std::string& key ) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << fnv1a( key ) << ".vmc";
+
+    return directory + "/" + name.str();
+}
+
+bool VolumeCache::load( const std::string& input, std::vector< vtkSmartPointer<vtkImageData> >& images ) const
+{
+    if ( !enabled )
+    {
+        return false;
+    }
+
+    ScopedTimer timer( "cache load", "io" );
+
+    std::string key  = getEntryKey( input );
+    std::string path = getKeyPath( key );
+    if ( !vtksys::SystemTools::FileExists( path, true ) )
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::vector<CacheImage> records( filters.size() + 1 );
+    std::size_t recordBytes = records.size() * sizeof( CacheImage );
+    std::string storedKey( key.size(), '\0' );
+    std::shared_ptr<MappedFile> file = MappedFile::open( path );
+    std::ifstream stream;
+
+    // Without a mapping (Windows) the voxels are read into memory instead
+    if ( file )
+    {
+        if ( file->size() < sizeof( header ) + recordBytes + key.size() )
+        {
+            return false;
+        }
+        std::memcpy( &header, file->data(), sizeof( header ) );
+        std::memcpy( records.data(), file->data() + sizeof( header ), recordBytes );
+        std::memcpy( &storedKey[0], file->data() + sizeof( header ) + recordBytes, key.size() );
+    }
+    else
+    {
+        stream.open( path.c_str(), std::ios::binary );
+        if ( !stream.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) ||
+             !stream.read( reinterpret_cast<char*>( records.data() ), recordBytes ) ||
+             !stream.read( &storedKey[0], key.size() ) )
+        {
+            return false;
+        }
+    }
+
+    // The file name is only a hash, so another input whose key has the same hash must miss
+    if ( std::memcmp( header.magic, cacheMagic, sizeof( cacheMagic ) ) != 0 || header.version != cacheVersion ||
+         header.headerSize != static_cast<int>( sizeof( header ) ) ||
+         header.imageCount != static_cast<int>( records.size() ) ||
+         header.keyBytes != static_cast<long long>( key.size() ) || storedKey != key )
+    {
+        return false;
+    }
+
+    vtkIdType points = vtkIdType( header.extent[1] - header.extent[0] + 1 ) *
+                       vtkIdType( header.extent[3] - header.extent[2] + 1 ) *
+                       vtkIdType( header.extent[5] - header.extent[4] + 1 );
+
+    images.resize( records.size() );
+    for ( std::size_t i = 0; i < records.size(); i++ )
+    {
+        const CacheImage& record = records[i];
+
+        images[i] = vtkSmartPointer<vtkImageData>::New();
+        images[i]->SetExtent( header.extent );
+        images[i]->SetSpacing( header.spacing );
+        images[i]->SetOrigin( header.origin );
+
+        if ( record.bytes != static_cast<long long>( points ) * record.components *
+                             vtkDataArray::GetDataTypeSize( record.scalarType ) )
+        {
+            return false;
+        }
+
+        if ( file )
+        {
+            vtkSmartPointer<vtkDataArray> scalars = MappedFile::createArray(
+                file, static_cast<std::size_t>( record.offset ), record.scalarType, record.components, points );
+
+            if ( !scalars )
+            {
+                return false;
+            }
+            images[i]->GetPointData()->SetScalars( scalars );
+        }
+        else
+        {
+            images[i]->AllocateScalars( record.scalarType, record.components );
+            stream.seekg( record.offset );
+            if ( !stream.read( static_cast<char*>( images[i]->GetScalarPointer() ), record.bytes ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    // Mark the entry as recently used
+    vtksys::SystemTools::Touch( path, false );
+
+    return true;
+}
+
+bool VolumeCache::store( const std::string& input, const std::vector< vtkSmartPointer<vtkImageData> >& images ) const
+{
+    if ( !enabled || images.size() != filters.size() + 1 )
+    {
+        return false;
+    }
+
+    ScopedTimer timer( "cache store", "io" );
+
+    CacheHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, cacheMagic, sizeof( cacheMagic ) );
+    header.version    = cacheVersion;
+    header.headerSize = static_cast<int>( sizeof( header ) );
+    header.imageCount = static_cast<int>( images.size() );
+
+    std::string key = getEntryKey( input );
+    header.keyBytes = static_cast<long long>( key.size() );
+
+    images[0]->GetExtent( header.extent );
+    images[0]->GetSpacing( header.spacing );
+    images[0]->GetOrigin( header.origin );
+
+    std::vector<CacheImage> records( images.size() );
+    std::size_t offset = alignUp( sizeof( header ) + records.size() * sizeof( CacheImage ) + key.size() );
+
+    for ( std::size_t i = 0; i < images.size(); i++ )
+    {
+        int extent[6];
+        images[i]->GetExtent( extent );
+
+        if ( !images[i]->GetPointData()->GetScalars() || !std::equal( extent, extent + 6, header.extent ) )
+        {
+            return false;
+        }
+
+        records[i].scalarType = images[i]->GetScalarType();
+        records[i].components = images[i]->GetNumberOfScalarComponents();
+        records[i].offset     = static_cast<long long>( offset );
+        records[i].bytes      = static_cast<long long>( images[i]->GetNumberOfPoints() ) * records[i].components *
+                                images[i]->GetScalarSize();
+
+        offset = alignUp( offset + static_cast<std::size_t>( records[i].bytes ) );
+    }
+
+    // Write a temporary file and rename it, so readers never see a partial entry.
+    // The process ID and a counter keep the temporary files of concurrent writers apart.
+    std::string path = getKeyPath( key );
+    std::ostringstream temporaryName;
+    temporaryName << path << "." << processId() << "." << temporaryCounter++ << ".tmp";
+    std::string temporaryPath = temporaryName.str();
+
+    {
+        std::ofstream file( temporaryPath.c_str(), std::ios::binary );
+        file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+        file.write( reinterpret_cast<const char*>( records.data() ), records.size() * sizeof( CacheImage ) );
+        file.write( key.data(), key.size() );
+
+        for ( std::size_t i = 0; i < images.size(); i++ )
+        {
+            std::vector<char> padding( static_cast<std::size_t>( records[i].offset ) - static_cast<std::size_t>( file.tellp() ), 0 );
+            file.write( padding.data(), padding.size() );
+            file.write( static_cast<const char*>( images[i]->GetScalarPointer() ), records[i].bytes );
+        }
+
+        if ( !file )
+        {
+            file.close();
+            vtksys::SystemTools::RemoveFile( temporaryPath );
+            return false;
+        }
+    }
+
+    if ( !vtksys::SystemTools::RenameFile( temporaryPath, path ) )
+    {
+        vtksys::SystemTools::RemoveFile( temporaryPath );
+        return false;
+    }
+
+    evict();
+
+    return true;
+}
+
+void VolumeCache::evict() const
+{
+    vtksys::Directory files;
+    if ( !files.Load( directory ) )
+    {
+        return;
+    }
+
+    struct Entry
+    {
+        std::string path;
+        long modified;
+        double bytes;
+    };
+
+    std::vector<Entry> entries;
+    double total = 0.0;
+
+    for ( unsigned long i = 0; i < files.GetNumberOfFiles(); i++ )
+    {
+        std::string name = files.GetFile( i );
+        if ( name.size() < 4 || name.compare( name.size() - 4, 4, ".vmc" ) != 0 )
+        {
+            continue;
+        }
+
+        Entry entry;
+        entry.path     = directory + "/" + name;
+        entry.modified = vtksys::SystemTools::ModifiedTime( entry.path );
+        entry.bytes    = static_cast<double>( vtksys::SystemTools::FileLength( entry.path ) );
+
+        entries.push_back( entry );
+        total += entry.bytes;
+    }
+
+    // Least recently used first
+    std::sort( entries.begin(), entries.end(), []( const Entry& a, const Entry& b )
+    {
+        return a.modified < b.modified;
+    } );
+
+    // The newest entry is always kept, even if it alone is over the limit
+    for ( std::size_t i = 0; i + 1 < entries.size() && total > maximumBytes; i++ )
+    {
+        if ( vtksys::SystemTools::RemoveFile( entries[i].path ) )
+        {
+            total -= entries[i].bytes;
+        }
+    }
+}
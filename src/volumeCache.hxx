@@ -0,0 +1,95 @@
+/****************************************************************************
+*   volumeCache.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the on-disk cache of the original and
+*                   filtered volumes.
+****************************************************************************/
+
+#ifndef VOLUMECACHE_H
+#define VOLUMECACHE_H
+
+#include "helperFunctions.hxx"
+
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/*
+*   Keeps the original and filtered volumes of a study on disk so a rerun
+*   (e.g. with other thresholds) skips loading and filtering.
+*
+*   Each entry is one file: a small header with one record per image, followed
+*   by the raw voxels of the images, each aligned to a page. A hit memory-maps the file and wraps
+*   the voxels in VTK arrays without copying, so it costs about as much as
+*   opening the file. Entries are keyed by the input path, the size and
+*   modification time of the input (every file for a DICOM directory) and the
+*   filters with all their parameters, so a changed input or filter misses.
+*   The file name is a hash of the key, and the full key is stored in the file
+*   and compared on load, so two keys with the same hash cannot share an entry.
+*
+*   The total size of the cache directory is kept under a limit by deleting the
+*   least recently used entries (a hit refreshes the modification time).
+*/
+class VolumeCache
+{
+    public:
+        /*
+        *   Set up the cache from the program options (--cache-dir, --cache-size,
+        *   --no-cache and the filters).
+        *
+        *   @param   options   The program options
+        */
+        VolumeCache( const ProgramOptions& options );
+
+        /*
+        *   @returns whether the cache is used
+        */
+        bool isEnabled() const { return enabled; }
+
+        /*
+        *   Load the volumes of a study.
+        *
+        *   @param   input    DICOM directory or NIfTI file
+        *   @param   images   Receives the original image, then the filtered images
+        *
+        *   @returns a boolean representing whether the study was in the cache
+        */
+        bool load( const std::string& input, std::vector< vtkSmartPointer<vtkImageData> >& images ) const;
+
+        /*
+        *   Store the volumes of a study and evict old entries if the cache is too large.
+        *
+        *   @param   input    DICOM directory or NIfTI file
+        *   @param   images   The original image, then the filtered images (same extent)
+        *
+        *   @returns a boolean representing whether the entry was written
+        */
+        bool store( const std::string& input, const std::vector< vtkSmartPointer<vtkImageData> >& images ) const;
+
+        /*
+        *   @returns the cache file of a study with the current filters
+        */
+        std::string getEntryPath( const std::string& input ) const;
+
+    private:
+        /*
+        *   @returns the full key of a study: the input path, the size and
+        *            modification time of its files, and the filters
+        */
+        std::string getEntryKey( const std::string& input ) const;
+
+        std::string getKeyPath( const std::string& key ) const;
+
+        void evict() const;
+
+        bool enabled;
+        std::string directory;
+        double maximumBytes;
+        std::vector<FilterSpec> filters;
+};
+
+#endif // VOLUMECACHE_H
@@ -0,0 +1,272 @@
+/****************************************************************************
+*   volumeView.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Implementation of the 3D volume rendering view of the
+*                   viewer (CPU ray casting).
+****************************************************************************/
+
+#include "volumeView.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+
+// Voxels of the level of detail rendered while interacting
+static const double lowResolutionVoxels = 128.0 * 128.0 * 128.0;
+
+VolumeView::VolumeView()
+    : sliceRenderer( nullptr ), shown( -1 ), interactive( false ), cameraPlaced( false )
+{
+    int threads = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+
+    fullMapper = vtkSmartPointer<vtkFixedPointVolumeRayCastMapper>::New();
+    fullMapper->SetNumberOfThreads( threads );
+    fullMapper->AutoAdjustSampleDistancesOff();
+    fullMapper->SetImageSampleDistance( 1.0 );
+
+    shrink = vtkSmartPointer<vtkImageShrink3D>::New();
+    shrink->MeanOn();
+
+    lowMapper = vtkSmartPointer<vtkFixedPointVolumeRayCastMapper>::New();
+    lowMapper->SetNumberOfThreads( threads );
+    lowMapper->AutoAdjustSampleDistancesOff();
+    lowMapper->SetImageSampleDistance( 2.0 );
+    lowMapper->SetInputConnection( shrink->GetOutputPort() );
+
+    intensityProperty = vtkSmartPointer<vtkVolumeProperty>::New();
+    intensityProperty->SetInterpolationTypeToLinear();
+    intensityProperty->ShadeOff();
+
+    // The segmentation is 0 or 255 (averages in the level of detail), drawn as a shaded red surface.
+    // 255 rather than 1 keeps the averages of the unsigned char level of detail from rounding to 0.
+    vtkSmartPointer<vtkColorTransferFunction> segmentationColor = vtkSmartPointer<vtkColorTransferFunction>::New();
+    segmentationColor->AddRGBPoint( 0.0, 0.0, 0.0, 0.0 );
+    segmentationColor->AddRGBPoint( 255.0, 1.0, 0.0, 0.0 );
+
+    vtkSmartPointer<vtkPiecewiseFunction> segmentationOpacity = vtkSmartPointer<vtkPiecewiseFunction>::New();
+    segmentationOpacity->AddPoint( 0.0, 0.0 );
+    segmentationOpacity->AddPoint( 127.5, 0.0 );
+    segmentationOpacity->AddPoint( 255.0, 0.6 );
+
+    segmentationProperty = vtkSmartPointer<vtkVolumeProperty>::New();
+    segmentationProperty->SetColor( segmentationColor );
+    segmentationProperty->SetScalarOpacity( segmentationOpacity );
+    segmentationProperty->SetInterpolationTypeToLinear();
+    segmentationProperty->ShadeOn();
+    segmentationProperty->SetAmbient( 0.3 );
+    segmentationProperty->SetDiffuse( 0.7 );
+
+    volume = vtkSmartPointer<vtkVolume>::New();
+    volume->SetMapper( fullMapper );
+
+    renderer = vtkSmartPointer<vtkRenderer>::New();
+    renderer->AddVolume( volume );
+
+    vtkSmartPointer<vtkPolyDataMapper> surfaceMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    surfaceMapper->ScalarVisibilityOff();
+
+    surfaceActor = vtkSmartPointer<vtkActor>::New();
+    surfaceActor->SetMapper( surfaceMapper );
+    surfaceActor->GetProperty()->SetColor( 1.0, 0.0, 0.0 );
+    surfaceActor->VisibilityOff();
+    renderer->AddActor( surfaceActor );
+    renderer->DrawOff();
+    renderer->InteractiveOff();
+
+    labelMapper = vtkSmartPointer<vtkTextMapper>::New();
+    labelActor = vtkSmartPointer<vtkActor2D>::New();
+    labelActor->SetMapper( labelMapper );
+    renderer->AddActor( labelActor );
+
+    setIntensityRange( 0.0, 1.0 );
+}
+
+void VolumeView::setViewport( vtkRenderWindow* window, vtkRenderer* slices, vtkTextProperty* textProperty )
+{
+    sliceRenderer = slices;
+    renderer->SetViewport( sliceRenderer->GetViewport() );
+    labelMapper->SetTextProperty( textProperty );
+    window->AddRenderer( renderer );
+}
+
+int VolumeView::addSource( const std::string& name, const std::string& label, Kind kind )
+{
+    Source source;
+    source.name  = name;
+    source.label = label;
+    source.kind  = kind;
+    sources.push_back( source );
+
+    return static_cast<int>( sources.size() ) - 1;
+}
+
+void VolumeView::setVolume( int source, vtkImageData* image )
+{
+    sources[source].image = image;
+}
+
+void VolumeView::setVolumeFactory( int source, const std::function<vtkSmartPointer<vtkImageData>()>& create )
+{
+    sources[source].create = create;
+}
+
+void VolumeView::setSurface( vtkPolyData* surface )
+{
+    surfaceActor->GetMapper()->SetInputDataObject( surface );
+}
+
+void VolumeView::setIntensityRange( double lower, double upper )
+{
+    upper = std::max( upper, lower + 1.0 );
+
+    vtkSmartPointer<vtkColorTransferFunction> color = vtkSmartPointer<vtkColorTransferFunction>::New();
+    color->AddRGBPoint( lower, 0.0, 0.0, 0.0 );
+    color->AddRGBPoint( upper, 1.0, 1.0, 1.0 );
+
+    vtkSmartPointer<vtkPiecewiseFunction> opacity = vtkSmartPointer<vtkPiecewiseFunction>::New();
+    opacity->AddPoint( lower, 0.0 );
+    opacity->AddPoint( upper, 0.8 );
+
+    intensityProperty->SetColor( color );
+    intensityProperty->SetScalarOpacity( opacity );
+}
+
+bool VolumeView::show( int source )
+{
+    if ( !isAvailable( source ) || !sliceRenderer )
+    {
+        return false;
+    }
+
+    // Created volumes are not kept by the source, only by the mappers while they are shown
+    Kind kind = sources[source].kind;
+    vtkSmartPointer<vtkImageData> image = sources[source].image;
+    if ( kind != KIND_SURFACE && sources[source].create )
+    {
+        image = sources[source].create();
+        if ( !image )
+        {
+            return false;
+        }
+    }
+
+    shown = source;
+    updateLabel();
+
+    sliceRenderer->DrawOff();
+    sliceRenderer->InteractiveOff();
+    renderer->DrawOn();
+    renderer->InteractiveOn();
+
+    volume->SetVisibility( kind != KIND_SURFACE );
+    surfaceActor->SetVisibility( kind == KIND_SURFACE );
+
+    if ( !cameraPlaced )
+    {
+        renderer->ResetCamera();
+        renderer->GetActiveCamera()->Azimuth( 30.0 );
+        renderer->GetActiveCamera()->Elevation( 30.0 );
+        renderer->GetActiveCamera()->OrthogonalizeViewUp();
+        renderer->ResetCameraClippingRange();
+        cameraPlaced = true;
+    }
+
+    if ( kind == KIND_SURFACE )
+    {
+        return true;
+    }
+
+    fullMapper->SetInputData( image );
+    shrink->SetInputData( image );
+
+    // Shrink to about lowResolutionVoxels, so the level of detail renders at a steady rate for any volume
+    int dims[3];
+    image->GetDimensions( dims );
+    double voxels = double( dims[0] ) * dims[1] * dims[2];
+    int factor = std::max( 2, static_cast<int>( std::ceil( std::cbrt( voxels / lowResolutionVoxels ) ) ) );
+    shrink->SetShrinkFactors( factor, factor, factor );
+
+    // Ready before the first interaction, which should not wait for it
+    shrink->Update();
+
+    volume->SetProperty( kind == KIND_SEGMENTATION ? segmentationProperty : intensityProperty );
+    volume->SetMapper( interactive ? lowMapper : fullMapper );
+
+    return true;
+}
+
+void VolumeView::hide()
+{
+    shown = -1;
+
+    renderer->DrawOff();
+    renderer->InteractiveOff();
+
+    if ( sliceRenderer )
+    {
+        sliceRenderer->DrawOn();
+        sliceRenderer->InteractiveOn();
+    }
+}
+
+int VolumeView::showNext()
+{
+    for ( int source = shown + 1; source < static_cast<int>( sources.size() ); source++ )
+    {
+        if ( show( source ) )
+        {
+            return source;
+        }
+    }
+
+    hide();
+    return -1;
+}
+
+void VolumeView::setInteractive( bool value )
+{
+    interactive = value;
+    volume->SetMapper( interactive ? lowMapper : fullMapper );
+}
+
+int VolumeView::sourceFromName( const std::string& name ) const
+{
+    for ( std::size_t i = 0; i < sources.size(); i++ )
+    {
+        if ( name == sources[i].name )
+        {
+            return static_cast<int>( i );
+        }
+    }
+
+    return -1;
+}
+
+bool VolumeView::isAvailable( int source ) const
+{
+    if ( source < 0 || source >= static_cast<int>( sources.size() ) )
+    {
+        return false;
+    }
+
+    if ( sources[source].kind == KIND_SURFACE )
+    {
+        return surfaceActor->GetMapper()->GetInputDataObject( 0, 0 ) != nullptr;
+    }
+
+    return sources[source].image != nullptr || sources[source].create;
+}
+
+void VolumeView::updateLabel()
+{
+    std::string label = "Volume: " + sources[shown].label;
+    labelMapper->SetInput( label.c_str() );
+}
@@ -0,0 +1,182 @@
+/****************************************************************************
+*   volumeView.hxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Definition of the 3D volume rendering view of the
+*                   viewer (CPU ray casting).
+****************************************************************************/
+
+#ifndef VOLUMEVIEW_H
+#define VOLUMEVIEW_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkVolume.h>
+#include <vtkVolumeProperty.h>
+#include <vtkFixedPointVolumeRayCastMapper.h>
+#include <vtkImageShrink3D.h>
+#include <vtkTextMapper.h>
+#include <vtkTextProperty.h>
+#include <vtkActor2D.h>
+#include <vtkActor.h>
+#include <vtkPolyData.h>
+
+/*
+*   Renders one of the volumes (original, filtered or segmentation) in place of
+*   a 2D slice viewport, with vtkFixedPointVolumeRayCastMapper, or
+*   the extracted surface of the segmentation (see SurfaceExtractor). The
+*   mapper casts rays on the CPU with one thread per core, so it needs no GPU
+*   and works with offscreen render windows.
+*
+*   While the user rotates the camera, a level of detail is rendered instead:
+*   a shrunken copy of the volume (at most about 128^3 voxels) with one ray
+*   per 2x2 pixels. The full resolution volume is rendered when the
+*   interaction ends.
+*/
+class VolumeView
+{
+    public:
+        /*
+        *   How a source is drawn.
+        */
+        enum Kind
+        {
+            KIND_INTENSITY = 0,     // Grey ramp over the threshold range
+            KIND_SEGMENTATION,      // Shaded red, 0 or 255 voxels (unsigned char)
+            KIND_SURFACE            // The surface given to setSurface()
+        };
+
+        VolumeView();
+
+        /*
+        *   Add a source. showNext() goes through the sources in the order they were added.
+        *
+        *   @param   name    Name used by sourceFromName() (lowercase, e.g. "median")
+        *   @param   label   Name shown in the view (e.g. "Median")
+        *   @param   kind    How the source is drawn
+        *
+        *   @returns the source, for setVolume() and show()
+        */
+        int addSource( const std::string& name, const std::string& label, Kind kind = KIND_INTENSITY );
+
+        /*
+        *   Create the renderer of the view, over the viewport of a 2D renderer.
+        *   Only one of the two is drawn at a time.
+        *
+        *   @param   window          The render window
+        *   @param   sliceRenderer   The 2D renderer the view replaces while it is shown
+        *   @param   textProperty    Font of the volume name
+        */
+        void setViewport( vtkRenderWindow* window, vtkRenderer* sliceRenderer, vtkTextProperty* textProperty );
+
+        /*
+        *   Set the image of a source. Sources without an image are skipped by showNext().
+        *
+        *   @param   source   A source returned by addSource()
+        *   @param   image    The volume, nullptr = not available (yet)
+        */
+        void setVolume( int source, vtkImageData* image );
+
+        /*
+        *   Create the image of a source each time it is shown, instead of
+        *   keeping it (e.g. the segmentation, expanded from its bit mask).
+        *
+        *   @param   source   A source returned by addSource()
+        *   @param   create   Returns the volume, nullptr = not available (yet)
+        */
+        void setVolumeFactory( int source, const std::function<vtkSmartPointer<vtkImageData>()>& create );
+
+        /*
+        *   Set the surface shown by the KIND_SURFACE source.
+        *
+        *   @param   surface   The surface, nullptr = not available
+        */
+        void setSurface( vtkPolyData* surface );
+
+        /*
+        *   Set the intensity range of the foreground: the original and filtered
+        *   volumes are transparent below the lower threshold and ramp up to their
+        *   full opacity and brightness at the upper threshold.
+        *
+        *   @param   lower   The lower threshold
+        *   @param   upper   The upper threshold
+        */
+        void setIntensityRange( double lower, double upper );
+
+        /*
+        *   Show a source in place of the 2D viewport.
+        *
+        *   @param   source   A source returned by addSource()
+        *
+        *   @returns false if the source has no image
+        */
+        bool show( int source );
+
+        /*
+        *   Show the 2D viewport again.
+        */
+        void hide();
+
+        /*
+        *   Show the next source that has an image, or the 2D viewport after the last one.
+        *
+        *   @returns the source shown, or -1 for the 2D viewport
+        */
+        int showNext();
+
+        bool isShown() const { return shown >= 0; }
+        vtkRenderer* getRenderer() const { return renderer; }
+
+        /*
+        *   Switch between the level of detail (while interacting) and the full
+        *   resolution volume.
+        *
+        *   @param   interactive   True when an interaction starts, false when it ends
+        */
+        void setInteractive( bool interactive );
+
+        /*
+        *   @param   name   The name given to addSource()
+        *
+        *   @returns the source with that name, -1 if there is none
+        */
+        int sourceFromName( const std::string& name ) const;
+
+    private:
+        void updateLabel();
+        bool isAvailable( int source ) const;
+
+        vtkRenderer* sliceRenderer;
+        vtkSmartPointer<vtkRenderer> renderer;
+        vtkSmartPointer<vtkVolume> volume;
+        vtkSmartPointer<vtkFixedPointVolumeRayCastMapper> fullMapper;
+        vtkSmartPointer<vtkFixedPointVolumeRayCastMapper> lowMapper;
+        vtkSmartPointer<vtkImageShrink3D> shrink;
+        vtkSmartPointer<vtkVolumeProperty> intensityProperty;
+        vtkSmartPointer<vtkVolumeProperty> segmentationProperty;
+        vtkSmartPointer<vtkTextMapper> labelMapper;
+        vtkSmartPointer<vtkActor2D> labelActor;
+        vtkSmartPointer<vtkActor> surfaceActor;
+        struct Source
+        {
+            std::string name;
+            std::string label;
+            Kind kind;
+            vtkSmartPointer<vtkImageData> image;
+            std::function<vtkSmartPointer<vtkImageData>()> create;
+        };
+
+        std::vector<Source> sources;
+        int shown;
+        bool interactive;
+        bool cameraPlaced;
+};
+
+#endif // VOLUMEVIEW_H
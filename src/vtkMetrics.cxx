@@ -8,285 +8,875 @@
 ****************************************************************************/
 
 #include "interactorStyler.hxx"
+#include "snrStatistics.hxx"
+#include "regionStatistics.hxx"
+#include "streamingStatistics.hxx"
+#include "myImageRecursiveGaussian.hxx"
+#include "filterBank.hxx"
+#include "metricsCore.hxx"
+#include "stageTrace.hxx"
+#include "batchProcessor.hxx"
+#include "studyServer.hxx"
+#include "myDICOMImageReader.hxx"
+#include "myNIFTIImageReader.hxx"
+#include "myBrickVolumeReader.hxx"
+#include "volumeCache.hxx"
+#include "thresholdOverlay.hxx"
+#include "myMaskSliceSource.hxx"
+#include "sliceCache.hxx"
+#include "volumeView.hxx"
+#include "surfaceExtractor.hxx"
+#include "surfaceRegistration.hxx"
+#include "imagePyramid.hxx"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include <vtkImageReader2.h>
+#include <vtkInformation.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkWindowToImageFilter.h>
+#include <vtkPNGWriter.h>
+#include <vtkImageReslice.h>
 
 vtkStandardNewMacro(myInteractorStyler);
 
+/*
+*   Print the SNR results of the original and filtered images as a table.
+*
+*   @param   results   Statistics of the original image, then the filtered images
+*   @param   labels    Names of the images, in the same order
+*/
+static void printSNRResults( const std::vector<SNRPartial>& results, const std::vector<std::string>& labels )
+{
+    int width = 8;
+    for ( std::size_t i = 0; i < labels.size(); i++ )
+    {
+        width = std::max( width, static_cast<int>( labels[i].size() ) + 2 );
+    }
+
+    std::cout << "\n" << std::fixed << std::setprecision(4);
+    std::cout << std::left << std::setw( width ) << "Image" << std::right
+              << std::setw( 18 ) << "Background mean" << std::setw( 18 ) << "Foreground mean"
+              << std::setw( 18 ) << "Background std" << std::setw( 12 ) << "SNR" << "\n";
+
+    for ( std::size_t i = 0; i < results.size(); i++ )
+    {
+        double deviation = results[i].background.getStandardDeviation();
+
+        std::cout << std::left << std::setw( width ) << labels[i] << std::right
+                  << std::setw( 18 ) << results[i].background.mean << std::setw( 18 ) << results[i].foreground.mean
+                  << std::setw( 18 ) << deviation << std::setw( 12 ) << results[i].foreground.mean / deviation << "\n";
+    }
+}
+
+/*
+*   Print the region SNR results of the original and filtered images as a table.
+*
+*   @param   results     Statistics of the original image, then the filtered images
+*   @param   labels      Names of the images, in the same order
+*   @param   estimator   The noise estimator
+*/
+static void printRegionResults( const std::vector<RegionResult>& results, const std::vector<std::string>& labels,
+                                NoiseEstimator estimator )
+{
+    int width = 8;
+    for ( std::size_t i = 0; i < labels.size(); i++ )
+    {
+        width = std::max( width, static_cast<int>( labels[i].size() ) + 2 );
+    }
+
+    std::string noiseColumn = std::string( "Noise (" ) + RegionStatistics::getEstimatorName( estimator ) + ")";
+
+    std::cout << "\n" << std::fixed << std::setprecision(4);
+    std::cout << std::left << std::setw( width ) << "Image" << std::right
+              << std::setw( 18 ) << "Noise mean" << std::setw( 18 ) << "Signal mean"
+              << std::setw( 18 ) << noiseColumn << std::setw( 12 ) << "SNR" << "\n";
+
+    for ( std::size_t i = 0; i < results.size(); i++ )
+    {
+        std::cout << std::left << std::setw( width ) << labels[i] << std::right
+                  << std::setw( 18 ) << results[i].noise.mean << std::setw( 18 ) << results[i].signal.mean
+                  << std::setw( 18 ) << results[i].getNoise( estimator ) << std::setw( 12 )
+                  << results[i].getSNR( estimator ) << "\n";
+    }
+}
+
+/*
+*   Apply the filters to a level of the pyramid, scaled to its voxel size.
+*
+*   @param   level     The downsampled image
+*   @param   factor    Its downsampling factor
+*   @param   filters   The full resolution filters
+*   @param   cores     Cores to split between the filters
+*
+*   @returns the filtered images, in the order of the filters
+*/
+static std::vector< vtkSmartPointer<vtkImageData> > filterPreviewLevel( vtkImageData* level, int factor,
+                                                                       const std::vector<FilterSpec>& filters,
+                                                                       int cores )
+{
+    std::vector<FilterSpec> coarse;
+    for ( std::size_t i = 0; i < filters.size(); i++ )
+    {
+        coarse.push_back( FilterBank::coarsen( filters[i], factor ) );
+    }
+
+    MetricsCore levelCore;
+    levelCore.setInput( level );
+    levelCore.setFilters( coarse );
+    levelCore.setNumberOfThreads( cores );
+    levelCore.filter();
+
+    return levelCore.getFilteredImages();
+}
+
+/*
+*   The threshold SNR of a level of the pyramid and its filtered images.
+*/
+static std::vector<SNRPartial> previewSNR( vtkImageData* level, const std::vector< vtkSmartPointer<vtkImageData> >& filtered,
+                                           double lower, double upper )
+{
+    MetricsCore levelCore;
+    levelCore.setInput( level );
+    levelCore.setFilteredImages( filtered );
+    levelCore.setThresholds( lower, upper );
+
+    return levelCore.computeSNR();
+}
+
+/*
+*   Convert the input into a bricked volume (--convert-bricks). The input is
+*   read one layer of bricks at a time, so it does not have to fit in memory.
+*   Inputs whose reader can only load the whole volume are rejected.
+*
+*   @returns a boolean representing whether the brick file was written
+*/
+static bool convertToBricks( const ProgramOptions& options )
+{
+    vtkSmartPointer<vtkImageReader2> reader = createImageReader( options.inputFile, options.inputType );
+
+    if ( !reader )
+    {
+        std::cout << "ERROR: Cannot read the provided input: " << options.inputFile << std::endl;
+        return false;
+    }
+
+    // NIfTI files that vtkNIFTIImageReader reads for us are loaded whole, which the conversion must not need
+    reader->UpdateInformation();
+    myNIFTIImageReader* niftiReader = myNIFTIImageReader::SafeDownCast( reader );
+    if ( niftiReader && !niftiReader->CanReadSlabs() )
+    {
+        std::cout << "ERROR: " << options.inputFile << " can only be read as a whole (e.g. NIfTI-2, byte-swapped or "
+                  << "more than 3 dimensions) and cannot be converted layer by layer. Save it as a NIfTI-1 file first. \n";
+        return false;
+    }
+
+    std::cout << "\n**Converting the input into " << options.brickFile << "** \n";
+    std::cout << "Writing bricks of " << options.brickSize << "^3 voxels" << ( options.compressBricks ? " (compressed)" : "" )
+              << "...";
+
+    BrickVolume volume;
+    if ( !volume.convert( reader, options.brickFile, options.brickSize, options.compressBricks ) )
+    {
+        std::cout << "\nERROR: " << volume.getError() << " \n";
+        return false;
+    }
+
+    double rawBytes = 0.0;
+    for ( int i = 0; i < volume.getNumberOfBricks(); i++ )
+    {
+        rawBytes += static_cast<double>( volume.getBrickBytes( i ) );
+    }
+
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << "Done! \n" << volume.getNumberOfBricks() << " bricks, " << std::fixed << std::setprecision( 1 )
+              << volume.getStoredBytes() / ( 1024.0 * 1024.0 ) << " MB (" << 100.0 * volume.getStoredBytes() / rawBytes
+              << "% of the voxels) \n";
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+
+    return true;
+}
+
+/*
+*   Align the input to the reference of --register and replace it with the
+*   input resampled into the reference frame, so the SNR, regions and masks of
+*   every study refer to the same anatomy. The surfaces are the segmentations
+*   at the thresholds (a reference scan is segmented like the input). The
+*   input takes the grid of a reference scan and keeps its own grid for a
+*   reference surface.
+*
+*   @param   core      The core with the loaded input
+*   @param   options   The parsed options
+*
+*   @returns a boolean representing whether the reference was read and both surfaces have points
+*/
+static bool registerToReference( MetricsCore& core, const ProgramOptions& options )
+{
+    std::cout << "\n**Registering the input to " << options.registerFile << "** \n";
+
+    vtkSmartPointer<vtkPolyData> referenceSurface;
+    vtkSmartPointer<vtkImageData> referenceImage;
+
+    SurfaceExtractor extractor;
+    extractor.setThresholds( options.lowerThreshold, options.upperThreshold );
+
+    if ( classifyInput( options.registerFile ) < 0 )
+    {
+        referenceSurface = SurfaceExtractor::read( options.registerFile );
+        if ( !referenceSurface )
+        {
+            std::cout << "ERROR: Cannot read the reference surface: " << options.registerFile << " \n";
+            return false;
+        }
+    }
+    else
+    {
+        MetricsCore referenceCore;
+        referenceCore.setNumberOfThreads( options.threads );
+        referenceCore.setMemoryBudgetMB( options.memoryBudgetMB );
+
+        if ( !referenceCore.load( options.registerFile ) )
+        {
+            std::cout << "ERROR: Cannot read the reference scan: " << referenceCore.getError() << " \n";
+            return false;
+        }
+
+        referenceImage = referenceCore.getInput();
+        referenceSurface = extractor.extract( referenceImage );
+        std::cout << "Reference surface: " << referenceSurface->GetNumberOfPoints() << " points \n";
+    }
+
+    vtkSmartPointer<vtkPolyData> surface = extractor.extract( core.getInput() );
+    std::cout << "Input surface: " << surface->GetNumberOfPoints() << " points \n";
+
+    SurfaceRegistration registration;
+    registration.setLevels( options.registerLevels );
+    registration.setSamplePoints( options.registerPoints );
+    registration.setTimeLimit( options.registerSeconds );
+    registration.setNumberOfThreads( options.threads );
+
+    if ( !registration.align( surface, referenceSurface ) )
+    {
+        std::cout << "ERROR: Cannot register the input: " << registration.getError() << " \n";
+        return false;
+    }
+    registration.printLevels( std::cout );
+
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision( 2 ) << "Registration: " << registration.getIterationsPerSecond()
+              << " iterations/s. Transform from the input to the reference: \n" << std::setprecision( 5 );
+    for ( int row = 0; row < 3; row++ )
+    {
+        std::cout << "  ";
+        for ( int column = 0; column < 4; column++ )
+        {
+            std::cout << std::setw( 12 ) << registration.getMatrix()->GetElement( row, column );
+        }
+        std::cout << " \n";
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::cout << "Resampling the input into the reference frame...";
+    core.setInput( SurfaceRegistration::resample( core.getInput(), registration.getMatrix(), referenceImage,
+                                                  core.getNumberOfThreads() ) );
+    std::cout << "Done! (" << std::setprecision( 2 )
+              << std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() << " s) \n";
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+
+    return true;
+}
+
+/*
+*   The whole-volume work of the lazy and preview modes (filters, SNR,
+*   histograms), done on a background thread while the viewer shows slices
+*   from the SliceCache (lazy) or upsampled from a pyramid level (preview).
+*/
+struct LazyVolumes
+{
+    std::atomic<bool> done;
+    bool shown;
+    int timerId;
+    std::vector< vtkSmartPointer<vtkImageData> > images;    // Original, then the filtered images
+    std::vector<SNRPartial> results;
+    std::vector<std::string> labels;                        // For printSNRResults()
+    std::vector<std::string> snrNames;                      // For the SNR messages
+
+    myInteractorStyler* style;
+    ThresholdOverlay* overlay;
+    std::vector<vtkImageMapper*> filterMappers;
+    std::vector<vtkTextMapper*> snrMappers;
+    VolumeView* volumeView;
+    std::vector<int> volumeSources;                         // Volume view source of each filter
+
+    // Preview mode: the next finer pyramid level, shown until the full resolution images are done
+    std::mutex previewMutex;
+    int previewFactor;                                      // Factor of a level waiting to be shown, 0 = none
+    std::vector< vtkSmartPointer<vtkImageData> > previewImages;     // Filtered images of that level
+    std::vector<SNRPartial> previewResults;                 // Original, then the filtered images of that level
+    std::vector<vtkImageReslice*> previewReslices;          // Upsample the previews for the filter viewports
+};
+
+/*
+*   Show a finer preview level, if the background thread finished one.
+*/
+static void showPreviewLevel( LazyVolumes* lazy )
+{
+    std::lock_guard<std::mutex> lock( lazy->previewMutex );
+    if ( lazy->previewFactor == 0 )
+    {
+        return;
+    }
+
+    std::cout << "\nProvisional SNR (" << lazy->previewFactor << "x preview):";
+    printSNRResults( lazy->previewResults, lazy->labels );
+
+    for ( std::size_t i = 0; i < lazy->previewReslices.size(); i++ )
+    {
+        lazy->previewReslices[i]->SetInputData( lazy->previewImages[i] );
+    }
+
+    for ( std::size_t i = 0; i < lazy->snrMappers.size(); i++ )
+    {
+        std::string msg = ImageMessage::previewFormat( lazy->snrNames[i], lazy->previewResults[i].getSNR(),
+                                                       lazy->previewFactor );
+        lazy->snrMappers[i]->SetInput( msg.c_str() );
+    }
+
+    lazy->previewFactor = 0;
+    lazy->style->requestRender( myInteractorStyler::VIEWPORT_ALL );
+}
+
+/*
+*   Timer callback of the lazy mode: once the background work is done, print
+*   the SNR, switch the viewports to the whole filtered volumes and update the
+*   SNR messages (for the current thresholds).
+*/
+static void showLazyVolumes( vtkObject* caller, unsigned long vtkNotUsed( eventId ),
+                             void* clientData, void* vtkNotUsed( callData ) )
+{
+    LazyVolumes* lazy = static_cast<LazyVolumes*>( clientData );
+    if ( !lazy->done && !lazy->shown )
+    {
+        showPreviewLevel( lazy );
+    }
+
+    if ( !lazy->done || lazy->shown )
+    {
+        return;
+    }
+
+    lazy->shown = true;
+    vtkRenderWindowInteractor::SafeDownCast( caller )->DestroyTimer( lazy->timerId );
+
+    std::cout << "\nThe whole filtered images are ready. \n";
+    printSNRResults( lazy->results, lazy->labels );
+
+    lazy->style->setSliceCache( nullptr, std::vector<int>() );
+    for ( std::size_t i = 0; i < lazy->filterMappers.size(); i++ )
+    {
+        lazy->filterMappers[i]->SetInputData( lazy->images[i + 1] );
+        lazy->volumeView->setVolume( lazy->volumeSources[i], lazy->images[i + 1] );
+    }
+
+    for ( std::size_t i = 0; i < lazy->snrMappers.size(); i++ )
+    {
+        double snr = lazy->overlay->hasHistograms() ? lazy->overlay->getStatistics( static_cast<int>( i ) ).getSNR()
+                                                    : lazy->results[i].getSNR();
+        std::string msg = ImageMessage::filterFormat( lazy->snrNames[i], snr );
+        lazy->snrMappers[i]->SetInput( msg.c_str() );
+    }
+
+    lazy->style->requestRender( myInteractorStyler::VIEWPORT_ALL );
+}
+
 int main(int argc, char* argv[])
 {
     /***************************************************************
     *   Check input arguements
     ***************************************************************/
-    if ( argc != 2 )
+    ProgramOptions options;
+
+    if ( !parseArguments( argc, argv, options ) )
     {
         std::cout << "ERROR: Incorrect program usage. \n";
-        std::cout << "Correct usage: \n";
-        std::cout << argv[0] << " <DICOM_Folder_Directory> \n";
-        std::cout << "OR: \n";
-        std::cout << argv[0] << " <NIfTI_File_Directory> \n";
+        printUsage( argv[0] );
         return EXIT_FAILURE;
     }
 
-    // Create a variable for the input arguement (if valid type).
-    std::string inputFile = "";
+    // Stage timings and the trace file are written when main() returns
+    TraceSession traceSession( options.traceFile );
 
-    // Verify that the provided input arguements are valid
-    int valid = checkInputs( argv[1] );
+    // The statistics of every mode share the vtkSMPTools thread pool
+    if ( options.threads > 0 )
+    {
+        MetricsCore::setThreadPoolSize( options.threads );
+    }
 
-    if ( valid == 0 || valid == 1 )
+    // Conversion mode: write the bricked volume and exit
+    if ( !options.brickFile.empty() )
     {
-        inputFile = argv[1];
+        return convertToBricks( options ) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-    else
+
+    // Server mode: answer queries from other processes until a shutdown request
+    if ( !options.serveSocket.empty() )
     {
-        return EXIT_FAILURE;
+        StudyServer server( options );
+        return server.run( options.serveSocket );
     }
 
-    vtkSmartPointer<vtkDICOMImageReader> dicomReader;
-    vtkSmartPointer<vtkNIFTIImageReader> niftiReader;
+    // Batch and sweep modes: no rendering and no prompts. A sweep of a single study is a batch of one.
+    if ( !options.batchInput.empty() || !options.sweepThresholds.empty() )
+    {
+        BatchProcessor batch( options );
 
-    vtkSmartPointer<vtkImageViewer2> imageViewer = vtkSmartPointer<vtkImageViewer2>::New();
+        if ( options.batchInput.empty() )
+        {
+            batch.addInput( options.inputFile );
+        }
+        else if ( !batch.addInputs( options.batchInput ) )
+        {
+            return EXIT_FAILURE;
+        }
+
+        return batch.run();
+    }
+
+    // Create a variable for the input arguement.
+    std::string inputFile = options.inputFile;
+
+    // Bricked volumes may not fit in memory, so they are streamed one layer of bricks at a time
+    // unless an option needs the whole image
+    if ( options.inputType == 2 && options.streamSlabSize == 0 && !options.lazySlices && !options.preview &&
+         options.volumeSource.empty() && options.surfaceFile.empty() && options.registerFile.empty() &&
+         !options.usesRegionSNR() && !options.usesWholeExtentFilter() )
+    {
+        BrickVolume bricks;
+        if ( bricks.open( inputFile ) )
+        {
+            options.streamSlabSize = bricks.getBrickSize();
+        }
+    }
+
+    // In streaming mode nothing is loaded up front: every stage pulls Z-slabs through the pipeline.
+    bool streaming = options.streamSlabSize > 0;
+
+    // In lazy mode the viewer opens once the original image is loaded, and filters only the displayed slices.
+    bool lazy = options.lazySlices && !streaming;
 
-    vtkSmartPointer<vtkImageData> volume        = vtkSmartPointer<vtkImageData>::New();
-    vtkSmartPointer<vtkImageData> gaussianImage = vtkSmartPointer<vtkImageData>::New();
-    vtkSmartPointer<vtkImageData> medianImage   = vtkSmartPointer<vtkImageData>::New();
+    // In preview mode the viewer opens with the filters and SNR of the 8x downsampled image.
+    bool preview = options.preview && !streaming;
 
-    vtkSmartPointer<vtkImageData> imageSeg      = vtkSmartPointer<vtkImageData>::New();
+    const std::vector<FilterSpec>& filters = options.filters;
+    int filterCount = static_cast<int>( filters.size() );
 
-    double xMin[4] = { 0.1, 0.6, 0.1, 0.6 };
-    double xMax[4] = { 0.6, 1.1, 0.6, 1.1 };
-    double yMin[4] = { 0.1, 0.1, 0.6, 0.6 };
-    double yMax[4] = { 0.6, 0.6, 1.1, 1.1 };
+    // Loading, filtering and the SNR of the whole images go through the core library
+    MetricsCore core;
+    core.setNumberOfThreads( options.threads );
+    core.setMemoryBudgetMB( options.memoryBudgetMB );
+    core.setFilters( filters );
+    int cores = core.getNumberOfThreads();
+
+    // Image names: "None" in the viewer and "Original" in the results, then the filter labels
+    std::vector<std::string> labels( 1, "Original" );
+    std::vector<std::string> snrNames( 1, "None" );
+    std::string filterList;
+    for ( int i = 0; i < filterCount; i++ )
+    {
+        labels.push_back( filters[i].label );
+        snrNames.push_back( filters[i].label );
+        filterList += ( i == 0 ? "" : ", " ) + filters[i].toString();
+    }
+
+    // Only streaming mode keeps a reader: its slabs are pulled through the pipeline
+    vtkSmartPointer<vtkImageReader2> reader;
+
+    vtkSmartPointer<vtkImageViewer2> imageViewer = vtkSmartPointer<vtkImageViewer2>::New();
+
+    vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+    std::vector< vtkSmartPointer<vtkImageData> > filteredImages( filterCount );
 
     /***************************************************************
     *   Read in the provided image
     ***************************************************************/
-    switch( valid )
+    // A rerun of the same study with the same filters skips loading and filtering.
+    // The cache holds the images as read, so a registered input bypasses it.
+    if ( !options.registerFile.empty() )
     {
-        case 0:     // Directory with DICOM series
-        {
-            // Read all files from the DICOM series in the specified directory.
-            dicomReader = vtkSmartPointer<vtkDICOMImageReader>::New();
-            dicomReader->SetDirectoryName( inputFile.c_str() );
-            dicomReader->Update();
+        options.useCache = false;
+    }
+    VolumeCache cache( options );
+    std::vector< vtkSmartPointer<vtkImageData> > cachedImages;
+    bool cacheHit = !streaming && cache.load( inputFile, cachedImages );
 
-            volume->DeepCopy( dicomReader->GetOutput() );
+    // Nothing is left to do lazily (or to preview) when the filtered images come from the cache
+    lazy    = lazy && !cacheHit;
+    preview = preview && !cacheHit;
 
-            break;
+    // Both modes finish the whole images on a background thread while the viewer is open
+    bool background = lazy || preview;
+
+    if ( cacheHit )
+    {
+        core.setInput( cachedImages[0] );
+        core.setFilteredImages( std::vector< vtkSmartPointer<vtkImageData> >( cachedImages.begin() + 1, cachedImages.end() ) );
+        std::cout << "Loaded the original and filtered images from the cache: " << cache.getEntryPath( inputFile ) << " \n";
+    }
+    else if ( streaming )
+    {
+        reader = createImageReader( inputFile, options.inputType );
+
+        if ( !reader )
+        {
+            std::cout << "ERROR: Cannot read the provided input: " << inputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        myBrickVolumeReader* brickReader = myBrickVolumeReader::SafeDownCast( reader );
+        if ( brickReader )
+        {
+            brickReader->SetCacheSizeMB( options.brickCacheMB );
         }
 
-        case 1:     // NIfTI
+        reader->UpdateInformation();
+
+        if ( brickReader && brickReader->GetVolume().getNumberOfBricks() > 0 )
         {
-            // Create a reader and check if the input file is readable.
-            niftiReader = vtkSmartPointer<vtkNIFTIImageReader>::New();
+            // A slab, plus the filter padding in the layers before and after it, must stay cached
+            const BrickVolume& bricks = brickReader->GetVolume();
+            int layers = ( options.streamSlabSize + bricks.getBrickSize() - 1 ) / bricks.getBrickSize() + 2;
+            double neededMB = layers * bricks.getLayerBytes() / ( 1024.0 * 1024.0 );
 
-            if ( !( niftiReader->CanReadFile( inputFile.c_str() ) ) )
+            std::cout << "Streaming the bricked volume in slabs of " << options.streamSlabSize << " slices. \n";
+            if ( filterCount > 0 && options.brickCacheMB < neededMB )
             {
-                std::cout << "ERROR: vtk NIFTI image reader cannot read the provided file: " << inputFile << std::endl;
-                return EXIT_FAILURE;
+                std::cout << "WARNING: The brick cache (" << options.brickCacheMB << " MB) is smaller than the "
+                          << static_cast<long long>( neededMB + 0.5 ) << " MB of " << layers << " brick layers: "
+                          << "bricks will be read more than once per pass. Raise it with --brick-cache. \n";
             }
+        }
+    }
+    else
+    {
+        // The volume shares the reader output (no deep copy).
+        if ( !core.load( inputFile ) )
+        {
+            std::cout << "ERROR: Cannot read the provided input: " << core.getError() << std::endl;
+            return EXIT_FAILURE;
+        }
 
-            niftiReader->SetFileName( inputFile.c_str() );
-            niftiReader->Update();
-
-            volume->DeepCopy( niftiReader->GetOutput() );
+        myDICOMImageReader* dicomReader = myDICOMImageReader::SafeDownCast( core.getReader() );
+        if ( dicomReader )
+        {
+            dicomReader->PrintTimings( std::cout );
+        }
 
-            break;
+        myNIFTIImageReader* niftiReader = myNIFTIImageReader::SafeDownCast( core.getReader() );
+        if ( niftiReader )
+        {
+            std::cout << "NIfTI voxels: " << niftiReader->GetReadMethod() << " \n";
         }
 
-        default:
+        if ( !options.registerFile.empty() && !registerToReference( core, options ) )
         {
             return EXIT_FAILURE;
         }
     }
 
+    if ( !streaming )
+    {
+        volume = core.getInput();
+        filteredImages = core.getFilteredImages();
+        filteredImages.resize( filterCount );
+    }
+
     /***************************************************************
-    *   Apply a Gaussian and median filter to the image
+    *   Apply the filters to the image
     ***************************************************************/
     std::cout << "\n**Filtering the input image** \n";
 
-    std::cout << "Applying a Gaussian filter with std = 1.0...";
-    vtkSmartPointer<vtkImageGaussianSmooth> gaussianSmoothFilter = vtkSmartPointer<vtkImageGaussianSmooth>::New();
-    gaussianSmoothFilter->SetInputData( volume );
-    gaussianSmoothFilter->SetStandardDeviation( 1.0 );
-    gaussianSmoothFilter->SetRadiusFactors( 1.0, 1.0, 1.0 );
-    gaussianSmoothFilter->SetDimensionality( 3 );
-    gaussianSmoothFilter->Update();
+    for ( int i = 0; i < filterCount; i++ )
+    {
+        if ( filters[i].name == "gaussian" && filters[i].get( "recursive" ) != 0.0 )
+        {
+            double maxError, l1Error;
+            myImageRecursiveGaussian::ComputeKernelError( filters[i].get( "sigma" ), maxError, l1Error );
+            std::cout << "Recursive Gaussian kernel error (" << filters[i].label << "): max " << maxError * 100.0
+                      << "% of the peak, L1 " << l1Error << " \n";
+        }
+    }
 
-    gaussianImage->DeepCopy( gaussianSmoothFilter->GetOutput() );
-    std::cout << "Done! \n";
+    // In streaming mode every filter reads the reader output through a pipeline connection.
+    std::vector< vtkSmartPointer<vtkImageAlgorithm> > streamedFilters;
 
-    std::cout << "Applying a median filter with a kernel size of 5x5x5...";
-    vtkSmartPointer<vtkImageMedian3D> medianFilter = vtkSmartPointer<vtkImageMedian3D>::New();
-    medianFilter->SetInputData( volume );
-    medianFilter->SetKernelSize( 5, 5, 5 );
-    medianFilter->Update();
+    // In preview mode the filters first run on the coarsest level of the pyramid
+    ImagePyramid pyramid;
+    int previewLevel = 0;
+    std::vector< vtkSmartPointer<vtkImageData> > previewImages;
 
-    medianImage->DeepCopy( medianFilter->GetOutput() );
-    std::cout << "Done! \n";
+    // The background thread of the lazy and preview modes keeps the same whole images
+    if ( background && !core.checkMemoryBudget() )
+    {
+        std::cout << "ERROR: " << core.getError() << ". Use --stream to filter in slabs. \n";
+        return EXIT_FAILURE;
+    }
+
+    if ( cacheHit )
+    {
+        std::cout << "The filtered images (" << filterList << ") were loaded from the cache. \n";
+    }
+    else if ( lazy )
+    {
+        std::cout << "The filtered slices (" << filterList << ") will be filtered when displayed, "
+                  << "the whole images in the background. \n";
+    }
+    else if ( preview )
+    {
+        pyramid.build( volume, 3 );
+        previewLevel = pyramid.getNumberOfLevels() - 1;
+
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Built " << previewLevel << " pyramid level(s) in " << std::fixed << std::setprecision( 2 )
+                  << pyramid.getSeconds() << " s \n";
+        std::cout.flags( flags );
+        std::cout.precision( precision );
+
+        int factor = ImagePyramid::getFactor( previewLevel );
+        std::cout << "Applying " << filterCount << " filter(s) to the " << factor << "x preview...";
+        previewImages = filterPreviewLevel( pyramid.getLevel( previewLevel ), factor, filters, cores );
+        std::cout << "Done! The full resolution images (" << filterList << ") will follow in the background. \n";
+    }
+    else if ( !streaming )
+    {
+        // The filters only read the volume, so they run at the same time with a share of the cores each
+        std::cout << "Applying " << filterCount << " filter(s) on " << cores << " core(s)...";
+
+        if ( !core.filter() )
+        {
+            std::cout << "\nERROR: " << core.getError() << ". Use --stream to filter in slabs. \n";
+            return EXIT_FAILURE;
+        }
+        filteredImages = core.getFilteredImages();
+
+        std::cout << "Done! \n";
+
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        for ( int i = 0; i < filterCount; i++ )
+        {
+            std::cout << "  " << filters[i].toString() << ": " << std::fixed << std::setprecision( 2 )
+                      << core.getFilterSeconds()[i] << " s \n";
+        }
+        std::cout.flags( flags );
+        std::cout.precision( precision );
+
+        std::vector< vtkSmartPointer<vtkImageData> > images( 1, volume );
+        images.insert( images.end(), filteredImages.begin(), filteredImages.end() );
+        cache.store( inputFile, images );
+    }
+    else
+    {
+        for ( int i = 0; i < filterCount; i++ )
+        {
+            streamedFilters.push_back( FilterBank::createFilter( filters[i] ) );
+            streamedFilters.back()->SetInputConnection( reader->GetOutputPort() );
+        }
+
+        std::cout << "The filters (" << filterList << ") will be streamed in slabs of "
+                  << options.streamSlabSize << " slices. \n";
+    }
 
     /***************************************************************
     *   Calculate the SNR of the images
     ***************************************************************/
-    int lowerThreshold = 0, upperThreshold = 0;
+    double lowerThreshold = options.lowerThreshold, upperThreshold = options.upperThreshold;
 
-    // Get the threshold and isovalue parameters from the user
+    // Get the threshold parameters from the user, unless they were given in the commandline
     std::cout << "\n**Performing SNR calculation** \n";
-    std::cout << "Please enter upper and lower threshold values: \n";
-    std::cout << "Lower Threshold = ";
-    std::cin >> lowerThreshold;
-    std::cout << "Upper Threshold = ";
-    std::cin >> upperThreshold;
-
-    // Set the image dimensionality
-    int dimX = volume->GetDimensions()[0] - 1;
-    int dimY = volume->GetDimensions()[1] - 1;
-    int dimZ = volume->GetDimensions()[2] - 1;
-
-    int countForeground[3]   = {0, 0, 0};
-    int countBackground[3]   = {0, 0, 0};
-    double meanForeground[3] = {0, 0, 0};
-    double meanBackground[3] = {0, 0, 0};
-    double std[3]            = {0, 0, 0};
-    double var[3]            = {0, 0, 0};
-
-    // Calculate the mean of the background
-    for (int z = 0; z < dimZ; z++)
-    {
-        for (int y = 0; y < dimY; y++)
-        {
-            for (int x = 0; x < dimX; x++)
-            {  
-                double originalVoxel = volume->GetScalarComponentAsDouble( x, y, z, 0 );
-                double gaussianVoxel = gaussianImage->GetScalarComponentAsDouble( x, y, z, 0 );
-                double medianVoxel   = medianImage->GetScalarComponentAsDouble( x, y, z, 0 );
-
-                // Original image
-                if ( originalVoxel > upperThreshold || originalVoxel < lowerThreshold )
-                {
-                    meanBackground[0] += originalVoxel;
-                    countBackground[0]++;
-                }
-
-                // Gaussian filtered image
-                if ( gaussianVoxel > upperThreshold || gaussianVoxel < lowerThreshold )
-                {
-                    meanBackground[1] += gaussianVoxel;
-                    countBackground[1]++;
-                }
-
-                // Median filtered image
-                if ( medianVoxel > upperThreshold || medianVoxel < lowerThreshold )
-                {
-                    meanBackground[2] += medianVoxel;
-                    countBackground[2]++;
-                }
-            }
-        }
+    if ( !options.hasLowerThreshold || !options.hasUpperThreshold )
+    {
+        std::cout << "Please enter upper and lower threshold values: \n";
+    }
+    if ( !options.hasLowerThreshold )
+    {
+        std::cout << "Lower Threshold = ";
+        std::cin >> lowerThreshold;
+    }
+    if ( !options.hasUpperThreshold )
+    {
+        std::cout << "Upper Threshold = ";
+        std::cin >> upperThreshold;
     }
 
-    meanBackground[0] /= countBackground[0];
-    meanBackground[1] /= countBackground[1];
-    meanBackground[2] /= countBackground[2];
-
-    std::cout << "\n" << std::fixed << std::setprecision(4);
-    std::cout << "Mean of the background of the original image is:          " << meanBackground[0] << "\n";
-    std::cout << "Mean of the background of the Gaussian filtered image is: " << meanBackground[1] << "\n";
-    std::cout << "Mean of the background of the median filtered image is:   " << meanBackground[2] << "\n";
-
-    // Calculate the mean of the foreground and the variance of the background
-    for (int z = 0; z < dimZ; z++)
-    {
-        for (int y = 0; y < dimY; y++)
-        {
-            for (int x = 0; x < dimX; x++)
-            {  
-                double originalVoxel = volume->GetScalarComponentAsDouble( x, y, z, 0 );
-                double gaussianVoxel = gaussianImage->GetScalarComponentAsDouble( x, y, z, 0 );
-                double medianVoxel   = medianImage->GetScalarComponentAsDouble( x, y, z, 0 );
-
-                // Original image
-                if ( originalVoxel <= upperThreshold && originalVoxel >= lowerThreshold )
-                {
-                    meanForeground[0] += originalVoxel;
-                    countForeground[0]++;
-                }
-                else
-                {
-                    var[0] += pow( ( originalVoxel - meanBackground[0] ), 2 );
-                }
-
-                // Gaussian filtered image
-                if ( gaussianVoxel <= upperThreshold && gaussianVoxel >= lowerThreshold )
-                {
-                    meanForeground[1] += gaussianVoxel;
-                    countForeground[1]++;
-                }
-                else
-                {
-                    var[1] += pow( ( gaussianVoxel - meanBackground[1] ), 2 );
-                }
-
-                // Median filtered image
-                if ( medianVoxel <= upperThreshold && medianVoxel >= lowerThreshold )
-                {
-                    meanForeground[2] += medianVoxel;
-                    countForeground[2]++;
-                }
-                else
-                {
-                    var[2] += pow( ( medianVoxel - meanBackground[2] ), 2 );
-                }
-            }
-        }
+    // The whole image: every row, column and slice
+    int extent[6];
+    if ( !streaming )
+    {
+        volume->GetExtent( extent );
+    }
+    else
+    {
+        reader->GetOutputInformation( 0 )->Get( vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent );
     }
 
-    meanForeground[0] /= countForeground[0];
-    meanForeground[1] /= countForeground[1];
-    meanForeground[2] /= countForeground[2];
+    // Single pass per image: foreground and background mean and variance together
+    std::vector<SNRPartial> results( filterCount + 1 );
 
-    std::cout << "\n";
-    std::cout << "Mean of the foreground of the original image is:          " << meanForeground[0] << "\n";
-    std::cout << "Mean of the foreground of the Gaussian filtered image is: " << meanForeground[1] << "\n";
-    std::cout << "Mean of the foreground of the median filtered image is:   " << meanForeground[2] << "\n";
+    // With regions, masks or a robust noise estimator, only the voxels of the regions are read
+    bool regionMode = options.usesRegionSNR();
+    std::vector<RegionResult> regionResults( filterCount + 1 );
 
-    var[0] /= countBackground[0];
-    var[1] /= countBackground[1];
-    var[2] /= countBackground[2];
+    if ( lazy )
+    {
+        std::cout << "The SNR will be calculated in the background and printed when it is ready. \n";
+    }
+    else if ( preview )
+    {
+        // Provisional: averaging lowers the noise, so the SNR of a coarse level is higher than the final SNR
+        results = previewSNR( pyramid.getLevel( previewLevel ), previewImages, lowerThreshold, upperThreshold );
+        std::cout << "Provisional SNR (" << ImagePyramid::getFactor( previewLevel ) << "x preview), "
+                  << "the full resolution SNR will be printed when it is ready:";
+    }
+    else if ( regionMode )
+    {
+        RegionStatistics statistics;
+        if ( !setupRegionStatistics( options, statistics ) )
+        {
+            return EXIT_FAILURE;
+        }
+        statistics.setThresholds( lowerThreshold, upperThreshold );
 
-    std[0] = sqrt( var[0] );
-    std[1] = sqrt( var[1] );
-    std[2] = sqrt( var[2] );
+        if ( !core.computeRegionSNR( statistics, regionResults ) )
+        {
+            std::cout << "ERROR: " << core.getError() << " \n";
+            return EXIT_FAILURE;
+        }
+    }
+    else if ( !streaming )
+    {
+        core.setThresholds( lowerThreshold, upperThreshold );
+        results = core.computeSNR();
+    }
+    else
+    {
+        std::cout << "Streaming the original and filtered images...";
+
+        // The filters of a slab run one after the other, each with all the cores
+        StreamingStatistics statistics;
+        statistics.setThresholds( lowerThreshold, upperThreshold );
+        statistics.setExtent( extent );
+        statistics.setSlabSize( options.streamSlabSize );
+        statistics.addSource( reader );
+        for ( int i = 0; i < filterCount; i++ )
+        {
+            statistics.addSource( streamedFilters[i] );
+        }
 
-    std::cout << "\n";
-    std::cout << "Standard deviation of the background of the original image is:          " << std[0] << "\n";
-    std::cout << "Standard deviation of the background of the Gaussian filtered image is: " << std[1] << "\n";
-    std::cout << "Standard deviation of the background of the median filtered image is:   " << std[2] << "\n";
+        results = statistics.run();
 
-    std::cout << "\n";
-    std::cout << "SNR of the image of the original image is:          " << meanForeground[0]/std[0] << "\n";
-    std::cout << "SNR of the image of the Gaussian filtered image is: " << meanForeground[1]/std[1] << "\n";
-    std::cout << "SNR of the image of the median filtered image is:   " << meanForeground[2]/std[2] << "\n";
+        std::cout << "Done! \n";
+
+        myBrickVolumeReader* brickReader = myBrickVolumeReader::SafeDownCast( reader );
+        if ( brickReader )
+        {
+            int brickCount = brickReader->GetVolume().getNumberOfBricks();
+
+            std::ios::fmtflags flags = std::cout.flags();
+            std::streamsize precision = std::cout.precision();
+            std::cout << "Bricks read from disk: " << brickReader->GetBricksRead() << " for " << brickCount
+                      << " bricks (" << std::fixed << std::setprecision( 2 )
+                      << static_cast<double>( brickReader->GetBricksRead() ) / std::max( 1, brickCount )
+                      << " reads per brick), " << brickReader->GetCacheHits() << " from the cache \n";
+            std::cout.flags( flags );
+            std::cout.precision( precision );
+        }
+    }
+
+    if ( regionMode )
+    {
+        printRegionResults( regionResults, labels, options.noiseEstimator );
+    }
+    else if ( !lazy )
+    {
+        printSNRResults( results, labels );
+    }
 
     /***************************************************************
     *   Segment the input image
     ***************************************************************/
     std::cout << "\n**Performing image segmentation** \n";
-    std::cout << "Applying global threshold...";
 
-    // Apply the global threshold
+    // The overlay follows threshold changes made in the viewer ([ ] ; ' keys)
+    ThresholdOverlay overlay;
+
     vtkSmartPointer<vtkImageThreshold> globalThresh = vtkSmartPointer<vtkImageThreshold>::New();
-    globalThresh->SetInputData( volume );
-    globalThresh->ThresholdBetween( lowerThreshold, upperThreshold );
-    globalThresh->ReplaceInOn();
-    globalThresh->SetInValue( 1 );
-    globalThresh->ReplaceOutOn();
-    globalThresh->SetOutValue( 0 );
-    globalThresh->SetOutputScalarTypeToFloat();
-    globalThresh->Update();
 
-    imageSeg->DeepCopy( globalThresh->GetOutput() );
+    if ( !streaming )
+    {
+        // Only the displayed slice is thresholded before rendering, the rest in the background (one bit per voxel)
+        overlay.setInput( volume );
 
-    std::cout << "Done! \n";
+        // In lazy and preview mode the histograms are built with the whole filtered images, in the background.
+        // The region SNR does not follow the thresholds, so it needs no histogram.
+        if ( !background && !regionMode )
+        {
+            std::cout << "Building intensity histograms for interactive thresholds...";
+            std::vector<vtkImageData*> images( 1, volume );
+            images.insert( images.end(), filteredImages.begin(), filteredImages.end() );
+            overlay.buildHistograms( images, extent );
+            std::cout << "Done! \n";
+        }
+    }
+    else
+    {
+        // In streaming mode the overlay is thresholded one displayed slice at a time.
+        std::cout << "Applying global threshold...";
+        globalThresh->SetInputConnection( reader->GetOutputPort() );
+        globalThresh->ReplaceInOn();
+        globalThresh->SetInValue( 1 );
+        globalThresh->ReplaceOutOn();
+        globalThresh->SetOutValue( 0 );
+        globalThresh->SetOutputScalarTypeToUnsignedChar();
+        overlay.setThresholdFilter( globalThresh );
+        std::cout << "Done! \n";
+    }
+
+    /***************************************************************
+    *   Extract the surface of the segmentation
+    ***************************************************************/
+    vtkSmartPointer<vtkPolyData> surface;
+
+    if ( !options.surfaceFile.empty() || options.volumeSource == "surface" )
+    {
+        std::cout << "\n**Extracting the segmentation surface** \n";
+
+        SurfaceExtractor extractor;
+        extractor.setThresholds( lowerThreshold, upperThreshold );
+        extractor.setTriangleBudget( options.surfaceTriangles );
+        surface = extractor.extract( volume );
+        extractor.printStages( std::cout );
+
+        if ( !options.surfaceFile.empty() )
+        {
+            if ( SurfaceExtractor::write( surface, options.surfaceFile ) )
+            {
+                std::cout << "Saved the surface to " << options.surfaceFile << " \n";
+            }
+            else
+            {
+                std::cout << "ERROR: Cannot write the surface to " << options.surfaceFile << " \n";
+            }
+        }
+    }
 
     /***************************************************************
     *   Add mappers, actors, renderer, and setup the scene
@@ -305,72 +895,154 @@ int main(int argc, char* argv[])
     sliceTextMapper->SetInput( sliceMessage.c_str() );
     sliceTextMapper->SetTextProperty( textProperty );
 
-    vtkSmartPointer<vtkTextMapper> filterTextMapper1 = vtkSmartPointer<vtkTextMapper>::New();
-    std::string filterMessage1 = ImageMessage::filterFormat( "Gaussian", meanForeground[1]/std[1] );
-    filterTextMapper1->SetInput( filterMessage1.c_str() );
-    filterTextMapper1->SetTextProperty( textProperty );
+    vtkSmartPointer<vtkTextMapper> thresholdTextMapper = vtkSmartPointer<vtkTextMapper>::New();
+    std::string thresholdMessage = ImageMessage::thresholdFormat( lowerThreshold, upperThreshold );
+    thresholdTextMapper->SetInput( thresholdMessage.c_str() );
+    thresholdTextMapper->SetTextProperty( textProperty );
 
-    vtkSmartPointer<vtkTextMapper> filterTextMapper2 = vtkSmartPointer<vtkTextMapper>::New();
-    std::string filterMessage2 = ImageMessage::filterFormat( "Median", meanForeground[2]/std[2] );
-    filterTextMapper2->SetInput( filterMessage2.c_str() );
-    filterTextMapper2->SetTextProperty( textProperty );
+    // One SNR message per image: the original ("None"), then the filters
+    std::vector< vtkSmartPointer<vtkTextMapper> > filterTextMappers( filterCount + 1 );
+    std::vector< vtkSmartPointer<vtkActor2D> > filterTextActors( filterCount + 1 );
+    std::vector<vtkTextMapper*> snrMappers( filterCount + 1 );
 
-    vtkSmartPointer<vtkTextMapper> filterTextMapper3 = vtkSmartPointer<vtkTextMapper>::New();
-    std::string filterMessage3 = ImageMessage::filterFormat( "None", meanForeground[0]/std[0] );
-    filterTextMapper3->SetInput( filterMessage3.c_str() );
-    filterTextMapper3->SetTextProperty( textProperty );
+    for ( int i = 0; i <= filterCount; i++ )
+    {
+        double snr = regionMode ? regionResults[i].getSNR( options.noiseEstimator ) : results[i].getSNR();
+        std::string filterMessage = lazy ? "Filter:  " + snrNames[i] + ", SNR = (calculating)"
+                                  : preview ? ImageMessage::previewFormat( snrNames[i], snr, ImagePyramid::getFactor( previewLevel ) )
+                                  : ImageMessage::filterFormat( snrNames[i], snr );
+
+        filterTextMappers[i] = vtkSmartPointer<vtkTextMapper>::New();
+        filterTextMappers[i]->SetInput( filterMessage.c_str() );
+        filterTextMappers[i]->SetTextProperty( textProperty );
+        snrMappers[i] = filterTextMappers[i];
+
+        filterTextActors[i] = vtkSmartPointer<vtkActor2D>::New();
+        filterTextActors[i]->SetMapper( filterTextMappers[i] );
+    }
+
+    // Frame statistics, filled in while shown (F key)
+    vtkSmartPointer<vtkTextMapper> frameTextMapper = vtkSmartPointer<vtkTextMapper>::New();
+    frameTextMapper->SetInput( "" );
+    frameTextMapper->SetTextProperty( textProperty );
 
     // Create the actors for each message.
     vtkSmartPointer<vtkActor2D> sliceTextActor = vtkSmartPointer<vtkActor2D>::New();
     sliceTextActor->SetMapper( sliceTextMapper );
     sliceTextActor->GetPositionCoordinate()->SetValue( 0.3, 1.0 );
 
-    vtkSmartPointer<vtkActor2D> filterTextActor1 = vtkSmartPointer<vtkActor2D>::New();
-    filterTextActor1->SetMapper( filterTextMapper1 );
-
-    vtkSmartPointer<vtkActor2D> filterTextActor2 = vtkSmartPointer<vtkActor2D>::New();
-    filterTextActor2->SetMapper( filterTextMapper2 );
+    vtkSmartPointer<vtkActor2D> thresholdTextActor = vtkSmartPointer<vtkActor2D>::New();
+    thresholdTextActor->SetMapper( thresholdTextMapper );
+    thresholdTextActor->GetPositionCoordinate()->SetValue( 0.3, 24.0 );
 
-    vtkSmartPointer<vtkActor2D> filterTextActor3 = vtkSmartPointer<vtkActor2D>::New();
-    filterTextActor3->SetMapper( filterTextMapper3 );
-
-    // Create a mask for the overlaid segmentation
-    vtkSmartPointer<vtkLookupTable> lookupTable = vtkSmartPointer<vtkLookupTable>::New();
-    lookupTable->SetNumberOfTableValues( 2 );
-    lookupTable->SetTableRange( 0.0, 1.0 );
-    lookupTable->SetTableValue( 0.0, 0.0, 0.0, 0.0, 0.0 );
-    lookupTable->SetTableValue( 1.0, 1.0, 0.0, 0.0, 1.0 );
-    lookupTable->Build();
+    vtkSmartPointer<vtkActor2D> frameTextActor = vtkSmartPointer<vtkActor2D>::New();
+    frameTextActor->SetMapper( frameTextMapper );
+    frameTextActor->GetPositionCoordinate()->SetValue( 0.3, 24.0 );
+    frameTextActor->VisibilityOff();
 
+    // Create the RGBA image of the overlaid segmentation: red inside the thresholds, transparent outside.
+    // Only the displayed slice is expanded, from the bit mask of the overlay or the streamed threshold filter.
+    vtkSmartPointer<myMaskSliceSource> maskSlices = vtkSmartPointer<myMaskSliceSource>::New();
     vtkSmartPointer<vtkImageMapToColors> mapTransparency = vtkSmartPointer<vtkImageMapToColors>::New();
-    mapTransparency->SetLookupTable( lookupTable );
-    mapTransparency->PassAlphaToOutputOn();
-    mapTransparency->SetInputData( imageSeg );
+
+    if ( !streaming )
+    {
+        maskSlices->SetOverlay( &overlay );
+    }
+    else
+    {
+        vtkSmartPointer<vtkLookupTable> lookupTable = vtkSmartPointer<vtkLookupTable>::New();
+        lookupTable->SetNumberOfTableValues( 2 );
+        lookupTable->SetTableRange( 0.0, 1.0 );
+        lookupTable->SetTableValue( 0.0, 0.0, 0.0, 0.0, 0.0 );
+        lookupTable->SetTableValue( 1.0, 1.0, 0.0, 0.0, 1.0 );
+        lookupTable->Build();
+
+        mapTransparency->SetLookupTable( lookupTable );
+        mapTransparency->PassAlphaToOutputOn();
+        mapTransparency->SetInputConnection( globalThresh->GetOutputPort() );
+    }
 
     // Create mappers for the original and segmented images
     vtkSmartPointer<vtkImageMapper> originalMapper = vtkSmartPointer<vtkImageMapper>::New();
-    originalMapper->SetInputData( volume );
+    if ( !streaming )
+    {
+        originalMapper->SetInputData( volume );
+    }
+    else
+    {
+        originalMapper->SetInputConnection( reader->GetOutputPort() );
+    }
     originalMapper->SetZSlice( 1 );
     originalMapper->SetColorWindow( 1000 );
     originalMapper->SetColorLevel( 500 );
 
     vtkSmartPointer<vtkImageMapper> segMapper = vtkSmartPointer<vtkImageMapper>::New();
-    segMapper->SetInputConnection( mapTransparency->GetOutputPort() );
+    segMapper->SetInputConnection( streaming ? mapTransparency->GetOutputPort() : maskSlices->GetOutputPort() );
     segMapper->SetZSlice( 1 );
     segMapper->SetColorWindow( 1 );
     segMapper->SetColorLevel( 1 );
 
-    vtkSmartPointer<vtkImageMapper> gaussMapper = vtkSmartPointer<vtkImageMapper>::New();
-    gaussMapper->SetInputData( gaussianImage );
-    gaussMapper->SetZSlice( 1 );
-    gaussMapper->SetColorWindow( 1000 );
-    gaussMapper->SetColorLevel( 500 );
+    // In lazy mode the filter viewports show slices filtered on demand
+    SliceCache sliceCache;
+    std::vector<int> cacheFilters( filterCount, 0 );
+
+    if ( lazy )
+    {
+        sliceCache.setInput( volume );
+        for ( int i = 0; i < filterCount; i++ )
+        {
+            FilterSpec spec = filters[i];
+            cacheFilters[i] = sliceCache.addFilter( [spec]() { return FilterBank::createFilter( spec ); } );
+        }
+    }
+
+    // In preview mode the filter viewports show the preview level, upsampled to the displayed slice
+    std::vector< vtkSmartPointer<vtkImageReslice> > previewReslices( filterCount );
+    std::vector<vtkImageReslice*> previewReslicePointers( filterCount );
 
-    vtkSmartPointer<vtkImageMapper> medianMapper = vtkSmartPointer<vtkImageMapper>::New();
-    medianMapper->SetInputData( medianImage );
-    medianMapper->SetZSlice( 1 );
-    medianMapper->SetColorWindow( 1000 );
-    medianMapper->SetColorLevel( 500 );
+    // One mapper and actor per filter
+    std::vector< vtkSmartPointer<vtkImageMapper> > filterMappers( filterCount );
+    std::vector< vtkSmartPointer<vtkActor2D> > filterActors( filterCount );
+    std::vector<vtkImageMapper*> filterMapperPointers( filterCount );
+
+    for ( int i = 0; i < filterCount; i++ )
+    {
+        filterMappers[i] = vtkSmartPointer<vtkImageMapper>::New();
+        if ( lazy )
+        {
+            filterMappers[i]->SetInputData( sliceCache.getSlice( cacheFilters[i], 1 ) );
+        }
+        else if ( preview )
+        {
+            // The mapper only requests the displayed slice, so only that slice is interpolated
+            previewReslices[i] = vtkSmartPointer<vtkImageReslice>::New();
+            previewReslices[i]->SetInputData( previewImages[i] );
+            previewReslices[i]->SetOutputExtent( extent );
+            previewReslices[i]->SetOutputSpacing( volume->GetSpacing() );
+            previewReslices[i]->SetOutputOrigin( volume->GetOrigin() );
+            previewReslices[i]->SetInterpolationModeToLinear();
+            previewReslices[i]->BorderOn();
+            previewReslicePointers[i] = previewReslices[i];
+
+            filterMappers[i]->SetInputConnection( previewReslices[i]->GetOutputPort() );
+        }
+        else if ( !streaming )
+        {
+            filterMappers[i]->SetInputData( filteredImages[i] );
+        }
+        else
+        {
+            filterMappers[i]->SetInputConnection( streamedFilters[i]->GetOutputPort() );
+        }
+        filterMappers[i]->SetZSlice( 1 );
+        filterMappers[i]->SetColorWindow( 1000 );
+        filterMappers[i]->SetColorLevel( 500 );
+        filterMapperPointers[i] = filterMappers[i];
+
+        filterActors[i] = vtkSmartPointer<vtkActor2D>::New();
+        filterActors[i]->SetMapper( filterMappers[i] );
+    }
 
     // Create actors for the original and segmented images
     vtkSmartPointer<vtkActor2D> imageActor = vtkSmartPointer<vtkActor2D>::New();
@@ -379,28 +1051,36 @@ int main(int argc, char* argv[])
     vtkSmartPointer<vtkActor2D> maskActor = vtkSmartPointer<vtkActor2D>::New();
     maskActor->SetMapper( segMapper );
 
-    vtkSmartPointer<vtkActor2D> gaussActor = vtkSmartPointer<vtkActor2D>::New();
-    gaussActor->SetMapper( gaussMapper );
-
-    vtkSmartPointer<vtkActor2D> medianActor = vtkSmartPointer<vtkActor2D>::New();
-    medianActor->SetMapper( medianMapper );
-
-    // Create the renderer and render window
+    // Create the renderers: the original, the segmentation, then one per filter
     vtkSmartPointer<vtkRenderer> rendererOG = vtkSmartPointer<vtkRenderer>::New();
     vtkSmartPointer<vtkRenderer> rendererSEG = vtkSmartPointer<vtkRenderer>::New();
-    vtkSmartPointer<vtkRenderer> rendererGAUSS = vtkSmartPointer<vtkRenderer>::New();
-    vtkSmartPointer<vtkRenderer> rendererMEDIAN = vtkSmartPointer<vtkRenderer>::New();
+    std::vector< vtkSmartPointer<vtkRenderer> > renderers( 1, rendererOG );
+    renderers.push_back( rendererSEG );
 
-    rendererOG->SetViewport( xMin[0], yMin[0], xMax[0], yMax[0] );
-    rendererSEG->SetViewport( xMin[1], yMin[1], xMax[1], yMax[1] );
-    rendererGAUSS->SetViewport( xMin[2], yMin[2], xMax[2], yMax[2] );
-    rendererMEDIAN->SetViewport( xMin[3], yMin[3], xMax[3], yMax[3] );
+    for ( int i = 0; i < filterCount; i++ )
+    {
+        renderers.push_back( vtkSmartPointer<vtkRenderer>::New() );
+        renderers.back()->AddActor( filterActors[i] );
+        renderers.back()->AddActor( filterTextActors[i + 1] );
+    }
+
+    // The viewports fill a grid from the bottom left, as square as possible (2x2 for two filters).
+    // Each viewport starts a fifth of a cell in, like the original four-viewport layout.
+    int columns = static_cast<int>( std::ceil( std::sqrt( static_cast<double>( renderers.size() ) ) ) );
+    int rows    = ( static_cast<int>( renderers.size() ) + columns - 1 ) / columns;
 
     vtkSmartPointer<vtkRenderWindow> renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
-    renderWindow->AddRenderer( rendererOG );
-    renderWindow->AddRenderer( rendererSEG );
-    renderWindow->AddRenderer( rendererGAUSS );
-    renderWindow->AddRenderer( rendererMEDIAN );
+
+    for ( std::size_t i = 0; i < renderers.size(); i++ )
+    {
+        double width  = 1.0 / columns;
+        double height = 1.0 / rows;
+        double xMin   = ( static_cast<int>( i ) % columns + 0.2 ) * width;
+        double yMin   = ( static_cast<int>( i ) / columns + 0.2 ) * height;
+
+        renderers[i]->SetViewport( xMin, yMin, xMin + width, yMin + height );
+        renderWindow->AddRenderer( renderers[i] );
+    }
 
     vtkSmartPointer<vtkRenderWindowInteractor> interactor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
     interactor->SetRenderWindow( renderWindow );
@@ -408,37 +1088,210 @@ int main(int argc, char* argv[])
     vtkSmartPointer<myInteractorStyler> interactorStyle = vtkSmartPointer<myInteractorStyler>::New();
 
     // Set the image viewer and status mapper to enable message updates when interacting with the image.
-    interactorStyle->setImageViewer( originalMapper, segMapper, gaussMapper,  medianMapper, renderWindow );
+    interactorStyle->setImageViewer( originalMapper, segMapper, filterMapperPointers, renderWindow );
+
+    std::vector<vtkRenderer*> filterRenderers;
+    for ( std::size_t i = 2; i < renderers.size(); i++ )
+    {
+        filterRenderers.push_back( renderers[i] );
+    }
+    interactorStyle->setViewportRenderers( rendererOG, rendererSEG, filterRenderers );
+
     interactorStyle->setSliceStatusMapper( sliceTextMapper );
 
+    interactorStyle->setThresholdOverlay( &overlay, thresholdTextMapper, snrMappers, snrNames );
+    interactorStyle->setFrameStatisticsMapper( frameTextActor, frameTextMapper );
+
+    if ( lazy )
+    {
+        interactorStyle->setSliceCache( &sliceCache, cacheFilters );
+    }
+
     interactor->SetInteractorStyle( interactorStyle );
 
     rendererSEG->AddActor( imageActor );
     rendererSEG->AddActor( maskActor );
     rendererSEG->AddActor( sliceTextActor );
+    rendererSEG->AddActor( thresholdTextActor );
 
     rendererOG->AddActor( imageActor );
-    rendererOG->AddActor( filterTextActor3 );
+    rendererOG->AddActor( filterTextActors[0] );
+    rendererOG->AddActor( frameTextActor );
+
+    renderWindow->SetSize( 400 * columns, 400 * rows );
+
+    for ( std::size_t i = 0; i < renderers.size(); i++ )
+    {
+        renderers[i]->ResetCamera();
+    }
+
+    // 3D view in place of the original image (V key), ray cast on the CPU. It needs the whole volumes.
+    VolumeView volumeView;
+    std::vector<int> filterSources( filterCount, -1 );
+
+    if ( !streaming )
+    {
+        volumeView.setViewport( renderWindow, rendererOG, textProperty );
+        volumeView.setIntensityRange( lowerThreshold, upperThreshold );
+
+        volumeView.setVolume( volumeView.addSource( "original", "Original" ), volume );
+        for ( int i = 0; i < filterCount; i++ )
+        {
+            filterSources[i] = volumeView.addSource( filters[i].id, filters[i].label );
 
-    rendererGAUSS->AddActor( gaussActor );
-    rendererGAUSS->AddActor( filterTextActor1 );
+            // In lazy and preview mode the filtered volumes are added when they are ready
+            if ( !background )
+            {
+                volumeView.setVolume( filterSources[i], filteredImages[i] );
+            }
+        }
+        // Expanded from the mask when it is shown, for the thresholds of that moment
+        volumeView.setVolumeFactory( volumeView.addSource( "segmentation", "Segmentation", VolumeView::KIND_SEGMENTATION ),
+                                     [&overlay]() { return overlay.createSegmentationImage( 255 ); } );
+        volumeView.addSource( "surface", "Surface", VolumeView::KIND_SURFACE );
+        volumeView.setSurface( surface );
+
+        interactorStyle->setVolumeView( &volumeView );
+
+        if ( !options.volumeSource.empty() && !volumeView.show( volumeView.sourceFromName( options.volumeSource ) ) )
+        {
+            std::cout << "The " << options.volumeSource << " volume is not ready yet, press V to show it later. \n";
+        }
+    }
 
-    rendererMEDIAN->AddActor( medianActor );
-    rendererMEDIAN->AddActor( filterTextActor2 );
+    // Threshold the displayed slice (or set the streamed filter) before the first frame
+    overlay.setThresholds( lowerThreshold, upperThreshold, segMapper->GetZSlice() );
+
+    // Lazy and preview mode: filter the whole images, calculate the SNR and build the histograms while the viewer is open
+    LazyVolumes lazyVolumes;
+    lazyVolumes.done          = false;
+    lazyVolumes.shown         = false;
+    lazyVolumes.timerId       = -1;
+    lazyVolumes.labels        = labels;
+    lazyVolumes.snrNames      = snrNames;
+    lazyVolumes.style         = interactorStyle;
+    lazyVolumes.overlay       = &overlay;
+    lazyVolumes.filterMappers = filterMapperPointers;
+    lazyVolumes.snrMappers    = snrMappers;
+    lazyVolumes.volumeView    = &volumeView;
+    lazyVolumes.volumeSources = filterSources;
+    lazyVolumes.previewFactor   = 0;
+    lazyVolumes.previewReslices = previewReslicePointers;
+
+    std::thread lazyThread;
+    if ( background )
+    {
+        lazyThread = std::thread( [&]()
+        {
+            TraceRecorder::setThreadName( "background" );
 
-    renderWindow->SetSize( 800, 800 );
+            // Coarse to fine: each finer level of the pyramid replaces the previous preview
+            for ( int level = previewLevel - 1; preview && level >= 1; level-- )
+            {
+                int factor = ImagePyramid::getFactor( level );
+                std::vector< vtkSmartPointer<vtkImageData> > filtered =
+                    filterPreviewLevel( pyramid.getLevel( level ), factor, filters, cores );
+                std::vector<SNRPartial> levelResults =
+                    previewSNR( pyramid.getLevel( level ), filtered, lowerThreshold, upperThreshold );
+
+                std::lock_guard<std::mutex> lock( lazyVolumes.previewMutex );
+                lazyVolumes.previewImages  = filtered;
+                lazyVolumes.previewResults = levelResults;
+                lazyVolumes.previewFactor  = factor;
+            }
 
-    rendererOG->ResetCamera();
-    rendererSEG->ResetCamera();
-    rendererGAUSS->ResetCamera();
-    rendererMEDIAN->ResetCamera();
+            // The filters read their own data object, so they do not share pipeline state with the viewer
+            vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+            input->ShallowCopy( volume );
 
-    renderWindow->Render();
+            MetricsCore wholeCore;
+            wholeCore.setInput( input );
+            wholeCore.setFilters( filters );
+            wholeCore.setNumberOfThreads( cores );
+            wholeCore.filter();
+            wholeCore.setThresholds( lowerThreshold, upperThreshold );
+
+            lazyVolumes.images.assign( 1, input );
+            lazyVolumes.images.insert( lazyVolumes.images.end(), wholeCore.getFilteredImages().begin(),
+                                       wholeCore.getFilteredImages().end() );
+            lazyVolumes.results = wholeCore.computeSNR();
+
+            overlay.buildHistograms( wholeCore.getImages(), extent );
+            cache.store( inputFile, lazyVolumes.images );
+
+            lazyVolumes.done = true;
+        } );
+    }
+
+    // Headless: render one frame without a window and save it
+    if ( !options.offscreenFile.empty() )
+    {
+        // The whole segmentation, not only the displayed slice (streaming thresholds the displayed slice only)
+        if ( !streaming )
+        {
+            overlay.waitUntilComplete();
+        }
+
+        renderWindow->SetOffScreenRendering( 1 );
+        {
+            ScopedTimer timer( "first render", "render" );
+            renderWindow->Render();
+        }
+
+        vtkSmartPointer<vtkWindowToImageFilter> screenshot = vtkSmartPointer<vtkWindowToImageFilter>::New();
+        screenshot->SetInput( renderWindow );
+        screenshot->ReadFrontBufferOff();
+        screenshot->Update();
+
+        vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+        writer->SetFileName( options.offscreenFile.c_str() );
+        writer->SetInputConnection( screenshot->GetOutputPort() );
+        writer->Write();
+
+        std::cout << "Done! Saved the rendering to " << options.offscreenFile << " \n";
+
+        if ( lazyThread.joinable() )
+        {
+            lazyThread.join();
+            printSNRResults( lazyVolumes.results, labels );
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    {
+        ScopedTimer timer( "first render", "render" );
+        renderWindow->Render();
+    }
 
     std::cout << "Done! \n";
 
     interactor->Initialize();
+
+    // The viewer polls for the background work, so the results are shown from the render thread
+    if ( background )
+    {
+        vtkSmartPointer<vtkCallbackCommand> lazyCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+        lazyCallback->SetCallback( showLazyVolumes );
+        lazyCallback->SetClientData( &lazyVolumes );
+        interactor->AddObserver( vtkCommand::TimerEvent, lazyCallback );
+        lazyVolumes.timerId = interactor->CreateRepeatingTimer( 200 );
+    }
+
     interactor->Start();
 
+    if ( lazyThread.joinable() )
+    {
+        lazyThread.join();
+    }
+
+    if ( lazy )
+    {
+        std::cout << "Slice cache: " << sliceCache.getHits() << " hits, " << sliceCache.getMisses() << " misses \n";
+    }
+
+    std::cout << "\nViewer performance: \n";
+    interactorStyle->getFrameStatistics().print( std::cout );
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
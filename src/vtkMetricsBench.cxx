@@ -0,0 +1,650 @@
+/****************************************************************************
+*   vtkMetricsBench.cxx
+*
+*   Created by:     Michael Kuczynski
+*   Created on:     17/10/2026
+*   Description:    Benchmark of the vtkMetrics processing stages (load,
+*                   pyramid, filters, SNR, histograms, threshold) on a
+*                   synthetic phantom, from 1 to N threads.
+****************************************************************************/
+
+#include "filterBank.hxx"
+#include "snrStatistics.hxx"
+#include "intensityHistogram.hxx"
+#include "imagePyramid.hxx"
+#include "metricsCore.hxx"
+#include "bitMask.hxx"
+#include "memoryUsage.hxx"
+#include "myNIFTIImageReader.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkNIFTIImageWriter.h>
+#include <vtkSMPTools.h>
+#include <vtkVersion.h>
+
+#include <vtksys/SystemTools.hxx>
+
+/*
+*   The benchmark settings.
+*/
+struct BenchOptions
+{
+    int dims[3];                    // Phantom size in voxels
+    std::string type;               // short, ushort or float
+    double noise;                   // Standard deviation of the Gaussian noise
+    unsigned int seed;              // Seed of the noise
+    int maxThreads;                 // Largest thread count of the sweep
+    int repeats;                    // Runs per stage and thread count, the fastest and the median are reported
+    double lower;                   // Thresholds of the SNR, histograms and segmentation
+    double upper;
+    std::vector<FilterSpec> filters;
+    std::string output;             // Results file, .csv or .json
+    std::string baseline;           // CSV results of an earlier run to compare with, empty = none
+    double tolerance;               // Slowdown in percent that fails the comparison
+    std::string scratch;            // Directory of the phantom NIfTI file
+};
+
+/*
+*   The timing of one stage at one thread count.
+*/
+struct StageResult
+{
+    std::string stage;
+    int threads;                    // Threads requested
+    int smpThreads;                 // Threads vtkSMPTools reports (the backend may ignore the request)
+    double voxels;                  // Voxels processed per run
+    double secondsMin;
+    double secondsMedian;
+    double speedup;                 // Fastest time with 1 thread divided by the fastest time with this count
+    double residentMB;              // Resident memory after the stage
+    double peakResidentMB;          // Peak resident memory of the process so far
+};
+
+static void printUsage( const char* programName )
+{
+    std::cout << "Usage: " << programName << " [options] \n";
+    std::cout << "Options: \n";
+    std::cout << "  --size <n>             Phantom of n^3 voxels (default 256) \n";
+    std::cout << "  --dims <x,y,z>         Phantom of x*y*z voxels \n";
+    std::cout << "  --type <short|ushort|float> Voxel type (default short) \n";
+    std::cout << "  --noise <std>          Standard deviation of the noise (default 50) \n";
+    std::cout << "  --seed <n>             Seed of the noise (default 42) \n";
+    std::cout << "  --threads <n>          Largest thread count, the sweep doubles from 1 (default: all cores) \n";
+    std::cout << "  --repeats <n>          Runs per stage and thread count (default 3) \n";
+    std::cout << "  --lower <value>        Lower threshold (default 500) \n";
+    std::cout << "  --upper <value>        Upper threshold (default 2000) \n";
+    std::cout << "  --filter <name[:k=v,...]> Filter to benchmark (repeatable, default: gaussian and median) \n";
+    std::cout << "  --output <file>        Results, .csv or .json (default vtkMetricsBench.csv) \n";
+    std::cout << "  --baseline <file.csv>  Compare with the results of an earlier run \n";
+    std::cout << "  --tolerance <percent>  Slowdown that fails the comparison (default 10) \n";
+    std::cout << "  --scratch <dir>        Directory for the phantom file of the load stage (default .) \n";
+}
+
+static bool parseArguments( int argc, char* argv[], BenchOptions& options )
+{
+    options.dims[0] = options.dims[1] = options.dims[2] = 256;
+    options.type       = "short";
+    options.noise      = 50.0;
+    options.seed       = 42;
+    options.maxThreads = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+    options.repeats    = 3;
+    options.lower      = 500.0;
+    options.upper      = 2000.0;
+    options.output     = "vtkMetricsBench.csv";
+    options.tolerance  = 10.0;
+    options.scratch    = ".";
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        std::string arg = argv[i];
+        bool hasValue   = ( i + 1 < argc );
+        std::string value = hasValue ? argv[i + 1] : "";
+
+        if ( arg == "--help" || arg == "-h" )
+        {
+            return false;
+        }
+        else if ( arg == "--size" && hasValue )
+        {
+            options.dims[0] = options.dims[1] = options.dims[2] = atoi( argv[++i] );
+        }
+        else if ( arg == "--dims" && hasValue )
+        {
+            char separator1 = 0, separator2 = 0;
+            std::istringstream fields( argv[++i] );
+            fields >> options.dims[0] >> separator1 >> options.dims[1] >> separator2 >> options.dims[2];
+
+            if ( !fields || separator1 != ',' || separator2 != ',' )
+            {
+                std::cout << "ERROR: --dims expects x,y,z, got \"" << value << "\". \n";
+                return false;
+            }
+        }
+        else if ( arg == "--type" && hasValue )
+        {
+            options.type = argv[++i];
+        }
+        else if ( arg == "--noise" && hasValue )
+        {
+            options.noise = atof( argv[++i] );
+        }
+        else if ( arg == "--seed" && hasValue )
+        {
+            options.seed = static_cast<unsigned int>( atol( argv[++i] ) );
+        }
+        else if ( arg == "--threads" && hasValue )
+        {
+            options.maxThreads = atoi( argv[++i] );
+        }
+        else if ( arg == "--repeats" && hasValue )
+        {
+            options.repeats = atoi( argv[++i] );
+        }
+        else if ( arg == "--lower" && hasValue )
+        {
+            options.lower = atof( argv[++i] );
+        }
+        else if ( arg == "--upper" && hasValue )
+        {
+            options.upper = atof( argv[++i] );
+        }
+        else if ( arg == "--filter" && hasValue )
+        {
+            FilterSpec spec;
+            if ( !FilterBank::parseSpec( argv[++i], spec ) )
+            {
+                return false;
+            }
+            options.filters.push_back( spec );
+        }
+        else if ( arg == "--output" && hasValue )
+        {
+            options.output = argv[++i];
+        }
+        else if ( arg == "--baseline" && hasValue )
+        {
+            options.baseline = argv[++i];
+        }
+        else if ( arg == "--tolerance" && hasValue )
+        {
+            options.tolerance = atof( argv[++i] );
+        }
+        else if ( arg == "--scratch" && hasValue )
+        {
+            options.scratch = argv[++i];
+        }
+        else
+        {
+            std::cout << "ERROR: Unknown or incomplete option " << arg << "\n";
+            return false;
+        }
+    }
+
+    if ( options.dims[0] <= 0 || options.dims[1] <= 0 || options.dims[2] <= 0 || options.maxThreads <= 0 ||
+         options.repeats <= 0 || options.noise < 0.0 )
+    {
+        std::cout << "ERROR: The size, threads and repeats must be positive and the noise not negative. \n";
+        return false;
+    }
+
+    if ( options.type != "short" && options.type != "ushort" && options.type != "float" )
+    {
+        std::cout << "ERROR: --type expects short, ushort or float. \n";
+        return false;
+    }
+
+    // The filters of the viewer by default
+    if ( options.filters.empty() )
+    {
+        FilterSpec gaussian, median;
+        FilterBank::parseSpec( "gaussian", gaussian );
+        FilterBank::parseSpec( "median:kernel=5", median );
+        options.filters.push_back( gaussian );
+        options.filters.push_back( median );
+    }
+    FilterBank::complete( options.filters );
+
+    return true;
+}
+
+/*
+*   CT-like phantom: a sphere of soft tissue (1040) with a sphere of bone (1800)
+*   at its centre, in air (24), with Gaussian noise.
+*/
+template <class T>
+static vtkSmartPointer<vtkImageData> createPhantom( const BenchOptions& options, int scalarType )
+{
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions( options.dims );
+    image->AllocateScalars( scalarType, 1 );
+
+    std::mt19937 generator( options.seed );
+    std::normal_distribution<double> noise( 0.0, options.noise );
+
+    int minDim   = std::min( options.dims[0], std::min( options.dims[1], options.dims[2] ) );
+    double outer = 0.4 * minDim, inner = 0.15 * minDim;
+    double centre[3] = { 0.5 * options.dims[0], 0.5 * options.dims[1], 0.5 * options.dims[2] };
+
+    T* data = static_cast<T*>( image->GetScalarPointer() );
+    for ( int z = 0; z < options.dims[2]; z++ )
+    {
+        for ( int y = 0; y < options.dims[1]; y++ )
+        {
+            for ( int x = 0; x < options.dims[0]; x++ )
+            {
+                double dx = x - centre[0], dy = y - centre[1], dz = z - centre[2];
+                double radius = std::sqrt( dx * dx + dy * dy + dz * dz );
+                double value  = ( radius < inner ? 1800.0 : radius < outer ? 1040.0 : 24.0 ) + noise( generator );
+
+                *data++ = static_cast<T>( std::numeric_limits<T>::is_signed ? value : std::max( 0.0, value ) );
+            }
+        }
+    }
+
+    return image;
+}
+
+static std::string compilerName()
+{
+    std::ostringstream name;
+#if defined( __clang__ )
+    name << "clang " << __clang_major__ << "." << __clang_minor__ << "." << __clang_patchlevel__;
+#elif defined( __GNUC__ )
+    name << "gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "." << __GNUC_PATCHLEVEL__;
+#elif defined( _MSC_VER )
+    name << "msvc " << _MSC_VER;
+#else
+    name << "unknown";
+#endif
+    return name.str();
+}
+
+static std::string buildType()
+{
+#ifdef NDEBUG
+    return "release";
+#else
+    return "debug";
+#endif
+}
+
+/*
+*   Run a stage several times and record its fastest and median time.
+*
+*   @param   stage     The stage name
+*   @param   threads   The thread count of the runs
+*   @param   voxels    Voxels processed per run
+*   @param   repeats   Number of runs
+*   @param   work      One run of the stage
+*   @param   results   Receives the timing
+*/
+static void timeStage( const std::string& stage, int threads, double voxels, int repeats,
+                       const std::function<void()>& work, std::vector<StageResult>& results )
+{
+    std::vector<double> seconds;
+
+    for ( int r = 0; r < repeats; r++ )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        work();
+        seconds.push_back( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+    }
+
+    std::sort( seconds.begin(), seconds.end() );
+
+    StageResult result;
+    result.stage          = stage;
+    result.threads        = threads;
+    result.smpThreads     = vtkSMPTools::GetEstimatedNumberOfThreads();
+    result.voxels         = voxels;
+    result.secondsMin     = seconds.front();
+    result.secondsMedian  = seconds[seconds.size() / 2];
+    result.speedup        = 1.0;
+    result.residentMB     = getResidentMemoryMB();
+    result.peakResidentMB = getPeakResidentMemoryMB();
+
+    for ( std::size_t i = 0; i < results.size(); i++ )
+    {
+        if ( results[i].stage == stage && results[i].threads == 1 )
+        {
+            result.speedup = results[i].secondsMin / result.secondsMin;
+        }
+    }
+
+    results.push_back( result );
+
+    std::cout << std::left << std::setw( 22 ) << stage << std::right << std::setw( 8 ) << threads
+              << std::fixed << std::setprecision( 4 ) << std::setw( 12 ) << result.secondsMin
+              << std::setw( 12 ) << result.secondsMedian << std::setprecision( 1 )
+              << std::setw( 12 ) << voxels / result.secondsMin / 1.0e6 << std::setprecision( 2 )
+              << std::setw( 10 ) << result.speedup << std::setprecision( 0 )
+              << std::setw( 12 ) << result.peakResidentMB << "\n";
+}
+
+/*
+*   Run every stage of the vtkMetrics pipeline with a number of threads.
+*
+*   @returns a boolean representing whether the phantom could be read
+*/
+static bool runStages( const BenchOptions& options, const std::string& phantomFile, int threads,
+                       std::vector<StageResult>& results )
+{
+    // vtkSMPTools code (SNR, histograms, pyramid) follows the scheduler, VTK threaded filters their own setting
+    vtkSMPTools::Initialize( threads );
+
+    int filterCount = static_cast<int>( options.filters.size() );
+    vtkSmartPointer<vtkImageData> volume;
+
+    // Loading: the NIfTI reader of the viewer. A mapped file is only read when its pages are touched,
+    // so the range of the voxels is computed too, or the stage would only time the header and mmap().
+    timeStage( "load", threads, double( options.dims[0] ) * options.dims[1] * options.dims[2], options.repeats, [&]()
+    {
+        MetricsCore core;
+        core.load( phantomFile );
+        volume = core.getInput();
+
+        double range[2];
+        if ( volume && volume->GetPointData()->GetScalars() )
+        {
+            volume->GetPointData()->GetScalars()->GetRange( range, 0 );
+        }
+    }, results );
+
+    if ( !volume )
+    {
+        std::cout << "ERROR: Cannot read the phantom " << phantomFile << "\n";
+        return false;
+    }
+
+    double voxels = static_cast<double>( volume->GetNumberOfPoints() );
+
+    timeStage( "pyramid", threads, voxels, options.repeats, [&]()
+    {
+        ImagePyramid pyramid;
+        pyramid.build( volume, 3 );
+    }, results );
+
+    // Each filter alone with all the threads
+    std::vector< vtkSmartPointer<vtkImageData> > filtered( filterCount );
+    for ( int i = 0; i < filterCount; i++ )
+    {
+        timeStage( "filter:" + options.filters[i].id, threads, voxels, options.repeats, [&]()
+        {
+            vtkSmartPointer<vtkImageAlgorithm> filter = FilterBank::createFilter( options.filters[i] );
+            filter->SetInputData( volume );
+            FilterBank::setNumberOfThreads( filter, threads );
+            filter->Update();
+
+            filtered[i] = vtkSmartPointer<vtkImageData>::New();
+            filtered[i]->ShallowCopy( filter->GetOutput() );
+        }, results );
+    }
+
+    // All filters at the same time, as in the viewer
+    timeStage( "filters", threads, voxels * filterCount, options.repeats, [&]()
+    {
+        FilterBank bank( options.filters );
+        filtered = bank.run( volume, threads );
+    }, results );
+
+    std::vector<vtkImageData*> images( 1, volume );
+    images.insert( images.end(), filtered.begin(), filtered.end() );
+
+    timeStage( "snr", threads, voxels * images.size(), options.repeats, [&]()
+    {
+        SNRStatistics statistics;
+        statistics.setThresholds( options.lower, options.upper );
+        for ( std::size_t i = 0; i < images.size(); i++ )
+        {
+            statistics.compute( images[i] );
+        }
+    }, results );
+
+    timeStage( "histogram", threads, voxels * images.size(), options.repeats, [&]()
+    {
+        for ( std::size_t i = 0; i < images.size(); i++ )
+        {
+            IntensityHistogram histogram;
+            histogram.build( images[i] );
+        }
+    }, results );
+
+    // The global segmentation of the original image, as the bit mask of the viewer
+    BitMask mask;
+    mask.setGeometry( volume );
+    timeStage( "threshold", threads, voxels, options.repeats, [&]()
+    {
+        mask.threshold( volume, options.lower, options.upper );
+    }, results );
+
+    timeStage( "mask count", threads, voxels, options.repeats, [&]()
+    {
+        mask.count();
+    }, results );
+
+    return true;
+}
+
+static bool endsWith( const std::string& text, const std::string& suffix )
+{
+    return text.size() >= suffix.size() && text.compare( text.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+static bool writeResults( const BenchOptions& options, const std::vector<StageResult>& results )
+{
+    std::ofstream file( options.output.c_str() );
+    if ( !file )
+    {
+        std::cout << "ERROR: Cannot write the results to " << options.output << "\n";
+        return false;
+    }
+
+    file << std::setprecision( 10 );
+
+    if ( endsWith( vtksys::SystemTools::LowerCase( options.output ), ".json" ) )
+    {
+        file << "{\n  \"vtk_version\": \"" << vtkVersion::GetVTKVersion() << "\", \"compiler\": \"" << compilerName()
+             << "\", \"build\": \"" << buildType() << "\",\n  \"dims\": [" << options.dims[0] << ", " << options.dims[1]
+             << ", " << options.dims[2] << "], \"type\": \"" << options.type << "\", \"noise\": " << options.noise
+             << ", \"seed\": " << options.seed << ", \"repeats\": " << options.repeats << ",\n  \"results\": [";
+
+        for ( std::size_t i = 0; i < results.size(); i++ )
+        {
+            const StageResult& r = results[i];
+            file << ( i == 0 ? "\n" : ",\n" ) << "    { \"stage\": \"" << r.stage << "\", \"threads\": " << r.threads
+                 << ", \"smp_threads\": " << r.smpThreads << ", \"voxels\": " << r.voxels
+                 << ", \"seconds_min\": " << r.secondsMin << ", \"seconds_median\": " << r.secondsMedian
+                 << ", \"voxels_per_second\": " << r.voxels / r.secondsMin << ", \"speedup\": " << r.speedup
+                 << ", \"rss_mb\": " << r.residentMB << ", \"peak_rss_mb\": " << r.peakResidentMB << " }";
+        }
+
+        file << "\n  ]\n}\n";
+        return true;
+    }
+
+    // The settings go in comment lines, so the rows stay a plain table
+    file << "# vtk_version=" << vtkVersion::GetVTKVersion() << " compiler=" << compilerName() << " build=" << buildType()
+         << " dims=" << options.dims[0] << "x" << options.dims[1] << "x" << options.dims[2] << " type=" << options.type
+         << " noise=" << options.noise << " seed=" << options.seed << " repeats=" << options.repeats << "\n";
+    file << "stage,threads,smp_threads,voxels,seconds_min,seconds_median,voxels_per_second,speedup,rss_mb,peak_rss_mb\n";
+
+    for ( std::size_t i = 0; i < results.size(); i++ )
+    {
+        const StageResult& r = results[i];
+        file << r.stage << "," << r.threads << "," << r.smpThreads << "," << r.voxels << "," << r.secondsMin << ","
+             << r.secondsMedian << "," << r.voxels / r.secondsMin << "," << r.speedup << "," << r.residentMB << ","
+             << r.peakResidentMB << "\n";
+    }
+
+    return true;
+}
+
+/*
+*   Compare the fastest times with a CSV file of an earlier run.
+*
+*   @returns false if a stage is slower than the baseline by more than the tolerance
+*/
+static bool compareWithBaseline( const BenchOptions& options, const std::vector<StageResult>& results )
+{
+    std::ifstream file( options.baseline.c_str() );
+    if ( !file )
+    {
+        std::cout << "ERROR: Cannot open the baseline " << options.baseline << "\n";
+        return false;
+    }
+
+    // (stage, threads) -> fastest time
+    std::map< std::pair<std::string, int>, double > baseline;
+    std::string line;
+
+    while ( std::getline( file, line ) )
+    {
+        if ( line.empty() || line[0] == '#' || line.compare( 0, 6, "stage," ) == 0 )
+        {
+            continue;
+        }
+
+        std::istringstream fields( line );
+        std::string stage, threads, smpThreads, voxels, secondsMin;
+        std::getline( fields, stage, ',' );
+        std::getline( fields, threads, ',' );
+        std::getline( fields, smpThreads, ',' );
+        std::getline( fields, voxels, ',' );
+        std::getline( fields, secondsMin, ',' );
+
+        baseline[std::make_pair( stage, atoi( threads.c_str() ) )] = atof( secondsMin.c_str() );
+    }
+
+    std::cout << "\nComparison with " << options.baseline << " (fastest times): \n";
+    std::cout << std::left << std::setw( 22 ) << "Stage" << std::right << std::setw( 8 ) << "Threads"
+              << std::setw( 12 ) << "Baseline" << std::setw( 12 ) << "Current" << std::setw( 10 ) << "Change" << "\n";
+
+    bool passed = true;
+
+    for ( std::size_t i = 0; i < results.size(); i++ )
+    {
+        const StageResult& r = results[i];
+        std::map< std::pair<std::string, int>, double >::const_iterator it =
+            baseline.find( std::make_pair( r.stage, r.threads ) );
+
+        if ( it == baseline.end() || it->second <= 0.0 )
+        {
+            continue;
+        }
+
+        double change = 100.0 * ( r.secondsMin / it->second - 1.0 );
+        bool slower   = change > options.tolerance;
+        passed = passed && !slower;
+
+        std::cout << std::left << std::setw( 22 ) << r.stage << std::right << std::setw( 8 ) << r.threads
+                  << std::fixed << std::setprecision( 4 ) << std::setw( 12 ) << it->second << std::setw( 12 )
+                  << r.secondsMin << std::setprecision( 1 ) << std::setw( 9 ) << change << "%"
+                  << ( slower ? "  SLOWER" : "" ) << "\n";
+    }
+
+    return passed;
+}
+
+int main( int argc, char* argv[] )
+{
+    BenchOptions options;
+    if ( !parseArguments( argc, argv, options ) )
+    {
+        printUsage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    vtkSmartPointer<vtkImageData> phantom;
+    if ( options.type == "short" )
+    {
+        phantom = createPhantom<short>( options, VTK_SHORT );
+    }
+    else if ( options.type == "ushort" )
+    {
+        phantom = createPhantom<unsigned short>( options, VTK_UNSIGNED_SHORT );
+    }
+    else
+    {
+        phantom = createPhantom<float>( options, VTK_FLOAT );
+    }
+
+    // The load stage reads the phantom back like the viewer reads a study
+    std::string phantomFile = options.scratch + "/vtkMetricsBench_phantom.nii";
+
+    vtkSmartPointer<vtkNIFTIImageWriter> writer = vtkSmartPointer<vtkNIFTIImageWriter>::New();
+    writer->SetFileName( phantomFile.c_str() );
+    writer->SetInputData( phantom );
+    writer->Write();
+    phantom = nullptr;
+
+    if ( !vtksys::SystemTools::FileExists( phantomFile ) )
+    {
+        std::cout << "ERROR: Cannot write the phantom to " << phantomFile << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // The phantom was just written, so the load stage reads it from the page cache, not the disk
+    vtkSmartPointer<myNIFTIImageReader> methodReader = vtkSmartPointer<myNIFTIImageReader>::New();
+    methodReader->SetFileName( phantomFile.c_str() );
+    methodReader->UpdateInformation();
+
+    std::cout << "VTK " << vtkVersion::GetVTKVersion() << ", " << compilerName() << " (" << buildType() << "), "
+              << options.dims[0] << "x" << options.dims[1] << "x" << options.dims[2] << " " << options.type
+              << " phantom, noise " << options.noise << ", best of " << options.repeats << " \n";
+    std::cout << "Load: " << methodReader->GetReadMethod() << " from the page cache, every voxel touched \n\n";
+    std::cout << std::left << std::setw( 22 ) << "Stage" << std::right << std::setw( 8 ) << "Threads"
+              << std::setw( 12 ) << "Min (s)" << std::setw( 12 ) << "Median (s)" << std::setw( 12 ) << "Mvoxels/s"
+              << std::setw( 10 ) << "Speedup" << std::setw( 12 ) << "Peak MB" << "\n";
+
+    // 1, 2, 4, ... and the largest count
+    std::vector<StageResult> results;
+    for ( int threads = 1; ; threads *= 2 )
+    {
+        threads = std::min( threads, options.maxThreads );
+        if ( !runStages( options, phantomFile, threads, results ) )
+        {
+            vtksys::SystemTools::RemoveFile( phantomFile );
+            return EXIT_FAILURE;
+        }
+
+        if ( threads == options.maxThreads )
+        {
+            break;
+        }
+    }
+
+    vtksys::SystemTools::RemoveFile( phantomFile );
+
+    if ( !writeResults( options, results ) )
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "\nSaved the results to " << options.output << " \n";
+
+    if ( !options.baseline.empty() && !compareWithBaseline( options, results ) )
+    {
+        std::cout << "At least one stage is more than " << options.tolerance << "% slower than the baseline. \n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}